@@ -15,6 +15,7 @@ Release:UI_DIR = release/.ui
 SOURCES += \
     src/cursor.cpp\
     src/engine.cpp\
+    src/enginecore.cpp\
     src/arpscreen.cpp\
     src/lfoscreen.cpp\
     src/seqscreen.cpp\
@@ -22,30 +23,41 @@ SOURCES += \
     src/lfowidget.cpp\
     src/seqwidget.cpp\
     src/groovewidget.cpp\
+    src/headlessengine.cpp\
     src/mainwindow.cpp\
     src/globstore.cpp\
     src/indicator.cpp\
     src/modulewidget.cpp\
+    src/modulecore.cpp\
     src/logwidget.cpp\
     src/main.cpp\
     src/midiworker.cpp\
     src/midiarp.cpp\
+    src/midicapture.cpp\
     src/midilfo.cpp \
     src/midiseq.cpp \
     src/midicctable.cpp\
     src/midicontrol.cpp\
+    src/nulldriver.cpp\
+    src/offlinedriver.cpp\
+    src/parlist.cpp\
     src/parstore.cpp\
     src/prefs.cpp\
     src/prefswidget.cpp\
     src/jackdriver.cpp\
+    src/routingtable.cpp\
     src/screen.cpp\
     src/seqdriver.cpp\
     src/slider.cpp\
+    src/smffile.cpp\
+    src/statswidget.cpp\
     src/storagebutton.cpp
 
 HEADERS += \
+    src/compactwave.h\
     src/cursor.h\
     src/engine.h\
+    src/enginecore.h\
     src/arpscreen.h\
     src/lfoscreen.h\
     src/seqscreen.h\
@@ -53,29 +65,45 @@ HEADERS += \
     src/lfowidget.h\
     src/seqwidget.h\
     src/groovewidget.h\
+    src/headlessengine.h\
     src/mainwindow.h\
     src/globstore.h\
     src/indicator.h\
     src/modulewidget.h\
+    src/modulecore.h\
     src/logwidget.h\
     src/main.h\
     src/midiworker.h\
     src/midiarp.h\
+    src/midicapture.h\
+    src/noteset.h\
     src/midilfo.h \
     src/midiseq.h \
     src/midicctable.h\
     src/midicontrol.h\
+    src/nulldriver.h\
+    src/offlinedriver.h\
+    src/parlist.h\
     src/parstore.h\
+    src/portbandwidth.h\
     src/prefs.h\
+    src/prng.h\
     src/prefswidget.h\
     src/jackdriver.h\
+    src/lockfree.h\
+    src/routingtable.h\
+    src/rtstats.h\
     src/screen.h\
     src/seqdriver.h\
     src/slider.h\
+    src/smffile.h\
+    src/statswidget.h\
     src/storagebutton.h\
     src/midievent.h \
     src/nsm.h \
-    src/driverbase.h
+    src/driverbase.h \
+    src/tickqueue.h \
+    src/timebase.h
 
 TRANSLATIONS += \
         src/translations/qmidiarp_cs.ts \
@@ -38,28 +38,25 @@ ArpScreen::ArpScreen(QWidget* parent) : Screen (parent)
     patternMaxIndex = 0;
 }
 
-// Paint event handler.
-void ArpScreen::paintEvent(QPaintEvent*)
+// Draws grid, labels and pattern into the cached pixmap
+void ArpScreen::drawStatic(QPainter *p)
 {
-    QPainter p(this);
     QPen pen;
     pen.setWidth(1);
-    p.setFont(QFont("Helvetica", 8));
-    p.setPen(pen);
+    p->setFont(QFont("Helvetica", 8));
+    p->setPen(pen);
 
-    int w = QWidget::width();
-    int h = QWidget::height();
     int notestreak_thick = 2;
 
     //Green Filled Frame
     if (isMuted)
-        p.fillRect(0, 0, w, h, QColor(70, 70, 70));
+        p->fillRect(0, 0, w, h, QColor(70, 70, 70));
     else
-        p.fillRect(0, 0, w, h, QColor(10, 50, 10));
+        p->fillRect(0, 0, w, h, QColor(10, 50, 10));
 
-    p.setViewport(0, 0, w, h);
-    p.setWindow(0, 0, w, h);
-    p.setPen(QColor(20, 160, 20));
+    p->setViewport(0, 0, w, h);
+    p->setWindow(0, 0, w, h);
+    p->setPen(QColor(20, 160, 20));
 
     //Grid
     double len = nSteps;
@@ -75,26 +72,26 @@ void ArpScreen::paintEvent(QPaintEvent*)
             ofs = w / len * .5 - 6 + ARPSCR_HMARG;
         }
         if ((bool)(l1%4)) {
-            p.setPen(QColor(60, 180, 60));
+            p->setPen(QColor(60, 180, 60));
         } else {
-            p.setPen(QColor(60, 180, 150));
+            p->setPen(QColor(60, 180, 150));
         }
         int x = l1 * xscale;
-        p.drawLine(ARPSCR_HMARG + x, ARPSCR_VMARG,
+        p->drawLine(ARPSCR_HMARG + x, ARPSCR_VMARG,
                 ARPSCR_HMARG + x, h-ARPSCR_VMARG);
 
         if (l1 < nSteps) {
 
             //Beat numbers
-            p.drawText(ofs + x, ARPSCR_VMARG, QString::number(l1+1));
+            p->drawText(ofs + x, ARPSCR_VMARG, QString::number(l1+1));
 
             // Beat divisor separators
-            p.setPen(QColor(40, 100, 40));
+            p->setPen(QColor(40, 100, 40));
 
             for (int l2 = 1; l2 < 1.0/minStepWidth; l2++) {
                 int x1 = x + l2 * xscale * minStepWidth;
                 if (x1 < xscale*len)
-                    p.drawLine(ARPSCR_HMARG + x1,
+                    p->drawLine(ARPSCR_HMARG + x1,
                             ARPSCR_VMARG, ARPSCR_HMARG + x1,
                             h - ARPSCR_VMARG);
             }
@@ -102,12 +99,12 @@ void ArpScreen::paintEvent(QPaintEvent*)
     }
 
     //Octave separators and numbers
-    p.setPen(QColor(40, 120, 40));
+    p->setPen(QColor(40, 120, 40));
     int noctaves = maxOctave - minOctave + 1;
     for (int l1 = 0; l1 < noctaves + 1; l1++) {
         int ypos = yscale * l1 / noctaves + ARPSCR_VMARG;
-        p.drawLine(ARPSCR_HMARG, ypos, w - ARPSCR_HMARG, ypos);
-        p.drawText(ARPSCR_HMARG / 2 - 3,
+        p->drawLine(ARPSCR_HMARG, ypos, w - ARPSCR_HMARG, ypos);
+        p->drawText(ARPSCR_HMARG / 2 - 3,
                 yscale * (l1 + 0.5) / noctaves + ARPSCR_VMARG + 4,
                 QString::number(noctaves - l1 + minOctave - 1));
     }
@@ -125,7 +122,10 @@ void ArpScreen::paintEvent(QPaintEvent*)
     int grooveIndex = 0;
     int polyindex = 0;
     int nlines = 0;
-    
+
+    cursorLines.clear();
+    cursorColors.clear();
+
     for (int l1 = 0; l1 < pattern.length(); l1++)
     {
         int forward = 0;
@@ -244,22 +244,46 @@ void ArpScreen::paintEvent(QPaintEvent*)
                     pen.setColor(QColor(50 + 60 * v, 130 + 40 * v, abs(100 + 10 * semitone) % 256));
                 else
                     pen.setColor(QColor(80 + 60 * v, 160 + 40 * v, 80 + 60 * v));
-                p.setPen(pen);
-                p.drawLine(xpos, ypos, xpos + dx - pen.width(), ypos);
+                p->setPen(pen);
+                p->drawLine(xpos, ypos, xpos + dx - pen.width(), ypos);
             }
-            // Cursor
-            if (grooveIndex == currentIndex) {
-                int ypos = h - 2;
-                pen.setWidth(notestreak_thick * 2);
-                p.setPen(pen);
-                p.drawLine(xpos, ypos, xpos + dx - pen.width(), ypos);
+            // Cursor position of this step, drawn by drawDynamic()
+            if (grooveIndex >= cursorLines.count()) {
+                cursorLines.resize(grooveIndex + 1);
+                cursorColors.resize(grooveIndex + 1);
             }
+            cursorLines[grooveIndex] = QLine(xpos, h - 2,
+                    xpos + dx - ARPSCR_CSR_THICK, h - 2);
+            cursorColors[grooveIndex] = pen.color();
             pen.setWidth(1);
         }
         grooveIndex+=forward;
     }
 }
 
+// Draws the cursor over the cached pixmap
+void ArpScreen::drawDynamic(QPainter *p)
+{
+    if ((currentIndex < 0) || (currentIndex >= cursorLines.count())) return;
+    if (cursorLines.at(currentIndex).isNull()) return;
+
+    QPen pen(cursorColors.at(currentIndex));
+    pen.setWidth(ARPSCR_CSR_THICK);
+    p->setPen(pen);
+    p->drawLine(cursorLines.at(currentIndex));
+}
+
+QRect ArpScreen::cursorRect(int index) const
+{
+    if ((index < 0) || (index >= cursorLines.count())) return QRect();
+    if (cursorLines.at(index).isNull()) return QRect();
+
+    const QLine& line = cursorLines.at(index);
+    return QRect(line.p1(), line.p2()).normalized().adjusted(
+            -ARPSCR_CSR_THICK, -ARPSCR_CSR_THICK,
+            ARPSCR_CSR_THICK, ARPSCR_CSR_THICK);
+}
+
 void ArpScreen::updateData(const QString& p_pattern, int p_minOctave,
                                 int p_maxOctave, double p_minStepWidth,
                                 double p_nSteps, int p_patternMaxIndex)
@@ -270,11 +294,13 @@ void ArpScreen::updateData(const QString& p_pattern, int p_minOctave,
     minOctave = p_minOctave;
     nSteps = p_nSteps;
     patternMaxIndex = p_patternMaxIndex;
-    needsRedraw = true;
+    invalidate();
 }
 
 void ArpScreen::updateCursor(int p_index)
 {
+    if (p_index == currentIndex) return;
+    dirtyRect |= cursorRect(currentIndex);
     currentIndex = p_index;
-    needsRedraw = true;
+    dirtyRect |= cursorRect(currentIndex);
 }
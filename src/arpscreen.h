@@ -24,12 +24,16 @@
 #ifndef ARPSCREEN_H
 #define ARPSCREEN_H
 
+#include <QColor>
+#include <QLine>
+#include <QVector>
 #include "screen.h"
 
 #define ARPSCR_MIN_W    250
 #define ARPSCR_MIN_H    120
 #define ARPSCR_VMARG    10
 #define ARPSCR_HMARG    16
+#define ARPSCR_CSR_THICK 4
 
 
 /*! @brief Drawing widget for visualization of arp patterns using QPainter
@@ -40,7 +44,9 @@
  * by calling ArpScreen::updateData() with the pattern text string as
  * and argument. A cursor is placed at the corresponding pattern index
  * by calling ArpScreen::updateCursor() with the integer current pattern
- * index as an overloaded member.
+ * index as an overloaded member. Only the cursor is drawn over the
+ * cached pattern display, and a cursor move repaints the areas of the
+ * old and new cursor position.
  */
 class ArpScreen : public Screen
 {
@@ -53,11 +59,15 @@ class ArpScreen : public Screen
     double minStepWidth;
     double nSteps;
     int patternMaxIndex;
+    QVector<QLine> cursorLines;     /**< Cursor line of each step of the pattern */
+    QVector<QColor> cursorColors;   /**< Cursor color of each step of the pattern */
+    QRect cursorRect(int index) const;
     void emitMouseEvent(QMouseEvent *event, int pressed) 
         {(void)event; (void)pressed;};
     
   protected:
-    virtual void paintEvent(QPaintEvent *);
+    virtual void drawStatic(QPainter *p);
+    virtual void drawDynamic(QPainter *p);
 
   public:
     ArpScreen(QWidget* parent=0);
@@ -48,6 +48,9 @@ ArpWidget::ArpWidget(MidiArp *p_midiArp, GlobStore *p_globStore,
     midiArp(p_midiArp)
 {
     bool compactStyle = p_prefs->compactStyle;
+    arpCore = new ArpCore(p_midiArp, p_prefs, p_name, &patternPresets,
+            parStore, &midiControl->ccList);
+    moduleCore = arpCore;
 #else
 ArpWidget::ArpWidget():
     ModuleWidget("Arp:"),
@@ -288,119 +291,17 @@ MidiArp *ArpWidget::getMidiWorker()
 {
     return (midiArp);
 }
-
-void ArpWidget::writeData(QXmlStreamWriter& xml)
-{
-        writeCommonData(xml);
-
-        xml.writeStartElement("pattern");
-            xml.writeTextElement("pattern", QString::fromStdString(midiArp->pattern));
-            xml.writeTextElement("repeatMode", QString::number(
-                midiArp->repeatPatternThroughChord));
-            xml.writeTextElement("octaveMode", QString::number(
-                midiArp->octMode));
-            xml.writeTextElement("octaveLow", QString::number(
-                midiArp->octLow));
-            xml.writeTextElement("octaveHigh", QString::number(
-                midiArp->octHigh));
-            xml.writeTextElement("latchMode", QString::number(
-                latchModeAction->isChecked()));
-        xml.writeEndElement();
-
-        xml.writeStartElement("random");
-            xml.writeTextElement("tick", QString::number(
-                midiArp->randomTickAmp));
-            xml.writeTextElement("velocity", QString::number(
-                midiArp->randomVelocityAmp));
-            xml.writeTextElement("length", QString::number(
-                midiArp->randomLengthAmp));
-        xml.writeEndElement();
-
-        xml.writeStartElement("envelope");
-            xml.writeTextElement("attack", QString::number(
-                attackTime->value()));
-            xml.writeTextElement("release", QString::number(
-                releaseTime->value()));
-        xml.writeEndElement();
-
-
-    xml.writeEndElement();
-}
-
-void ArpWidget::readData(QXmlStreamReader& xml, const QString& qmaxVersion)
-{
-    (void)qmaxVersion;
-    
-    while (!xml.atEnd()) {
-        xml.readNext();
-        if (xml.isEndElement())
-            break;
-
-        readCommonData(xml);
-
-        if (xml.isStartElement() && (xml.name() == "pattern")) {
-            while (!xml.atEnd()) {
-                xml.readNext();
-                if (xml.isEndElement())
-                    break;
-                if (xml.name() == "pattern")
-                    patternText->setText(xml.readElementText());
-                else if (xml.name() == "repeatMode")
-                    repeatPatternThroughChord->setCurrentIndex(xml.readElementText().toInt());
-                else if (xml.name() == "octaveMode")
-                    octaveModeBox->setCurrentIndex(xml.readElementText().toInt());
-                else if (xml.name() == "octaveLow")
-                    octaveLowBox->setCurrentIndex(-xml.readElementText().toInt());
-                else if (xml.name() == "octaveHigh")
-                    octaveHighBox->setCurrentIndex(xml.readElementText().toInt());
-                else if (xml.name() == "latchMode")
-                    latchModeAction->setChecked(xml.readElementText().toInt());
-                else skipXmlElement(xml);
-            }
-        }
-
-        else if (xml.isStartElement() && (xml.name() == "random")) {
-            while (!xml.atEnd()) {
-                xml.readNext();
-                if (xml.isEndElement())
-                    break;
-                if (xml.name() == "tick")
-                    randomTick->setValue(xml.readElementText().toInt());
-                else if (xml.name() == "velocity")
-                    randomVelocity->setValue(xml.readElementText().toInt());
-                else if (xml.name() == "length")
-                    randomLength->setValue(xml.readElementText().toInt());
-                else skipXmlElement(xml);
-            }
-        }
-        else if (xml.isStartElement() && (xml.name() == "envelope")) {
-            while (!xml.atEnd()) {
-                xml.readNext();
-                if (xml.isEndElement())
-                    break;
-                if (xml.name() == "attack")
-                    attackTime->setValue(xml.readElementText().toInt());
-                else if (xml.name() == "release")
-                    releaseTime->setValue(xml.readElementText().toInt());
-                else skipXmlElement(xml);
-             }
-        }
-        else skipXmlElement(xml);
-    }
-
-    updateChIn(chIn->currentIndex());
-    updateChannelOut(channelOut->currentIndex());
-    updatePortOut(portOut->currentIndex());
-    midiArp->needsGUIUpdate = false;
-    modified = false;
-}
 #endif
 
 
 void ArpWidget::updateText(const QString& newtext)
 {
     patternPresetBox->setCurrentIndex(0);
+    patternPresetBoxIndex = 0;
     if (!midiArp) return;
+#ifdef APPBUILD
+    arpCore->presetIndex = 0;
+#endif
     textRemoveAction->setEnabled(false);
     textStoreAction->setEnabled(true);
     midiArp->updatePattern(newtext.toStdString());
@@ -419,6 +320,10 @@ void ArpWidget::selectPatternPreset(int val)
             patternText->setText(patternPresets.at(val));
             if (!midiArp) return;
             patternPresetBox->setCurrentIndex(val);
+            patternPresetBoxIndex = val;
+#ifdef APPBUILD
+            arpCore->presetIndex = val;
+#endif
             textStoreAction->setEnabled(false);
             textRemoveAction->setEnabled(true);
         }
@@ -573,6 +478,10 @@ void ArpWidget::updatePatternPresets(const QString& n, const QString& p, int ind
     if (index) {
        if (index == patternPresetBox->currentIndex()) {
             patternPresetBox->setCurrentIndex(0);
+            patternPresetBoxIndex = 0;
+#ifdef APPBUILD
+            arpCore->presetIndex = 0;
+#endif
             textRemoveAction->setEnabled(false);
         }
         patternNames.removeAt(index);
@@ -627,111 +536,61 @@ void ArpWidget::setLatchMode(bool on)
 
 #ifdef APPBUILD
 
-void ArpWidget::doStoreParams(int ix)
+void ArpWidget::updateScreen(bool newData)
 {
-    parStore->temp.attack = attackTime->value();
-    parStore->temp.release = releaseTime->value();
-    parStore->temp.rndTick = randomTick->value();
-    parStore->temp.rndLen = randomLength->value();
-    parStore->temp.rndVel = randomVelocity->value();
-    parStore->temp.pattern = patternText->text();
-    parStore->temp.repeatMode = repeatPatternThroughChord->currentIndex();
-    parStore->tempToList(ix);
+    (void)newData;
+    screen->updateDraw();
 }
 
-void ArpWidget::doRestoreParams(int ix)
+void ArpWidget::updateWidgets()
 {
-    midiArp->applyPendingParChanges();
-    if (parStore->list.at(ix).empty) return;
-    patternText->setText(parStore->list.at(ix).pattern);
-    repeatPatternThroughChord->setCurrentIndex(parStore->list.at(ix).repeatMode);
-    updateRepeatPattern(parStore->list.at(ix).repeatMode);
-    if (!parStore->onlyPatternList.at(ix)) {
-        attackTime->setValue(parStore->list.at(ix).attack);
-        releaseTime->setValue(parStore->list.at(ix).release);
-        randomTick->setValue(parStore->list.at(ix).rndTick);
-        randomLength->setValue(parStore->list.at(ix).rndLen);
-        randomVelocity->setValue(parStore->list.at(ix).rndVel);
-    }
-    midiArp->advancePatternIndex(true);
-}
+    ModuleWidget::updateWidgets();
 
-void ArpWidget::handleController(int ccnumber, int channel, int value)
-{
-    QVector<MidiCC> cclist= midiControl->ccList;
-
-    for (int l2 = 0; l2 < cclist.count(); l2++) {
-        int min = cclist.at(l2).min;
-        int max = cclist.at(l2).max;
-
-        if ((ccnumber == cclist.at(l2).ccnumber) &&
-            (channel == cclist.at(l2).channel)) {
-            int sval = 0;
-            switch (cclist.at(l2).ID) {
-                case MUTE_BUTTON: if (min == max) {
-                            if (value == max) {
-                                bool m = midiArp->isMuted;
-                                midiArp->setMuted(!m);
-                            }
-                        }
-                        else {
-                            if (value == max) {
-                                midiArp->setMuted(false);
-                            }
-                            if (value == min) {
-                                midiArp->setMuted(true);
-                            }
-                        }
-                break;
-                case ARP_PRESET_SWITCH:
-                        sval = min + ((double)value * (max - min) / 127);
-                        patternPresetBoxIndex = sval;
-                break;
-                case PARAM_RESTORE:
-                        sval = min + ((double)value * (max - min) / 127);
-                        if ((sval < parStore->list.count())
-                                && (sval != parStore->activeStore)
-                                && (sval != parStore->currentRequest)) {
-                            parStore->requestDispState(sval, 2);
-                            parStore->restoreRequest = sval;
-                            parStore->restoreRunOnce = (parStore->jumpToList.at(sval) > -2);
-                        }
-                        else return;
-                break;
-
-                default:
-                break;
-            }
-            needsGUIUpdate = true;
-        }
+    if (patternText->text() != QString::fromStdString(midiArp->pattern)) {
+        patternText->blockSignals(true);
+        patternText->setText(QString::fromStdString(midiArp->pattern));
+        patternText->blockSignals(false);
+        screen->updateData(patternText->text(), midiArp->minOctave,
+                    midiArp->maxOctave, midiArp->minStepWidth,
+                    midiArp->nSteps, midiArp->patternMaxIndex);
+    }
+    if (arpCore->presetIndex != patternPresetBoxIndex) {
+        patternPresetBoxIndex = arpCore->presetIndex;
+        patternPresetBox->setCurrentIndex(patternPresetBoxIndex);
+        textStoreAction->setEnabled(!patternPresetBoxIndex);
+        textRemoveAction->setEnabled(patternPresetBoxIndex > 0);
     }
-}
 
+    QComboBox *boxes[4] = { repeatPatternThroughChord, octaveModeBox,
+            octaveLowBox, octaveHighBox };
+    const int boxValues[4] = { midiArp->repeatPatternThroughChord,
+            midiArp->octMode, -midiArp->octLow, midiArp->octHigh };
+    for (int l1 = 0; l1 < 4; l1++) {
+        boxes[l1]->blockSignals(true);
+        boxes[l1]->setCurrentIndex(boxValues[l1]);
+        boxes[l1]->blockSignals(false);
+    }
 
-void ArpWidget::updateDisplay()
-{
-    bool repetitionsFinished = (midiArp->currentRepetition == 0);
-    parStore->updateDisplay(getFramePtr(), midiArp->nPoints, repetitionsFinished, false);
-    if (parStore->nRepList.count() > 0) {
-        if (parStore->nRepList.at(parStore->activeStore) != midiArp->nRepetitions) {
-            updateNRep(parStore->nRepList.at(parStore->activeStore));
-        }
+    Slider *sliders[5] = { randomTick, randomVelocity, randomLength,
+            attackTime, releaseTime };
+    const int sliderValues[5] = { midiArp->randomTickAmp,
+            midiArp->randomVelocityAmp, midiArp->randomLengthAmp,
+            (int)midiArp->attack_time, (int)midiArp->release_time };
+    for (int l1 = 0; l1 < 5; l1++) {
+        sliders[l1]->blockSignals(true);
+        sliders[l1]->setValue(sliderValues[l1]);
+        sliders[l1]->blockSignals(false);
     }
-    screen->updateDraw();
-    midiControl->update();
+    checkIfRandomSet();
+    checkIfEnvelopeSet();
 
-    if (!(needsGUIUpdate || midiArp->needsGUIUpdate)) return;
+    latchModeAction->blockSignals(true);
+    latchModeAction->setChecked(midiArp->latch_mode);
+    latchModeAction->blockSignals(false);
 
-    muteOut->setChecked(midiArp->isMuted);
     screen->newGrooveValues(midiArp->newGrooveTick, midiArp->grooveVelocity,
-                midiArp->grooveLength);    
+                midiArp->grooveLength);
     screen->setMuted(midiArp->isMuted);
-    parStore->ndc->setMuted(midiArp->isMuted);
-    if (patternPresetBoxIndex != patternPresetBox->currentIndex())
-        selectPatternPreset(patternPresetBoxIndex);
-
-    needsGUIUpdate = false;
-    midiArp->needsGUIUpdate = false;
 }
 
 #endif
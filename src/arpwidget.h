@@ -45,6 +45,9 @@ class ArpWidget :  public ModuleWidget
   Q_OBJECT
 
     MidiArp *midiArp;
+#ifdef APPBUILD
+    ArpCore *arpCore;   /**< ModuleWidget::moduleCore holding the preset switched by controller */
+#endif
 
     QGroupBox *randomBox, *envelopeBox;
     QToolButton *textEditButton, *textStoreButton, *textRemoveButton;
@@ -99,22 +102,6 @@ class ArpWidget :  public ModuleWidget
     };
 
 #ifdef APPBUILD
-    //these members are common to all modules
-/*!
-* @brief reads all parameters of this module from an XML stream
-* passed by the caller, i.e. MainWindow.
-*
-* @param xml QXmlStreamWriter to read from
-* @param qmaxVersion QString with xml format version
-*/
-    void readData(QXmlStreamReader& xml, const QString& qmaxVersion) override;
-/*!
-* @brief writes all parameters of this module to an XML stream
-* passed by the caller, i.e. MainWindow.
-*
-* @param xml QXmlStreamWriter to write to
-*/
-    void writeData(QXmlStreamWriter& xml) override;
 /*!
 * @brief returns the MidiArp instance associated with this GUI
 * Widget.
@@ -122,13 +109,11 @@ class ArpWidget :  public ModuleWidget
 */
     MidiArp *getMidiWorker();
 
-    void doStoreParams(int ix);
-    void doRestoreParams(int ix);
-    void updateDisplay();
-    void handleController(int ccnumber, int channel, int value);
+    void updateWidgets() override;
+    void updateScreen(bool newData) override;
 #endif
 
-    void updateCursorPos() { screen->updateCursor(midiArp->getFramePtr()); }
+    void updateCursorPos(int pos) { screen->updateCursor(pos); }
     
 /* SIGNALS */
   signals:
@@ -0,0 +1,431 @@
+/*!
+ * @file bench.cpp
+ * @brief Engine throughput benchmark, built by "make bench"
+ *
+ *      Runs the MidiWorkers and the EngineCore realtime dispatch, which
+ *      the GUI Engine shares, through a HeadlessEngine on a NullDriver
+ *      under synthetic loads and writes the timings as JSON, so that
+ *      they can be compared between releases.
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+#include <vector>
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+
+#include "headlessengine.h"
+#include "arpwidget.h"
+#include "lfowidget.h"
+#include "seqwidget.h"
+#include "main.h"
+
+/* referenced by JackDriver, defined in main.cpp for the application */
+QString global_jack_session_uuid = "";
+
+typedef std::chrono::steady_clock BenchClock;
+
+/*! @brief Load parameters of one engine run */
+struct BenchLoad {
+    int modules;        /**< Number of modules, arp, LFO and seq in turn */
+    int lfoRes;         /**< Resolution of the LFO modules */
+    int chordSize;      /**< Notes of each input chord */
+    int density;        /**< Input chords per beat, 0 for no input */
+    int ccCount;        /**< Controller bindings spread over the modules */
+};
+
+/*! @brief Input event at a tick */
+struct BenchInput {
+    uint64_t tick;
+    MidiEvent ev;
+};
+
+static struct option options[] = {
+    {"help", 0, 0, 'h'},
+    {"modules", 1, 0, 'm'},
+    {"lfo-res", 1, 0, 'r'},
+    {"chord", 1, 0, 'c'},
+    {"density", 1, 0, 'd'},
+    {"cc", 1, 0, 'C'},
+    {"beats", 1, 0, 'b'},
+    {"frames", 1, 0, 'f'},
+    {"repeat", 1, 0, 'n'},
+    {"output", 1, 0, 'o'},
+    {0, 0, 0, 0}
+};
+
+static volatile int frameSink; /**< Keeps the frame loops from being optimized away */
+
+static MidiEvent mkEvent(int type, int data, int value)
+{
+    MidiEvent ev;
+    ev.type = type;
+    ev.channel = 0;
+    ev.data = data;
+    ev.value = value;
+    return ev;
+}
+
+static int64_t elapsedNs(BenchClock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            BenchClock::now() - start).count();
+}
+
+static bool parseList(const char *arg, std::vector<int> *list, int min, int max)
+{
+    const QStringList values = QString(arg).split(',', QString::SkipEmptyParts);
+    list->clear();
+    for (int l1 = 0; l1 < values.count(); l1++) {
+        bool ok;
+        int val = values.at(l1).toInt(&ok);
+        if (!ok || (val < min) || (val > max)) {
+            qWarning("Invalid value %s, allowed are %d to %d",
+                    qPrintable(values.at(l1)), min, max);
+            return false;
+        }
+        list->push_back(val);
+    }
+    return !list->empty();
+}
+
+static bool isLfoRes(int res)
+{
+    for (unsigned int l1 = 0; l1 < sizeof(lfoResValues)/sizeof(lfoResValues[0]); l1++) {
+        if (lfoResValues[l1] == res) return true;
+    }
+    return false;
+}
+
+/*!
+* @brief calls getNextFrame() of a worker in a loop, each time at the
+* tick the worker requested
+*
+* @return Nanoseconds per call, the best of repeat runs
+*/
+static double frameBench(MidiWorker *worker, int calls, int repeat)
+{
+    int64_t best = -1;
+
+    for (int l2 = 0; l2 < repeat; l2++) {
+        worker->setNextTick(0);
+        int64_t tick = 0;
+        int sink = 0;
+        BenchClock::time_point start = BenchClock::now();
+        for (int l1 = 0; l1 < calls; l1++) {
+            worker->getNextFrame(tick);
+            sink += worker->outFrame[0].data;
+            tick = (worker->nextTick > tick) ? worker->nextTick : tick + 1;
+        }
+        const int64_t ns = elapsedNs(start);
+        frameSink = sink;
+        if ((best < 0) || (ns < best)) best = ns;
+    }
+    return (double)best / calls;
+}
+
+static void addBinding(ModuleCore *module, int ccnumber)
+{
+    MidiCC cc;
+    cc.ccnumber = ccnumber;
+    cc.channel = 0;
+    cc.min = 0;
+    cc.max = 127;
+    /* bindings that change a parameter without muting or restoring */
+    switch (module->midiWorker->moduleType) {
+        case MOD_ARP:
+            cc.ID = ArpWidget::ARP_PRESET_SWITCH;
+            cc.max = 0;
+        break;
+        case MOD_LFO:
+            cc.ID = LfoWidget::LFO_AMPLITUDE;
+        break;
+        default:
+            cc.ID = SeqWidget::SEQ_VELOCITY;
+        break;
+    }
+    module->ccList->append(cc);
+}
+
+/*!
+* @brief builds the input of an engine run
+*
+* Each chord is held for half of its interval and followed by a
+* controller event cycling through the bound controllers.
+*/
+static void makeInput(const BenchLoad& load, int beats,
+        std::vector<BenchInput> *input)
+{
+    input->clear();
+    if (!load.density) return;
+
+    const uint64_t interval = TPQN / load.density;
+    const uint64_t endTick = (uint64_t)beats * TPQN;
+    const int ccSpan = (load.ccCount < 128) ? load.ccCount : 128;
+    int ccIndex = 0;
+    BenchInput in;
+
+    for (uint64_t tick = 0; tick < endTick; tick += interval) {
+        for (int l1 = 0; l1 < load.chordSize; l1++) {
+            in.tick = tick;
+            in.ev = mkEvent(EV_NOTEON, 48 + l1 * 2, 100);
+            input->push_back(in);
+        }
+        for (int l1 = 0; l1 < load.chordSize; l1++) {
+            in.tick = tick + interval / 2;
+            in.ev = mkEvent(EV_NOTEOFF, 48 + l1 * 2, 0);
+            input->push_back(in);
+        }
+        if (ccSpan) {
+            in.tick = tick + interval / 2;
+            in.ev = mkEvent(EV_CONTROLLER, ccIndex, (ccIndex * 7) % 128);
+            input->push_back(in);
+            ccIndex = (ccIndex + 1) % ccSpan;
+        }
+    }
+}
+
+/*!
+* @brief runs a session with the given load on the NullDriver and
+* writes the timings of the realtime path as a JSON object
+*
+* The modules are ModuleCore objects as in a loaded session. Only the
+* calls into the driver are timed, the periodic HeadlessEngine::update()
+* between them runs EngineCore::update() and ModuleCore::update() as the
+* display timer of the GUI does.
+*/
+static void engineBench(FILE *out, const BenchLoad& load, int beats, int repeat)
+{
+    std::vector<BenchInput> input;
+    int64_t best = -1;
+    uint64_t sent = 0, received = 0, echoes = 0;
+    const uint64_t endTick = (uint64_t)beats * TPQN;
+    const uint64_t step = TPQN / 100;
+
+    makeInput(load, beats, &input);
+
+    for (int l3 = 0; l3 < repeat; l3++) {
+        HeadlessEngine engine(2, HeadlessEngine::BACKEND_NULL);
+        NullDriver *driver = (NullDriver *)engine.driver;
+        std::vector<ModuleCore *> modules;
+
+        for (int l1 = 0; l1 < load.modules; l1++) {
+            ModuleCore *module = engine.addModule(l1 % 3,
+                    QString("bench:%1").arg(l1));
+            if (module->midiWorker->moduleType == MOD_ARP) {
+                ((ArpCore *)module)->midiArp->updatePattern("0");
+            }
+            else if (module->midiWorker->moduleType == MOD_LFO) {
+                ((LfoCore *)module)->midiLfo->updateResolution(load.lfoRes);
+                module->updateWave();
+            }
+            modules.push_back(module);
+        }
+        for (int l1 = 0; l1 < load.ccCount; l1++) {
+            addBinding(modules[l1 % modules.size()], l1 % 128);
+        }
+        engine.initSession();
+        engine.setStatus(true);
+
+        unsigned int ix = 0;
+        int64_t ns = 0;
+        for (uint64_t tick = 0; tick < endTick; tick += step) {
+            const uint64_t stepEnd = (tick + step < endTick) ? tick + step : endTick;
+            BenchClock::time_point start = BenchClock::now();
+            while ((ix < input.size()) && (input[ix].tick < stepEnd)) {
+                driver->receive(input[ix].tick, input[ix].ev);
+                ix++;
+            }
+            driver->process(stepEnd);
+            ns += elapsedNs(start);
+            engine.update();
+        }
+        engine.setStatus(false);
+
+        if ((best < 0) || (ns < best)) best = ns;
+        sent = driver->sentEvents;
+        received = driver->receivedEvents;
+        echoes = driver->echoes;
+    }
+
+    const double seconds = best * 1e-9;
+    /* simulated time at the default tempo of 120 bpm */
+    const double simSeconds = beats * 0.5;
+    fprintf(out, "    {\"modules\": %d, \"lfo_res\": %d, \"chord\": %d, "
+            "\"density\": %d, \"cc\": %d, \"beats\": %d, "
+            "\"events_in\": %llu, \"events_out\": %llu, \"echoes\": %llu, "
+            "\"seconds\": %.6f, \"events_per_second\": %.0f, "
+            "\"ns_per_echo\": %.1f, \"realtime_factor\": %.1f}",
+            load.modules, load.lfoRes, load.chordSize, load.density,
+            load.ccCount, beats,
+            (unsigned long long)received, (unsigned long long)sent,
+            (unsigned long long)echoes, seconds,
+            (seconds > 0) ? (received + sent) / seconds : 0.,
+            echoes ? (double)best / echoes : 0.,
+            (seconds > 0) ? simSeconds / seconds : 0.);
+}
+
+static void usage()
+{
+    printf("Usage: qmidiarp-bench [OPTION]\n\n");
+    printf("Comma separated lists are run in all combinations.\n\n");
+    printf("Options:\n");
+    printf("  -h, --help               Print this message\n");
+    printf("  -m, --modules <list>     Modules per session, arp, LFO and seq in turn [1,12]\n");
+    printf("  -r, --lfo-res <list>     LFO resolution [16,192]\n");
+    printf("  -c, --chord <list>       Notes per input chord [1,8]\n");
+    printf("  -d, --density <list>     Input chords per beat [4]\n");
+    printf("  -C, --cc <list>          Controller bindings per session [0,256]\n");
+    printf("  -b, --beats <num>        Length of each session run [256]\n");
+    printf("  -f, --frames <num>       getNextFrame() calls per module [200000]\n");
+    printf("  -n, --repeat <num>       Runs of each measurement, the best is kept [3]\n");
+    printf("  -o, --output <file>      Write the JSON results to file [stdout]\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int getopt_return;
+    int option_index;
+    std::vector<int> moduleCounts = {1, 12};
+    std::vector<int> lfoRes = {16, 192};
+    std::vector<int> chordSizes = {1, 8};
+    std::vector<int> densities = {4};
+    std::vector<int> ccCounts = {0, 256};
+    int beats = 256;
+    int frames = 200000;
+    int repeat = 3;
+    const char *outName = NULL;
+    bool ok = true;
+
+    QCoreApplication app(argc, argv);
+
+    while ((getopt_return = getopt_long(argc, argv, "hm:r:c:d:C:b:f:n:o:", options,
+                    &option_index)) >= 0) {
+        switch(getopt_return) {
+            case 'h':
+                usage();
+                return EXIT_SUCCESS;
+            case 'm':
+                ok &= parseList(optarg, &moduleCounts, 1, 1024);
+                break;
+            case 'r':
+                ok &= parseList(optarg, &lfoRes, 1, 192);
+                break;
+            case 'c':
+                ok &= parseList(optarg, &chordSizes, 1, 32);
+                break;
+            case 'd':
+                ok &= parseList(optarg, &densities, 0, 96);
+                break;
+            case 'C':
+                ok &= parseList(optarg, &ccCounts, 0, 65536);
+                break;
+            case 'b':
+                beats = atoi(optarg);
+                break;
+            case 'f':
+                frames = atoi(optarg);
+                break;
+            case 'n':
+                repeat = atoi(optarg);
+                break;
+            case 'o':
+                outName = optarg;
+                break;
+            default:
+                usage();
+                return EXIT_FAILURE;
+        }
+    }
+    for (unsigned int l1 = 0; l1 < lfoRes.size(); l1++) {
+        if (!isLfoRes(lfoRes[l1])) {
+            qWarning("LFO resolution %d is not one of the GUI values", lfoRes[l1]);
+            ok = false;
+        }
+    }
+    if (!ok || (beats < 1) || (frames < 1) || (repeat < 1)) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    FILE *out = stdout;
+    if (outName && !(out = fopen(outName, "w"))) {
+        qWarning("Could not open %s for writing", outName);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "{\n  \"program\": \"qmidiarp-bench\",\n");
+    fprintf(out, "  \"version\": \"%s\",\n", PACKAGE_VERSION);
+    fprintf(out, "  \"tpqn\": %d,\n  \"repeat\": %d,\n", TPQN, repeat);
+
+    /* getNextFrame() of each worker type alone */
+    fprintf(out, "  \"frames\": [\n");
+    for (unsigned int l1 = 0; l1 < chordSizes.size(); l1++) {
+        MidiArp arp;
+        arp.updatePattern("0");
+        for (int l2 = 0; l2 < chordSizes[l1]; l2++) {
+            arp.handleEvent(mkEvent(EV_NOTEON, 48 + l2 * 2, 100), 0);
+        }
+        fprintf(out, "    {\"module\": \"arp\", \"chord\": %d, \"calls\": %d, "
+                "\"ns_per_frame\": %.1f},\n", chordSizes[l1], frames,
+                frameBench(&arp, frames, repeat));
+    }
+    for (unsigned int l1 = 0; l1 < lfoRes.size(); l1++) {
+        MidiLfo lfo;
+        std::vector<Sample> data;
+        lfo.updateResolution(lfoRes[l1]);
+        lfo.getData(&data);
+        fprintf(out, "    {\"module\": \"lfo\", \"res\": %d, \"calls\": %d, "
+                "\"ns_per_frame\": %.1f},\n", lfoRes[l1], frames,
+                frameBench(&lfo, frames, repeat));
+    }
+    MidiSeq seq;
+    fprintf(out, "    {\"module\": \"seq\", \"res\": %d, \"calls\": %d, "
+            "\"ns_per_frame\": %.1f}\n  ],\n", seq.res, frames,
+            frameBench(&seq, frames, repeat));
+
+    /* the full realtime path for each combination of loads */
+    fprintf(out, "  \"engine\": [\n");
+    bool first = true;
+    BenchLoad load;
+    for (unsigned int m = 0; m < moduleCounts.size(); m++)
+    for (unsigned int r = 0; r < lfoRes.size(); r++)
+    for (unsigned int c = 0; c < chordSizes.size(); c++)
+    for (unsigned int d = 0; d < densities.size(); d++)
+    for (unsigned int k = 0; k < ccCounts.size(); k++) {
+        load.modules = moduleCounts[m];
+        load.lfoRes = lfoRes[r];
+        load.chordSize = chordSizes[c];
+        load.density = densities[d];
+        load.ccCount = ccCounts[k];
+        if (!first) fprintf(out, ",\n");
+        first = false;
+        engineBench(out, load, beats, repeat);
+        fflush(out);
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout) fclose(out);
+    return EXIT_SUCCESS;
+}
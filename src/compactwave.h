@@ -0,0 +1,129 @@
+/*!
+ * @file compactwave.h
+ * @brief Implementation of the CompactWave class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#ifndef COMPACTWAVE_H
+#define COMPACTWAVE_H
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Drawn wave or note sequence stored with one byte per point
+ *
+ * Each point holds a 7-bit value, which is the controller value of an
+ * LFO wave or the note of a Seq sequence, and a mute flag kept in a
+ * separate bit set. The tick of a point is not stored, it follows from
+ * the point index and the resolution of the module.
+ *
+ * Copies share their points until one of them is modified, so that
+ * parameter storage locations and cloned modules holding the same wave
+ * cost no additional memory. A modification of a shared wave copies the
+ * points first, call detach() beforehand if this must not happen in the
+ * realtime thread.
+ */
+class CompactWave
+{
+public:
+    CompactWave(int count = 0) : d(std::make_shared<Data>())
+    {
+        resize(count);
+    }
+
+    int count() const { return d->values.size(); }
+
+    int value(int index) const { return d->values[index]; }
+
+    bool isMuted(int index) const
+    {
+        return (d->mutes[index >> 6] >> (index & 63)) & 1;
+    }
+
+    /** @brief Set the value of a point, clipped to 0 ... 127 */
+    void setValue(int index, int value)
+    {
+        detach();
+        d->values[index] = (value < 0) ? 0 : (value > 127) ? 127 : value;
+    }
+
+    void setMuted(int index, bool on)
+    {
+        detach();
+        const uint64_t bit = (uint64_t)1 << (index & 63);
+        if (on) d->mutes[index >> 6] |= bit;
+        else d->mutes[index >> 6] &= ~bit;
+    }
+
+    /**
+     * @brief Change the number of points
+     *
+     * Added points are set to value 0 and not muted.
+     */
+    void resize(int count)
+    {
+        if (count == this->count()) return;
+        detach();
+        const int old_count = this->count();
+        d->values.resize(count, 0);
+        d->mutes.resize((count + 63) / 64, 0);
+        /* clear stale mute bits beyond the previous end */
+        for (int l1 = old_count; (l1 < count) && (l1 & 63); l1++) {
+            d->mutes[l1 >> 6] &= ~((uint64_t)1 << (l1 & 63));
+        }
+    }
+
+    /**
+     * @brief Overwrite the first other.count() points with the points
+     * of other
+     *
+     * If both waves have the same size, the points are shared instead.
+     */
+    void copyFrom(const CompactWave &other)
+    {
+        if (other.count() == count()) {
+            d = other.d;
+            return;
+        }
+        const int n = (other.count() < count()) ? other.count() : count();
+        for (int l1 = 0; l1 < n; l1++) {
+            setValue(l1, other.value(l1));
+            setMuted(l1, other.isMuted(l1));
+        }
+    }
+
+    /** @brief Make sure the points are not shared with another wave */
+    void detach()
+    {
+        if (d.use_count() > 1) d = std::make_shared<Data>(*d);
+    }
+
+private:
+    struct Data {
+        std::vector<uint8_t> values;
+        std::vector<uint64_t> mutes;
+    };
+    std::shared_ptr<Data> d;
+};
+
+#endif
@@ -37,6 +37,7 @@ Cursor::Cursor(QChar modtype)
     nPoints = 16;
     nSteps = 4;
     setMinimumHeight(CSR_MIN_H);
+    setAttribute(Qt::WA_OpaquePaintEvent);
     needsRedraw = false;
 }
 
@@ -45,7 +46,7 @@ Cursor::~Cursor()
 }
 
 // Paint event handler.
-void Cursor::paintEvent(QPaintEvent*)
+void Cursor::paintEvent(QPaintEvent *event)
 {
     QPainter p(this);
     QColor bg, fg;
@@ -66,7 +67,7 @@ void Cursor::paintEvent(QPaintEvent*)
         fg = QColor(50, 180, 220);
     }
 
-    p.fillRect(0, 0, w, h, bg);
+    p.fillRect(event->rect(), bg);
 
     xscale = (w - 2 * CSR_HMARG);
 
@@ -90,15 +91,29 @@ void Cursor::updateNumbers(int res, int size)
 
 void Cursor::updatePosition(int p_index)
 {
+    if (p_index == currentIndex) return;
+    dirtyRect |= streakRect(currentIndex);
     currentIndex = p_index;
-    needsRedraw = true;
+    dirtyRect |= streakRect(currentIndex);
 }
 
 void Cursor::updateDraw()
 {
-    if (!needsRedraw) return;
+    if (needsRedraw)
+        update();
+    else if (!dirtyRect.isEmpty())
+        update(dirtyRect);
     needsRedraw = false;
-    update();
+    dirtyRect = QRect();
+}
+
+QRect Cursor::streakRect(int index) const
+{
+    const int xscale = QWidget::width() - 2 * CSR_HMARG;
+    const int x = CSR_HMARG + index * xscale / nPoints;
+
+    /* the streak is drawn with a square cap of half its thickness */
+    return QRect(x - 4, 0, xscale / nPoints + 8, QWidget::height());
 }
 
 QSize Cursor::sizeHint() const
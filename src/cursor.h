@@ -27,6 +27,8 @@
 #include <QWidget>
 #include <QSizePolicy>
 #include <QSize>
+#include <QRect>
+#include <QPaintEvent>
 
 #define CSR_MIN_W   250
 #define CSR_MIN_H     6
@@ -40,7 +42,8 @@
  * produces a streak whose location is a function of module resolution,
  * size transferred through the Cursor::updateNumbers()
  * and and frame position transferred by Cursor::updatePosition(). The
- * drawing update is done by Cursor::updateDraw().
+ * drawing update is done by Cursor::updateDraw(), which only repaints
+ * the old and new streak area after a position change.
  */
 class Cursor : public QWidget
 {
@@ -51,6 +54,7 @@ class Cursor : public QWidget
     QChar modType;
     int nPoints, nSteps;
     bool needsRedraw;
+    QRect streakRect(int index) const;
 
   protected:
     virtual void paintEvent(QPaintEvent *);
@@ -59,6 +63,7 @@ class Cursor : public QWidget
     Cursor(QChar modtype = 'L');
     ~Cursor();
     int currentIndex;
+    QRect dirtyRect;    /**< Area repainted by updateDraw() if no full repaint is requested */
     virtual QSize sizeHint() const;
     virtual QSizePolicy sizePolicy() const;
 
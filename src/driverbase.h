@@ -27,11 +27,27 @@
 #define DRIVERBASE_H__9383DA6E_DCDB_4840_86DA_6A36E87653D2__INCLUDED
 
 #include <QThread>
+#include "timebase.h"
+#include "midicapture.h"
+#include "portbandwidth.h"
+#include "rtstats.h"
+
 /*! @brief Base class for the JackDriver and SeqDriver backends
  *
  * Defines some useful functions and member variables common to both
  * backends. DriverBase derives from QThread, only because it is a base
- * class for SeqDriver, which implements a thread.
+ * class for SeqDriver, which implements a thread. The conversion between
+ * ticks and backend time is done by the DriverBase::timeBase member.
+ *
+ * Output ports can be flagged as DIN MIDI ports with
+ * setPortBandwidthLimited(). The backends then pass the events of these
+ * ports through a PortBandwidth model, and events due at the same tick
+ * are sent in the order of their outputPriority().
+ *
+ * The backends record the timing of their realtime path in
+ * DriverBase::rtStats. All events received, sent by sendMidiEvent(),
+ * forwarded as unmatched or sent by the transport itself are recorded
+ * to DriverBase::capture while a capture is running.
  */
 
 class DriverBase : public QThread
@@ -46,6 +62,8 @@ public:
     QString jsFilename;
     uint64_t trStartingTick;
     uint64_t trLoopingTick;
+    RtStats rtStats;    /**< Timing statistics of the realtime path */
+    MidiCapture capture; /**< Capture file writer fed by the backends */
 
     virtual void resetTick(unsigned int tick = 0)
     {
@@ -65,11 +83,6 @@ public:
         }
     }
 
-    virtual void setTpm(uint64_t ticks_per_minute)
-    {
-        m_tpm = ticks_per_minute;
-    }
-
     virtual void setUseJackTransport(bool on)
     {
         useJackSync = on;
@@ -99,6 +112,42 @@ public:
     {
         portUnmatched = id;
     }
+
+    /*! @brief Enable or disable the DIN bandwidth model for an output port */
+    void setPortBandwidthLimited(int port, bool on)
+    {
+        if ((port < 0) || (port >= MAX_PORTS)) return;
+        const uint64_t bit = (uint64_t)1 << port;
+        if (on) bandwidthPorts.fetch_or(bit, std::memory_order_relaxed);
+        else bandwidthPorts.fetch_and(~bit, std::memory_order_relaxed);
+        portBandwidth[port].resetStats();
+    }
+
+    bool isPortBandwidthLimited(int port) const
+    {
+        if ((port < 0) || (port >= MAX_PORTS)) return false;
+        return (bandwidthPorts.load(std::memory_order_relaxed) >> port) & 1;
+    }
+
+    /*! @brief Queue delay statistics of a bandwidth limited port */
+    PortBandwidth::Stats portBandwidthStats(int port) const
+    {
+        return portBandwidth[port].stats();
+    }
+
+    /*!
+     * @brief Set the rank of an event type among events due at the same
+     * tick, lower ranks are sent first
+     */
+    void setOutputPriority(int type, int rank)
+    {
+        if ((type >= 0) && (type <= EV_NONE)) outputRank[type] = rank;
+    }
+
+    int outputPriority(int type) const
+    {
+        return ((type >= 0) && (type <= EV_NONE)) ? outputRank[type] : 0;
+    }
     virtual void setTempo(double bpm)
     {
         tempo = bpm;
@@ -131,10 +180,9 @@ protected:
         : m_midi_event_received_callback(midi_event_received_callback)
         , m_tick_callback(tick_callback)
         , m_callback_context(callback_context)
-        , m_backend_rate(backend_rate)
+        , timeBase(backend_rate)
         , m_current_tick(0)
         , m_next_tick(0)
-        , m_tpm(0)
         , portCount(p_portCount)
     {
     internalTempo = 120;
@@ -147,16 +195,25 @@ protected:
     useMidiClock = false;
     outputMidiClock = false;
     portMidiClock = 0;
+    bandwidthPorts = 0;
+    /* timing first, then notes, then everything else */
+    for (int l1 = 0; l1 <= EV_NONE; l1++) outputRank[l1] = 3;
+    outputRank[EV_CLOCK] = 0;
+    outputRank[EV_START] = 0;
+    outputRank[EV_STOP] = 0;
+    outputRank[EV_NOTEON] = 1;
+    outputRank[EV_NOTEOFF] = 1;
+    outputRank[EV_PGMCHANGE] = 2;
     }
 
-    uint64_t tickToBackendOffset(unsigned int tick)
+    uint64_t tickToBackendOffset(uint64_t tick)
     {
-        return (uint64_t)tick * m_backend_rate / m_tpm;
+        return timeBase.tickToPos(tick);
     }
 
-    unsigned int backendOffsetToTick(uint64_t backend_offset)
+    uint64_t backendOffsetToTick(uint64_t backend_offset)
     {
-        return backend_offset * m_tpm / m_backend_rate;
+        return timeBase.posToTick(backend_offset);
     }
 
     uint64_t getCurrentTickBackendOffset()
@@ -169,8 +226,36 @@ protected:
         return tickToBackendOffset(m_next_tick);
     }
 
+    /*! @brief Free the wire of all bandwidth limited ports, to be called
+     * when the backend positions restart */
+    void resetPortBandwidth()
+    {
+        for (int l1 = 0; l1 < MAX_PORTS; l1++) {
+            portBandwidth[l1].reset(timeBase.rate());
+        }
+    }
+
+    /*! @brief MIDI status byte of an event as sent to a port */
+    static int statusByte(const MidiEvent& ev)
+    {
+        switch (ev.type) {
+            case EV_NOTEON:     return 0x90 + ev.channel;
+            case EV_NOTEOFF:    return 0x80 + ev.channel;
+            case EV_KEYPRESS:   return 0xa0 + ev.channel;
+            case EV_CONTROLLER: return 0xb0 + ev.channel;
+            case EV_PGMCHANGE:  return 0xc0 + ev.channel;
+            case EV_CHANPRESS:  return 0xd0 + ev.channel;
+            case EV_PITCHBEND:  return 0xe0 + ev.channel;
+            case EV_CLOCK:      return 0xf8;
+            case EV_START:      return 0xfa;
+            case EV_STOP:       return 0xfc;
+            default:            return 0xf0;
+        }
+    }
+
     bool midi_event_received(MidiEvent ev)
     {
+        capture.record(ev, getCurrentTick(), 0, CAPTURE_IN);
         return m_midi_event_received_callback(m_callback_context, ev);
     }
 
@@ -193,13 +278,16 @@ protected:
     bool (* m_midi_event_received_callback)(void * context, MidiEvent ev);
     void (* m_tick_callback)(void * context, bool echo_from_trig);
     void * m_callback_context;
-    uint64_t m_backend_rate;    // samples(?) per minute (granularity)
+    TimeBase timeBase;          // backend rate in units per minute
     uint64_t m_current_tick;
     uint64_t m_next_tick;
 
-    uint64_t m_tpm;             // ticks per minute
     double tempo, internalTempo, requestedTempo;
     int portCount;
+
+    PortBandwidth portBandwidth[MAX_PORTS];
+    std::atomic<uint64_t> bandwidthPorts;   /**< Bit mask of the bandwidth limited ports */
+    int outputRank[EV_NONE + 1];
 };
 
 #endif // #ifndef DRIVERBASE_H__9383DA6E_DCDB_4840_86DA_6A36E87653D2__INCLUDED
@@ -23,27 +23,35 @@
  */
 
 #include <iostream>
+#include <QApplication>
+#include <QMouseEvent>
 #include "engine.h"
 
 
 Engine::Engine(GlobStore *p_globStore, GrooveWidget *p_grooveWidget, 
             int p_portCount, bool p_alsamidi, QWidget *parent) 
-            : QObject(parent), modified(false)
+            : QObject(parent), EngineCore(p_portCount), modified(false),
+            logRing(LOG_RINGSIZE)
 {
-    ready = false;
+    logBatch.reserve(logRing.capacity());
 
-    logEventBuffer.resize(128);
-    logTickBuffer.resize(128);
-    logEventCount = 0;
+    // the display timer is started once the driver is set up
+    dispTimer = new MTimer();
+    connect(dispTimer, SIGNAL(timeout()), this, SLOT(updateDisplay()));
+    qApp->installEventFilter(this);
 
     midiControl = new MidiControl;
     midiControl->ID = -3;
     connect(midiControl, SIGNAL(setMidiLearn(int, int)),
             this, SLOT(setMidiLearn(int, int)));
+    connect(midiControl, SIGNAL(ccListChanged()),
+            this, SLOT(updateCCIndex()));
 
     globStoreWidget = p_globStore;
     connect(globStoreWidget->midiControl, SIGNAL(setMidiLearn(int, int)),
             this, SLOT(setMidiLearn(int, int)));
+    connect(globStoreWidget->midiControl, SIGNAL(ccListChanged()),
+            this, SLOT(updateCCIndex()));
 
     grooveWidget = p_grooveWidget;
     connect(grooveWidget, SIGNAL(newGrooveTick(int)),
@@ -54,10 +62,11 @@ Engine::Engine(GlobStore *p_globStore, GrooveWidget *p_grooveWidget,
             this, SLOT(setGrooveLength(int)));
     connect(grooveWidget->midiControl, SIGNAL(setMidiLearn(int, int)),
             this, SLOT(setMidiLearn(int, int)));
-    portCount = p_portCount;
+    connect(grooveWidget->midiControl, SIGNAL(ccListChanged()),
+            this, SLOT(updateCCIndex()));
 
     if (!p_alsamidi) {
-        driver = new JackDriver(portCount, this, tr_state_cb, 
+        driver = new JackDriver(portCount, (EngineCore *)this, tr_state_cb,
                 midi_event_received_callback, tick_callback, tempo_callback);
     }
 #ifdef HAVE_ALSA
@@ -65,38 +74,20 @@ Engine::Engine(GlobStore *p_globStore, GrooveWidget *p_grooveWidget,
     // In case of ALSA MIDI with Jack Transport sync, JackDriver is 
     // instantiated with 0 ports
     // a pointer to jackSync has to be passed to driver
-        jackSync = new JackDriver(0, this, tr_state_cb, 
+        jackSync = new JackDriver(0, (EngineCore *)this, tr_state_cb,
                 midi_event_received_callback, tick_callback, tempo_callback);
-        driver = new SeqDriver(jackSync, portCount, this, 
+        driver = new SeqDriver(jackSync, portCount, (EngineCore *)this,
                 midi_event_received_callback, tick_callback);
     }
 #endif
 
     alsaMidi = p_alsamidi;
-    alsaSyncTol = 2;
     midiLearnFlag = false;
-    midiControllable = true;
-    grooveTick = 0;
-    grooveVelocity = 0;
-    grooveLength = 0;
-    schedDelayTicks = 2;
-    status = false;
     sendLogEvents = false;
-    useMidiClock = false;
-    currentTick = 0;
-    requestTick = 0;
-    tempo = 120;
-    requestedTempo = 120;
-
-    restoreRequest = -1;
-    restoreModIx = 0;
-    restoreTick = -1;
-    schedRestoreLocation = -1;
-
-    nextMinTick = 0;
+
     resetTicks(0);
-    dispTimer = new MTimer();
-    connect(dispTimer, SIGNAL(timeout()), this, SLOT(updateDisplay()));
+    updateCCIndex();
+    dispTimer->start();
     ready = true;
 }
 
@@ -108,8 +99,8 @@ Engine::~Engine()
 
 void Engine::updatePatternPresets(const QString& n, const QString& p, int index)
 {
-    for (int l1 = 0; l1 < midiWorkerCount(); l1++) {
-        if (moduleWidget(l1)->name.startsWith("Arp"))
+    for (int l1 = 0; l1 < moduleWidgetCount(); l1++) {
+        if (moduleWidget(l1)->midiWorker->moduleType == MOD_ARP)
             ((ArpWidget *)moduleWidget(l1))->updatePatternPresets(n, p, index);
     }
 }
@@ -135,45 +126,8 @@ void Engine::setGrooveLength(int val)
     modified = true;
 }
 
-void Engine::sendGroove(int ix)
-{
-    if (ix  == -1)
-        for (int l1 = 0; l1 < moduleWidgetCount(); l1++) {
-            moduleWidget(l1)->newGrooveValues(grooveTick, grooveVelocity, grooveLength);
-        }
-    else
-        moduleWidget(ix)->newGrooveValues(grooveTick, grooveVelocity, grooveLength);
-}
-
 //Module management
 
-MidiWorker *Engine::midiWorker(int index)
-{
-    if (index == -1) index = midiWorkerList.count() - 1;
-    return(midiWorkerList.at(index));
-}
-
-void Engine::addMidiWorker(MidiWorker *midiWorker)
-{
-    midiWorkerList.append(midiWorker);
-    modified = true;
-}
-
-void Engine::removeMidiWorker(MidiWorker *midiWorker)
-{
-    if (status && (midiWorkerCount() < 1)) {
-        setStatus(false);
-    }
-    int i = midiWorkerList.indexOf(midiWorker);
-    if (i != -1)
-        delete midiWorkerList.takeAt(i);
-}
-
-int Engine::midiWorkerCount()
-{
-    return(midiWorkerList.count());
-}
-
 ModuleWidget *Engine::moduleWidget(int index)
 {
     if (index == -1) index = moduleWidgetList.count() - 1;
@@ -182,8 +136,10 @@ ModuleWidget *Engine::moduleWidget(int index)
 
 void Engine::addModuleWidget(ModuleWidget *moduleWidget)
 {
-    addMidiWorker(moduleWidget->midiWorker);
     moduleWidgetList.append(moduleWidget);
+    addModule(moduleWidget->moduleCore);
+    connect(moduleWidget->midiControl, SIGNAL(ccListChanged()),
+            this, SLOT(updateCCIndex()));
     sendGroove(moduleWidgetCount() - 1);
     updateGlobRestoreTimeModule(restoreModIx);
 
@@ -192,8 +148,11 @@ void Engine::addModuleWidget(ModuleWidget *moduleWidget)
 
 void Engine::removeModuleWidget(ModuleWidget *moduleWidget)
 {
+    MidiWorker *worker = moduleWidget->midiWorker;
+
     moduleWidgetList.removeOne(moduleWidget);
-    removeMidiWorker(moduleWidget->midiWorker);
+    removeModule(moduleWidget->moduleCore);
+    delete worker;
 
     delete moduleWidget->parent();
     modified = true;
@@ -273,195 +232,86 @@ void Engine::setModified(bool m)
     globStoreWidget->setModified(m);
 }
 
-/* All following functions are the core engine of QMidiArp. They need to
- * be made realtime-safe.
- * They currently call different driver backend functions, which
- * can eventually (hopefully) get a jackDriver equivalent, so that
- * switching between the driver backends can be done from here.
- */
-
-int Engine::getPortCount()
-{
-    return(portCount);
-}
-
-int Engine::getClientId()
-{
-    return driver->getClientId();
-}
-
-void Engine::setStatus(bool on)
+void Engine::showAllIOPanels(bool on)
 {
-    if (!moduleWidgetCount()) return;
-    if (!on) {
-        for (int l1 = 0; l1 < midiWorkerCount(); l1++) {
-            midiWorker(l1)->clearNoteBuffer();
-        }
-    }
-    status = on;
-    driver->setTransportStatus(on);
     for (int l1 = 0; l1 < moduleWidgetCount(); l1++) {
-        moduleWidget(l1)->parStore->engineRunning = on;
-    }
-    if (on) {
-        resetTicks(driver->getCurrentTick());
-        driver->requestEchoAt(0);
+        moduleWidget(l1)->hideInOutBoxAction->setChecked(on);
     }
 }
 
-void Engine::tick_callback(void * context, bool echo_from_trig)
+//EngineCore hooks
+
+void Engine::addGlobalControllers(MidiCCIndex *index)
 {
-  ((Engine *)context)->echoCallback(echo_from_trig);
+    index->add(this, midiControl->ccList);
+    index->add(grooveWidget, grooveWidget->midiControl->ccList);
+    index->add(globStoreWidget, globStoreWidget->midiControl->ccList);
 }
 
-void Engine::echoCallback(bool echo_from_trig)
+int Engine::getTimeMode()
 {
-    int l1, l2;
-    int tol = alsaSyncTol;
-    int tick = driver->getCurrentTick();
-    bool restoreFlag = (restoreRequest >= 0);
-    
-    currentTick = tick;
-
-        //~ printf("       tick %d     ",tick);
-        //~ printf("nextMinTick %d  ",nextMinTick);
-    
-    //Module data request and queueing
-    for (l1 = 0; l1 < moduleWidgetCount(); l1++) {
-        if (moduleWidget(l1)->prepareNextFrame(echo_from_trig, tol, tick, 
-                                       &restoreTick, &restoreFlag)) {
-            
-            l2 = 0;
-            while (midiWorker(l1)->outFrame[l2].data > -1) {
-                if (!midiWorker(l1)->outFrame[l2].muted && !midiWorker(l1)->isMuted) {
-                    MidiEvent outEv = mkMidiEvent(
-                                        midiWorker(l1)->eventType, 
-                                        midiWorker(l1)->channelOut, 
-                                        midiWorker(l1)->outFrame[l2].data, 
-                                        midiWorker(l1)->outFrame[l2].value);
-                    driver->sendMidiEvent(outEv, 
-                                        midiWorker(l1)->outFrame[l2].tick,
-                                        midiWorker(l1)->portOut, 
-                                        midiWorker(l1)->returnLength);
-                }
-                l2++;
-            }
-        }
-    }
-    
-    //Calculate timing of next echo to be requested (minimum of all modules)
-    for (l1 = 0; l1 < midiWorkerCount(); l1++) {
-        int64_t nt = midiWorker(l1)->nextTick - schedDelayTicks;
-        if (nt < nextMinTick + schedDelayTicks || !l1) nextMinTick = nt;            
-    }
-    if (nextMinTick < 0) nextMinTick = 0;
-    if (moduleWidgetCount()) driver->requestEchoAt(nextMinTick, 0);
-
-    //Update GlobStore master indicator pacman
-    if (restoreFlag && (globStoreWidget->timeModeBox->currentIndex())) {
-        int percent = 100 * (currentTick - requestTick) / (restoreTick - requestTick);
-        globStoreWidget->indicator->updatePercent(percent);
-    }
-
-    //Check for parameter restore requests
-    if ((restoreTick > -1)
-        && (!moduleWidgetCount() || (nextMinTick + schedDelayTicks >= restoreTick))) {
-        restoreTick = -1;
-        schedRestore(restoreRequest);
-    }
+    return globStoreWidget->timeMode;
 }
 
-bool Engine::midi_event_received_callback(void * context, MidiEvent ev)
+int Engine::getSwitchAtBeat()
 {
-  return ((Engine *)context)->eventCallback(ev);
+    return globStoreWidget->switchAtBeat;
 }
 
-bool Engine::eventCallback(MidiEvent inEv)
+void Engine::logEvent(const MidiEvent& ev, int tick)
 {
-    bool unmatched = true;
-    bool no_collision = false;
-    int l1;
+    if (!sendLogEvents) return;
 
-    int tick = driver->getCurrentTick();
-
-    if (sendLogEvents) {
-        logEventBuffer.replace(logEventCount, inEv);
-        logTickBuffer.replace(logEventCount, tick);
-        logEventCount++;
-    }
+    MidiLogEvent logEv;
+    logEv.ev = ev;
+    logEv.tick = tick;
+    logEv.time_ns = RtStats::now();
+    logRing.push(logEv);
+}
 
-    /* from here on we handle Note Off events as Note On / Vel 0 events */
-    if (inEv.type == EV_NOTEOFF) {
-        inEv.type = EV_NOTEON;
-        inEv.value = 0;
-    }
+bool Engine::learnEvent(const MidiEvent& ev)
+{
+    if (!midiLearnFlag) return false;
 
-    if (useMidiClock){
-        if (inEv.type == EV_START) {
-            setStatus(true);
-            return(false);
-        }
-        if (inEv.type == EV_STOP) {
-            setStatus(false);
-            return(false);
-        }
-    }
-    if (midiLearnFlag && inEv.type == EV_NOTEON) {   //input range midi learn
+    if (ev.type == EV_NOTEON) {   //input range midi learn
         if (midiLearnWindowID > 0) {
-            if (midiLearnID == 10) {
-                moduleWidget(midiLearnModuleID)->indexIn[0]->setValue(inEv.data);
+            MidiWorker *worker = moduleWidget(midiLearnModuleID)->midiWorker;
+            if (midiLearnID == ModuleWidget::NOTE_LOW) {
+                worker->indexIn[0] = ev.data;
             }
-            else if (midiLearnID == 11) {
-                moduleWidget(midiLearnModuleID)->indexIn[1]->setValue(inEv.data);
+            else if (midiLearnID == ModuleWidget::NOTE_HIGH) {
+                worker->indexIn[1] = ev.data;
             }
+            worker->needsGUIUpdate = true;
             midiLearnFlag = false;
         }
+        return false;
     }
-    for (l1 = 0; l1 < midiWorkerCount(); l1++) {
-        if (status && moduleWidget(l1)->name.startsWith("Arp:")) {
-            unmatched = midiWorker(l1)->handleEvent(inEv, tick, 1);
-        }
-        else {
-            unmatched = midiWorker(l1)->handleEvent(inEv, tick);
-        }
-        if (midiWorker(l1)->gotKbdTrig) {
-            nextMinTick = midiWorker(l1)->nextTick;
-            no_collision = driver->requestEchoAt(nextMinTick, true);
-            if (!no_collision) midiWorker(l1)->gotKbdTrig = false;
-        }
+    if ((ev.type == EV_CONTROLLER) && midiControllable) {
+        learnController(ev.data, ev.channel);
+        return true;
     }
-
-    if (inEv.type == EV_CONTROLLER) {
-        if (midiControllable) {
-            if (!midiLearnFlag)
-                sendController(inEv.data, inEv.channel, inEv.value);
-            else
-                learnController(inEv.data, inEv.channel);
-            unmatched = false;
-        }
-    }
-
-    return unmatched;
+    return false;
 }
 
-void Engine::showAllIOPanels(bool on)
+void Engine::restoreRequested(int ix)
 {
-    for (int l1 = 0; l1 < moduleWidgetCount(); l1++) {
-        moduleWidget(l1)->hideInOutBoxAction->setChecked(on);
-    }
+    globStoreWidget->setDispState(ix, 2);
 }
 
-void Engine::sendController(int ccnumber, int channel, int value)
+void Engine::restored(int ix)
 {
-    handleController(ccnumber, channel, value);
-    grooveWidget->handleController(ccnumber, channel, value);
-    globStoreWidget->handleController(ccnumber, channel, value);
+    globStoreWidget->requestDispState(ix, 1);
+}
 
-    for (int l1 = 0; l1 < moduleWidgetCount(); l1++) {
-        moduleWidget(l1)->handleController(ccnumber, channel, value);
-    }
+void Engine::updateModule(int ix)
+{
+    moduleWidget(ix)->updateIndicators();
+    moduleWidget(ix)->updateDisplay();
 }
 
+//MIDI learn and controllers
+
 void Engine::learnController(int ccnumber, int channel)
 {
     if (midiLearnWindowID == -1) {
@@ -493,32 +343,18 @@ void Engine::learnController(int ccnumber, int channel)
     midiLearnFlag = false;
 }
 
-void Engine::handleController(int ccnumber, int channel, int value)
+void Engine::handleController(int controlID, int min, int max, int value)
 {
-    if (!midiControl->ccList.count()) return;
-
-    MidiCC midiCC = midiControl->ccList.at(0);
-    int sval, min, max;
+    (void)controlID; // the tempo is the only control of Engine
 
-    if ((ccnumber != midiCC.ccnumber) || (channel != midiCC.channel)) return;
     if ((driver->useJackSync) || (driver->useMidiClock)) return;
-    min = midiCC.min;
-    max = midiCC.max;
-    sval = min + ((double)value * (max - min) / 127);
+    int sval = min + ((double)value * (max - min) / 127);
     requestedTempo = sval;
 }
 
-void Engine::resetTicks(int curtick)
+void Engine::updateCCIndex()
 {
-    for (int l1 = 0; l1 < moduleWidgetCount(); l1++) {
-        if (status && moduleWidget(l1)->name.startsWith("Arp:")) {
-            midiWorker(l1)->foldReleaseTicks(driver->trStartingTick - curtick);
-        }
-        midiWorker(l1)->setNextTick(curtick);
-        if (!l1) nextMinTick = midiWorker(l1)->nextTick;
-        if (midiWorker(l1)->nextTick < nextMinTick)
-            nextMinTick=midiWorker(l1)->nextTick;
-    }
+    EngineCore::updateCCIndex();
 }
 
 void Engine::setMidiControllable(bool on)
@@ -527,30 +363,6 @@ void Engine::setMidiControllable(bool on)
     modified = true;
 }
 
-void Engine::setUseMidiClock(bool on)
-{
-    if (alsaMidi and on)
-        alsaSyncTol = 3000;
-    else
-        alsaSyncTol = 2;
-    
-    setStatus(false);
-    driver->setUseMidiClock(on);
-    useMidiClock = on;
-    modified = true;
-}
-
-void Engine::setUseJackTransport(bool on)
-{
-    if (alsaMidi and on)
-        alsaSyncTol = 1000;
-    else
-        alsaSyncTol = 2;
-    
-    driver->setUseJackTransport(on);
-    modified = true;
-}
-
 void Engine::setMidiLearn(int moduleWidgetID, int controlID)
 {
     if (0 > controlID) {
@@ -566,117 +378,111 @@ void Engine::setMidiLearn(int moduleWidgetID, int controlID)
     }
 }
 
-void Engine::setTempo(double bpm)
+//Transport
+
+void Engine::setStatus(bool on)
 {
-    driver->requestTempo(bpm);
-    requestedTempo = bpm;
+    EngineCore::setStatus(on);
+}
 
-    tempo=bpm;
+void Engine::setUseMidiClock(bool on)
+{
+    EngineCore::setUseMidiClock(on);
     modified = true;
 }
 
-void Engine::tempo_callback(double bpm, void *context)
+void Engine::setUseJackTransport(bool on)
 {
-    ((Engine *)context)->requestedTempo = bpm;
+    EngineCore::setUseJackTransport(on);
+    modified = true;
 }
 
-void Engine::setSendLogEvents(bool on)
+void Engine::setTempo(double bpm)
 {
-    sendLogEvents = on;
+    EngineCore::setTempo(bpm);
     modified = true;
 }
 
-void Engine::tr_state_cb(bool on, void *context)
+void Engine::setSendLogEvents(bool on)
 {
-    if  (((Engine  *)context)->ready) {
-        if (((Engine  *)context)->driver->useJackSync) {
-           ((Engine  *)context)->setStatus(on);
-        }
-    }
+    sendLogEvents = on;
+    modified = true;
 }
 
+//Global storage
+
 void Engine::store(int ix)
 {
-    for (int l1 = 0; l1 < moduleWidgetCount(); l1++) {
-        moduleWidget(l1)->storeParams(ix);
-    }
+    EngineCore::store(ix);
 }
 
 void Engine::requestRestore(int ix)
 {
-    if (status == false) {
-        restore(ix);
-        return;
-    }
-
-    restoreRequest = ix;
-
-    globStoreWidget->setDispState(ix, 2);
-    if (globStoreWidget->timeModeBox->currentIndex()) {
-        requestTick = currentTick;
-        restoreTick = TPQN * (2 + globStoreWidget->switchAtBeatBox
-            ->currentIndex()) + currentTick;
-    }
+    EngineCore::requestRestore(ix);
 }
 
-void Engine::schedRestore(int ix)
+void Engine::removeParStores(int ix)
 {
-    schedRestoreLocation = ix;
+    EngineCore::removeParStores(ix);
 }
 
-void Engine::restore(int ix)
+void Engine::updateGlobRestoreTimeModule(int windowIndex)
 {
-    for (int l1 = 0; l1 < moduleWidgetCount(); l1++) {
-        moduleWidget(l1)->parStore->setRestoreRequest(ix, true);
-        moduleWidget(l1)->parStore->oldRestoreRequest = ix;
-    }
-
-    restoreRequest = -1;
-
-    globStoreWidget->requestDispState(ix, 1);
+    EngineCore::updateGlobRestoreTimeModule(windowIndex);
 }
 
-void Engine::removeParStores(int ix)
+bool Engine::eventFilter(QObject *obj, QEvent *event)
 {
-    for (int l1 = 0; l1 < moduleWidgetCount(); l1++) {
-        moduleWidget(l1)->parStore->removeLocation(ix);
+    switch (event->type()) {
+        case QEvent::MouseMove:
+            // hovering changes nothing
+            if (!((QMouseEvent *)event)->buttons()) break;
+            dispTimer->requestUpdate();
+            break;
+        case QEvent::MouseButtonPress:
+        case QEvent::MouseButtonRelease:
+        case QEvent::Wheel:
+        case QEvent::KeyPress:
+        case QEvent::KeyRelease:
+        case QEvent::Show:
+        case QEvent::WindowStateChange:
+            dispTimer->requestUpdate();
+            break;
+        default:
+            break;
     }
-}
-
-void Engine::updateGlobRestoreTimeModule(int windowIndex)
-{
-    moduleWidget(restoreModIx)->parStore->isRestoreMaster = false;
-    moduleWidget(windowIndex)->parStore->isRestoreMaster = true;
-
-    restoreModIx = windowIndex;
+    return QObject::eventFilter(obj, event);
 }
 
 void Engine::updateDisplay()
 {
     int l1;
-    // The following is a test whether the display update loop is fast
-    // enough to restore the parameters in time. This cannot be done in
-    // realtime currently, since it requires reworking the restore routines
-    // entirely. Testing seems positive, but TODO.
-
-    if (schedRestoreLocation >= 0) {
-        restore(schedRestoreLocation);
-        schedRestoreLocation = -1;
-    }
 
+    dispTimer->frameDone();
+
+    EngineCore::update();
+
+    bool restorePending = false;
     for (l1 = 0; l1 < moduleWidgetCount(); l1++) {
-        moduleWidget(l1)->updateDisplay();
+        ParStore *parStore = moduleWidget(l1)->parStore;
+        if ((parStore->restoreRequest >= 0) || parStore->restoreRunOnce)
+            restorePending = true;
     }
+    dispTimer->setFastMode(status && restorePending);
+
+    int percent = restorePercent.exchange(-1, std::memory_order_relaxed);
+    if (percent >= 0) globStoreWidget->indicator->updatePercent(percent);
 
     globStoreWidget->updateDisplay();
     grooveWidget->updateDisplay();
     midiControl->update();
 
-    if ((sendLogEvents) && (logEventCount)) {
-        for (l1 = 0; l1 < logEventCount; l1++) {
-            emit midiEventReceived(logEventBuffer.at(l1), logTickBuffer.at(l1));
-        }
-        logEventCount = 0;
+    // events still in the ring after the log was disabled are drained too
+    logBatch.resize(logRing.size());
+    logRing.pop(logBatch.data(), logBatch.size());
+    int dropped = logRing.takeDropped();
+    if (!logBatch.isEmpty() || dropped) {
+        emit midiEventsReceived(logBatch, dropped);
     }
 
     if (requestedTempo != tempo) {
@@ -685,16 +491,32 @@ void Engine::updateDisplay()
     }
 }
 
-MTimer::MTimer()
+MTimer::MTimer() : dirty(true), pending(false), fast(false)
 {
-    start();
 }
 
 void MTimer::run() {
 
+    int idleFrames = 0;
+    int sinceTimeout = 0;
+
     while(true) {
-        // set fixed to 5000us
-        usleep(5000);
+        int period = (idleFrames < IDLE_FRAMES) ? FRAME_USEC : IDLE_USEC;
+        if (fast.load(std::memory_order_relaxed)) period = FAST_USEC;
+        usleep(period);
+        sinceTimeout += period;
+
+        if (pending.load(std::memory_order_relaxed)) continue;
+
+        if (dirty.exchange(false, std::memory_order_relaxed)) {
+            idleFrames = 0;
+        }
+        else {
+            if (idleFrames < IDLE_FRAMES) idleFrames++;
+            if (sinceTimeout < HEARTBEAT_USEC) continue;
+        }
+        sinceTimeout = 0;
+        pending.store(true, std::memory_order_relaxed);
         emit timeout();
     }
 }
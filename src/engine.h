@@ -25,6 +25,7 @@
 #define ENGINE_H
 
 #include <QDockWidget>
+#include <QEvent>
 #include <QThread>
 
 #include "jackdriver.h"
@@ -33,29 +34,57 @@
 #include "lfowidget.h"
 #include "seqwidget.h"
 #include "groovewidget.h"
+#include "enginecore.h"
 #include "config.h"
 
 /*!
- * @brief 5ms timer calling the updateDisplay() function periodically
+ * @brief Thread pacing the calls of the updateDisplay() function
  *
- * This class produces timeout() signals every 5ms. The signal
- * is connected to the Engine::updateDisplay() method. This mechanism is used
+ * This class produces timeout() signals, which are connected to the
+ * Engine::updateDisplay() method. This mechanism is used
  * to update many GUI elements as a function of changes happening in the
  * backend's realtime thread. For example, cursor redrawing cannot be called
  * directly from the driver. The modules' updateDisplay() functions therefore
- * only read the position and redraw their screens within this MTimer thread. 
- * 
- * MTimer consumes about 10 times less CPU than QTimer with the
- * same interval.
- *
+ * only read the position and redraw their screens when called here.
+ *
+ * A timeout() is only emitted if requestUpdate() was called since the
+ * previous one, and at most FRAME_USEC apart, which caps the display
+ * at 60 Hz while the transport runs. After IDLE_FRAMES frames without
+ * request, the thread only checks every IDLE_USEC, and a timeout() is
+ * still emitted every HEARTBEAT_USEC for changes that were not
+ * requested. While a module restore is pending, the period is lowered
+ * to FAST_USEC with setFastMode(), since ParStore::updateDisplay()
+ * switches at a given frame. No new timeout() is emitted before updateDisplay() has
+ * called frameDone(), so that a slow GUI thread is not flooded with
+ * queued signals.
  */
 class MTimer : public QThread
 {
     Q_OBJECT
 
+    enum {
+        FAST_USEC = 5000,       /**< Period while a module restore is pending */
+        FRAME_USEC = 16667,     /**< Minimum period of timeout(), 60 Hz */
+        IDLE_USEC = 50000,      /**< Check period when idle */
+        IDLE_FRAMES = 30,       /**< Frames without request before idling */
+        HEARTBEAT_USEC = 1000000 /**< Maximum period of timeout() */
+    };
+
+    std::atomic<bool> dirty;    /**< Set by requestUpdate() */
+    std::atomic<bool> pending;  /**< Set from timeout() until frameDone() */
+    std::atomic<bool> fast;     /**< Set by setFastMode() */
+
 public:
     MTimer();
 
+/*! @brief marks the display dirty, can be called from any thread,
+ * also in realtime */
+    void requestUpdate() { dirty.store(true, std::memory_order_relaxed); }
+/*! @brief called by the receiver of timeout() when it starts the update */
+    void frameDone() { pending.store(false, std::memory_order_relaxed); }
+/*! @brief selects the FAST_USEC period for pending module restores */
+    void setFastMode(bool on) { fast.store(on, std::memory_order_relaxed); }
+
 signals:
     void timeout();
 
@@ -66,75 +95,79 @@ protected:
 /*!
  * @brief Core Engine Class. Instantiates SeqDriver and JackDriver.
  *
- * For each module type there is a QList for each of
- * its components (for example MidiArp and ArpWidget). In parallel there is
- * a common list for all modules containing their DockWidgets.
- * Engine also instantiates the MIDI Driver backend and processes MIDI
- * events coming in and going out. It dispatches incoming events to the
- * worker modules and schedules resulting events back to the driver.
- * Controller events are dispatched to the modules as required by their
- * MidiControl::ccList.
+ * Engine holds the list of the module widgets in parallel to the
+ * ModuleCore list of EngineCore, which runs their MidiWorkers in the
+ * realtime thread, dispatches incoming events to them and schedules
+ * resulting events back to the driver. Controller events are dispatched
+ * to the modules as required by their MidiControl::ccList.
  *
+ * Engine adds the MIDI learn, the event log, the GlobStore and
+ * GrooveWidget panels and the periodic display update to EngineCore.
  */
-class Engine : public QObject  {
+class Engine : public QObject, public EngineCore  {
 
   Q_OBJECT
 
   private:
-    QList<MidiWorker *> midiWorkerList;
     QList<ModuleWidget *> moduleWidgetList;
 
-    int portCount;
     bool modified;
     int midiLearnID, midiLearnWindowID, midiLearnModuleID;
     bool midiLearnFlag;
-    bool useMidiClock;
-    int alsaSyncTol; /**< Tolerance in ticks set when synching alsa to jack */
-
-    int restoreRequest;
-    int64_t restoreTick;
-    int schedRestoreLocation; /**< When Engine requests restore during running this is the location, it is -1 otherwise */
 
-    double tempo;
-    double requestedTempo;
-
-    //From SeqDriver
-    int schedDelayTicks;
-    int nextMinTick;
-    int currentTick;
-    int requestTick;
     bool sendLogEvents;
-    int logEventCount;
-    QVector<MidiEvent> logEventBuffer;
-    QVector<int> logTickBuffer;
+    SpscRing<MidiLogEvent> logRing; /**< Received events passed from eventCallback() to updateDisplay() */
+    QVector<MidiLogEvent> logBatch;
 
     MTimer *dispTimer;
 
-    static bool midi_event_received_callback(void * context, MidiEvent ev);
-    static void tick_callback(void * context, bool echo_from_trig);
-    static void tr_state_cb(bool tr_state, void * context);
-    static void tempo_callback(double bpm, void *context);
   public:
-    int grooveTick, grooveVelocity, grooveLength;
-    int restoreModIx;
-    bool midiControllable;
-    bool status;
-    bool ready;
     GlobStore *globStoreWidget;
     GrooveWidget *grooveWidget;
-    JackDriver *jackSync;
-    DriverBase *driver;
     MidiControl *midiControl;
 
+  protected:
+/*!
+* @brief requests a display update on user input to any widget
+*
+* Installed as application event filter, so that changes made in the
+* GUI are shown without waiting for the MTimer heartbeat.
+*/
+    bool eventFilter(QObject *obj, QEvent *event);
+
+    void addGlobalControllers(MidiCCIndex *index) override;
+    int getTimeMode() override;
+    int getSwitchAtBeat() override;
+    void requestDisplayUpdate() override { dispTimer->requestUpdate(); }
+/*!
+* @brief pushes the received event to the logRing if logging is enabled,
+* from where it is regularly transferred to the LogWidget by
+* updateDisplay()
+*/
+    void logEvent(const MidiEvent& ev, int tick) override;
+/*!
+* @brief attributes the received note to the input range or the
+* controller to the control requesting MIDI learn
+*/
+    bool learnEvent(const MidiEvent& ev) override;
+    void restoreRequested(int ix) override;
+    void restored(int ix) override;
+    void updateModule(int ix) override;
+
   public:
     Engine(GlobStore *p_globStore, GrooveWidget *p_grooveWidget, int p_portCount, bool p_alsamidi, QWidget* parent=0);
     ~Engine();
-    int getPortCount();
     bool isModified();
-    bool alsaMidi; /**< True when using alsa MIDI driver */
-
 
+/*!
+* @brief appends the module widget and its ModuleWidget::moduleCore to
+* the session
+*/
     void addModuleWidget(ModuleWidget *moduleWidget);
+/*!
+* @brief removes the module from the session and deletes its dock
+* widget and its MidiWorker
+*/
     void removeModuleWidget(ModuleWidget *moduleWidget);
     ModuleWidget *moduleWidget(int index);
     /**
@@ -146,24 +179,22 @@ class Engine : public QObject  {
     int moduleWidgetCount(const QString& name = "");
     void updateIDs(int curID);
 
-    void addMidiWorker(MidiWorker *midiWorker);
-    void removeMidiWorker(MidiWorker *midiWorker);
-    int midiWorkerCount();
-    MidiWorker *midiWorker(int index);
-
-    int getClientId();
+/*! @brief calls EngineCore::setTempo() and sets the modified flag */
     void setTempo(double bpm);
-    void sendGroove(int ix = -1);
     void showAllIOPanels(bool on);
 
   signals:
 /**
- * @brief This signal is connected to the LogWidget::appendEvent() slot
+ * @brief This signal is connected to the LogWidget::appendEvents() slot
  *
- * @param ev MidiEvent received by Engine
- * @param tick Set to the tick value at which the event was received
+ * It is emitted once per display update with all events received since
+ * the previous one.
+ *
+ * @param events MidiLogEvents received by Engine in reception order
+ * @param dropped Number of events lost since the previous signal
+ * because the log ring was full
  */
-    void midiEventReceived(MidiEvent ev, int tick);
+    void midiEventsReceived(const QVector<MidiLogEvent>& events, int dropped);
 /**
  * @brief This signal is connected to the MainWindow::updateTempo() slot
  *
@@ -212,16 +243,6 @@ class Engine : public QObject  {
  * 
  */
     void updatePatternPresets(const QString& n, const QString& p, int index);
-/**
- * @brief Dispatches a controller MIDI event to all concerned widgets
- *
- * Concerned widgets are those containing MIDI-learnable elements. 
- *
- * @param ccnumber MIDI Control Event number
- * @param channel MIDI Control Event channel
- * @param value MIDI Control Event value
- */
-    void sendController(int ccnumber, int channel, int value);
 /**
  * @brief Checks all concerned widgets if they requested a MIDI learn
  *
@@ -237,11 +258,12 @@ class Engine : public QObject  {
  *
  * Only the tempo is currently MIDI-learnable and controllable
  *
- * @param ccnumber MIDI Control Event number
- * @param channel MIDI Control Event channel
+ * @param controlID ID of the bound control
+ * @param min Value mapped to controller value 0
+ * @param max Value mapped to controller value 127
  * @param value MIDI Control Event value
  */
-    void handleController(int ccnumber, int channel, int value);
+    void handleController(int controlID, int min, int max, int value) override;
 /**
  * @brief Slot for MidiControl::setMidiLearn(). Sets Engine into MIDI Learn status for
  * moduleWidgetID and controlID.
@@ -253,6 +275,11 @@ class Engine : public QObject  {
  * @param controlID ID of the controllable widget requesting MIDI learn
  */
     void setMidiLearn(int moduleWidgetID, int controlID);
+/**
+ * @brief Slot for MidiControl::ccListChanged(). Calls
+ * EngineCore::updateCCIndex().
+ */
+    void updateCCIndex();
 /**
  * @brief turns on and off MIDI controller handling globally
  *
@@ -290,7 +317,7 @@ class Engine : public QObject  {
     void setGrooveLength(int grooveLength);
 /**
  * @brief turns on and off the recording and transfer of received MIDI
- * events to the LogWidget via the midiEventReceived signal
+ * events to the LogWidget via the midiEventsReceived signal
  *
  * This is a slot for LogWidget::enableLogToggle() called when the
  * log window checkbox is clicked.
@@ -311,96 +338,30 @@ class Engine : public QObject  {
  * MainWindow::jackSyncToggle() called when the toolbar button is clicked.
  */
     void setUseJackTransport(bool on);
-/**
- * @brief called by the driver at the time a MIDI event is received.
- *
- * It queries all module midi workers for direct event eligibility and if
- * not routes it to all module's handleController() methods. If logging
- * is enabled, it stores the event in the logEventBuffer, which
- * is regularly transferred to the LogWidget by updateDisplay().
- *
- * @param inEv MidiEvent structure that should be handled
- */
-    bool eventCallback(MidiEvent inEv);
-/**
- * @brief core function called by the driver every time an echo is pending
- *
- * It queries all module midi workers whether new data should be generated
- * at the tick time of that echo (this is the case when the current tick
- * reaches the module's nextTick. If new data is needed it gets it,
- * composes and sends the new MIDI events back in the driver's queue along
- * with their tick time at which they should be played out.
- * It also updates the cursors and sets the module and global indicator
- * pacman. It causes parameter restore() in case global restores
- * are pending.
- *
-* @param echo_from_trig True if this echo was generated by a trigger through
-* and incoming MIDI event
- */
-    void echoCallback(bool echo_from_trig);
-    void resetTicks(int curtick);
 /*!
 * @brief Called by the display MTimer event loop
 
-* Dispatches the periodic call by the MTimer thread to all widgets, which
-* will perform their associated operations. 
+* Calls EngineCore::update(), which dispatches the periodic call to all
+* module widgets, and updates the global widgets. Modules in hidden
+* docks skip their drawing.
 */
     void updateDisplay();
-/*!
-* @brief causes all modules to restore their parameters from its
-* ParStore::list at index ix.
-*
-* @param ix ParStore::list index from which all module parameters are to be restored
-*/
-    void restore(int ix);
-/*!
-* @brief causes Engine to call restore() when the restore conditions are met
-*
-* @param ix ParStore::list index from which all module parameters are to be restored
-*/
-    void schedRestore(int ix);
-/*!
-* @brief causes all modules to remove their entries in the ParStore::list
-* at index ix
-*
-* @param ix ParStore::list index at which module parameters are to be removed
-*/
+/*! @brief Slot for GlobStore::removeParStores(), calls EngineCore::removeParStores() */
     void removeParStores(int ix);
-/*!
-* @brief causes all modules to store their current parameters in their
-* ParStore::list at index ix
-*
-* @param ix ParStore::list index at which all module parameters are to be stored
-*/
+/*! @brief Slot for GlobStore::store(), calls EngineCore::store() */
     void store(int ix);
-/*!
-* @brief causes Engine to call restore() when the timing and
-* restore type conditions are met
-* @param ix ParStore::list index from which all module parameters are to be restored
-*/
+/*! @brief Slot for GlobStore::requestRestore(), calls EngineCore::requestRestore() */
     void requestRestore(int ix);
 /*!
 * @brief slot for GlobStore::updateGlobRestoreTimeModule signal
 *
-* Makes the module with index windowIndex trigger global store switches when its cursor
-* reaches the end. It determines the type (Arp, LFO, Seq) and the index of the selected
-* module the module storage lists and stores these in local variables.
+* Makes the module with index windowIndex trigger global store switches
+* when its cursor reaches the end.
 *
 * @param windowIndex moduleWidgetList index of the module to become switch
 * trigger when its cursor reaches the end of the pattern
 */
     void updateGlobRestoreTimeModule(int windowIndex);
-
-/*! @brief Convenience function for creating a new MidiEvent struct */
-    MidiEvent mkMidiEvent(int type, int channel=0, int data=0, int value=0)
-    {
-        MidiEvent ev;
-        ev.type = type;
-        ev.channel = channel;
-        ev.data = data;
-        ev.value = value;
-        return ev;
-    }
 };
 
 #endif
@@ -0,0 +1,599 @@
+/**
+ * @file enginecore.cpp
+ * @brief Implementation of the EngineCore class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#include <QFile>
+#include "enginecore.h"
+
+
+EngineCore::EngineCore(int p_portCount)
+{
+    portCount = p_portCount;
+    ready = false;
+    jackSync = NULL;
+    driver = NULL;
+    alsaMidi = false;
+    alsaSyncTol = 2;
+    midiControllable = true;
+    grooveTick = 0;
+    grooveVelocity = 0;
+    grooveLength = 0;
+    schedDelayTicks = 2;
+    status = false;
+    useMidiClock = false;
+    currentTick = 0;
+    requestTick = 0;
+    tempo = 120;
+    requestedTempo = 120;
+
+    restoreRequest = -1;
+    restoreModIx = 0;
+    restoreTick = -1;
+    schedRestoreLocation = -1;
+    restorePercent = -1;
+    reportedEventOverflows = 0;
+    reportedEchoOverflows = 0;
+
+    nextMinTick = 0;
+    scheduleCapacity = 64;
+    schedule = new TickSchedule(scheduleCapacity);
+    pendingSchedule = NULL;
+    retiredSchedule = NULL;
+    tickHeapDirty = true;
+}
+
+EngineCore::~EngineCore()
+{
+    delete schedule;
+    delete pendingSchedule.load();
+    delete retiredSchedule.load();
+}
+
+//Module management
+
+void EngineCore::addModule(ModuleCore *module)
+{
+    // every new module gets a different sequence, which only depends on
+    // its position in the session and is replaced by the seed stored in
+    // the session file when the module is read
+    uint64_t seed = moduleList.count() + 1;
+    for (int l1 = 0; l1 < moduleList.count(); l1++) {
+        if (moduleList.at(l1)->midiWorker->randomSeed == seed) {
+            seed++;
+            l1 = -1;
+        }
+    }
+    module->midiWorker->setRandomSeed(seed);
+
+    reserveSchedule(moduleList.count() + 1);
+    moduleList.append(module);
+    updateRouting(true);
+    tickHeapDirty = true;
+    updateCCIndex();
+}
+
+void EngineCore::removeModule(ModuleCore *module)
+{
+    if (status && (moduleList.count() < 1)) {
+        setStatus(false);
+    }
+    int i = moduleList.indexOf(module);
+    if (i == -1) return;
+
+    moduleList.removeAt(i);
+    tickHeapDirty = true;
+    // the module may only be deleted once the realtime thread has
+    // released all tables referring to it
+    updateCCIndex();
+    ccIndex.synchronize();
+    updateRouting(true);
+    routingTable.synchronize();
+}
+
+void EngineCore::updateRouting(bool force)
+{
+    const int count = moduleList.count();
+    MidiRoute route;
+
+    if (routes.size() != (unsigned int)count) force = true;
+    for (int l1 = 0; !force && (l1 < count); l1++) {
+        moduleList.at(l1)->midiWorker->getRoute(&route);
+        if (route != routes[l1]) force = true;
+    }
+    if (!force) return;
+
+    std::vector<MidiWorker *> workers(count);
+    routes.resize(count);
+    for (int l1 = 0; l1 < count; l1++) {
+        workers[l1] = moduleList.at(l1)->midiWorker;
+        workers[l1]->getRoute(&routes[l1]);
+    }
+
+    RoutingTable *table = new RoutingTable;
+    table->build(workers, routes);
+    routingTable.publish(table);
+}
+
+void EngineCore::updateCCIndex()
+{
+    MidiCCIndex *index = new MidiCCIndex;
+
+    addGlobalControllers(index);
+    for (int l1 = 0; l1 < moduleList.count(); l1++) {
+        index->add(moduleList.at(l1), *moduleList.at(l1)->ccList);
+    }
+    index->finalize();
+    ccIndex.publish(index);
+}
+
+void EngineCore::sendGroove(int ix)
+{
+    for (int l1 = 0; l1 < moduleList.count(); l1++) {
+        if ((ix != -1) && (l1 != ix)) continue;
+        // grooveTick is only updated on pair steps to keep quantization
+        // newGrooveTick stores the new value temporarily
+        MidiWorker *worker = moduleList.at(l1)->midiWorker;
+        worker->newGrooveTick = grooveTick;
+        worker->grooveVelocity = grooveVelocity;
+        worker->grooveLength = grooveLength;
+        worker->needsGUIUpdate = true;
+    }
+}
+
+bool EngineCore::writeRtStats(const QString& fn)
+{
+    std::vector<RtStats::Module> modules(moduleList.count());
+    for (int l1 = 0; l1 < moduleList.count(); l1++) {
+        modules[l1].name = moduleList.at(l1)->name.toStdString();
+        modules[l1].frame = &moduleList.at(l1)->midiWorker->frameTime;
+        modules[l1].event = &moduleList.at(l1)->midiWorker->eventTime;
+    }
+
+    QFile f(fn);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning("Could not write statistics to %s", qPrintable(fn));
+        return false;
+    }
+    f.write(driver->rtStats.toJson(modules).c_str());
+    return true;
+}
+
+void EngineCore::resetRtStats()
+{
+    driver->rtStats.reset();
+    reportedEventOverflows = 0;
+    reportedEchoOverflows = 0;
+    for (int l1 = 0; l1 < moduleList.count(); l1++) {
+        moduleList.at(l1)->midiWorker->frameTime.reset();
+        moduleList.at(l1)->midiWorker->eventTime.reset();
+    }
+}
+
+bool EngineCore::startCapture(const QString& fn)
+{
+    return driver->capture.open(fn);
+}
+
+void EngineCore::stopCapture()
+{
+    driver->capture.close();
+}
+
+/* All following functions are the realtime core of QMidiArp, shared
+ * by Engine and HeadlessEngine.
+ */
+
+void EngineCore::setStatus(bool on)
+{
+    if (!moduleList.count()) return;
+    if (!on) {
+        for (int l1 = 0; l1 < moduleList.count(); l1++) {
+            moduleList.at(l1)->midiWorker->clearNoteBuffer();
+        }
+    }
+    status = on;
+    driver->setTransportStatus(on);
+    for (int l1 = 0; l1 < moduleList.count(); l1++) {
+        moduleList.at(l1)->parList->engineRunning = on;
+    }
+    if (on) {
+        resetTicks(driver->getCurrentTick());
+        driver->requestEchoAt(0);
+    }
+}
+
+void EngineCore::tick_callback(void * context, bool echo_from_trig)
+{
+  ((EngineCore *)context)->echoCallback(echo_from_trig);
+}
+
+void EngineCore::echoCallback(bool echo_from_trig)
+{
+    int l1, l2, ix;
+    int tol = alsaSyncTol;
+    int tick = driver->getCurrentTick();
+    bool restoreFlag = (restoreRequest >= 0);
+    bool restoreAtEnd = !getTimeMode();
+    int dueCount = 0;
+    const int count = moduleList.count();
+    const uint64_t start_ns = RtStats::now();
+
+    currentTick = tick;
+
+    takeSchedule();
+    if (tickHeapDirty.exchange(false)) rebuildTickHeap();
+
+    TickQueue<int>& heap = schedule->heap;
+    std::vector<int>& dueModules = schedule->dueModules;
+
+    // Take the modules due at this tick from the heap, and handle them
+    // in module order as before
+    while (!heap.isEmpty() && ((int64_t)heap.nextTick() <= tick + tol)) {
+        ix = heap.next();
+        const int64_t queued = heap.nextTick();
+        heap.pop();
+        // entries replaced by a trigger and modules removed since the
+        // last rebuild are skipped
+        if ((ix >= count) || (schedule->queuedTick[ix] != queued)) continue;
+        schedule->queuedTick[ix] = -1;
+        for (l1 = dueCount; l1 && (dueModules[l1 - 1] > ix); l1--)
+            dueModules[l1] = dueModules[l1 - 1];
+        dueModules[l1] = ix;
+        dueCount++;
+    }
+
+    //Module data request and queueing
+    for (l2 = 0; l2 < dueCount; l2++) {
+        l1 = dueModules[l2];
+        MidiWorker *worker = moduleList.at(l1)->midiWorker;
+        const uint64_t frame_ns = RtStats::now();
+        if (worker->prepareNextFrame(echo_from_trig, tol, tick,
+                        restoreAtEnd, &restoreTick, &restoreFlag)) {
+            worker->frameTime.record(RtStats::now() - frame_ns);
+
+            int l3 = 0;
+            while (worker->outFrame[l3].data > -1) {
+                if (!worker->outFrame[l3].muted && !worker->isMuted) {
+                    MidiEvent outEv = mkMidiEvent(
+                                        worker->eventType,
+                                        worker->channelOut,
+                                        worker->outFrame[l3].data,
+                                        worker->outFrame[l3].value);
+                    driver->sendMidiEvent(outEv,
+                                        worker->outFrame[l3].tick,
+                                        worker->portOut,
+                                        worker->returnLength);
+                }
+                l3++;
+            }
+        }
+        queueModule(l1);
+    }
+    if (tickHeapDirty.exchange(false)) rebuildTickHeap();
+
+    //Timing of next echo to be requested (minimum of all modules)
+    if (!heap.isEmpty()) {
+        nextMinTick = (int64_t)heap.nextTick() - schedDelayTicks;
+    }
+    if (nextMinTick < 0) nextMinTick = 0;
+    if (count) driver->requestEchoAt(nextMinTick, 0);
+
+    //Update GlobStore master indicator pacman
+    if (restoreFlag && !restoreAtEnd) {
+        int percent = 100 * (currentTick - requestTick) / (restoreTick - requestTick);
+        restorePercent.store(percent, std::memory_order_relaxed);
+    }
+
+    //Check for parameter restore requests, carried out by update()
+    if ((restoreTick > -1)
+        && (!count || (nextMinTick + schedDelayTicks >= restoreTick))) {
+        restoreTick = -1;
+        schedRestoreLocation.store(restoreRequest);
+    }
+    requestDisplayUpdate();
+    driver->rtStats.echo.record(RtStats::now() - start_ns);
+}
+
+bool EngineCore::midi_event_received_callback(void * context, MidiEvent ev)
+{
+  return ((EngineCore *)context)->eventCallback(ev);
+}
+
+bool EngineCore::eventCallback(MidiEvent inEv)
+{
+    bool unmatched = true;
+    bool no_collision = false;
+    int l1;
+
+    int tick = driver->getCurrentTick();
+
+    requestDisplayUpdate();
+    logEvent(inEv, tick);
+
+    /* from here on we handle Note Off events as Note On / Vel 0 events */
+    if (inEv.type == EV_NOTEOFF) {
+        inEv.type = EV_NOTEON;
+        inEv.value = 0;
+    }
+
+    if (useMidiClock){
+        if (inEv.type == EV_START) {
+            setStatus(true);
+            return(false);
+        }
+        if (inEv.type == EV_STOP) {
+            setStatus(false);
+            return(false);
+        }
+    }
+    const bool learned = learnEvent(inEv);
+
+    // Only the workers whose route accepts the event are called. As
+    // before, the event counts as unmatched unless the last worker
+    // matched it.
+    const RoutingTable *table = routingTable.acquire();
+    int count;
+    MidiWorker * const *workers = table->lookup(inEv, &count);
+    for (l1 = 0; l1 < count; l1++) {
+        MidiWorker *worker = workers[l1];
+        bool worker_unmatched;
+        const uint64_t event_ns = RtStats::now();
+        if (status && (worker->moduleType == MOD_ARP)) {
+            worker_unmatched = worker->handleEvent(inEv, tick, 1);
+        }
+        else {
+            worker_unmatched = worker->handleEvent(inEv, tick);
+        }
+        worker->eventTime.record(RtStats::now() - event_ns);
+        if (worker == table->lastWorker) unmatched = worker_unmatched;
+        if (worker->gotKbdTrig) {
+            queueModule(table->moduleIndex(&workers[l1]));
+            nextMinTick = worker->nextTick;
+            no_collision = driver->requestEchoAt(nextMinTick, true);
+            if (!no_collision) worker->gotKbdTrig = false;
+        }
+    }
+    routingTable.release();
+
+    if ((inEv.type == EV_CONTROLLER) && midiControllable) {
+        if (!learned) sendController(inEv.data, inEv.channel, inEv.value);
+        unmatched = false;
+    }
+
+    return unmatched;
+}
+
+void EngineCore::sendController(int ccnumber, int channel, int value)
+{
+    const MidiCCIndex *index = ccIndex.acquire();
+    int count;
+    const MidiCCTarget *targets = index->lookup(ccnumber, channel, &count);
+
+    for (int l1 = 0; l1 < count; l1++) {
+        targets[l1].handler->handleController(targets[l1].ID,
+                targets[l1].min, targets[l1].max, value);
+    }
+    ccIndex.release();
+}
+
+void EngineCore::resetTicks(int curtick)
+{
+    for (int l1 = 0; l1 < moduleList.count(); l1++) {
+        MidiWorker *worker = moduleList.at(l1)->midiWorker;
+        if (status && (worker->moduleType == MOD_ARP)) {
+            worker->foldReleaseTicks(driver->trStartingTick - curtick);
+        }
+        worker->setNextTick(curtick);
+        if (!l1) nextMinTick = worker->nextTick;
+        if (worker->nextTick < nextMinTick)
+            nextMinTick = worker->nextTick;
+    }
+    tickHeapDirty = true;
+}
+
+void EngineCore::reserveSchedule(int count)
+{
+    delete retiredSchedule.exchange(NULL);
+    if (count <= scheduleCapacity) return;
+
+    while (scheduleCapacity < count) scheduleCapacity *= 2;
+    // a schedule not yet adopted is replaced by the larger one
+    delete pendingSchedule.exchange(new TickSchedule(scheduleCapacity));
+}
+
+void EngineCore::takeSchedule()
+{
+    // the replaced schedule is handed back only after the main thread
+    // deleted the previous one
+    if (retiredSchedule.load()) return;
+
+    TickSchedule *next = pendingSchedule.exchange(NULL);
+    if (!next) return;
+
+    retiredSchedule.store(schedule);
+    schedule = next;
+    tickHeapDirty = true;
+}
+
+void EngineCore::queueModule(int ix)
+{
+    // a module beyond the capacity is queued once its schedule is adopted
+    if (ix >= schedule->capacity()) {
+        tickHeapDirty = true;
+        return;
+    }
+    int64_t nt = moduleList.at(ix)->midiWorker->nextTick;
+    if (nt < 0) nt = 0;
+    if (schedule->queuedTick[ix] == nt) return;
+
+    schedule->queuedTick[ix] = nt;
+    if (!schedule->heap.push(nt, ix)) tickHeapDirty = true;
+}
+
+void EngineCore::rebuildTickHeap()
+{
+    const int count = moduleList.count();
+
+    schedule->heap.clear();
+    for (int l1 = 0; l1 < schedule->capacity(); l1++) {
+        schedule->queuedTick[l1] = -1;
+        if (l1 < count) queueModule(l1);
+    }
+}
+
+void EngineCore::setUseMidiClock(bool on)
+{
+    if (alsaMidi and on)
+        alsaSyncTol = 3000;
+    else
+        alsaSyncTol = 2;
+
+    setStatus(false);
+    driver->setUseMidiClock(on);
+    useMidiClock = on;
+}
+
+void EngineCore::setUseJackTransport(bool on)
+{
+    if (alsaMidi and on)
+        alsaSyncTol = 1000;
+    else
+        alsaSyncTol = 2;
+
+    driver->setUseJackTransport(on);
+}
+
+void EngineCore::setTempo(double bpm)
+{
+    driver->requestTempo(bpm);
+    requestedTempo = bpm;
+    tempo = bpm;
+}
+
+void EngineCore::tempo_callback(double bpm, void *context)
+{
+    ((EngineCore *)context)->requestedTempo = bpm;
+    ((EngineCore *)context)->requestDisplayUpdate();
+}
+
+void EngineCore::tr_state_cb(bool on, void *context)
+{
+    if  (((EngineCore  *)context)->ready) {
+        if (((EngineCore  *)context)->driver->useJackSync) {
+           ((EngineCore  *)context)->setStatus(on);
+           ((EngineCore  *)context)->requestDisplayUpdate();
+        }
+    }
+}
+
+//Global storage
+
+void EngineCore::store(int ix)
+{
+    for (int l1 = 0; l1 < moduleList.count(); l1++) {
+        moduleList.at(l1)->storeParams(ix);
+    }
+}
+
+void EngineCore::removeParStores(int ix)
+{
+    for (int l1 = 0; l1 < moduleList.count(); l1++) {
+        moduleList.at(l1)->parList->removeLocation(ix);
+    }
+}
+
+void EngineCore::requestRestore(int ix)
+{
+    if (status == false) {
+        restore(ix);
+        return;
+    }
+
+    restoreRequest = ix;
+
+    restoreRequested(ix);
+    if (getTimeMode()) {
+        requestTick = currentTick;
+        restoreTick = TPQN * (2 + getSwitchAtBeat()) + currentTick;
+    }
+}
+
+void EngineCore::restore(int ix)
+{
+    for (int l1 = 0; l1 < moduleList.count(); l1++) {
+        moduleList.at(l1)->parList->setRestoreRequest(ix, true);
+        moduleList.at(l1)->parList->oldRestoreRequest = ix;
+    }
+
+    restoreRequest = -1;
+
+    restored(ix);
+}
+
+void EngineCore::updateGlobRestoreTimeModule(int index)
+{
+    if (restoreModIx < moduleList.count()) {
+        moduleList.at(restoreModIx)->parList->isRestoreMaster = false;
+        moduleList.at(restoreModIx)->midiWorker->isRestoreMaster = false;
+    }
+    moduleList.at(index)->parList->isRestoreMaster = true;
+    moduleList.at(index)->midiWorker->isRestoreMaster = true;
+
+    restoreModIx = index;
+}
+
+void EngineCore::update()
+{
+    delete retiredSchedule.exchange(NULL);
+
+    int ix = schedRestoreLocation.exchange(-1);
+    if (ix >= 0) restore(ix);
+
+    updateRouting();
+    reportOverflows();
+
+    for (int l1 = 0; l1 < moduleList.count(); l1++) {
+        updateModule(l1);
+    }
+}
+
+void EngineCore::reportOverflows()
+{
+    if (driver == NULL) return;
+
+    const uint64_t events =
+            driver->rtStats.eventOverflows.load(std::memory_order_relaxed);
+    const uint64_t echoes =
+            driver->rtStats.echoOverflows.load(std::memory_order_relaxed);
+
+    if (events != reportedEventOverflows) {
+        qWarning("Event buffer overflow, %llu overflows so far",
+                (unsigned long long)events);
+        reportedEventOverflows = events;
+    }
+    if (echoes != reportedEchoOverflows) {
+        qWarning("Echo buffer overflow, %llu overflows so far",
+                (unsigned long long)echoes);
+        reportedEchoOverflows = echoes;
+    }
+}
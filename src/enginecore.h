@@ -0,0 +1,354 @@
+/**
+ * @file enginecore.h
+ * @brief Header file for the EngineCore class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+#ifndef ENGINECORE_H
+#define ENGINECORE_H
+
+#include <atomic>
+#include <vector>
+#include <QList>
+#include <QString>
+
+#include "driverbase.h"
+#include "lockfree.h"
+#include "modulecore.h"
+#include "routingtable.h"
+#include "tickqueue.h"
+
+class JackDriver;
+
+/*!
+ * @brief Tick heap of the realtime thread with the storage needed by one
+ * EngineCore::echoCallback()
+ *
+ * It is allocated by the main thread, so that the realtime thread never
+ * allocates when modules are added or triggered. The heap holds twice
+ * as many entries as there are modules, which leaves room for the
+ * stale entries left by keyboard triggers.
+ */
+struct TickSchedule {
+    TickSchedule(int capacity)
+        : heap(2 * capacity), dueModules(capacity), queuedTick(capacity, -1) {}
+    TickQueue<int> heap;            /**< Module indices ordered by tick */
+    std::vector<int> dueModules;    /**< Modules taken from heap during one echo */
+    std::vector<int64_t> queuedTick; /**< Tick of the valid heap entry of each module, -1 if none */
+    int capacity() const { return dueModules.size(); }
+};
+
+/*!
+ * @brief Realtime part of the engine shared by the GUI and the headless
+ * session.
+ *
+ * EngineCore holds the ModuleCore list and dispatches the driver
+ * callbacks to the MidiWorkers of the modules: eventCallback() routes
+ * the received events through the RoutingTable and the controllers
+ * through the MidiCCIndex, echoCallback() takes the due modules from
+ * the tick heap and sends their output. The global storage restores
+ * requested from either side are scheduled here and carried out by
+ * update(), which the owner calls periodically outside the realtime
+ * thread.
+ *
+ * Engine adds the widgets, the MIDI learn and the event log,
+ * HeadlessEngine the session file reading and the offline rendering.
+ * They create the driver with the static callbacks of this class and
+ * provide the hooks for the parts that differ.
+ */
+class EngineCore : public MidiCCHandler
+{
+  protected:
+    QList<ModuleCore *> moduleList;
+    SnapshotStore<RoutingTable> routingTable; /**< Input event routing read by eventCallback() */
+    SnapshotStore<MidiCCIndex> ccIndex; /**< MIDI controller bindings read by sendController() */
+    std::vector<MidiRoute> routes; /**< MidiRoute of each worker the current routingTable was built from */
+    TickSchedule *schedule; /**< Tick heap, only accessed by the realtime thread */
+    std::atomic<TickSchedule *> pendingSchedule; /**< Larger schedule allocated by addModule() for the realtime thread */
+    std::atomic<TickSchedule *> retiredSchedule; /**< Schedule replaced by the realtime thread, deleted by the main thread */
+    int scheduleCapacity;   /**< Capacity of the last schedule allocated by addModule() */
+    std::atomic<bool> tickHeapDirty; /**< Set when the tick heap has to be rebuilt before the next echo */
+
+    int portCount;
+    bool useMidiClock;
+    int alsaSyncTol; /**< Tolerance in ticks set when synching alsa to jack */
+
+    int restoreRequest; /**< Location of a global restore pending while running, -1 if none */
+    int64_t restoreTick; /**< Tick of a timed global restore, -1 if none */
+    std::atomic<int> schedRestoreLocation; /**< Location set by echoCallback() for update() to restore, -1 if none */
+
+    double tempo;
+    double requestedTempo;
+
+    int schedDelayTicks;
+    int nextMinTick;
+    int currentTick;
+    int requestTick;
+    std::atomic<int> restorePercent; /**< Progress of a timed restore published by echoCallback(), -1 if none */
+    uint64_t reportedEventOverflows; /**< Output queue overflows already reported by reportOverflows() */
+    uint64_t reportedEchoOverflows; /**< Echo queue overflows already reported by reportOverflows() */
+
+    static bool midi_event_received_callback(void * context, MidiEvent ev);
+    static void tick_callback(void * context, bool echo_from_trig);
+    static void tr_state_cb(bool tr_state, void * context);
+    static void tempo_callback(double bpm, void *context);
+
+/*!
+* @brief appends a module to the session and publishes its routing and
+* controller bindings to the realtime thread
+*
+* The worker is given a random seed derived from its position in the
+* session, which differs from the seeds of the other modules.
+*/
+    void addModule(ModuleCore *module);
+/*!
+* @brief removes a module from the session
+*
+* Returns once the realtime thread has released all routing tables and
+* controller indices referring to the module, so that the caller can
+* delete the module and its worker.
+*/
+    void removeModule(ModuleCore *module);
+/*!
+* @brief rebuilds and publishes the routingTable if the MidiRoute of a
+* worker changed
+*
+* @param force Rebuild in any case, used when workers are added or removed
+*/
+    void updateRouting(bool force = false);
+/*!
+* @brief allocates a larger TickSchedule for the realtime thread if
+* count modules do not fit in the current one
+*
+* Called from the main thread before a module is appended. The schedule
+* is adopted by takeSchedule(), the one it replaces is deleted here or
+* by update().
+*/
+    void reserveSchedule(int count);
+/*!
+* @brief adopts the schedule allocated by reserveSchedule(), called from
+* the realtime thread
+*/
+    void takeSchedule();
+/*!
+* @brief queues module ix in the tick heap at the nextTick of its worker
+*
+* Called from the realtime thread. A previous entry of the module becomes
+* stale and is skipped when it reaches the top of the heap. If the heap
+* is full, it is rebuilt before the next echo.
+*/
+    void queueModule(int ix);
+/*!
+* @brief refills the tick heap with all workers keyed by their nextTick
+*
+* Called from the realtime thread when tickHeapDirty is set, it removes
+* all stale entries.
+*/
+    void rebuildTickHeap();
+    void resetTicks(int curtick);
+/*!
+* @brief warns about the driver queue overflows counted since the last
+* call
+*
+* The drivers only count the overflows in DriverBase::rtStats, since
+* they cannot print from the realtime thread. Called by update().
+*/
+    void reportOverflows();
+
+/*! @brief adds the bindings not belonging to a module to the index */
+    virtual void addGlobalControllers(MidiCCIndex *index) = 0;
+/*! @brief returns 0 for global restores at the end of the restore
+ * master module, 1 for restores after getSwitchAtBeat() beats */
+    virtual int getTimeMode() = 0;
+    virtual int getSwitchAtBeat() = 0;
+/*! @brief requests a display update, called from any thread */
+    virtual void requestDisplayUpdate() { }
+/*! @brief passes a received event to the event log, called from the
+ * realtime thread */
+    virtual void logEvent(const MidiEvent& ev, int tick)
+    {
+        (void)ev; (void)tick;
+    }
+/*!
+* @brief handles a received event for MIDI learn, called from the
+* realtime thread
+*
+* @return True if a controller was learned and must not be sent to the
+* bindings
+*/
+    virtual bool learnEvent(const MidiEvent& ev) { (void)ev; return false; }
+/*! @brief is called when a global restore of location ix becomes pending */
+    virtual void restoreRequested(int ix) { (void)ix; }
+/*! @brief is called when all modules were requested to restore location ix */
+    virtual void restored(int ix) { (void)ix; }
+/*! @brief updates module ix outside the realtime thread, called by update() */
+    virtual void updateModule(int ix) { moduleList.at(ix)->update(); }
+
+  public:
+    EngineCore(int p_portCount);
+    virtual ~EngineCore();
+
+    int grooveTick, grooveVelocity, grooveLength;
+    int restoreModIx;   /**< Index of the restore master module */
+    bool midiControllable;
+    bool status;
+    bool ready;
+    bool alsaMidi;      /**< True when using alsa MIDI driver */
+    JackDriver *jackSync;
+    DriverBase *driver;
+
+    int getPortCount() { return portCount; }
+    int getClientId() { return driver->getClientId(); }
+    int moduleCount() { return moduleList.count(); }
+    ModuleCore *module(int index) { return moduleList.at(index); }
+
+/*!
+* @brief  Sets the transport status running or stopped
+*
+* Clears all note buffers when stopping and calls the transport
+* start/stop functions of the driver backend.
+*
+* @param on Run or Stop
+*/
+    void setStatus(bool on);
+    void setTempo(double bpm);
+/*!
+* @brief turns on and off MIDI realtime clock synchronization
+*
+* It stops the transport and calls DriverBase::setUseMidiClock().
+*/
+    void setUseMidiClock(bool on);
+/*! @brief turns on and off JACK Transport synchronization */
+    void setUseJackTransport(bool on);
+/*!
+* @brief sends the groove settings to the module ix, to all modules
+* if ix is -1
+*/
+    void sendGroove(int ix = -1);
+/*!
+* @brief rebuilds EngineCore::ccIndex from the controller bindings of
+* the session and publishes it to the realtime thread
+*/
+    void updateCCIndex();
+/*!
+* @brief Dispatches a controller MIDI event to all concerned handlers
+*
+* The handlers bound to this controller are looked up in
+* EngineCore::ccIndex.
+*
+* @param ccnumber MIDI Control Event number
+* @param channel MIDI Control Event channel
+* @param value MIDI Control Event value
+*/
+    void sendController(int ccnumber, int channel, int value);
+/*!
+* @brief causes all modules to store their current parameters in their
+* ParList::list at index ix
+*/
+    void store(int ix);
+/*!
+* @brief causes all modules to remove their entries in the ParList::list
+* at index ix
+*/
+    void removeParStores(int ix);
+/*!
+* @brief restores location ix at once when stopped, otherwise at the
+* end of the restore master module or after the configured beats
+*/
+    void requestRestore(int ix);
+/*!
+* @brief causes all modules to restore their parameters from its
+* ParList::list at index ix.
+*/
+    void restore(int ix);
+/*!
+* @brief makes module index trigger the global restores when it
+* reaches its end
+*/
+    void updateGlobRestoreTimeModule(int index);
+/*!
+* @brief writes the realtime statistics of the driver and of all modules
+* as JSON document
+*
+* @param fn Path of the output file
+* @return False if the file could not be written
+*/
+    bool writeRtStats(const QString& fn);
+/*! @brief clears the realtime statistics of the driver and the modules */
+    void resetRtStats();
+/*!
+* @brief starts recording all received and sent events to a capture
+* file
+*
+* The events are recorded by the driver backend in DriverBase::capture,
+* including the MIDI clock and the forwarded unmatched events.
+*
+* @param fn Path of the capture file
+* @return False if the file could not be created
+* @see MidiCapture
+*/
+    bool startCapture(const QString& fn);
+/*! @brief stops the capture started by startCapture() */
+    void stopCapture();
+/*!
+* @brief does the work that cannot be done in the realtime thread
+*
+* Restores the location scheduled by echoCallback(), rebuilds the
+* routing if a module changed its input settings, reports queue
+* overflows and calls updateModule() for each module.
+*/
+    void update();
+
+/*!
+* @brief called by the driver at the time a MIDI event is received.
+*
+* It passes the event to the modules whose route accepts it, and the
+* controllers to the handlers bound to them.
+*
+* @param inEv MidiEvent structure that should be handled
+* @return True if no module took the event, which is then forwarded
+*/
+    bool eventCallback(MidiEvent inEv);
+/**
+ * @brief core function called by the driver every time an echo is pending
+ *
+ * It takes the modules whose nextTick is reached from the tick heap,
+ * has them prepare their next frame and sends the resulting events to
+ * the driver queue along with their tick time. It then requests the
+ * next echo and schedules pending global restores for update().
+ *
+ * @param echo_from_trig True if this echo was generated by a trigger through
+ * and incoming MIDI event
+ */
+    void echoCallback(bool echo_from_trig);
+
+/*! @brief Convenience function for creating a new MidiEvent struct */
+    MidiEvent mkMidiEvent(int type, int channel=0, int data=0, int value=0)
+    {
+        MidiEvent ev;
+        ev.type = type;
+        ev.channel = channel;
+        ev.data = data;
+        ev.value = value;
+        return ev;
+    }
+};
+
+#endif
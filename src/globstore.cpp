@@ -40,6 +40,7 @@ GlobStore::GlobStore(QWidget *parent)
     activeStore = 0;
     currentRequest = 0;
     switchAtBeat = 0;
+    timeMode = 0;
 
     storeSignalMapper = new QSignalMapper(this);
     connect(storeSignalMapper, SIGNAL(mapped(int)),
@@ -216,6 +217,7 @@ void GlobStore::updateTimeModule(int ix)
 
 void GlobStore::updateTimeModeBox(int ix)
 {
+    timeMode = ix;
     if (ix == 0) {
         switchAtBeatBox->hide();
         timeModuleBox->show();
@@ -379,18 +381,11 @@ void GlobStore::skipXmlElement(QXmlStreamReader& xml)
     }
 }
 
-void GlobStore::handleController(int ccnumber, int channel, int value)
+void GlobStore::handleController(int controlID, int min, int max, int value)
 {
-    if (!midiControl->ccList.count()) return;
+    if (controlID != GLOB_RESTORE) return;
 
-    MidiCC midiCC = midiControl->ccList.at(GLOB_RESTORE);
-    int sval, min, max;
-
-    if ((ccnumber != midiCC.ccnumber) || (channel != midiCC.channel)) return;
-
-    min = midiCC.min;
-    max = midiCC.max;
-    sval = min + ((double)value * (max - min) / 127);
+    int sval = min + ((double)value * (max - min) / 127);
     if ((sval < widgetList.count() - 1)
             && (sval != activeStore)
             && (sval != currentRequest)) {
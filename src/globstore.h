@@ -46,7 +46,7 @@
 
  * @brief Global Parameter Storage UI. Instantiated by MainWindow.
  */
-class GlobStore : public QWidget
+class GlobStore : public QWidget, public MidiCCHandler
 
 {
   Q_OBJECT
@@ -73,6 +73,7 @@ class GlobStore : public QWidget
     Indicator *indicator;
     QList<QWidget*> widgetList;
     int switchAtBeat; /**< number of beats after which parameter restore is done in Engine */
+    int timeMode; /**< Index of timeModeBox, read by Engine in the realtime thread */
 
 /*!
  * @brief ENUM for Internal MIDI Control IDs supported 
@@ -113,7 +114,7 @@ class GlobStore : public QWidget
 * @param xml QXmlStreamWriter to write to
 */
     void writeData(QXmlStreamWriter& xml);
-    void handleController(int ccnumber, int channel, int value);
+    void handleController(int controlID, int min, int max, int value) override;
     bool isModified() { return modified;};
     void setModified(bool on) { modified = on; };
 #ifdef APPBUILD
@@ -77,35 +77,26 @@ void GrooveWidget::updateGrooveLength(int val)
 {
     emit(newGrooveLength(val));
 }
-void GrooveWidget::handleController(int ccnumber, int channel, int value)
+void GrooveWidget::handleController(int controlID, int min, int max, int value)
 {
-    QVector<MidiCC> cclist= midiControl->ccList;
-
-    for (int l2 = 0; l2 < cclist.count(); l2++) {
-        int min = cclist.at(l2).min;
-        int max = cclist.at(l2).max;
-        int sval = min + ((double)value * (max - min) / 127);
-        if ((ccnumber == cclist.at(l2).ccnumber) &&
-            (channel == cclist.at(l2).channel)) {
-            switch (cclist.at(l2).ID) {
-                case GROOVE_TICK:
-                        tickVal = sval;
-                break;
-
-                case GROOVE_VELOCITY:
-                        velocityVal = sval;
-                break;
-
-                case GROOVE_LENGTH:
-                        lengthVal = sval;
-                break;
-
-                default:
-                break;
-            }
-            needsGUIUpdate = true;
-        }
+    int sval = min + ((double)value * (max - min) / 127);
+    switch (controlID) {
+        case GROOVE_TICK:
+                tickVal = sval;
+        break;
+
+        case GROOVE_VELOCITY:
+                velocityVal = sval;
+        break;
+
+        case GROOVE_LENGTH:
+                lengthVal = sval;
+        break;
+
+        default:
+        break;
     }
+    needsGUIUpdate = true;
 }
 void GrooveWidget::readData(QXmlStreamReader& xml)
 {
@@ -39,7 +39,7 @@
  * Each Slider controls a groove setting transmitted to Engine at every change.
  *
  */
-class GrooveWidget : public QWidget
+class GrooveWidget : public QWidget, public MidiCCHandler
 
 {
   Q_OBJECT
@@ -101,7 +101,7 @@ class GrooveWidget : public QWidget
     void updateGrooveVelocity(int);
     void updateGrooveTick(int);
     void updateGrooveLength(int);
-    void handleController(int ccnumber, int channel, int value);
+    void handleController(int controlID, int min, int max, int value) override;
     void updateDisplay();
 };
 
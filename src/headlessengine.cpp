@@ -0,0 +1,588 @@
+/**
+ * @file headlessengine.cpp
+ * @brief Implementation of the HeadlessEngine class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#include <csignal>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+
+#include "headlessengine.h"
+#include "globstore.h"
+#include "groovewidget.h"
+#include "smffile.h"
+
+static volatile sig_atomic_t quitRequested = 0;
+
+static void quitHandler(int sig)
+{
+    (void)sig;
+    quitRequested = 1;
+}
+
+HeadlessEngine::HeadlessEngine(int p_portCount, int p_backend, QObject *parent)
+            : QObject(parent), EngineCore(p_portCount)
+{
+    jackFailed = false;
+    offlineDriver = NULL;
+    offline = (p_backend == BACKEND_OFFLINE) || (p_backend == BACKEND_NULL);
+    prefs.portCount = portCount;
+
+    if (p_backend == BACKEND_OFFLINE) {
+        offlineDriver = new OfflineDriver(portCount, (EngineCore *)this,
+                midi_event_received_callback, tick_callback);
+        driver = offlineDriver;
+    }
+    else if (p_backend == BACKEND_NULL) {
+        driver = new NullDriver(portCount, (EngineCore *)this,
+                midi_event_received_callback, tick_callback);
+    }
+#ifdef HAVE_ALSA
+    else if (p_backend == BACKEND_ALSA) {
+    // As in Engine, JackDriver is only used for Jack Transport sync here
+        jackSync = new JackDriver(0, (EngineCore *)this, tr_state_cb,
+                midi_event_received_callback, tick_callback, tempo_callback);
+        connect(jackSync, SIGNAL(j_shutdown()), this, SLOT(jackShutdown()));
+        driver = new SeqDriver(jackSync, portCount, (EngineCore *)this,
+                midi_event_received_callback, tick_callback);
+    }
+#endif
+    else {
+        driver = new JackDriver(portCount, (EngineCore *)this, tr_state_cb,
+                midi_event_received_callback, tick_callback, tempo_callback);
+        connect((JackDriver *)driver, SIGNAL(j_shutdown()),
+                this, SLOT(jackShutdown()));
+        if (((JackDriver *)driver)->callJack(portCount, PACKAGE))
+            jackFailed = true;
+    }
+
+    alsaMidi = (p_backend == BACKEND_ALSA);
+    grooveTickVal = 0;
+    grooveVelocityVal = 0;
+    grooveLengthVal = 0;
+    grooveChanged = false;
+
+    timeMode = 0;
+    switchAtBeat = 0;
+    locationCount = 0;
+    globActiveStore = 0;
+    globCurrentRequest = 0;
+    globSchedRestore = -1;
+
+    loadPatternPresets();
+    resetTicks(0);
+    updateCCIndex();
+
+    updateTimer = new QTimer(this);
+    connect(updateTimer, SIGNAL(timeout()), this, SLOT(update()));
+    // render() and the benchmark call update() themselves
+    if (!offline) updateTimer->start(5);
+    ready = true;
+}
+
+HeadlessEngine::~HeadlessEngine()
+{
+    if (status) setStatus(false);
+    delete driver;
+    if (jackSync) delete jackSync;
+    for (int l1 = 0; l1 < moduleList.count(); l1++) {
+        delete moduleList.at(l1)->midiWorker;
+        delete moduleList.at(l1);
+    }
+}
+
+void HeadlessEngine::installSignalHandlers()
+{
+    signal(SIGINT, quitHandler);
+    signal(SIGTERM, quitHandler);
+}
+
+void HeadlessEngine::loadPatternPresets()
+{
+    QString qs;
+    QStringList value;
+
+    QDir qmahome = QDir(QDir::homePath());
+    QString qmarcpath = qmahome.filePath(QMARCNAME);
+    QFile f(qmarcpath);
+
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning("Could not read the pattern presets from %s",
+                qPrintable(qmarcpath));
+        return;
+    }
+    QTextStream loadText(&f);
+
+    while (!loadText.atEnd()) {
+        qs = loadText.readLine();
+        if (qs.startsWith('#')) {
+            value.clear();
+            value = qs.split('%');
+            if ((value.at(0) == "#Pattern") && (value.count() > 2)) {
+                patternPresets << value.at(2);
+            }
+        }
+    }
+}
+
+//File loading
+
+bool HeadlessEngine::openFile(const QString& fn)
+{
+    QString qmaxVersion = "";
+
+    QFile f(fn);
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning("Could not read from file %s", qPrintable(fn));
+        return false;
+    }
+
+    QXmlStreamReader xml(&f);
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (xml.isStartElement()) {
+            if (xml.name() != "session") {
+                qWarning("%s is not a valid xml file for %s",
+                        qPrintable(fn), APP_NAME);
+                return false;
+            }
+            if (xml.attributes().hasAttribute("qMaxVersion")) {
+                qmaxVersion = xml.attributes().value("qMaxVersion").toString();
+            }
+            while (!xml.atEnd()) {
+                xml.readNext();
+
+                if (xml.isEndElement())
+                    break;
+
+                if ((xml.isStartElement()) && (xml.name() == "global"))
+                    readFilePartGlobal(xml);
+                else if (xml.isStartElement() && (xml.name() == "modules"))
+                    readFilePartModules(xml, qmaxVersion);
+                else if (xml.isStartElement() && (xml.name() == "globalstorage"))
+                    readFilePartGlobalStorage(xml);
+                else if (xml.isStartElement() && (xml.name() == "GUI"))
+                    xml.skipCurrentElement();
+                else skipXmlElement(xml);
+            }
+        }
+        else skipXmlElement(xml);
+    }
+    if (xml.hasError()) {
+        qWarning("Error reading %s: %s", qPrintable(fn),
+                qPrintable(xml.errorString()));
+        return false;
+    }
+
+    initSession();
+    if (!offline && !driver->useJackSync && !useMidiClock) setStatus(true);
+
+    return true;
+}
+
+ModuleCore *HeadlessEngine::addModule(int moduleType, const QString& name)
+{
+    ModuleCore *module;
+
+    if (moduleType == MOD_ARP)
+        module = new ArpCore(new MidiArp(), &prefs, name, &patternPresets);
+    else if (moduleType == MOD_LFO)
+        module = new LfoCore(new MidiLfo(), &prefs, name);
+    else if (moduleType == MOD_SEQ)
+        module = new SeqCore(new MidiSeq(), &prefs, name);
+    else return NULL;
+
+    module->parList->engineRunning = status;
+    EngineCore::addModule(module);
+
+    return module;
+}
+
+void HeadlessEngine::initSession()
+{
+    updateRouting(true);
+    tickHeapDirty = true;
+    updateCCIndex();
+    grooveTickVal = grooveTick;
+    grooveVelocityVal = grooveVelocity;
+    grooveLengthVal = grooveLength;
+    sendGroove();
+    if (moduleList.count()) {
+        if (restoreModIx >= moduleList.count()) restoreModIx = 0;
+        updateGlobRestoreTimeModule(restoreModIx);
+    }
+}
+
+bool HeadlessEngine::render(const QString& inName, const QString& outName,
+        int beats)
+{
+    SmfFile smfIn;
+    SmfFile smfOut;
+    uint64_t endTick;
+    bool hasTempo = false;
+
+    if (!offlineDriver) return false;
+
+    if (!inName.isEmpty() && CaptureReader::isCaptureFile(inName)) {
+        if (!queueCaptureInput(inName)) return false;
+    }
+    else if (!inName.isEmpty()) {
+        if (!smfIn.read(inName)) {
+            qWarning("Could not read %s: %s", qPrintable(inName),
+                    qPrintable(smfIn.errorString));
+            return false;
+        }
+        smfOut.division = smfIn.division;
+    }
+
+    for (int l1 = 0; l1 < smfIn.events.count(); l1++) {
+        const SmfFile::Event& ev = smfIn.events.at(l1);
+        if (ev.port < 0) {
+            // the tempo map of the input is kept in the output
+            smfOut.events.append(ev);
+            if (!ev.tick) hasTempo = true;
+            continue;
+        }
+        offlineDriver->queueInput(ev.tick * TPQN / smfIn.division,
+                (const unsigned char *)ev.data.constData(), ev.data.size());
+    }
+    if (!hasTempo) smfOut.appendTempo(0, tempo);
+
+    if (beats > 0)
+        endTick = (uint64_t)beats * TPQN;
+    else if (smfIn.events.count() || offlineDriver->inputEndTick())
+        endTick = (offlineDriver->inputEndTick() / TPQN + 1) * TPQN;
+    else
+        endTick = 16 * TPQN;
+
+    setStatus(true);
+    for (uint64_t tick = 0; tick < endTick; tick += RENDER_STEP) {
+        if (quitRequested) {
+            qWarning("Rendering interrupted");
+            return false;
+        }
+        offlineDriver->process((tick + RENDER_STEP < endTick)
+                ? tick + RENDER_STEP : endTick);
+        update();
+    }
+    setStatus(false);
+    offlineDriver->flush();
+
+    for (unsigned int l1 = 0; l1 < offlineDriver->output.size(); l1++) {
+        const OfflineDriver::RawEvent& raw = offlineDriver->output[l1];
+        smfOut.appendMessage((raw.tick * smfOut.division + TPQN / 2) / TPQN,
+                raw.port, raw.data, raw.size);
+    }
+    if (!smfOut.write(outName)) {
+        qWarning("Could not write %s: %s", qPrintable(outName),
+                qPrintable(smfOut.errorString));
+        return false;
+    }
+    printf("Rendered %llu ticks, %u events to %s\n",
+            (unsigned long long)endTick,
+            (unsigned int)offlineDriver->output.size(), qPrintable(outName));
+    return true;
+}
+
+bool HeadlessEngine::queueCaptureInput(const QString& fn)
+{
+    CaptureReader capIn;
+    unsigned char data[3];
+    uint64_t base = 0;
+    uint64_t last = 0;
+    bool first = true;
+
+    if (!capIn.open(fn)) {
+        qWarning("Could not read %s: %s", qPrintable(fn),
+                qPrintable(capIn.errorString));
+        return false;
+    }
+
+    for (uint64_t l1 = 0; l1 < capIn.count; l1++) {
+        const CaptureRecord& rec = capIn.records[l1];
+        if (rec.direction != CAPTURE_IN) continue;
+        const int size = CaptureReader::toRaw(rec, data);
+        if (!size) continue;
+
+        uint64_t tick = rec.tick * TPQN / capIn.header->tpqn;
+        if (first) {
+            base = tick / TPQN * TPQN;
+            first = false;
+        }
+        // a transport restart during the capture makes ticks go back,
+        // the events are kept in capture order
+        tick = (tick > base) ? tick - base : 0;
+        if (tick < last) tick = last;
+        last = tick;
+        offlineDriver->queueInput(tick, data, size);
+    }
+    return true;
+}
+
+void HeadlessEngine::readFilePartGlobal(QXmlStreamReader& xml)
+{
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (xml.isEndElement()) {
+            break;
+        }
+        if (xml.name() == "tempo") {
+            setTempo(xml.readElementText().toInt());
+        }
+        if (xml.isStartElement() && (xml.name() == "settings")) {
+            while (!xml.atEnd()) {
+                xml.readNext();
+                if (xml.isEndElement())
+                    break;
+                if (xml.name() == "midiControlEnabled") {
+                    midiControllable = xml.readElementText().toInt();
+                    prefs.midiControllable = midiControllable;
+                }
+                else if (xml.name() == "midiClockEnabled") {
+                    bool tmp = xml.readElementText().toInt();
+                    if (alsaMidi && !offline && tmp) setUseMidiClock(true);
+                }
+                else if (xml.name() == "jackSyncEnabled") {
+                    bool tmp = xml.readElementText().toInt();
+                    if (tmp && !offline && !useMidiClock)
+                        setUseJackTransport(true);
+                }
+                else if (xml.name() == "forwardUnmatched") {
+                    prefs.forwardUnmatched = xml.readElementText().toInt();
+                    driver->setForwardUnmatched(prefs.forwardUnmatched);
+                }
+                else if (xml.name() == "storeMuteState")
+                    prefs.storeMuteState = xml.readElementText().toInt();
+                else if (xml.name() == "forwardPort") {
+                    prefs.portUnmatched = xml.readElementText().toInt();
+                    driver->setPortUnmatched(prefs.portUnmatched);
+                }
+                else if (xml.name() == "outputMidiClock") {
+                    prefs.outputMidiClock = xml.readElementText().toInt();
+                    driver->setOutputMidiClock(prefs.outputMidiClock);
+                }
+                else if (xml.name() == "midiClockPort") {
+                    prefs.portMidiClock = xml.readElementText().toInt();
+                    driver->setPortMidiClock(prefs.portMidiClock);
+                }
+                else if (xml.name() == "dinPorts") {
+                    prefs.dinPorts = xml.readElementText().toULongLong();
+                    for (int l1 = 0; l1 < portCount; l1++) {
+                        driver->setPortBandwidthLimited(l1,
+                                (prefs.dinPorts >> l1) & 1);
+                    }
+                }
+                else skipXmlElement(xml);
+            }
+        }
+        else if (xml.isStartElement() && (xml.name() == "groove")) {
+            while (!xml.atEnd()) {
+                xml.readNext();
+                if (xml.isEndElement())
+                    break;
+                if (xml.name() == "tick")
+                    grooveTick = xml.readElementText().toInt();
+                else if (xml.name() == "velocity")
+                    grooveVelocity = xml.readElementText().toInt();
+                else if (xml.name() == "length")
+                    grooveLength = xml.readElementText().toInt();
+                else if (xml.isStartElement() && (xml.name() == "midiControllers"))
+                    MidiControl::readCcList(xml, &grooveCcList, CTRL_GROOVE);
+                else skipXmlElement(xml);
+            }
+        }
+        else if (xml.isStartElement() && (xml.name() == "midiControllers"))
+            MidiControl::readCcList(xml, &ccList, CTRL_TEMPO);
+        else skipXmlElement(xml);
+    }
+}
+
+void HeadlessEngine::readFilePartModules(QXmlStreamReader& xml,
+        const QString& qmaxVersion)
+{
+    while (!xml.atEnd()) {
+        xml.readNext();
+
+        if (xml.isEndElement())
+            break;
+
+        if (!xml.isStartElement()) {
+            skipXmlElement(xml);
+            continue;
+        }
+
+        QString name = xml.name() + ":" + xml.attributes().value("name").toString();
+        int moduleType;
+        if (xml.name() == "Arp")
+            moduleType = MOD_ARP;
+        else if (xml.name() == "LFO")
+            moduleType = MOD_LFO;
+        else if (xml.name() == "Seq")
+            moduleType = MOD_SEQ;
+        else {
+            skipXmlElement(xml);
+            continue;
+        }
+
+        ModuleCore *module = addModule(moduleType, name);
+        module->readData(xml, qmaxVersion);
+
+        if (moduleList.count() == 1)
+            locationCount = module->parList->list.count();
+    }
+}
+
+void HeadlessEngine::readFilePartGlobalStorage(QXmlStreamReader& xml)
+{
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (xml.isEndElement())
+            break;
+        if (xml.name() == "timeMode")
+            timeMode = xml.readElementText().toInt();
+        else if (xml.name() == "switchAtBeat")
+            switchAtBeat = xml.readElementText().toInt();
+        else if (xml.name() == "timeModule") {
+            int tmp = xml.readElementText().toInt();
+            if (tmp > -1) restoreModIx = tmp;
+        }
+        else if (xml.isStartElement() && (xml.name() == "midiControllers"))
+            MidiControl::readCcList(xml, &globStoreCcList, CTRL_GLOBSTORE);
+        else skipXmlElement(xml);
+    }
+}
+
+void HeadlessEngine::skipXmlElement(QXmlStreamReader& xml)
+{
+    if (xml.isStartElement()) {
+        qWarning("Unknown Element in XML File: %s",qPrintable(xml.name().toString()));
+        while (!xml.atEnd()) {
+            xml.readNext();
+
+            if (xml.isEndElement())
+                break;
+
+            if (xml.isStartElement()) {
+                skipXmlElement(xml);
+            }
+        }
+    }
+}
+
+//Controllers
+
+void HeadlessEngine::addGlobalControllers(MidiCCIndex *index)
+{
+    index->add(this, ccList);
+    index->add(this, grooveCcList);
+    index->add(this, globStoreCcList);
+}
+
+void HeadlessEngine::handleController(int controlID, int min, int max, int value)
+{
+    int sval = min + ((double)value * (max - min) / 127);
+
+    if (controlID >= CTRL_GLOBSTORE) {
+        if (controlID - CTRL_GLOBSTORE != GlobStore::GLOB_RESTORE) return;
+        if ((sval < locationCount) && (sval != globActiveStore)
+                && (sval != globCurrentRequest)) {
+            globSchedRestore = sval;
+        }
+    }
+    else if (controlID >= CTRL_GROOVE) {
+        switch (controlID - CTRL_GROOVE) {
+            case GrooveWidget::GROOVE_TICK:
+                grooveTickVal = sval;
+            break;
+            case GrooveWidget::GROOVE_VELOCITY:
+                grooveVelocityVal = sval;
+            break;
+            case GrooveWidget::GROOVE_LENGTH:
+                grooveLengthVal = sval;
+            break;
+            default:
+                return;
+        }
+        grooveChanged = true;
+    }
+    else {
+        if ((driver->useJackSync) || (driver->useMidiClock)) return;
+        requestedTempo = sval;
+    }
+}
+
+//Global storage
+
+void HeadlessEngine::requestRestore(int ix)
+{
+    globCurrentRequest = ix;
+    EngineCore::requestRestore(ix);
+}
+
+void HeadlessEngine::update()
+{
+    if (quitRequested && !offline) {
+        quitRequested = 0;
+        QCoreApplication::quit();
+        return;
+    }
+
+    if (globSchedRestore >= 0) {
+        requestRestore(globSchedRestore);
+        globSchedRestore = -1;
+    }
+
+    if (grooveChanged) {
+        grooveChanged = false;
+        grooveTick = grooveTickVal;
+        grooveVelocity = grooveVelocityVal;
+        grooveLength = grooveLengthVal;
+        sendGroove();
+    }
+
+    EngineCore::update();
+
+    if (requestedTempo != tempo) {
+        if ((driver->useJackSync) || (driver->useMidiClock))
+            tempo = requestedTempo;
+        else
+            setTempo(requestedTempo);
+    }
+}
+
+void HeadlessEngine::jackShutdown()
+{
+    if (!alsaMidi) {
+        qWarning("JACK has shut down or could not be started, but %s runs\n"
+                "with JACK MIDI backend. The ALSA MIDI backend can be used\n"
+                "by calling %s -a --headless", PACKAGE, PACKAGE);
+        jackFailed = true;
+        QCoreApplication::quit();
+    }
+    else {
+        setStatus(false);
+        setUseJackTransport(false);
+        setStatus(true);
+    }
+}
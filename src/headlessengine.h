@@ -0,0 +1,216 @@
+/**
+ * @file headlessengine.h
+ * @brief Header file for the HeadlessEngine class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+#ifndef HEADLESSENGINE_H
+#define HEADLESSENGINE_H
+
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+
+#include "jackdriver.h"
+#include "seqdriver.h"
+#include "enginecore.h"
+#include "nulldriver.h"
+#include "offlinedriver.h"
+#include "prefs.h"
+#include "config.h"
+
+/*!
+ * @brief Engine running a session without GUI, used with the --headless
+ * option.
+ *
+ * HeadlessEngine reads a .qmax session file into ModuleCore objects
+ * and runs them on the same JACK or ALSA driver backend and with the
+ * same EngineCore realtime dispatch as Engine. No widget is created,
+ * so that it runs under a QCoreApplication without display.
+ *
+ * The session is controlled by the MIDI controllers bound in the file,
+ * which restore the module and global storage locations and change the
+ * module parameters, the groove and the tempo as in the GUI. The
+ * transport follows JACK Transport or the MIDI clock if either is
+ * enabled in the session, otherwise it starts once the file is loaded.
+ *
+ * With the offline backend, the session is not run in realtime but
+ * rendered by render() from an input Standard MIDI File to an output
+ * file, using an OfflineDriver. With the null backend, the modules are
+ * created by addModule() and driven through a NullDriver by the
+ * qmidiarp-bench program.
+ */
+class HeadlessEngine : public QObject, public EngineCore  {
+
+  Q_OBJECT
+
+  private:
+/*!
+ * @brief Offsets of the controller IDs of the global bindings in
+ * EngineCore::ccIndex
+ *
+ * The tempo, groove and global storage bindings are all handled by
+ * HeadlessEngine::handleController(), their IDs are moved apart so that
+ * they can be told from each other.
+ */
+    enum {
+        CTRL_TEMPO = 0,
+        CTRL_GROOVE = 0x100,
+        CTRL_GLOBSTORE = 0x200,
+    };
+    /*! @brief Ticks rendered between two calls of update(), which is
+     * about the 5 ms of the update timer at 120 bpm */
+    enum { RENDER_STEP = TPQN / 100 };
+
+    QVector<MidiCC> ccList;     /**< Tempo controller bindings */
+    QVector<MidiCC> grooveCcList; /**< Groove controller bindings */
+    QVector<MidiCC> globStoreCcList; /**< Global storage controller bindings */
+    QStringList patternPresets; /**< Arp pattern presets of the .qmidiarprc file */
+    Prefs prefs;
+    QTimer *updateTimer;
+
+    bool offline;       /**< Set for the offline and the null backend */
+    OfflineDriver *offlineDriver;
+
+    int grooveTickVal, grooveVelocityVal, grooveLengthVal; /**< Set by handleController() */
+    bool grooveChanged;
+
+    int timeMode;       /**< 0: global restore at the end of the restore master, 1: after switchAtBeat beats */
+    int switchAtBeat;
+    int locationCount;  /**< Number of global storage locations */
+    int globActiveStore;
+    int globCurrentRequest;
+    int globSchedRestore; /**< Location requested by controller, -1 if none */
+
+/*!
+* @brief queues the received events of a capture file as input of the
+* offlineDriver
+*
+* @return False if the file could not be read
+*/
+    bool queueCaptureInput(const QString& fn);
+    void loadPatternPresets();
+
+    void readFilePartGlobal(QXmlStreamReader& xml);
+    void readFilePartModules(QXmlStreamReader& xml, const QString& qmaxVersion);
+    void readFilePartGlobalStorage(QXmlStreamReader& xml);
+    void skipXmlElement(QXmlStreamReader& xml);
+
+  protected:
+    void addGlobalControllers(MidiCCIndex *index) override;
+    int getTimeMode() override { return timeMode; }
+    int getSwitchAtBeat() override { return switchAtBeat; }
+    void restored(int ix) override { globActiveStore = ix; }
+
+  public:
+    /*! @brief Driver backends, selected at construction */
+    enum Backend {
+        BACKEND_JACK = 0,
+        BACKEND_ALSA,
+        BACKEND_OFFLINE,
+        BACKEND_NULL,
+    };
+
+    bool jackFailed;
+
+  public:
+    HeadlessEngine(int p_portCount, int p_backend, QObject *parent = 0);
+    ~HeadlessEngine();
+
+/*!
+* @brief loads a .qmax session file
+*
+* Must be called once before the engine runs. Starts the transport
+* unless it is synchronized to JACK Transport or the MIDI clock.
+*
+* @param fn Path of the session file
+* @return False if the file could not be read
+*/
+    bool openFile(const QString& fn);
+/*!
+* @brief creates a module with default parameters and appends it to the
+* session
+*
+* Used by openFile() and for sessions set up without file. initSession()
+* has to be called once all modules are added and configured.
+*
+* @param moduleType MOD_ARP, MOD_LFO or MOD_SEQ
+* @param name Name of the module
+* @return The new module, NULL for an unknown type
+*/
+    ModuleCore *addModule(int moduleType, const QString& name);
+/*!
+* @brief publishes the routing and controller bindings of the modules
+* to the realtime thread and sends them the groove settings
+*/
+    void initSession();
+/*!
+* @brief renders the loaded session offline to a Standard MIDI File
+*
+* Only available with the offline backend. The input events are passed
+* to the modules at their tick, the transport starts at tick 0 and runs
+* for the given number of beats as fast as possible. The driver is
+* processed in steps of RENDER_STEP ticks, each followed by update(),
+* so that the restores and controller changes of the ModuleCore objects
+* are applied as in a realtime session. The output file
+* has the time division of the input file, and its tempo changes or
+* the session tempo.
+*
+* The input file can also be a capture file written by MidiCapture, in
+* which case its received events are replayed, shifted so that the
+* beat of the first one is at tick 0.
+*
+* @param inName Path of the input file, can be empty
+* @param outName Path of the output file
+* @param beats Length of the rendering, 0 to end with the beat
+* following the last input event, or after 16 beats without input
+* @return False if a file could not be read or written
+*/
+    bool render(const QString& inName, const QString& outName, int beats);
+/*!
+* @brief installs handlers for SIGINT and SIGTERM, which make update()
+* quit the application
+*/
+    static void installSignalHandlers();
+/*! @brief records the requested location for the GLOB_RESTORE
+ * controller before calling EngineCore::requestRestore() */
+    void requestRestore(int ix);
+
+/*!
+* @brief handles the tempo, groove and global storage controllers
+*
+* @see Engine::handleController(), GrooveWidget::handleController(),
+* GlobStore::handleController()
+*/
+    void handleController(int controlID, int min, int max, int value) override;
+
+  public slots:
+/*!
+* @brief Called periodically by HeadlessEngine::updateTimer
+*
+* Applies the groove and tempo controller changes and the global
+* restores requested by controller, then calls EngineCore::update() as
+* Engine::updateDisplay() does for the GUI.
+*/
+    void update();
+    void jackShutdown();
+};
+
+#endif
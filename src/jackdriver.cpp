@@ -33,21 +33,16 @@ JackDriver::JackDriver(
     bool (* midi_event_received_callback)(void * context, MidiEvent ev),
     void (* tick_callback)(void * context, bool echo_from_trig),
     void (* p_tempo_callback)(double bpm, void * context))
-    : DriverBase(p_portCount, callback_context, midi_event_received_callback, tick_callback, 60e9)
+    : DriverBase(p_portCount, callback_context, midi_event_received_callback, tick_callback, 48000 * 60),
+    echoQueue(JQ_BUFSZ),
+    evQueue(JQ_BUFSZ)
 {
     cbContext = callback_context;
     trStateCb = p_tr_state_cb;
     tempoCb = p_tempo_callback;
     jackRunning = false;
-    echoTickQueue.resize(JQ_BUFSZ);
-    echoTrigFlagQueue.resize(JQ_BUFSZ);
-    evQueue.resize(JQ_BUFSZ);
-    evTickQueue.resize(JQ_BUFSZ);
-    evPortQueue.resize(JQ_BUFSZ);
-    bufPtr = 0;
-    echoPtr = 0;
-    tempoChangeTick = 0;
-    tempoChangeJPosFrame = 0;
+    curFrame = 0;
+    periodFrame = 0;
     jackNFrames = 256;
     trStartingTick = 0;
     trLoopingTick = 0;
@@ -81,6 +76,7 @@ bool JackDriver::callJack(int port_count, const QString & clientname)
         }
         transportState = getState();
         jSampleRate = jack_get_sample_rate(jack_handle);
+        timeBase.setRate((uint64_t)jSampleRate * 60);
     }
     return false;
 }
@@ -187,7 +183,6 @@ void JackDriver::jack_shutdown(void *arg)
 
 int JackDriver::process_callback(jack_nframes_t nframes, void *arg)
 {
-    uint32_t i;
     uint32_t l1, l2;
 
     JackDriver *rd = (JackDriver *) arg;
@@ -196,31 +191,22 @@ int JackDriver::process_callback(jack_nframes_t nframes, void *arg)
 
     if (!out_port_count) return (0);
 
+    const uint64_t start_ns = RtStats::now();
+    rd->rtStats.queueDepth.record(rd->evQueue.count());
+
     rd->handleEchoes(nframes);
 
-    int cur_tempo = rd->tempo;
-    uint64_t cur_j_frame = rd->curJFrame;
     bool forward_unmatched = rd->forwardUnmatched;
     int port_unmatched = rd->portUnmatched;
-    uint64_t tempochangetick = rd->tempoChangeTick;
-    uint64_t nexttick = 0;
-    uint64_t tmptick = 0;
-    uint32_t idx = 0;
-    int evport;
-    uint64_t ev_jframe, ev_sample;
-    uint32_t ev_inframe;
     MidiEvent inEv;
     inEv.type = 0;
     inEv.data = 0;
     inEv.channel = 0;
     inEv.value = 0;
-    MidiEvent outEv;
-    outEv.channel = 0;
 
     unsigned char* buffer;
     jack_midi_event_t in_event;
-    jack_nframes_t event_index = 0;
-    jack_nframes_t j_sample_rate = rd->jSampleRate;
+    jack_nframes_t event_index;
     void *in_buf = jack_port_get_buffer(rd->in_port, nframes);
     void *out_buf[out_port_count];
     for (l1 = 0; l1 < out_port_count; l1++) {
@@ -231,112 +217,130 @@ int JackDriver::process_callback(jack_nframes_t nframes, void *arg)
     }
 
     jack_nframes_t event_count = jack_midi_get_event_count(in_buf);
-    jack_midi_event_get(&in_event, in_buf, 0);
-
-    for(i = 0; i < nframes; i++) {
-
-        /* MIDI Output queue first **/
-        if (rd->bufPtr) { /* If we have events, find earliest event tick **/
-            idx = 0;
-            nexttick = rd->evTickQueue.first();
-            for (l1 = 0; l1 < rd->bufPtr; l1++) {
-                tmptick = rd->evTickQueue.at(l1);
-                if (nexttick > tmptick) {
-                    idx = l1;
-                    nexttick = tmptick;
-                }
-            }
-            ev_sample = (uint64_t)j_sample_rate * 60 * (nexttick - tempochangetick) / TPQN / cur_tempo;
-            ev_jframe = ev_sample / nframes;
-            ev_inframe = ev_sample % nframes;
-            if ((ev_jframe <= cur_j_frame) && (ev_inframe <= i)) {
-                //qWarning("nexttick %d, ev_frame %d, ev_inframe %d, cur_jframe %d, buf_idx %d", nexttick, ev_jframe, ev_inframe, cur_j_frame, idx);
-                outEv = rd->evQueue.at(idx);
-                evport = rd->evPortQueue.at(idx);
-                for (uint32_t l4 = idx ; l4 < (rd->bufPtr - 1);l4++) {
-                    rd->evQueue.replace(l4, rd->evQueue.at(l4 + 1));
-                    rd->evPortQueue.replace(l4, rd->evPortQueue.at(l4 + 1));
-                    rd->evTickQueue.replace(l4, rd->evTickQueue.at(l4 + 1));
-                }
-                rd->bufPtr--;
-                int k = 0;
-                do {
-                    if ((ev_jframe) < cur_j_frame) ev_inframe = 0;
-                    buffer = jack_midi_event_reserve(out_buf[evport], ev_inframe + k, 3);
-                    k++;
-                } while (buffer == NULL);
-
-                buffer[2] = outEv.value;        /* velocity / value **/
-                buffer[1] = outEv.data;         /* note / controller **/
-                if (outEv.type == EV_NOTEON) {
-                    if (outEv.value) {
-                        buffer[0] = 0x90;
-                        buffer[2] = outEv.value;
-                    }
-                    else {
-                        buffer[0] = 0x80;
-                        buffer[2] = 127;
-                    }
+
+    for (event_index = 0; event_index < event_count; event_index++) {
+        jack_midi_event_get(&in_event, in_buf, event_index);
+
+        /* MIDI Output due up to this input event first **/
+        rd->outputEvents(out_buf, nframes, in_event.time);
+
+        /* MIDI Input handling **/
+        if( ((*(in_event.buffer) & 0xf0)) == 0x90 ) {
+            inEv.type = EV_NOTEON;
+            inEv.value = *(in_event.buffer + 2);
+        }
+        else if( ((*(in_event.buffer)) & 0xf0) == 0x80 ) {
+            inEv.type = EV_NOTEOFF;
+            inEv.value = *(in_event.buffer + 2);
+        }
+        else if( ((*(in_event.buffer)) & 0xf0) == 0xa0 ) {
+            inEv.type = EV_KEYPRESS;
+            inEv.value = *(in_event.buffer + 2);
+        }
+        else if( ((*(in_event.buffer)) & 0xf0) == 0xb0 ) {
+            inEv.type = EV_CONTROLLER;
+            inEv.value = *(in_event.buffer + 2);
+        }
+        else if( ((*(in_event.buffer)) & 0xf0) == 0xc0 ) {
+            inEv.type = EV_PGMCHANGE;
+            inEv.value = *(in_event.buffer + 1);
+        }
+        else if( ((*(in_event.buffer)) & 0xf0) == 0xd0 ) {
+            inEv.type = EV_CHANPRESS;
+            inEv.value = *(in_event.buffer + 1);
+        }
+        else if( ((*(in_event.buffer)) & 0xf0) == 0xe0 ) {
+            inEv.type = EV_PITCHBEND;
+            inEv.value = *(in_event.buffer + 2) * 128;
+            inEv.value += *(in_event.buffer + 1);
+            inEv.value -= 8192;
+        }
+        else inEv.type = EV_NONE;
+
+        inEv.data = *(in_event.buffer + 1);
+        inEv.channel = (*(in_event.buffer)) & 0x0f;
+        bool unmatched = rd->midi_event_received(inEv);
+
+        if (unmatched && forward_unmatched) {
+            rd->capture.record(inEv, rd->getCurrentTick(), port_unmatched,
+                    CAPTURE_OUT);
+            buffer = jack_midi_event_reserve(out_buf[port_unmatched], in_event.time, in_event.size);
+            if (buffer) {
+                for (l2 = 0; l2 < in_event.size; l2++) {
+                    buffer[l2] = *(in_event.buffer + l2);
                 }
-                else if (outEv.type == EV_CONTROLLER) buffer[0] = 0xb0;
-                buffer[0] += outEv.channel;
             }
         }
-        /* MIDI Input handling **/
-        while ((in_event.time == i) && (event_index < event_count)) {
+    }
+    /* Remaining MIDI Output of this period **/
+    rd->outputEvents(out_buf, nframes, nframes - 1);
 
-            if( ((*(in_event.buffer) & 0xf0)) == 0x90 ) {
-                inEv.type = EV_NOTEON;
-                inEv.value = *(in_event.buffer + 2);
-            }
-            else if( ((*(in_event.buffer)) & 0xf0) == 0x80 ) {
-                inEv.type = EV_NOTEOFF;
-                inEv.value = *(in_event.buffer + 2);
-            }
-            else if( ((*(in_event.buffer)) & 0xf0) == 0xa0 ) {
-                inEv.type = EV_KEYPRESS;
-                inEv.value = *(in_event.buffer + 2);
-            }
-            else if( ((*(in_event.buffer)) & 0xf0) == 0xb0 ) {
-                inEv.type = EV_CONTROLLER;
-                inEv.value = *(in_event.buffer + 2);
-            }
-            else if( ((*(in_event.buffer)) & 0xf0) == 0xc0 ) {
-                inEv.type = EV_PGMCHANGE;
-                inEv.value = *(in_event.buffer + 1);
-            }
-            else if( ((*(in_event.buffer)) & 0xf0) == 0xd0 ) {
-                inEv.type = EV_CHANPRESS;
-                inEv.value = *(in_event.buffer + 1);
+    rd->curFrame += nframes;
+    rd->rtStats.period.record(RtStats::now() - start_ns);
+    return(0);
+}
+
+void JackDriver::outputEvents(void **out_buf, jack_nframes_t nframes,
+        jack_nframes_t last_frame)
+{
+    while (!evQueue.isEmpty()) {
+        OutEvent outEv = evQueue.next();
+        uint64_t ev_sample = outEv.onWire ? outEv.wirePos
+                : timeBase.tickToPos(evQueue.nextTick());
+        jack_nframes_t ev_inframe = 0;
+
+        /* events that are late are output at the start of the period **/
+        if (ev_sample > periodFrame) {
+            if (ev_sample - periodFrame > last_frame) break;
+            ev_inframe = ev_sample - periodFrame;
+        }
+
+        evQueue.pop();
+
+        const bool limited = isPortBandwidthLimited(outEv.port);
+        if (limited && !outEv.onWire) {
+            /* the event has its place on the wire from now on, if that
+             * is beyond this period it is queued again at that place **/
+            const uint64_t wire_sample = portBandwidth[outEv.port].schedule(
+                    statusByte(outEv.ev), periodFrame + ev_inframe);
+            if (wire_sample - periodFrame > last_frame) {
+                outEv.onWire = true;
+                outEv.wirePos = wire_sample;
+                evQueue.push(timeBase.posToTick(wire_sample), outEv, -1);
+                continue;
             }
-            else if( ((*(in_event.buffer)) & 0xf0) == 0xe0 ) {
-                inEv.type = EV_PITCHBEND;
-                inEv.value = *(in_event.buffer + 2) * 128;
-                inEv.value += *(in_event.buffer + 1);
-                inEv.value -= 8192;
+            ev_inframe = wire_sample - periodFrame;
+        }
+
+        unsigned char* buffer = NULL;
+        while ((buffer == NULL) && (ev_inframe < nframes)) {
+            buffer = jack_midi_event_reserve(out_buf[outEv.port], ev_inframe, 3);
+            ev_inframe++;
+        }
+        if (buffer == NULL) continue;
+
+        const uint64_t emit_sample = periodFrame + ev_inframe - 1;
+        const uint64_t sched_sample = timeBase.tickToPos(outEv.schedTick);
+        rtStats.lateness.record((emit_sample > sched_sample)
+                ? emit_sample - sched_sample : 0);
+
+        buffer[2] = outEv.ev.value;        /* velocity / value **/
+        buffer[1] = outEv.ev.data;         /* note / controller **/
+        if (outEv.ev.type == EV_NOTEON) {
+            if (outEv.ev.value || limited) {
+                /* a limited port keeps the running status with note on
+                 * velocity 0 as note off **/
+                buffer[0] = 0x90;
+                buffer[2] = outEv.ev.value;
             }
-            else inEv.type = EV_NONE;
-
-            inEv.data = *(in_event.buffer + 1);
-            inEv.channel = (*(in_event.buffer)) & 0x0f;
-            bool unmatched = rd->midi_event_received(inEv);
-
-            if (unmatched && forward_unmatched) {
-                buffer = jack_midi_event_reserve(out_buf[port_unmatched], i, in_event.size);
-                if (buffer) {
-                    for (l2 = 0; l2 < in_event.size; l2++) {
-                        buffer[l2] = *(in_event.buffer + l2);
-                    }
-                }
+            else {
+                buffer[0] = 0x80;
+                buffer[2] = 127;
             }
-
-            event_index++;
-            if(event_index < event_count)
-                jack_midi_event_get(&in_event, in_buf, event_index);
         }
+        else if (outEv.ev.type == EV_CONTROLLER) buffer[0] = 0xb0;
+        buffer[0] += outEv.ev.channel;
     }
-    rd->curJFrame++;
-    return(0);
 }
 
 #ifdef JACK_SESSION
@@ -425,51 +429,56 @@ jack_position_t JackDriver::getCurrentPos()
 void JackDriver::sendMidiEvent(MidiEvent ev, uint64_t n_tick, unsigned outport, unsigned duration)
 {
   //qWarning("sendMidiEvent([%d, %d, %d, %d], %u, %u) at tick %d", ev.type, ev.channel, ev.data, ev.value, outport, duration, n_tick);
-
-    if (bufPtr > JQ_BUFSZ - 2) {
-        printf("WARNING: Event buffer overflow. Buffer cleared.\n");
-        bufPtr = 0;
+    capture.record(ev, n_tick, outport, CAPTURE_OUT, duration);
+
+    OutEvent outEv;
+    outEv.ev = ev;
+    outEv.port = outport;
+    outEv.onWire = false;
+    outEv.wirePos = 0;
+    outEv.schedTick = n_tick;
+    const int rank = outputPriority(ev.type);
+
+    if (evQueue.count() > evQueue.capacity() - 2) {
+        rtStats.eventOverflows.fetch_add(1, std::memory_order_relaxed);
+        evQueue.clear();
     }
-    evQueue.replace(bufPtr,ev);
-    evTickQueue.replace(bufPtr,n_tick);
-    evPortQueue.replace(bufPtr,outport);
-    bufPtr++;
+    evQueue.push(n_tick, outEv, rank);
 
     if ((ev.type == EV_NOTEON) && (ev.value)) {
-        ev.value = 0;
-        evQueue.replace(bufPtr,ev);
-        evTickQueue.replace(bufPtr,n_tick + (duration / 4));
-        evPortQueue.replace(bufPtr,outport);
-        bufPtr++;
+        outEv.ev.value = 0;
+        evQueue.push(n_tick + (duration / 4), outEv, rank);
     }
 }
 
 bool JackDriver::requestEchoAt(uint64_t echo_tick, bool echo_from_trig)
 {
-    if (echoPtr > JQ_BUFSZ - 1) {
-        printf("WARNING: Echo buffer overflow. Buffer cleared.\n");
-        echoPtr = 0;
+    if (echoQueue.count() > echoQueue.capacity() - 1) {
+        rtStats.echoOverflows.fetch_add(1, std::memory_order_relaxed);
+        echoQueue.clear();
     }
     if ((echo_tick == lastSchedTick) && (echo_tick)) return false;
-    echoTickQueue.replace(echoPtr, echo_tick);
-    echoTrigFlagQueue.replace(echoPtr, echo_from_trig);
-    echoPtr++;
+    echoQueue.push(echo_tick, echo_from_trig);
     lastSchedTick = echo_tick;
 
     return true;
 
 }
 
+uint64_t JackDriver::periodEndTick(int nframes)
+{
+    return timeBase.posToTick(periodFrame + nframes);
+}
+
 void JackDriver::handleEchoes(int nframes)
 {
     jackNFrames = nframes;
 
     if (useJackSync) {
-        m_current_tick = ((uint64_t)currentPos.frame - tempoChangeJPosFrame)
-            * TPQN * tempo / (currentPos.frame_rate * 60) + tempoChangeTick;
+        periodFrame = currentPos.frame;
+        m_current_tick = timeBase.posToTick(periodFrame);
             if ((currentPos.beats_per_minute != tempo)
                     && (currentPos.beats_per_minute > 0.01))  {
-                tempoChangeJPosFrame = currentPos.frame;
                 setTempo(currentPos.beats_per_minute);
                 // inform engine via callback about the tempo change
                 tempoCb(tempo, cbContext);
@@ -477,41 +486,36 @@ void JackDriver::handleEchoes(int nframes)
             }
     }
     else {
-        m_current_tick =  (uint64_t)curJFrame * TPQN * tempo * nframes
-            / (jSampleRate * 60) + tempoChangeTick;
+        periodFrame = curFrame;
+        m_current_tick = timeBase.posToTick(periodFrame);
         if (requestedTempo != tempo) setTempo(requestedTempo);
     }
 
-    if (!queueStatus) {
-        curJFrame++;
-        return;
-    }
-    if (!echoPtr) return;
-
-    int idx = 0;
-    int nexttick = echoTickQueue.first();
-
-    for (uint32_t l1 = 0; l1 < echoPtr; l1++) {
-        int tmptick = echoTickQueue.at(l1);
-        if (nexttick > tmptick) {
-            idx = l1;
-            nexttick = tmptick;
-        }
-    }
-    if (m_current_tick >= echoTickQueue.at(idx)) {
-        tick_callback(echoTrigFlagQueue.at(idx));
-        for (uint32_t l4 = idx ; l4 < (echoPtr - 1); l4++) {
-            echoTickQueue.replace(l4, echoTickQueue.at(l4 + 1));
-            echoTrigFlagQueue.replace(l4, echoTrigFlagQueue.at(l4 + 1));
-        }
-        echoPtr--;
+    if (!queueStatus) return;
+
+    /* Dispatch all echoes falling into this period in tick order. During
+     * each callback the current tick is the one of the echo, so that
+     * the modules schedule their events at the right frame. Echoes
+     * requested by a callback for this same period are handled in the
+     * same loop, bounded by the queue size. **/
+    const uint64_t period_tick = m_current_tick;
+    const uint64_t end_tick = periodEndTick(nframes);
+    int count = echoQueue.capacity();
+
+    while (!echoQueue.isEmpty() && (echoQueue.nextTick() < end_tick) && count) {
+        const bool echo_from_trig = echoQueue.next();
+        const uint64_t echo_tick = echoQueue.nextTick();
+        echoQueue.pop();
+        m_current_tick = (echo_tick > period_tick) ? echo_tick : period_tick;
+        tick_callback(echo_from_trig);
+        count--;
     }
+    m_current_tick = period_tick;
 }
 
 void JackDriver::setTempo(double bpm)
 {
-    tempoChangeTick = m_current_tick;
-    curJFrame = 0;
+    timeBase.setTempo(bpm, periodFrame);
     tempo = bpm;
     internalTempo = bpm;
 }
@@ -525,8 +529,7 @@ void JackDriver::setTransportStatus(bool on)
         else
             tempo = internalTempo;
 
-        tempoChangeJPosFrame = 0;
-        tempoChangeTick = 0;
+        timeBase.reset(tempo);
     }
     else {
         tempo = internalTempo;
@@ -534,17 +537,17 @@ void JackDriver::setTransportStatus(bool on)
 
     if (on) {
         if (useJackSync) {
-            m_current_tick = ((uint64_t)currentPos.frame - tempoChangeJPosFrame)
-                * TPQN * tempo / (currentPos.frame_rate * 60) + tempoChangeTick;
-            curJFrame = ((uint64_t)currentPos.frame - tempoChangeJPosFrame) * (jSampleRate * 60) / jackNFrames / (currentPos.frame_rate * 60);
+            periodFrame = currentPos.frame;
         } else {
-            m_current_tick = 0;
-            curJFrame = 0;
+            timeBase.reset(tempo);
+            curFrame = 0;
+            periodFrame = 0;
         }
-        tempoChangeTick = 0;
+        m_current_tick = timeBase.posToTick(periodFrame);
         lastSchedTick = 0;
-        echoPtr = 0;
-        bufPtr = 0;
+        echoQueue.clear();
+        evQueue.clear();
+        resetPortBandwidth();
         printf("Internal Transport started\n");
     }
     else {
@@ -24,7 +24,6 @@
 #ifndef JACKSYNC_H
 #define JACKSYNC_H
 
-#include <QVector>
 #include "config.h"
 #include <jack/jack.h>
 #include <jack/transport.h>
@@ -36,6 +35,7 @@
 
 #include "main.h"
 #include "driverbase.h"
+#include "tickqueue.h"
 
 extern QString global_jack_session_uuid;
 
@@ -45,18 +45,23 @@ extern QString global_jack_session_uuid;
  * functions to register and initialise a jack client and to read the
  * current frame position of a transport master. It establishes input and
  * output ports if requested and implements a sequencer queue based on
- * QVectors.
+ * TickQueues.
  * When the JackDriver::setTransportStatus() function is called with True
  * argument, a so called "echo event" is added to the
- * JackDriver::echoTickQueue with zero time. The JACK process will be used
- * to check the timing of all scheduled echoes. When the transport time
- * matches a scheduled echo time, it will call Engine::echoCallback() to
- * query the modules for events to be scheduled. Incoming MIDI events are
+ * JackDriver::echoQueue with zero time. The JACK process will be used
+ * to check the timing of all scheduled echoes. For every echo falling
+ * into the current period it will call Engine::echoCallback(), in tick
+ * order, to query the modules for events to be scheduled. Incoming MIDI events are
  * transferred to the Engine::eventCallback(). Engine will call the
  * sendMidiEvent() function to schedule events and their timing into
- * the JackDriver::evQueue. After the
+ * the JackDriver::evQueue, a TickQueue ordered by event tick. The JACK
+ * process only takes the events falling into the current period off the
+ * queue and writes them at their frame offset, which is delayed by the
+ * PortBandwidth model of the port if its bandwidth is limited. After the
  * event output, a new echo event is scheduled for the next MIDI event
  * to be output, which will again call the Engine, and so on.
+ * Each period records its duration, the output queue length and the
+ * lateness of the emitted events in DriverBase::rtStats.
  * JackDriver derives from DriverBase, which is a QThread
  * class, but it does not implement other threads than the JACK process.
  *
@@ -73,6 +78,17 @@ class JackDriver : public DriverBase
     static void session_callback(jack_session_event_t *ev, void *arg);
 #endif
     void update_ports();
+    void outputEvents(void **out_buf, jack_nframes_t nframes,
+            jack_nframes_t last_frame);
+
+    /*! @brief Element of the output event queue */
+    struct OutEvent {
+        MidiEvent ev;
+        unsigned int port;
+        bool onWire;        /**< Placed by the bandwidth model of the port */
+        uint64_t wirePos;   /**< Frame assigned by the bandwidth model */
+        uint64_t schedTick; /**< Tick requested by the engine, for the lateness statistics */
+    };
 
     jack_port_t * in_port;
     jack_port_t * out_ports[MAX_PORTS];
@@ -81,19 +97,14 @@ class JackDriver : public DriverBase
     uint32_t transportState;
     uint32_t jackNFrames;
     uint64_t lastSchedTick;
-    uint64_t tempoChangeTick;
-    uint64_t curJFrame;
-    uint64_t tempoChangeJPosFrame;
-    QVector<uint64_t> echoTickQueue;
-    QVector<bool> echoTrigFlagQueue;
-    QVector<MidiEvent> evQueue;
-    QVector<uint64_t> evTickQueue;
-    QVector<uint64_t> evPortQueue;
-    uint32_t bufPtr;
-    uint32_t echoPtr;
+    uint64_t curFrame;      /**< Frames since the internal transport start */
+    uint64_t periodFrame;   /**< Transport frame of the current period start */
+    TickQueue<bool> echoQueue;
+    TickQueue<OutEvent> evQueue;
     jack_client_t *jack_handle;
     jack_position_t currentPos;
     void handleEchoes(int nframes);
+    uint64_t periodEndTick(int nframes);
 
 #ifdef JACK_SESSION
   public:
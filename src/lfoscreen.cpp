@@ -30,32 +30,29 @@ LfoScreen::LfoScreen(QWidget* parent) : Screen (parent)
     xMax = LFOSCR_HMARG;
 }
 
-// Paint event handler.
-void LfoScreen::paintEvent(QPaintEvent*)
+// Draws grid, labels and waveform into the cached pixmap
+void LfoScreen::drawStatic(QPainter *p)
 {
     if (p_data.isEmpty()) return;
 
-    QPainter p(this);
     QPen pen;
     pen.setWidth(1);
-    p.setFont(QFont("Helvetica", 8));
-    p.setPen(pen);
+    p->setFont(QFont("Helvetica", 8));
+    p->setPen(pen);
 
     int beat = 4;
     int xscale, yscale;
-    w = QWidget::width();
-    h = QWidget::height();
     int notestreak_thick = 2;
     int x, x1;
 
     //Beryll Filled Frame
     if (isMuted)
-        p.fillRect(0, 0, w, h, QColor(70, 70, 70));
+        p->fillRect(0, 0, w, h, QColor(70, 70, 70));
     else
-        p.fillRect(0, 0, w, h, QColor(50, 10, 10));
-    p.setViewport(0, 0, w, h);
-    p.setWindow(0, 0, w, h);
-    p.setPen(QColor(160, 20, 20));
+        p->fillRect(0, 0, w, h, QColor(50, 10, 10));
+    p->setViewport(0, 0, w, h);
+    p->setWindow(0, 0, w, h);
+    p->setPen(QColor(160, 20, 20));
 
     //Grid
     int npoints = p_data.count() - 1;
@@ -77,25 +74,25 @@ void LfoScreen::paintEvent(QPaintEvent*)
             ofs = w / nsteps * .5 - 6 + LFOSCR_HMARG;
         }
         if ((bool)(l1%beat)) {
-            p.setPen(QColor(180, 100, 60));
+            p->setPen(QColor(180, 100, 60));
         } else {
-            p.setPen(QColor(180, 100, 100));
+            p->setPen(QColor(180, 100, 100));
         }
         x = l1 * xscale / nsteps;
-        p.drawLine(LFOSCR_HMARG + x, LFOSCR_VMARG,
+        p->drawLine(LFOSCR_HMARG + x, LFOSCR_VMARG,
                 LFOSCR_HMARG + x, h-LFOSCR_VMARG);
 
         if (l1 < nsteps) {
             //Beat numbers
-            p.setPen(QColor(180, 150, 100));
-            p.drawText(ofs + x, LFOSCR_VMARG, QString::number(l1+1));
+            p->setPen(QColor(180, 150, 100));
+            p->drawText(ofs + x, LFOSCR_VMARG, QString::number(l1+1));
 
             // Beat divisor separators
-            p.setPen(QColor(120, 60, 20));
+            p->setPen(QColor(120, 60, 20));
             for (int l2 = 1; l2 < beatDiv; l2++) {
                 x1 = x + l2 * xscale / nsteps / beatDiv;
                 if (x1 < xscale)
-                    p.drawLine(LFOSCR_HMARG + x1,
+                    p->drawLine(LFOSCR_HMARG + x1,
                             LFOSCR_VMARG, LFOSCR_HMARG + x1,
                             h - LFOSCR_VMARG);
             }
@@ -106,7 +103,7 @@ void LfoScreen::paintEvent(QPaintEvent*)
     //Draw function
 
     pen.setWidth(notestreak_thick);
-    p.setPen(pen);
+    p->setPen(pen);
     int grooveTmp = (beatRes < 32) ? grooveTick : 0;
     int l1 = 0;
     while (l1 < npoints) {
@@ -121,8 +118,8 @@ void LfoScreen::paintEvent(QPaintEvent*)
         else {
             pen.setColor(QColor(180, 130, 50));
         }
-        p.setPen(pen);
-        p.drawLine(xpos, ypos,
+        p->setPen(pen);
+        p->drawLine(xpos, ypos,
                         xpos + (xscale / nsteps / beatRes)
                         - (pen.width()/(2+npoints/(TPQN*8))), ypos);
         l1++;
@@ -130,11 +127,11 @@ void LfoScreen::paintEvent(QPaintEvent*)
     }
 
     //Horizontal separators and numbers
-    p.setPen(QColor(180, 120, 40));
+    p->setPen(QColor(180, 120, 40));
     for (int l1 = 0; l1 < 3; l1++) {
         int ypos = yscale * l1 / 2 + LFOSCR_VMARG;
-        p.drawLine(LFOSCR_HMARG, ypos, xMax, ypos);
-        p.drawText(1, yscale * (l1) + LFOSCR_VMARG + 4,
+        p->drawLine(LFOSCR_HMARG, ypos, xMax, ypos);
+        p->drawText(1, yscale * (l1) + LFOSCR_VMARG + 4,
                 QString::number(128 * (1 - l1)));
     }
 
@@ -173,5 +170,5 @@ int LfoScreen::clip(int value, int min, int max, bool *outOfRange)
 void LfoScreen::updateData(const QVector<Sample>& data)
 {
     p_data = data;
-    needsRedraw = true;
+    invalidate();
 }
@@ -55,7 +55,7 @@ class LfoScreen : public Screen
     int clip(int value, int min, int max, bool *outOfRange);
 
   protected:
-    virtual void paintEvent(QPaintEvent *);
+    virtual void drawStatic(QPainter *p);
 
   public:
     LfoScreen(QWidget* parent=0);
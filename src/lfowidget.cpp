@@ -43,6 +43,8 @@ LfoWidget::LfoWidget(MidiLfo *p_midiLfo, GlobStore *p_globStore,
     midiLfo(p_midiLfo)
 {
     bool compactStyle = p_prefs->compactStyle;
+    moduleCore = new LfoCore(p_midiLfo, p_prefs, p_name, parStore,
+            &midiControl->ccList);
 #else
 LfoWidget::LfoWidget():
     ModuleWidget("LFO:"),
@@ -152,6 +154,45 @@ LfoWidget::LfoWidget():
     midiControl->addMidiLearnMenu("LoopMode", loopBox, LFO_LOOPMODE);
 #endif
 
+#ifdef APPBUILD
+    QLabel *thinBoxLabel = new QLabel(tr("&Thin"));
+    thinBox = new QComboBox;
+    thinBoxLabel->setBuddy(thinBox);
+    names.clear();
+    names << tr("Off") << tr("Repeats");
+    for (uint64_t i = 2; i < sizeof(lfoThinValues)/sizeof(lfoThinValues[0]); i++) {
+        names << QString::number(lfoThinValues[i]);
+    }
+    thinBox->insertItems(0, names);
+    thinBox->setCurrentIndex(0);
+    thinBox->setToolTip(
+            tr("Output thinning: Do not send repeated values and changes up to the given amount. Values at the ends of rising or falling segments are always sent"));
+    thinBox->setMinimumContentsLength(3);
+    connect(thinBox, SIGNAL(activated(int)), this,
+            SLOT(updateThin(int)));
+
+    QLabel *maxRateBoxLabel = new QLabel(tr("&Max rate"));
+    maxRateBox = new QComboBox;
+    maxRateBoxLabel->setBuddy(maxRateBox);
+    names.clear();
+    names << "-";
+    for (uint64_t i = 1; i < sizeof(lfoMaxRateValues)/sizeof(lfoMaxRateValues[0]); i++) {
+        names << QString::number(lfoMaxRateValues[i]);
+    }
+    maxRateBox->insertItems(0, names);
+    maxRateBox->setCurrentIndex(0);
+    maxRateBox->setToolTip(
+            tr("Maximum rate (events/beat) of the thinned output"));
+    maxRateBox->setMinimumContentsLength(3);
+    maxRateBox->setDisabled(true);
+    connect(maxRateBox, SIGNAL(activated(int)), this,
+            SLOT(updateMaxRate(int)));
+
+    thinCountLabel = new QLabel;
+    thinCountLabel->setToolTip(tr("Number of events saved by the output thinning"));
+    thinCount = -1;
+#endif
+
     flipWaveVerticalAction = new QAction(QPixmap(lfowflip_xpm),tr("&Flip"), this);
     flipWaveVerticalAction->setToolTip(tr("Do a vertical flip of the wave about its mid value"));
     connect(flipWaveVerticalAction, SIGNAL(triggered(bool)), this, SLOT(updateFlipWaveVertical()));
@@ -221,6 +262,13 @@ LfoWidget::LfoWidget():
     paramBoxLayout->addWidget(sizeBoxLabel, 1, 4);
     paramBoxLayout->addWidget(sizeBox, 1, 5);
     paramBoxLayout->addWidget(flipWaveVerticalButton, 0, 6);
+#ifdef APPBUILD
+    paramBoxLayout->addWidget(thinBoxLabel, 2, 2);
+    paramBoxLayout->addWidget(thinBox, 2, 3);
+    paramBoxLayout->addWidget(maxRateBoxLabel, 2, 4);
+    paramBoxLayout->addWidget(maxRateBox, 2, 5);
+    paramBoxLayout->addWidget(thinCountLabel, 2, 6, 1, 2);
+#endif
     paramBoxLayout->setColumnStretch(7, 7);
 
     if (compactStyle) {
@@ -254,169 +302,6 @@ MidiLfo *LfoWidget::getMidiWorker()
 {
     return (midiLfo);
 }
-
-void LfoWidget::writeData(QXmlStreamWriter& xml)
-{
-    QByteArray tempArray;
-    int l1;
-
-        writeCommonData(xml);
-    
-        xml.writeStartElement("waveParams");
-            xml.writeTextElement("loopmode", QString::number(
-                loopBox->currentIndex()));
-            xml.writeTextElement("waveform", QString::number(
-                waveFormBox->currentIndex()));
-            xml.writeTextElement("frequency", QString::number(
-                freqBox->currentIndex()));
-            xml.writeTextElement("resolution", QString::number(
-                resBox->currentIndex()));
-            xml.writeTextElement("size", QString::number(
-                sizeBox->currentIndex()));
-            xml.writeTextElement("amplitude", QString::number(
-                midiLfo->amp));
-            xml.writeTextElement("offset", QString::number(
-                midiLfo->offs));
-            xml.writeTextElement("phase", QString::number(
-                midiLfo->phase));
-        xml.writeEndElement();
-
-        tempArray.clear();
-        l1 = 0;
-        while (l1 < midiLfo->maxNPoints) {
-            tempArray.append(midiLfo->muteMask.at(l1));
-            l1++;
-        }
-        xml.writeStartElement("muteMask");
-            xml.writeTextElement("data", tempArray.toHex());
-        xml.writeEndElement();
-
-        tempArray.clear();
-        l1 = 0;
-        while (l1 < midiLfo->maxNPoints) {
-            tempArray.append(midiLfo->customWave.at(l1).value);
-            l1++;
-        }
-        xml.writeStartElement("customWave");
-            xml.writeTextElement("data", tempArray.toHex());
-        xml.writeEndElement();
-
-    xml.writeEndElement();
-}
-
-void LfoWidget::readData(QXmlStreamReader& xml, const QString& qmaxVersion)
-{
-    int tmp;
-    int wvtmp = 0;
-    Sample sample = {0, 0, 0, false};
-
-    while (!xml.atEnd()) {
-        xml.readNext();
-        if (xml.isEndElement())
-            break;
-        
-        readCommonData(xml);
-            
-        // Compatibility with earlier versions //
-        for (int l1 = 0; l1 < parStore->list.count(); l1++) {
-            if (qmaxVersion == "" && parStore->list[l1].res < 5) {
-                parStore->list[l1].res = mapOldLfoRes[parStore->list[l1].res];
-            }
-            if (qmaxVersion == "" && parStore->list[l1].size < 10) {
-                parStore->list[l1].size = mapOldLfoSize[parStore->list[l1].size];
-            }
-        }
-
-        if (xml.isStartElement() && (xml.name() == "waveParams")) {
-            while (!xml.atEnd()) {
-                xml.readNext();
-                if (xml.isEndElement())
-                    break;
-                if (xml.name() == "loopmode") {
-                    tmp = xml.readElementText().toInt();
-                    loopBox->setCurrentIndex(tmp);
-                    updateLoop(tmp);
-                }
-                else if (xml.name() == "waveform")
-                    wvtmp = xml.readElementText().toInt();
-                else if (xml.name() == "frequency") {
-                    tmp = xml.readElementText().toInt();
-                    freqBox->setCurrentIndex(tmp);
-                    updateFreq(tmp);
-                }
-                else if (xml.name() == "resolution") {
-                    tmp = xml.readElementText().toInt();
-                    if (qmaxVersion == "" && tmp < 9) {
-                        tmp = mapOldLfoRes[tmp];
-                    }
-                    resBox->setCurrentIndex(tmp);
-                    updateRes(tmp);
-                }
-                else if (xml.name() == "size") {
-                    tmp = xml.readElementText().toInt();
-                    if (qmaxVersion == "" && tmp < 12) {
-                        tmp = mapOldLfoSize[tmp];
-                    }
-                    sizeBox->setCurrentIndex(tmp);
-                    updateSize(tmp);
-                }
-                else if (xml.name() == "amplitude")
-                    amplitude->setValue(xml.readElementText().toInt());
-                else if (xml.name() == "offset")
-                    offset->setValue(xml.readElementText().toInt());
-                else if (xml.name() == "phase")
-                    phase->setValue(xml.readElementText().toInt());
-                else skipXmlElement(xml);
-            }
-        }
-        else if (xml.isStartElement() && (xml.name() == "muteMask")) {
-            while (!xml.atEnd()) {
-                xml.readNext();
-                if (xml.isEndElement())
-                    break;
-                if (xml.isStartElement() && (xml.name() == "data")) {
-                    QByteArray tmpArray =
-                            QByteArray::fromHex(xml.readElementText().toLatin1());
-                    for (int l1 = 0; l1 < tmpArray.count(); l1++) {
-                        midiLfo->muteMask[l1] = tmpArray.at(l1);
-                    }
-                    midiLfo->maxNPoints = tmpArray.count();
-                }
-                else skipXmlElement(xml);
-            }
-        }
-        else if (xml.isStartElement() && (xml.name() == "customWave")) {
-            while (!xml.atEnd()) {
-                xml.readNext();
-                if (xml.isEndElement())
-                    break;
-                if (xml.isStartElement() && (xml.name() == "data")) {
-                    QByteArray tmpArray =
-                            QByteArray::fromHex(xml.readElementText().toLatin1());
-                    int step = TPQN / midiLfo->res;
-                    int lt = 0;
-                    for (int l1 = 0; l1 < tmpArray.count(); l1++) {
-                        sample.value = tmpArray.at(l1);
-                        sample.tick = lt;
-                        sample.muted = midiLfo->muteMask[l1];
-                        midiLfo->customWave[l1] = sample;
-                        lt+=step;
-                    }
-                }
-                else skipXmlElement(xml);
-            }
-        }
-        else skipXmlElement(xml);
-    }
-    
-    updateChIn(chIn->currentIndex());
-    updateChannelOut(channelOut->currentIndex());
-    updatePortOut(portOut->currentIndex());
-    waveFormBox->setCurrentIndex(wvtmp);
-    updateWaveForm(wvtmp);
-    midiLfo->needsGUIUpdate = false;
-    modified = false;
-}
 #endif
 
 void LfoWidget::loadWaveForms()
@@ -491,6 +376,26 @@ void LfoWidget::updateLoop(int val)
     modified = true;
 }
 
+void LfoWidget::updateThin(int val)
+{
+    if ((uint64_t)val >= sizeof(lfoThinValues)/sizeof(lfoThinValues[0])) return;
+    modified = true;
+    if (!midiLfo) return;
+    maxRateBox->setDisabled(lfoThinValues[val] < 0);
+    thinCount = -1;
+    midiLfo->updateThinning(lfoThinValues[val],
+            lfoMaxRateValues[maxRateBox->currentIndex()]);
+}
+
+void LfoWidget::updateMaxRate(int val)
+{
+    if ((uint64_t)val >= sizeof(lfoMaxRateValues)/sizeof(lfoMaxRateValues[0])) return;
+    modified = true;
+    if (!midiLfo) return;
+    midiLfo->updateThinning(lfoThinValues[thinBox->currentIndex()],
+            lfoMaxRateValues[val]);
+}
+
 void LfoWidget::updateAmp(int val)
 {
     modified = true;
@@ -570,68 +475,13 @@ void LfoWidget::setRecord(bool on)
     screen->setRecordMode(on);
 }
 
-QVector<Sample> LfoWidget::getCustomWave()
-{
-    return QVector<Sample>::fromStdVector(midiLfo->customWave);
-}
-
-QVector<bool> LfoWidget::getMuteMask()
+CompactWave LfoWidget::getCustomWave()
 {
-    return QVector<bool>::fromStdVector(midiLfo->muteMask);
+    return midiLfo->customWave;
 }
 
 #ifdef APPBUILD
 
-void LfoWidget::doStoreParams(int ix)
-{
-    parStore->temp.ccnumberIn = ccnumberInBox->value();
-    parStore->temp.ccnumber = ccnumberBox->value();
-    parStore->temp.res = resBox->currentIndex();
-    parStore->temp.size = sizeBox->currentIndex();
-    parStore->temp.loopMode = loopBox->currentIndex();
-    parStore->temp.freq = freqBox->currentIndex();
-    parStore->temp.ampl = amplitude->value();
-    parStore->temp.offs = offset->value();
-    parStore->temp.phase = phase->value();
-    parStore->temp.waveForm = waveFormBox->currentIndex();
-
-    if (midiLfo) parStore->temp.wave = getCustomWave().mid(0, midiLfo->maxNPoints);
-    if (midiLfo) parStore->temp.muteMask = getMuteMask().mid(0, midiLfo->maxNPoints);
-
-    parStore->tempToList(ix);
-}
-
-void LfoWidget::doRestoreParams(int ix)
-{
-    midiLfo->applyPendingParChanges();
-    if (parStore->list.at(ix).empty) return;
-    for (int l1 = 0; l1 < parStore->list.at(ix).wave.count(); l1++) {
-        midiLfo->customWave[l1] = parStore->list.at(ix).wave.at(l1);
-        midiLfo->muteMask[l1] = parStore->list.at(ix).muteMask.at(l1);
-    }
-    sizeBox->setCurrentIndex(parStore->list.at(ix).size);
-    midiLfo->updateSize(sizeBox->currentText().toInt());
-
-    midiLfo->updateResolution(lfoResValues[parStore->list.at(ix).res]);
-    midiLfo->updateWaveForm(parStore->list.at(ix).waveForm);
-    midiLfo->updateFrequency(lfoFreqValues[parStore->list.at(ix).freq]);
-    freqBox->setCurrentIndex(parStore->list.at(ix).freq);
-    resBox->setCurrentIndex(parStore->list.at(ix).res);
-    waveFormBox->setCurrentIndex(parStore->list.at(ix).waveForm);
-    loopBox->setCurrentIndex(parStore->list.at(ix).loopMode);
-    updateLoop(parStore->list.at(ix).loopMode);
-    updateWaveForm(parStore->list.at(ix).waveForm);
-    if (!parStore->onlyPatternList.at(ix)) {
-        amplitude->setValue(parStore->list.at(ix).ampl);
-        offset->setValue(parStore->list.at(ix).offs);
-        phase->setValue(parStore->list.at(ix).phase);
-        ccnumberInBox->setValue(parStore->list.at(ix).ccnumberIn);
-        ccnumberBox->setValue(parStore->list.at(ix).ccnumber);
-    }
-    int frame = ( midiLfo->reverse ? midiLfo->nPoints : 0);
-    midiLfo->setFramePtr(frame);
-}
-
 void LfoWidget::copyParamsFrom(ModuleWidget *p_fromWidget)
 {
     LfoWidget *fromWidget = (LfoWidget *)p_fromWidget;
@@ -683,11 +533,14 @@ void LfoWidget::copyParamsFrom(ModuleWidget *p_fromWidget)
     amplitude->setValue(fromWidget->amplitude->value());
     offset->setValue(fromWidget->offset->value());
     phase->setValue(fromWidget->phase->value());
-
-    for (int l1 = 0; l1 < fromWidget->getMidiWorker()->maxNPoints; l1++) {
-        midiLfo->customWave[l1] = fromWidget->getCustomWave().at(l1);
-        midiLfo->muteMask[l1] = midiLfo->customWave.at(l1).muted;
-    }
+    tmp = fromWidget->maxRateBox->currentIndex();
+    maxRateBox->setCurrentIndex(tmp);
+    tmp = fromWidget->thinBox->currentIndex();
+    thinBox->setCurrentIndex(tmp);
+    updateThin(tmp);
+
+    midiLfo->customWave = fromWidget->getCustomWave();
+    midiLfo->maxNPoints = fromWidget->getMidiWorker()->maxNPoints;
     midiControl->setCcList(fromWidget->midiControl->ccList);
     muteOutAction->setChecked(true);
 
@@ -696,157 +549,68 @@ void LfoWidget::copyParamsFrom(ModuleWidget *p_fromWidget)
     updateWaveForm(tmp);
 }
 
-void LfoWidget::handleController(int ccnumber, int channel, int value)
+void LfoWidget::updateScreen(bool newData)
 {
-    QVector<MidiCC> cclist= midiControl->ccList;
-
-    for (int l2 = 0; l2 < cclist.count(); l2++) {
-        int min = cclist.at(l2).min;
-        int max = cclist.at(l2).max;
-        if ((ccnumber == cclist.at(l2).ccnumber) &&
-            (channel == cclist.at(l2).channel)) {
-            int sval = 0;
-            bool m = false;
-            switch (cclist.at(l2).ID) {
-                case MUTE_BUTTON: if (min == max) {
-                            if (value == max) {
-                                m = midiLfo->isMuted;
-                                midiLfo->setMuted(!m);
-                            }
-                        }
-                        else {
-                            if (value == max) {
-                                midiLfo->setMuted(false);
-                            }
-                            if (value == min) {
-                                midiLfo->setMuted(true);
-                            }
-                        }
-                break;
-
-                case LFO_AMPLITUDE:
-                        sval = min + ((double)value * (max - min) / 127);
-                        midiLfo->updateAmplitude(sval);
-                break;
-
-                case LFO_OFFSET:
-                        sval = min + ((double)value * (max - min) / 127);
-                        midiLfo->updateOffset(sval);
-                break;
-                case LFO_WAVEFORM:
-                        sval = min + ((double)value * (max - min) / 127);
-                        if (sval < 6) waveFormBoxIndex = sval;
-                break;
-                case LFO_FREQUENCY:
-                        sval = min + ((double)value * (max - min) / 127);
-                        if ((uint64_t)sval < sizeof(lfoFreqValues)/sizeof(lfoFreqValues[0])) freqBoxIndex = sval;
-                break;
-                case LFO_RECORD: if (min == max) {
-                            if (value == max) {
-                                m = midiLfo->recordMode;
-                                midiLfo->setRecordMode(!m);
-                                return;
-                            }
-                        }
-                        else {
-                            if (value == max) {
-                                midiLfo->setRecordMode(true);
-                            }
-                            if (value == min) {
-                                midiLfo->setRecordMode(false);
-                            }
-                        }
-                break;
-                case LFO_RESOLUTION:
-                        sval = min + ((double)value * (max - min) / 127);
-                        if ((uint64_t)sval < sizeof(lfoResValues)/sizeof(lfoResValues[0])) resBoxIndex = sval;
-                break;
-                case LFO_SIZE:
-                        sval = min + ((double)value * (max - min) / 127);
-                        if ((uint64_t)sval < sizeof(lfoSizeValues)/sizeof(lfoSizeValues[0])) sizeBoxIndex = sval;
-                break;
-                case LFO_LOOPMODE:
-                        sval = min + ((double)value * (max - min) / 127);
-                        if (sval < 6) midiLfo->curLoopMode = sval;
-                break;
-                case PARAM_RESTORE:
-                        sval = min + ((double)value * (max - min) / 127);
-                        if ((sval < parStore->list.count())
-                                && (sval != parStore->activeStore)
-                                && (sval != parStore->currentRequest)) {
-                            parStore->requestDispState(sval, 2);
-                            parStore->restoreRequest = sval;
-                            parStore->restoreRunOnce = (parStore->jumpToList.at(sval) > -2);
-                        }
-                        else return;
-                break;
-                case LFO_PHASE:
-                        sval = min + ((double)value * (max - min) / 127);
-                        midiLfo->updatePhase(sval);
-                break;
-
-                default:
-                break;
-            }
-            needsGUIUpdate = true;
-        }
-    }
-}
-
-void LfoWidget::updateDisplay()
-{
-    QVector<Sample> data;
-    std::vector<Sample> sdata;
-
-    bool repetitionsFinished = (midiLfo->currentRepetition == 0);
-    if (midiLfo->reverse) {
-    repetitionsFinished = (midiLfo->currentRepetition >= midiLfo->nRepetitions - 1);
-    }
-    parStore->updateDisplay(getFramePtr(), 
-        midiLfo->nPoints, repetitionsFinished, midiLfo->reverse);
-    if (parStore->nRepList.count() > 0) {
-        if (parStore->nRepList.at(parStore->activeStore) != midiLfo->nRepetitions) {
-            updateNRep(parStore->nRepList.at(parStore->activeStore));
-        }
-    }
-    if (midiLfo->dataChanged) {
-        midiLfo->getData(&sdata);
-        data = QVector<Sample>::fromStdVector(sdata);
+    if (newData) {
+        data = QVector<Sample>::fromStdVector(moduleCore->data);
         screen->updateData(data);
         cursor->updateNumbers(midiLfo->res, midiLfo->size);
+        offset->blockSignals(true);
         offset->setValue(midiLfo->offs);
+        offset->blockSignals(false);
+        phase->blockSignals(true);
         phase->setValue(midiLfo->phase);
-        midiLfo->dataChanged = false;
+        phase->blockSignals(false);
     }
     screen->updateDraw();
     cursor->updateDraw();
-    midiControl->update();
+    if (midiLfo->thinnedCount != thinCount) {
+        thinCount = midiLfo->thinnedCount;
+        if (midiLfo->thinDeadband < 0) thinCountLabel->clear();
+        else thinCountLabel->setText(tr("%1 saved").arg(thinCount));
+    }
+}
 
-    if (!(needsGUIUpdate || midiLfo->needsGUIUpdate)) return;
+void LfoWidget::updateWidgets()
+{
+    ModuleWidget::updateWidgets();
 
-    muteOut->setChecked(midiLfo->isMuted);
-    screen->newGrooveValues(midiLfo->newGrooveTick, midiLfo->grooveVelocity,
-                midiLfo->grooveLength);   
-    screen->setMuted(midiLfo->isMuted);
-    parStore->ndc->setMuted(midiLfo->isMuted);
-    recordAction->setChecked(midiLfo->recordMode);
-    screen->setRecordMode(midiLfo->recordMode);
+    const int maxRate = (midiLfo->thinMinTicks) ? TPQN / midiLfo->thinMinTicks : 0;
+
+    waveFormBoxIndex = midiLfo->waveFormIndex;
+    freqBoxIndex = ModuleCore::tableIndex(lfoFreqValues, 14, midiLfo->freq, 3);
+    resBoxIndex = ModuleCore::tableIndex(lfoResValues, 13, midiLfo->res, 3);
+    sizeBoxIndex = ModuleCore::tableIndex(lfoSizeValues, 20, midiLfo->size, 0);
+    waveFormBox->setCurrentIndex(waveFormBoxIndex);
+    freqBox->setCurrentIndex(freqBoxIndex);
     resBox->setCurrentIndex(resBoxIndex);
-    updateRes(resBoxIndex);
     sizeBox->setCurrentIndex(sizeBoxIndex);
-    updateSize(sizeBoxIndex);
-    freqBox->setCurrentIndex(freqBoxIndex);
-    updateFreq(freqBoxIndex);
     loopBox->setCurrentIndex(midiLfo->curLoopMode);
-    amplitude->setValue(midiLfo->amp);
-    offset->setValue(midiLfo->offs);
-    phase->setValue(midiLfo->phase);
-    if (waveFormBoxIndex != waveFormBox->currentIndex()) {
-        waveFormBox->setCurrentIndex(waveFormBoxIndex);
-        updateWaveForm(waveFormBoxIndex);
+    thinBox->setCurrentIndex(ModuleCore::tableIndex(lfoThinValues, 6,
+            midiLfo->thinDeadband, 0));
+    maxRateBox->setCurrentIndex(ModuleCore::tableIndex(lfoMaxRateValues, 8,
+            maxRate, 0));
+    maxRateBox->setDisabled(midiLfo->thinDeadband < 0);
+
+    Slider *sliders[3] = { amplitude, offset, phase };
+    const int sliderValues[3] = { midiLfo->amp, midiLfo->offs, midiLfo->phase };
+    for (int l1 = 0; l1 < 3; l1++) {
+        sliders[l1]->blockSignals(true);
+        sliders[l1]->setValue(sliderValues[l1]);
+        sliders[l1]->blockSignals(false);
     }
-    needsGUIUpdate = false;
-    midiLfo->needsGUIUpdate = false;
+    const bool isCustom = (waveFormBoxIndex == 5);
+    amplitude->setDisabled(isCustom);
+    freqBox->setDisabled(isCustom);
+    phase->setDisabled(isCustom);
+
+    recordAction->blockSignals(true);
+    recordAction->setChecked(midiLfo->recordMode);
+    recordAction->blockSignals(false);
+    screen->setRecordMode(midiLfo->recordMode);
+    screen->newGrooveValues(midiLfo->newGrooveTick, midiLfo->grooveVelocity,
+                midiLfo->grooveLength);
+    screen->setMuted(midiLfo->isMuted);
 }
 
 #endif
@@ -94,9 +94,11 @@ class LfoWidget : public ModuleWidget
     QAction *recordAction;
     QAction *flipWaveVerticalAction;
     QComboBox *waveFormBox, *freqBox;
+    QComboBox *thinBox, *maxRateBox;
+    QLabel *thinCountLabel;
+    int thinCount;      /*!< MidiLfo::thinnedCount currently shown by LfoWidget::thinCountLabel */
 
-    QVector<Sample> getCustomWave();
-    QVector<bool> getMuteMask();
+    CompactWave getCustomWave();
     int resBoxIndex;
     int sizeBoxIndex;
     int freqBoxIndex;
@@ -127,21 +129,6 @@ class LfoWidget : public ModuleWidget
     MidiLfo *getMidiWorker();
 
 /*!
-* @brief reads all parameters of this LFO from an XML stream
-* passed by the caller, i.e. MainWindow.
-*
-* @param xml QXmlStreamWriter to read from
-* @param qmaxVersion QString with xml format version
-*/
-    void readData(QXmlStreamReader& xml, const QString& qmaxVersion) override;
-/*!
-* @brief writes all parameters of this LFO to an XML stream
-* passed by the caller, i.e. MainWindow.
-*
-* @param xml QXmlStreamWriter to write to
-*/
-    void writeData(QXmlStreamWriter& xml) override;
-/*!
 * @brief copies all LFO module GUI parameters from
 * fromWidget
 *
@@ -149,11 +136,9 @@ class LfoWidget : public ModuleWidget
 */
     void copyParamsFrom(ModuleWidget *fromWidget) override;
 
-    void doStoreParams(int ix);
-    void doRestoreParams(int ix);
-    void updateDisplay();
-    void handleController(int ccnumber, int channel, int value);
-    void updateCursorPos() { cursor->updatePosition(getFramePtr()); }
+    void updateWidgets() override;
+    void updateScreen(bool newData) override;
+    void updateCursorPos(int pos) { cursor->updatePosition(pos); }
 #endif
 
 /* SIGNALS */
@@ -203,6 +188,24 @@ class LfoWidget : public ModuleWidget
 */
     void updateLoop(int);
 /*!
+* @brief Slot for the LfoWidget::thinBox combobox. Sets the output
+* thinning deadband of the LFO.
+*
+* It calls MidiLfo::updateThinning().
+* @param val Deadband index from lfoThinValues to set.
+*
+*/
+    void updateThin(int val);
+/*!
+* @brief Slot for the LfoWidget::maxRateBox combobox. Sets the maximum
+* rate of the thinned LFO output.
+*
+* It calls MidiLfo::updateThinning().
+* @param val Rate index from lfoMaxRateValues to set.
+*
+*/
+    void updateMaxRate(int val);
+/*!
 * @brief Slot for the LfoWidget::freqBox combobox. Sets the frequency
 * of the LFO.
 *
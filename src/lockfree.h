@@ -1,7 +1,7 @@
 /* -*- Mode: C++ ; c-basic-offset: 4 -*- */
 /*!
  * @file lockfree.h
- * @brief Implementation of the LockFreeStore and LockedData templates
+ * @brief Implementation of the SnapshotBuffer and SnapshotStore templates
  *
  *
  *      Copyright 2011 <qmidiarp-devel@lists.sourceforge.net>
@@ -26,119 +26,275 @@
 #ifndef LOCKFREE_H__5C0B9D86_95EB_47E0_81EA_D2D148F3C394__INCLUDED
 #define LOCKFREE_H__5C0B9D86_95EB_47E0_81EA_D2D148F3C394__INCLUDED
 
-#include <QMutex>
-
-template <typename T> class LockedData;
+#include <atomic>
+#include <thread>
+#include <vector>
 
 /**
- * @brief Template class that implements a lock-free data store
- *
- * The store has two parts, the writable part and a read-only part.
- * Both parts of the store are of type T (the template typename parameter).
- * The the access to the read-only part is guaranteed to be lock-free.
- * The access of the writable part involves obtaining of lock.
- * This lock guarantees that the read-only part will be consistent.
+ * @brief Template class that publishes snapshots of type T to one
+ * realtime reader thread without ever allocating or deleting them
  *
- * The threading model that is implied is consists of two threads.
- * A gui/main thread accesses and updates the writable part of the store.
- * The restricted thread has read-only and lock-free access to the
- * read-only part of the store.
+ * The store holds three instances of T, which are recycled. The writer
+ * (gui/main) thread obtains an instance that is neither current nor held
+ * by the reader with edit(), fills it and makes it current with
+ * publish(). The reader thread brackets its accesses with acquire() and
+ * release() exactly like with SnapshotStore. Since at most one instance
+ * is held by the reader, edit() always finds a free one.
  *
- * Before the restricted thread accesses the read-only part of the store
- * it should try to update it from the write-only part by calling
- * try_lockfree_update(). If gui thread is currently not accessing the
- * writable store, the update will succeed. If the gui thread is accessing
- * the writable store, the update of the read-only store will not be made
- * and the restricted thread will access the older version of the data.
+ * A published instance is not modified until a later edit() hands it out
+ * again, so the reader never sees a partly written T. If T contains
+ * containers, they keep their capacity when recycled, so that after the
+ * first edits no allocation happens in either thread.
+ */
+template <typename T>
+class SnapshotBuffer
+{
+public:
+    SnapshotBuffer() : m_current(&m_slots[0]), m_hazard(NULL) {}
+
+    /**
+     * @brief Obtain the current snapshot from the reader thread
+     *
+     * The snapshot remains valid until release() is called.
+     */
+    const T *acquire()
+    {
+        T *snapshot = m_current.load();
+        for (;;) {
+            m_hazard.store(snapshot);
+            T *check = m_current.load();
+            if (check == snapshot) return snapshot;
+            snapshot = check;
+        }
+    }
+
+    /**
+     * @brief Release the snapshot obtained by acquire()
+     */
+    void release() { m_hazard.store(NULL); }
+
+    /**
+     * @brief Access the current snapshot from the writer thread
+     */
+    const T *current() const { return m_current.load(); }
+
+    /**
+     * @brief Obtain an instance to fill from the writer thread
+     *
+     * The instance still holds the data it had when it was published
+     * before. The instances are handed out in turn.
+     */
+    T *edit()
+    {
+        const T *current = m_current.load();
+        const T *hazard = m_hazard.load();
+        int index = current - m_slots;
+        for (;;) {
+            index = (index + 1) % 3;
+            if ((&m_slots[index] != current) && (&m_slots[index] != hazard))
+                return &m_slots[index];
+        }
+    }
+
+    /**
+     * @brief Make the instance obtained by edit() the current snapshot
+     */
+    void publish(T *snapshot) { m_current.store(snapshot); }
+
+private:
+    T m_slots[3];
+    std::atomic<T *> m_current;
+    std::atomic<T *> m_hazard;
+};
+
+/**
+ * @brief Template class that publishes immutable snapshots of type T
+ * to one realtime reader thread
  *
- * Access to the read only part of the store is obtained by casting
- * of the LockFreeStore object to a const pointer to the template parameter
- * type T.
+ * The writer (gui/main) thread prepares a new T and hands it over by
+ * calling publish(). The reader thread brackets its accesses with
+ * acquire() and release(). acquire() never blocks and never allocates.
  *
- * Access to the writable part of the store is obtained by instantiating
- * a LockedData object. LockedData implements a scoped lock of the
- * writable part of the store.
+ * Replaced snapshots are retired and deleted by the writer thread as soon
+ * as the reader no longer holds them. The reader announces the snapshot
+ * it holds in a hazard pointer, so that there is no lock in either thread.
+ * Only one reader thread is supported.
  */
 template <typename T>
-class LockFreeStore
+class SnapshotStore
 {
 public:
+    SnapshotStore() : m_current(new T), m_hazard(NULL) {}
+
+    ~SnapshotStore()
+    {
+        for (unsigned int l1 = 0; l1 < m_retired.size(); l1++) {
+            delete m_retired[l1];
+        }
+        delete m_current.load();
+    }
+
     /**
-     * @brief Obtain a read-only pointer to the read-only part of the store
+     * @brief Obtain the current snapshot from the reader thread
+     *
+     * The snapshot remains valid until release() is called.
      */
-    operator const T * () { return &m_lockfree_data; }
+    const T *acquire()
+    {
+        T *snapshot = m_current.load();
+        for (;;) {
+            m_hazard.store(snapshot);
+            T *check = m_current.load();
+            if (check == snapshot) return snapshot;
+            snapshot = check;
+        }
+    }
 
     /**
-     * @brief If possible, update the read-only part of the store from the
-     * writable part of store
+     * @brief Release the snapshot obtained by acquire()
+     */
+    void release() { m_hazard.store(NULL); }
+
+    /**
+     * @brief Access the current snapshot from the writer thread
+     */
+    const T *current() const { return m_current.load(); }
+
+    /**
+     * @brief Replace the current snapshot from the writer thread
      *
-     * @retval true the read-only store was successful update
-     * @retval false the read-only store was not updated
+     * @param snapshot Newly allocated snapshot, the store takes ownership
      */
-    bool try_lockfree_update()
+    void publish(T *snapshot)
     {
-        if (!m_mutex.tryLock()) return false;
+        m_retired.push_back(m_current.exchange(snapshot));
+        reclaim();
+    }
 
-        m_lockfree_data = m_data;
-        m_mutex.unlock();
-        return true;
+    /**
+     * @brief Wait until the reader holds no retired snapshot and delete
+     * all of them
+     *
+     * Has to be called from the writer thread before data referenced by
+     * the retired snapshots is destroyed.
+     */
+    void synchronize()
+    {
+        reclaim();
+        while (!m_retired.empty()) {
+            std::this_thread::yield();
+            reclaim();
+        }
     }
 
 private:
-    T m_data;
-    T m_lockfree_data;
-    QMutex m_mutex;
+    void reclaim()
+    {
+        const T *hazard = m_hazard.load();
+        unsigned int l2 = 0;
+        for (unsigned int l1 = 0; l1 < m_retired.size(); l1++) {
+            if (m_retired[l1] == hazard) {
+                m_retired[l2++] = m_retired[l1];
+            }
+            else {
+                delete m_retired[l1];
+            }
+        }
+        m_retired.resize(l2);
+    }
 
-    friend class LockedData<T>;
+    std::atomic<T *> m_current;
+    std::atomic<T *> m_hazard;
+    std::vector<T *> m_retired;
 };
 
 /**
- * @brief Template class that implements a read-write access to LockFreeStore
- *
- * When a LockedData object is constructed, the writable part of the LockFreeStore
- * is locked. When the LockedData object is destructed, the writable part of the
- * LockFreeStore is unlocked. I.e. LockedData implements a scoped lock.
+ * @brief Template class passing elements of type T from one realtime
+ * writer thread to one reader thread
  *
- * Access to the writable part of the LockFreeStore is obtained by casting
- * the LockFreeStore object to a pointer to the template parameter type T.
- *
- * The store associated by passing a LockFreeStore reference as parameter to
- * the LockedData constructor.
+ * The ring buffer is allocated once in the constructor, its size is
+ * rounded up to a power of two. push() never blocks and never
+ * allocates. If the ring is full, the element is dropped and counted,
+ * the reader collects the count with takeDropped(). The reader takes
+ * all available elements at once with pop(). Only one writer and one
+ * reader thread are supported.
  */
 template <typename T>
-class LockedData
+class SpscRing
 {
 public:
+    explicit SpscRing(unsigned int size) : m_head(0), m_tail(0), m_dropped(0)
+    {
+        unsigned int capacity = 1;
+        while (capacity < size) capacity <<= 1;
+        m_buffer.resize(capacity);
+        m_mask = capacity - 1;
+    }
+
+    unsigned int capacity() const { return m_mask + 1; }
+
     /**
-     * @brief Constructor.
-     *
-     * Obtains the writable store lock.
+     * @brief Number of elements available to the reader
      *
-     * @param store a reference to existing LockFreeStore
+     * At least this number will be returned by the next pop() from the
+     * reader thread.
      */
-    LockedData(LockFreeStore<T> &store) : m_store(store)
+    unsigned int size() const
     {
-        m_store.m_mutex.lock();
+        return m_head.load(std::memory_order_acquire)
+                - m_tail.load(std::memory_order_relaxed);
     }
 
     /**
-     * @brief Destructor.
+     * @brief Append an element from the writer thread
      *
-     * Releases the writable store lock.
+     * @return False if the ring was full and the element was dropped
+     */
+    bool push(const T& element)
+    {
+        const unsigned int head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) > m_mask) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_buffer[head & m_mask] = element;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Move the available elements to out from the reader thread
      *
+     * @param out Array receiving the elements in the order of push()
+     * @param max Number of elements out can hold
+     * @return Number of elements written to out
      */
-    ~LockedData()
+    unsigned int pop(T *out, unsigned int max)
     {
-        m_store.m_mutex.unlock();
+        const unsigned int tail = m_tail.load(std::memory_order_relaxed);
+        unsigned int count = m_head.load(std::memory_order_acquire) - tail;
+        if (count > max) count = max;
+        for (unsigned int l1 = 0; l1 < count; l1++) {
+            out[l1] = m_buffer[(tail + l1) & m_mask];
+        }
+        m_tail.store(tail + count, std::memory_order_release);
+        return count;
     }
 
     /**
-     * @brief Obtain a pointer to the writable part of the store
+     * @brief Return the number of dropped elements since the last call
      */
-    T * operator->() { return &m_store.m_data; }
+    unsigned int takeDropped()
+    {
+        return m_dropped.exchange(0, std::memory_order_relaxed);
+    }
 
 private:
-    LockFreeStore<T> & m_store;
+    std::vector<T> m_buffer;
+    unsigned int m_mask;
+    std::atomic<unsigned int> m_head;   /**< Written by the writer only */
+    std::atomic<unsigned int> m_tail;   /**< Written by the reader only */
+    std::atomic<unsigned int> m_dropped;
 };
 
 #endif /* #ifndef LOCKFREE_H__5C0B9D86_95EB_47E0_81EA_D2D148F3C394__INCLUDED */
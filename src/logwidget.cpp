@@ -21,22 +21,155 @@
  *      MA 02110-1301, USA.
  */
 
+#include <QBrush>
 #include <QPushButton>
+#include <QScrollBar>
 #include <QStringList>
 #include <QGroupBox>
 
 #include "logwidget.h"
+#include "rtstats.h"
 
 
+LogModel::LogModel(QObject *parent) : QAbstractListModel(parent)
+{
+    first = 0;
+    count = 0;
+}
+
+int LogModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return count;
+}
+
+QVariant LogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || (index.row() >= count)) return QVariant();
+
+    const Entry &entry = entries.at((first + index.row()) % LOG_MAXROWS);
+    const MidiEvent &ev = entry.ev;
+
+    if (role == Qt::ForegroundRole) {
+        switch (ev.type) {
+            case EV_NOTEON:
+            case EV_NOTEOFF:
+                return QBrush(QColor(0, 0, 255));
+            case EV_CONTROLLER:
+                return QBrush(QColor(100, 160, 0));
+            case EV_PITCHBEND:
+                return QBrush(QColor(100, 0, 255));
+            case EV_PGMCHANGE:
+                return QBrush(QColor(0, 100, 100));
+            case EV_CLOCK:
+                return QBrush(QColor(150, 150, 150));
+            case EV_START:
+                return QBrush(QColor(0, 192, 0));
+            case EV_CONTINUE:
+                return QBrush(QColor(0, 128, 0));
+            case EV_STOP:
+                return QBrush(QColor(128, 96, 0));
+            default:
+                return QBrush(QColor(0, 0, 0));
+        }
+    }
+
+    if (role != Qt::DisplayRole) return QVariant();
+
+    QString qs;
+    switch (ev.type) {
+        case EV_NOTEON:
+            qs = QString("Ch %1, Note On %2, Vel %3, tick %4")
+                    .arg(ev.channel + 1, 2).arg(ev.data, 3)
+                    .arg(ev.value, 3).arg(entry.tick);
+            break;
+        case EV_NOTEOFF:
+            qs = QString("Ch %1, Note Off %2, tick %3")
+                    .arg(ev.channel + 1, 2).arg(ev.data, 3).arg(entry.tick);
+            break;
+        case EV_CONTROLLER:
+            qs = QString("Ch %1, Ctrl %2, Val %3, tick %4")
+                    .arg(ev.channel + 1, 2).arg(ev.data, 3)
+                    .arg(ev.value, 3).arg(entry.tick);
+            break;
+        case EV_PITCHBEND:
+            qs = QString("Ch %1, Pitch %2, tick %3")
+                    .arg(ev.channel + 1, 2).arg(ev.value, 5).arg(entry.tick);
+            break;
+        case EV_PGMCHANGE:
+            qs = QString("Ch %1, PrgChg %2, tick %3")
+                    .arg(ev.channel + 1, 2).arg(ev.value, 5).arg(entry.tick);
+            break;
+        case EV_CLOCK:
+            qs = LogWidget::tr("MIDI Clock, tick") + QString(" %1").arg(entry.tick);
+            break;
+        case EV_START:
+            qs = LogWidget::tr("MIDI Start (Transport)");
+            break;
+        case EV_CONTINUE:
+            qs = LogWidget::tr("MIDI Continue (Transport)");
+            break;
+        case EV_STOP:
+            qs = LogWidget::tr("MIDI Stop (Transport)");
+            break;
+        default:
+            qs = LogWidget::tr("Unknown event type");
+            break;
+    }
+    return QDateTime::fromMSecsSinceEpoch(entry.msecs).toString(
+            "hh:mm:ss.zzz") + "  " + qs;
+}
+
+void LogModel::append(const Entry *batch, int n)
+{
+    if (n <= 0) return;
+    if (n > LOG_MAXROWS) {
+        batch += n - LOG_MAXROWS;
+        n = LOG_MAXROWS;
+    }
+
+    const int overflow = count + n - LOG_MAXROWS;
+    if (overflow > 0) {
+        beginRemoveRows(QModelIndex(), 0, overflow - 1);
+        first = (first + overflow) % LOG_MAXROWS;
+        count -= overflow;
+        endRemoveRows();
+    }
+
+    // entries grows up to LOG_MAXROWS, then its oldest rows are reused
+    beginInsertRows(QModelIndex(), count, count + n - 1);
+    for (int l1 = 0; l1 < n; l1++) {
+        const int ix = (first + count) % LOG_MAXROWS;
+        if (ix < entries.count())
+            entries[ix] = batch[l1];
+        else
+            entries.append(batch[l1]);
+        count++;
+    }
+    endInsertRows();
+}
+
+void LogModel::clear()
+{
+    beginResetModel();
+    entries.clear();
+    first = 0;
+    count = 0;
+    endResetModel();
+}
+
 LogWidget::LogWidget(QWidget *parent) : QWidget(parent)
 {
     logActive = false;
     logMidiActive = false;
-
-    logText = new QTextEdit(this);
-    logText->setTextColor(QColor(0,0,255));
-    logText->setCurrentFont(QFont("Courier", 8));
-    logText->setReadOnly(true);
+    droppedCount = 0;
+
+    logModel = new LogModel(this);
+    logView = new QListView(this);
+    logView->setModel(logModel);
+    logView->setUniformItemSizes(true);
+    logView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    logView->setFont(QFont("Courier", 8));
     enableLog = new QCheckBox(this);
     enableLog->setText(tr("&Enable Log"));
     QObject::connect(enableLog, SIGNAL(toggled(bool)), this,
@@ -49,16 +182,19 @@ LogWidget::LogWidget(QWidget *parent) : QWidget(parent)
             SLOT(logMidiToggle(bool)));
     logMidiClock->setChecked(logMidiActive);
 
+    droppedLabel = new QLabel(this);
+
     QPushButton *clearButton = new QPushButton(tr("&Clear"), this);
     QObject::connect(clearButton, SIGNAL(clicked()), this, SLOT(clear()));
     QHBoxLayout *buttonBoxLayout = new QHBoxLayout;
     buttonBoxLayout->addWidget(enableLog);
     buttonBoxLayout->addWidget(logMidiClock);
     buttonBoxLayout->addStretch(10);
+    buttonBoxLayout->addWidget(droppedLabel);
     buttonBoxLayout->addWidget(clearButton);
 
     QVBoxLayout *logBoxLayout = new QVBoxLayout;
-    logBoxLayout->addWidget(logText);
+    logBoxLayout->addWidget(logView);
     logBoxLayout->addLayout(buttonBoxLayout);
     setLayout(logBoxLayout);
 }
@@ -67,65 +203,37 @@ LogWidget::~LogWidget()
 {
 }
 
-void LogWidget::appendEvent(MidiEvent ev, int tick) {
-
-    QString qs, qs2;
-
+void LogWidget::appendEvents(const QVector<MidiLogEvent>& events, int dropped)
+{
     if (!logActive) {
         return;
     }
-    switch (ev.type) {
-        case EV_NOTEON:
-            qs.sprintf("Ch %2d, Note On %3d, Vel %3d, tick %d",
-                    ev.channel + 1,
-                    ev.data, ev.value, tick);
-            break;
-        case EV_NOTEOFF:
-            qs.sprintf("Ch %2d, Note Off %3d, tick %d", ev.channel+1,
-                    ev.data, tick);
-            break;
-        case EV_CONTROLLER:
-            logText->setTextColor(QColor(100,160,0));
-            qs.sprintf("Ch %2d, Ctrl %3d, Val %3d, tick %d", ev.channel+1,
-                    ev.data, ev.value, tick);
-            break;
-        case EV_PITCHBEND:
-            logText->setTextColor(QColor(100,0,255));
-            qs.sprintf("Ch %2d, Pitch %5d, tick %d", ev.channel+1,
-                    ev.value, tick);
-            break;
-        case EV_PGMCHANGE:
-            logText->setTextColor(QColor(0,100,100));
-            qs.sprintf("Ch %2d, PrgChg %5d, tick %d", ev.channel+1,
-                    ev.value, tick);
-            break;
-        case EV_CLOCK:
-            if (logMidiActive) {
-                logText->setTextColor(QColor(150,150,150));
-                qs = tr("MIDI Clock, tick");
-            }
-            break;
-        case EV_START:
-            logText->setTextColor(QColor(0,192,0));
-            qs = tr("MIDI Start (Transport)");
-            break;
-        case EV_CONTINUE:
-            logText->setTextColor(QColor(0,128,0));
-            qs = tr("MIDI Continue (Transport)");
-            break;
-        case EV_STOP:
-            logText->setTextColor(QColor(128,96,0));
-            qs = tr("MIDI Stop (Transport)");
-            break;
-        default:
-            logText->setTextColor(QColor(0,0,0));
-            qs = tr("Unknown event type");
-            break;
+
+    if (dropped) {
+        droppedCount += dropped;
+        droppedLabel->setText(tr("%1 events dropped").arg(droppedCount));
     }
-    if ((ev.type != EV_CLOCK) || logMidiActive)
-        logText->append(QTime::currentTime().toString(
-                    "hh:mm:ss.zzz") + "  " + qs);
-    logText->setTextColor(QColor(0, 0, 255));
+
+    // convert the reception times from the monotonic clock to local time
+    const uint64_t now_ns = RtStats::now();
+    const qint64 now_ms = QDateTime::currentDateTime().toMSecsSinceEpoch();
+
+    batch.resize(0);
+    for (int l1 = 0; l1 < events.count(); l1++) {
+        const MidiLogEvent &logEv = events.at(l1);
+        if ((logEv.ev.type == EV_CLOCK) && !logMidiActive) continue;
+        LogModel::Entry entry;
+        entry.ev = logEv.ev;
+        entry.tick = logEv.tick;
+        entry.msecs = now_ms - (qint64)((now_ns - logEv.time_ns) / 1000000);
+        batch.append(entry);
+    }
+    if (batch.isEmpty()) return;
+
+    QScrollBar *scrollBar = logView->verticalScrollBar();
+    const bool atEnd = (scrollBar->value() == scrollBar->maximum());
+    logModel->append(batch.constData(), batch.count());
+    if (atEnd) logView->scrollToBottom();
 }
 
 void LogWidget::enableLogToggle(bool on)
@@ -141,11 +249,7 @@ void LogWidget::logMidiToggle(bool on)
 
 void LogWidget::clear()
 {
-    logText->clear();
+    logModel->clear();
+    droppedCount = 0;
+    droppedLabel->clear();
 }
-
-void LogWidget::appendText(const QString& qs)
-{
-    logText->append(qs);
-}
-
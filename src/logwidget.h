@@ -24,24 +24,70 @@
 #ifndef LOGWIDGET_H
 #define LOGWIDGET_H
 
+#include <QAbstractListModel>
 #include <QBoxLayout>
 #include <QDateTime>
 #include <QString>
 #include <QLabel>
 #include <QCheckBox>
-#include <QTextEdit>
+#include <QListView>
+#include <QVector>
 
+#include "main.h"
 #include "midievent.h"
 
+/*!
+ * @brief List model holding the events shown by the LogWidget.
+ *
+ * The events are stored in a ring of at most LOG_MAXROWS entries, the
+ * oldest ones are removed when it is full. The text and color of a row
+ * are only computed when the view requests it, so that only the visible
+ * rows are formatted.
+ */
+class LogModel : public QAbstractListModel
+
+{
+  Q_OBJECT
+
+  public:
+    /*! @brief Event as stored in the model */
+    struct Entry {
+        MidiEvent ev;
+        int tick;
+        qint64 msecs;   /**< Reception time in ms since the epoch */
+    };
+
+  private:
+    QVector<Entry> entries;
+    int first;      /**< Index of the oldest row in entries */
+    int count;      /**< Number of rows */
+
+  public:
+    LogModel(QObject *parent = 0);
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+/*!
+* @brief appends rows at the end of the log, removing the oldest rows
+* if more than LOG_MAXROWS would be held
+*
+* @param batch Entries to append
+* @param n Number of entries in batch
+*/
+    void append(const Entry *batch, int n);
+    void clear();
+};
+
 /*!
  * @brief Creates a QWidget displaying a log of received MIDI events from SeqDriver.
  *
  * The LogWidget is instantiated by MainWindow on program start. It is
  * embedded in a DockWindow and shown/hidden by a MainWindow menu entry and
  * tool button.
- * The Widget holds a QTextEdit panel, which is filled with information on
- * each MIDI Event passed by signalling to the LogWidget::appendEvent() slot.
- * The events are currently emitted by the SeqDriver backend.
+ * The Widget holds a QListView on a LogModel, which is filled with the
+ * MIDI Events passed in batches by signalling to the
+ * LogWidget::appendEvents() slot once per display update. The view
+ * follows the new events while it is scrolled to the end. Events
+ * dropped because the Engine log ring was full are counted in a label.
  */
 class LogWidget : public QWidget
 
@@ -49,10 +95,13 @@ class LogWidget : public QWidget
   Q_OBJECT
 
   private:
-    QVBoxLayout vBox;
-    QTextEdit *logText;
+    QListView *logView;
+    LogModel *logModel;
+    QLabel *droppedLabel;
+    QVector<LogModel::Entry> batch;
     bool logActive;
     bool logMidiActive;
+    int droppedCount;
 
 
   public:
@@ -67,8 +116,16 @@ class LogWidget : public QWidget
   public slots:
     void logMidiToggle(bool on);
     void enableLogToggle(bool on);
-    void appendEvent(MidiEvent ev, int tick);
-    void appendText(const QString&);
+/*!
+* @brief appends a batch of received events to the log
+*
+* This is a slot for Engine::midiEventsReceived(). MIDI Clock events
+* are skipped unless their logging is enabled.
+*
+* @param events Received events in reception order
+* @param dropped Number of events lost before these
+*/
+    void appendEvents(const QVector<MidiLogEvent>& events, int dropped);
     void clear();
 };
 
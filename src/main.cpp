@@ -58,6 +58,7 @@
 #include <getopt.h>
 #include <unistd.h>
 #include <QApplication>
+#include <QCoreApplication>
 #include <QFileInfo>
 #include <QString>
 #include <QTextStream>
@@ -67,6 +68,7 @@
 #include <QLocale>
 #include <QLibraryInfo>
 
+#include "headlessengine.h"
 #include "mainwindow.h"
 #include "main.h"
 
@@ -80,6 +82,12 @@ static struct option options[] = {
 #endif
     {"jack_session_uuid", required_argument, 0, 'U' },
     {"portCount", 1, 0, 'p'},
+    {"headless", 0, 0, 'H'},
+    {"render", 1, 0, 'r'},
+    {"input", 1, 0, 'i'},
+    {"length", 1, 0, 'l'},
+    {"stats", 1, 0, 's'},
+    {"capture", 1, 0, 'c'},
     {0, 0, 0, 0}
 };
 
@@ -91,11 +99,17 @@ int main(int argc, char *argv[])
     int option_index;
     int portCount = 2;
     bool alsamidi = false;
+    bool headless = false;
+    QString renderFile;
+    QString inputFile;
+    int renderBeats = 0;
+    QString statsFile;
+    QString captureFile;
     QString s;
 
     QTextStream out(stdout);
     srand(getpid());
-    while ((getopt_return = getopt_long(argc, argv, "vhajUp:", options,
+    while ((getopt_return = getopt_long(argc, argv, "vhajUp:Hr:i:l:s:c:", options,
                     &option_index)) >= 0) {
         switch(getopt_return) {
             case 'v':
@@ -123,6 +137,18 @@ int main(int argc, char *argv[])
 #endif
                 out << QString("  -p, --portCount <num>    "
                         "Number of output ports [%1]").arg(portCount) << endl;
+                out << "  -H, --headless           "
+                    "Run FILENAME without GUI" << endl;
+                out << "  -r, --render <file>      "
+                    "Render FILENAME offline to a MIDI file" << endl;
+                out << "  -i, --input <file>       "
+                    "MIDI file played into the rendered session" << endl;
+                out << "  -l, --length <beats>     "
+                    "Length of the rendering [end of input]" << endl;
+                out << "  -s, --stats <file>       "
+                    "Write realtime statistics as JSON on exit" << endl;
+                out << "  -c, --capture <file>     "
+                    "Capture all MIDI input and output to a file" << endl;
                 out.flush();
                 exit(EXIT_SUCCESS);
 #ifdef HAVE_ALSA
@@ -143,9 +169,64 @@ int main(int argc, char *argv[])
                 else if (portCount < 1)
                     portCount = 2;
                 break;
+            case 'H':
+                headless = true;
+                break;
+            case 'r':
+                renderFile = QString(optarg);
+                headless = true;
+                break;
+            case 'i':
+                inputFile = QString(optarg);
+                break;
+            case 'l':
+                renderBeats = atoi(optarg);
+                break;
+            case 's':
+                statsFile = QString(optarg);
+                break;
+            case 'c':
+                captureFile = QString(optarg);
+                break;
         }
     }
 
+    if (headless) {
+        if (optind >= argc) {
+            qWarning("The --headless and --render options require a session file");
+            exit(EXIT_FAILURE);
+        }
+        QCoreApplication app(argc, argv);
+        QFileInfo fi(argv[optind]);
+        if (!fi.exists()) {
+            qWarning("File not found: %s", argv[optind]);
+            exit(EXIT_FAILURE);
+        }
+        HeadlessEngine::installSignalHandlers();
+        int backend = alsamidi ? HeadlessEngine::BACKEND_ALSA
+                : HeadlessEngine::BACKEND_JACK;
+        if (!renderFile.isEmpty()) backend = HeadlessEngine::BACKEND_OFFLINE;
+        HeadlessEngine *engine = new HeadlessEngine(portCount, backend);
+        int result = -1;
+        if (!captureFile.isEmpty() && !engine->startCapture(captureFile)) {
+            delete engine;
+            exit(EXIT_FAILURE);
+        }
+        if (!renderFile.isEmpty()) {
+            if (engine->openFile(fi.absoluteFilePath())
+                    && engine->render(inputFile, renderFile, renderBeats))
+                result = EXIT_SUCCESS;
+        }
+        else if (!engine->jackFailed
+                && engine->openFile(fi.absoluteFilePath()))
+            result = app.exec();
+
+        engine->stopCapture();
+        if (!statsFile.isEmpty()) engine->writeRtStats(statsFile);
+        delete engine;
+        return result;
+    }
+
     QApplication app(argc, argv);
     QLocale loc = QLocale::system();
 
@@ -172,10 +253,15 @@ int main(int argc, char *argv[])
         else
             qWarning("File not found: %s", argv[optind]);
     }
+    if (!captureFile.isEmpty()) qmidiarp->startCapture(captureFile);
     int result = -1;
     if (!qmidiarp->jackFailed)
         result = app.exec();
 
+    qmidiarp->stopCapture();
+
+    if (!statsFile.isEmpty()) qmidiarp->writeRtStats(statsFile);
+
     delete qmidiarp;
     return result;
 }
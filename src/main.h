@@ -33,6 +33,8 @@
 #define MAX_PORTS         64
 #define SEQPOOL         2048
 #define JQ_BUFSZ        1024
+#define LOG_RINGSIZE    4096
+#define LOG_MAXROWS   200000
 #define LFO_FRAMELIMIT    16
 #define MAXNOTES         128
 #define TPQN           48000
@@ -67,6 +69,16 @@ const int lfoResValues[13] = {1, 2, 3, 4, 5, 6, 7, 8, 16, 32, 64, 96, 192};
 //const int old_lfoResValues[9] = {1, 2, 4, 8, 16, 32, 64, 96, 192};
 const int mapOldLfoRes[9] = {0, 1, 3, 7, 8, 9, 10, 11, 12};
 
+/*! @brief This array holds the currently available LFO output thinning
+ * deadbands, -1 disables the thinning.
+ */
+const int lfoThinValues[6] = {-1, 0, 1, 2, 4, 8};
+
+/*! @brief This array holds the currently available maximum LFO output
+ * rates in events per beat, 0 for no limit.
+ */
+const int lfoMaxRateValues[8] = {0, 96, 64, 32, 16, 8, 4, 2};
+
 /*! @brief This array holds the currently available Seq resolution values.
  */
 const int seqResValues[13] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 16};
@@ -161,15 +161,25 @@ MainWindow::MainWindow(int p_portCount, bool p_alsamidi, char *execName)
     logWindow->setWidget(logWidget);
     logWindow->setObjectName("logWidget");
     qRegisterMetaType<MidiEvent>("MidiEvent");
-    connect(engine, SIGNAL(midiEventReceived(MidiEvent, int)),
-            logWidget, SLOT(appendEvent(MidiEvent, int)));
+    connect(engine, SIGNAL(midiEventsReceived(const QVector<MidiLogEvent>&, int)),
+            logWidget, SLOT(appendEvents(const QVector<MidiLogEvent>&, int)));
 
     connect(logWidget, SIGNAL(sendLogEvents(bool)),
             engine, SLOT(setSendLogEvents(bool)));
 
+    statsWidget = new StatsWidget(engine, this);
+    statsWindow = new QDockWidget(tr("Realtime Statistics"), this);
+    statsWindow->setFeatures(QDockWidget::DockWidgetClosable
+            | QDockWidget::DockWidgetMovable
+            | QDockWidget::DockWidgetFloatable);
+    statsWindow->setWidget(statsWidget);
+    statsWindow->setObjectName("statsWidget");
+
     addDockWidget(Qt::BottomDockWidgetArea, globStoreWindow);
     addDockWidget(Qt::BottomDockWidgetArea, grooveWindow);
     addDockWidget(Qt::BottomDockWidgetArea, logWindow);
+    addDockWidget(Qt::BottomDockWidgetArea, statsWindow);
+    statsWindow->setVisible(false);
     
     prefs = new Prefs;
     
@@ -270,6 +280,9 @@ MainWindow::MainWindow(int p_portCount, bool p_alsamidi, char *execName)
     viewLogAction->setText(tr("&Event Log"));
     viewLogAction->setShortcut(QKeySequence(tr("Ctrl+H", "View|Event Log")));
 
+    QAction* viewStatsAction = statsWindow->toggleViewAction();
+    viewStatsAction->setText(tr("Realtime &Statistics"));
+
     QAction* viewGrooveAction = grooveWindow->toggleViewAction();
     viewGrooveAction->setIcon(QPixmap(groovetog_xpm));
     viewGrooveAction->setText(tr("&Groove Settings"));
@@ -310,6 +323,7 @@ MainWindow::MainWindow(int p_portCount, bool p_alsamidi, char *execName)
     viewMenu->addAction(showAllIOAction);
     viewMenu->addAction(hideAllIOAction);
     viewMenu->addAction(viewLogAction);
+    viewMenu->addAction(viewStatsAction);
     viewMenu->addAction(viewGrooveAction);
     viewMenu->addAction(viewGlobAction);
     viewMenu->addAction(QPixmap(midicontrol_xpm), tr("&MIDI Controllers..."),
@@ -404,6 +418,21 @@ MainWindow::~MainWindow()
     clear();
 }
 
+bool MainWindow::writeRtStats(const QString& fn)
+{
+    return engine->writeRtStats(fn);
+}
+
+bool MainWindow::startCapture(const QString& fn)
+{
+    return engine->startCapture(fn);
+}
+
+void MainWindow::stopCapture()
+{
+    engine->stopCapture();
+}
+
 void MainWindow::updateWindowTitle()
 {
     if (filename.isEmpty())
@@ -578,13 +607,13 @@ void MainWindow::clear()
         globStore->removeLocation(l1);
     }
     globStore->setDispState(0, 0);
-    globStore->midiControl->ccList.clear();
+    globStore->midiControl->clearCcList();
     while (engine->moduleWidgetCount()) {
         globStore->removeModule(0);
         engine->removeModuleWidget(engine->moduleWidget(0));
     }
     checkIfLastModule();
-    grooveWidget->midiControl->ccList.clear();
+    grooveWidget->midiControl->clearCcList();
 
 }
 
@@ -737,6 +766,8 @@ void MainWindow::readFilePartGlobal(QXmlStreamReader& xml)
                     prefsWidget->setOutputMidiClock(xml.readElementText().toInt());
                 else if (xml.name() == "midiClockPort")
                     prefsWidget->setPortMidiClock(xml.readElementText().toInt());
+                else if (xml.name() == "dinPorts")
+                    prefsWidget->setDinPorts(xml.readElementText().toULongLong());
                 else skipXmlElement(xml);
             }
         }
@@ -861,6 +892,8 @@ bool MainWindow::saveFile()
                 QString::number((int)prefsWidget->outputMidiClockCheck->isChecked()));
             xml.writeTextElement("midiClockPort",
                 QString::number(prefsWidget->portMidiClockSpin->currentIndex()));
+            xml.writeTextElement("dinPorts",
+                QString::number(prefs->dinPorts));
             xml.writeTextElement("storeMuteState",
                 QString::number(prefsWidget->storeMuteStateCheck->isChecked()));
         xml.writeEndElement();
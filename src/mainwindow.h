@@ -32,6 +32,7 @@
 #include <QToolBar>
 
 #include "logwidget.h"
+#include "statswidget.h"
 #include "midicctable.h"
 #include "prefswidget.h"
 #include "globstore.h"
@@ -81,6 +82,7 @@ class MainWindow : public QMainWindow
     PrefsWidget *prefsWidget;
     GrooveWidget *grooveWidget;
     LogWidget *logWidget;
+    StatsWidget *statsWidget;
     GlobStore *globStore;
     Engine *engine;
     MidiCCTable *midiCCTable;
@@ -89,6 +91,7 @@ class MainWindow : public QMainWindow
     QStringList patternNames, patternPresets;
     QStringList recentFiles;
     QDockWidget *logWindow, *grooveWindow, *passWindow, *globStoreWindow;
+    QDockWidget *statsWindow;
 
     QToolBar *controlToolBar, *fileToolBar;
     QAction *runAction, *addArpAction;
@@ -339,6 +342,16 @@ class MainWindow : public QMainWindow
     ~MainWindow();
 
     bool jackFailed;
+/*!
+* @brief writes the realtime statistics as JSON document
+*
+* @see Engine::writeRtStats()
+*/
+    bool writeRtStats(const QString& fn);
+/*! @see Engine::startCapture() */
+    bool startCapture(const QString& fn);
+/*! @see Engine::stopCapture() */
+    void stopCapture();
 
 /* SIGNALS */
   signals:
@@ -28,67 +28,12 @@
 
 #include "midiarp.h"
 
-/*
-#include "lockfree.h"
-
-// this class must be implemented in such way
-// so that its copy (= operator) is realtime safe
-class MidiEngine
-{
-public:
-    int foo;
-};
-*/
-
 MidiArp::MidiArp()
 {
-    /*
-    // this simulates access from the two threads
-    // lock congestion is simulated by attempt to update
-    // when LockedData destructor is not called
-    {
-        LockFreeStore<MidiEngine> store; // store for the two instances of MidiEngine
-        const MidiEngine * rdata(store); // pointer to the read-only store, to be used from the seq/jack driver thread
-
-        // write to the writable store
-        {
-            LockedData<MidiEngine> ldata(store); // lock the writable store, destructor will unlock it
-            ldata->foo = 1;                       // write access the writable store (lock obtained)
-            qWarning("gui: %d", ldata->foo);      // read access to the writable store (lock obtained)
-        } // ldata gets out of the scope and its destructor is called. this results in unlock of the writable store
-
-        // attempt update the read-only store and report whether the update succeeded
-        // should succeed because the writable store is not locked
-        qWarning("update %s", store.try_lockfree_update() ? "complete" : "not complete (gui thread locked)");
-        // print the data in the read-only store
-        qWarning("seq: %d", rdata->foo);
-
-        // write to the writable store
-        {
-            LockedData<MidiEngine> ldata(store);
-            ldata->foo = 2;
-            qWarning("gui: %d", ldata->foo);
-
-            // attempt update the read-only store and report whether the update succeeded
-            // should fail because the writable store is locked
-            qWarning("update %s", store.try_lockfree_update() ? "complete" : "not complete (gui thread locked)");
-            qWarning("seq: %d (data locked by gui)", rdata->foo);
-        }
-
-        // print the data in the read-only store before the update
-        qWarning("seq: %d (before update)", rdata->foo);
-        // attempt update the read-only store and report whether the update succeeded
-        // should succeed because the writable store is not locked
-        qWarning("update %s", store.try_lockfree_update() ? "complete" : "not complete (gui thread locked)");
-        // print the data in the read-only store after the update
-        qWarning("seq: %d (after update)", rdata->foo);
-    }
-*/
     eventType = EV_NOTEON;
+    moduleType = MOD_ARP;
 
     int latchDelayMsec = 50;
-    noteBufPtr = 0;
-    releaseNoteCount = 0;
     purgeReleaseFlag = false;
     stepWidth = 1.0;     // stepWidth relative to global queue stepWidth
     minStepWidth = 1.0;
@@ -105,13 +50,12 @@ MidiArp::MidiArp()
     len = 0.5;       // note length
     vel = 0.8;  // velocity relative to global velocity
     patternIndex = 0;
+    stepCount = 0;
     patternLen = 0;
-    semitone = 0;
     patternMaxIndex = 0;
     noteOfs = 0;
     arpTick = 0;
     returnTick = 0;
-    chordMode = false;
     randomTick = 0;
     randomVelocity = 0;
     randomLength = 0;
@@ -135,19 +79,18 @@ MidiArp::MidiArp()
     
     for (int l1 = 0; l1 < MAXCHORD; l1++) {
         noteIndex[l1] = 0;
-        chordSemitone[l1] = 0;
         outFrame[l1] = sample;
         nextVelocity[l1] = 0;
         nextNote[l1] = 0;
     }
     for (int l1 = 0; l1 < MAXNOTES; l1++) {
-        for (int l2 = 0; l2 < 4; l2++) notes[0][l2][l1] = 0;
-        for (int l2 = 0; l2 < 4; l2++) notes[1][l2][l1] = 0;
         sustainBuffer[l1] = 0;
         latchBuffer[l1] = 0;
+    }
+    for (int l1 = 0; l1 < NoteSet::SLOTS; l1++) {
         old_attackfn[l1] = 0.;
     }
-    
+    compilePattern();
 }
 
 bool MidiArp::handleEvent(MidiEvent inEv, int64_t tick, int keep_rel)
@@ -175,7 +118,7 @@ bool MidiArp::handleEvent(MidiEvent inEv, int64_t tick, int keep_rel)
             purgeLatchBuffer(tick);
             if (restartByKbd) restartFlag = true;
             // if we have been triggered, remove pending release notes
-            if (trigByKbd && release_time > 0) purgeReleaseNotes(noteBufPtr);
+            if (trigByKbd && release_time > 0) purgeReleaseNotes();
         }
         
         addNote(inEv.data, inEv.value, tick);
@@ -219,256 +162,121 @@ bool MidiArp::handleEvent(MidiEvent inEv, int64_t tick, int keep_rel)
     return(false);
 }
 
-void MidiArp::addNote(int note, int vel, int64_t tick)
+void MidiArp::getRoute(MidiRoute *route)
 {
-        // modify buffer that is not accessed by arpeggio output
-    int bufPtr = (noteBufPtr) ? 0 : 1;
-    int index = 0;
-
-    if (!noteCount || (note > notes[bufPtr][0][noteCount - 1])
-            || (repeatPatternThroughChord == 4) )
-        index = noteCount;
-    else {
-        while (index < MAXNOTES && note > notes[bufPtr][0][index]) index++;
-
-        for (int l3 = 0; l3 < 4; l3++) {
-            for (int l2 = noteCount; l2 > index; l2--) {
-                notes[bufPtr][l3][l2] = notes[bufPtr][l3][l2 - 1];
-            }
-        }
-    }
-    notes[bufPtr][0][index] = note;
-    notes[bufPtr][1][index] = vel;
-    notes[bufPtr][2][index] = tick;
-    notes[bufPtr][3][index] = 0;
-    noteCount++;
+    route->clear();
+    route->channel = chIn;
+    route->setNoteRange(indexIn[0], indexIn[1]);
+    route->addController(CT_FOOTSW);
+    route->addController(CT_ALLNOTESOFF);
+    route->addController(CT_ALLSOUNDOFF);
+}
 
-    copyNoteBuffer();
+void MidiArp::addNote(int note, int vel, int64_t tick)
+{
+    int slot = noteBuffer.insert(note, vel, tick);
+    if (slot >= 0) old_attackfn[slot] = 0.;
+    noteCount = noteBuffer.current().count();
 }
 
 void MidiArp::releaseNote(int note, int64_t tick, bool keep_rel)
 {
-    // modify buffer that is not accessed by arpeggio output
-    int bufPtr = (noteBufPtr) ? 0 : 1;
+    const NoteSet &noteSet = noteBuffer.current();
+
     if ((!keep_rel) || (!release_time)) {
         //definitely remove from buffer
-        if (note == notes[bufPtr][0][noteCount - 1]
-                && (repeatPatternThroughChord != 4)) {
-            //note is on top of buffer: only decrement noteCount
-            noteCount--;
-            if (repeatPatternThroughChord == 2) noteOfs = noteCount - 1;
-        }
-        else {
-            //note is not on top: take out the note and pull down all above
-            int index = 0;
-            while ((index < MAXNOTES) && (index < noteCount) 
-                && (note != notes[bufPtr][0][index])) index++;
-            deleteNoteAt(index, bufPtr);
-        }
+        int slot = noteSet.find(note);
+        if (slot < 0) return;
+        bool onTop = (repeatPatternThroughChord != 4)
+                && (note == NoteSet::note(noteSet.last()));
+        noteBuffer.remove(slot);
+        noteCount = noteBuffer.current().count();
+        if (onTop && (repeatPatternThroughChord == 2)) noteOfs = noteCount - 1;
     }
-    else tagAsReleased(note, tick, bufPtr);
-    
-    copyNoteBuffer();
+    else tagAsReleased(note, tick);
 }
 
-void MidiArp::removeNote(int64_t *noteptr, int64_t tick, int keep_rel)
+void MidiArp::removeNote(int note, int64_t tick, int keep_rel)
 {
-    int bufPtr, note ;
-    note = *noteptr;
+    const NoteSet &noteSet = noteBuffer.current();
 
-    // modify buffer that is not accessed by arpeggio output
-    bufPtr = (noteBufPtr) ? 0 : 1;
     if (!noteCount) {
         return;
     }
     if (!keep_rel || (!release_time)) {
         // definitely remove from buffer, do NOT check for doubles
-        if (note == notes[bufPtr][0][noteCount - 1]
-                && (repeatPatternThroughChord != 4)) {
-            // note is on top of buffer: only decrement noteCount
-            noteCount--;
-            if (tick == -1) releaseNoteCount--;
-            if ((repeatPatternThroughChord == 2) && (noteOfs)) noteOfs--;
-        }
-        else {
-            // note is not on top: take out the note and pull down all above
-            int index = 0;
-            if (tick != -1) {
-                while ((index < noteCount) 
-                        && (note != notes[bufPtr][0][index])) index++;
-            }
-            else {
-                while ((index < noteCount) 
-                        && ((note != notes[bufPtr][0][index])
-                        || (!notes[bufPtr][3][index]))) index++;
-            }
-
-            
-            if (note == notes[bufPtr][0][index]) {
-                deleteNoteAt(index, bufPtr);
-                if (tick == -1) releaseNoteCount--;
-                for (int l2 = index; l2 < noteCount; l2++) {
-                    old_attackfn[l2] = old_attackfn[l2 + 1];
-                }
-            }
-        }
+        int slot = noteSet.find(note, (tick == -1) ? 1 : -1);
+        if (slot < 0) return;
+        bool onTop = (repeatPatternThroughChord != 4)
+                && (note == NoteSet::note(noteSet.last()));
+        noteBuffer.remove(slot);
+        noteCount = noteBuffer.current().count();
+        if (onTop && (repeatPatternThroughChord == 2) && (noteOfs)) noteOfs--;
     }
-    else tagAsReleased(note, tick, bufPtr);
-
-    copyNoteBuffer();
+    else tagAsReleased(note, tick);
 }
 
-void MidiArp::deleteNoteAt(int index, int bufPtr)
-{
-    for (int l3 = 0; l3 < 4; l3++) {
-        for (int l2 = index; l2 < noteCount - 1; l2++) {
-            notes[bufPtr][l3][l2] = notes[bufPtr][l3][l2 + 1];
-        }
-    }
-    noteCount--;
-}
-
-void MidiArp::tagAsReleased(int note, int64_t tick, int bufPtr)
+void MidiArp::tagAsReleased(int note, int64_t tick)
 {
     //mark as released but keep with note off time tick
-    int l1 = 0;
-    while ((l1 < noteCount) 
-        && ((note != notes[bufPtr][0][l1]) || (notes[bufPtr][3][l1]))) {
-        l1++;
-    }
-    if (note == notes[bufPtr][0][l1]) {
-        notes[bufPtr][3][l1] = 1;
-        notes[bufPtr][2][l1] = tick;
-        releaseNoteCount++;
-    }
-}
-
-void MidiArp::copyNoteBuffer()
-{
-    int newBufPtr = noteBufPtr;
-    noteBufPtr++;
-    noteBufPtr%=2;
-
-    for (int l2 = 0; l2 < noteCount; l2++) {
-        for (int l3 = 0; l3 < 4; l3++) {
-            notes[newBufPtr][l3][l2] = notes[noteBufPtr][l3][l2];
-        }
-    }
+    int slot = noteBuffer.current().find(note, 0);
+    if (slot >= 0) noteBuffer.release(slot, tick);
 }
 
 void MidiArp::getNote(int64_t *tick, int64_t note[], int velocity[], int *length)
 {
-    char c;
-    int l1, tmpIndex[MAXCHORD], chordIndex, grooveTmp;
-    int current_octave = 0;
+    int l1, grooveTmp;
+    int current_octave, ofs;
     bool outOfRange = false;
-    bool gotCC, pause;
+    bool pause;
 
-
-    chordIndex = 0;
-    tmpIndex[0] = 0;
-    tmpIndex[1] = -1;
-    gotCC = false;
-    pause = false;
-    
     if (purgeReleaseFlag) {
         purgeLatchBuffer(arpTick);
-        purgeReleaseNotes(noteBufPtr);
+        purgeReleaseNotes();
         purgeReleaseFlag = false;
     }
+    const ArpPattern *compiled = patternBuffer.acquire();
+    stepCount = compiled->steps.size();
+
     if (restartFlag) advancePatternIndex(true);
+    // the pattern may have been replaced by a shorter one
+    if (patternIndex >= stepCount) patternIndex = 0;
 
     if (!patternIndex) initLoop();
 
     framePtr++;
     if (framePtr >= nPoints) framePtr = 0;
 
-    chordSemitone[0] = semitone;
-    do {
-        if (patternLen)
-            c = (pattern.at(patternIndex));
-        else
-            c = ' ';
+    const ArpStep &step = compiled->steps[patternIndex];
+    const ArpStepNote *stepNote = compiled->stepNotes.data() + step.firstNote;
+    const int stepNoteCount = step.noteCount;
+    stepWidth = step.stepWidth;
+    vel = step.vel;
+    len = step.len;
+    pause = step.pause;
+    current_octave = octOfs;
+    ofs = (patternLen) ? noteOfs : 0;
 
-        if (c != ' ') {
-            if (isdigit(c) || (c == 'p')) {
-                tmpIndex[chordIndex] = c - '0' + noteOfs;
-                if ((chordIndex < MAXCHORD - 1) && chordMode) {
-                    chordIndex++;
-                    chordSemitone[chordIndex] = semitone;
-                }
-                gotCC = false;
-                pause = (c == 'p');
-            }
-            else {
-                gotCC = true;
-
-                switch(c) {
-                    case '(':
-                        chordMode = true;
-                        break;
-                    case ')':
-                        // mark end of chord
-                        tmpIndex[chordIndex] = -1;
-                        chordMode = false;
-                        gotCC = false;
-                        break;
-                    case 't':
-                        semitone++;
-                        break;
-                    case 'g':
-                        semitone--;
-                        break;
-                    case '+':
-                        semitone+=12;
-                        break;
-                    case '-':
-                        semitone-=12;
-                        break;
-                    case '=':
-                        semitone = 0;
-                        break;
-                    case '>':
-                        stepWidth *= .5;
-                        break;
-                    case '<':
-                        stepWidth *= 2.0;
-                        break;
-                    case '.':
-                        stepWidth = 1.0;
-                        break;
-                    case '/':
-                        vel += 0.2;
-                        break;
-                    case '\\':
-                        vel -= 0.2;
-                        break;
-                    case 'd':
-                        len *= 2.0;
-                        break;
-                    case 'h':
-                        len *= .5;
-                        break;
-                }
-                chordSemitone[chordIndex] = semitone;
-            }
-        }
-        current_octave = octOfs;
-    } while (advancePatternIndex(false) && (gotCC || chordMode || c == ' '));
+    advancePatternIndex(false);
 
+    const bool asPlayed = (repeatPatternThroughChord == 4);
     l1 = 0;
-    if (noteCount) do {
-        noteIndex[l1] = (noteCount) ? tmpIndex[l1] % noteCount : 0;
-        note[l1] = clip(notes[noteBufPtr][0][noteIndex[l1]] + current_octave * 12
-                + chordSemitone[l1], 0, 127, &outOfRange);
+    if (noteCount && stepNoteCount) do {
+        const NoteSet &noteSet = noteBuffer.current();
+        noteIndex[l1] = (stepNote[l1].index + ofs) % noteCount;
+        const int slot = noteSet.select(noteIndex[l1], asPlayed);
+        if (slot < 0) break;
+        const bool released = noteSet.isReleased(slot);
+
+        note[l1] = clip(NoteSet::note(slot) + current_octave * 12
+                + stepNote[l1].semitone, 0, 127, &outOfRange);
         if (outOfRange) checkOctaveAtEdge(false);
 
         grooveTmp = (framePtr % 2) ? grooveVelocity : -grooveVelocity;
         
         double releasefn = 0;
-        if ((release_time > 0) && (notes[noteBufPtr][3][noteIndex[l1]])) {
-            releasefn = 1.0 - (double)(arpTick
-                    - notes[noteBufPtr][2][noteIndex[l1]])
+        if ((release_time > 0) && released) {
+            releasefn = 1.0 - (double)(arpTick - noteSet.tick(slot))
                     / (release_time * (double)TPQN * 2);
 
             if (releasefn < 0.0) releasefn = 0.0;
@@ -477,31 +285,29 @@ void MidiArp::getNote(int64_t *tick, int64_t note[], int velocity[], int *length
         
         double attackfn = 0;
         if (attack_time > 0) {
-            if (!notes[noteBufPtr][3][noteIndex[l1]]) {
-                attackfn = (double)(arpTick
-                    - notes[noteBufPtr][2][noteIndex[l1]])
+            if (!released) {
+                attackfn = (double)(arpTick - noteSet.tick(slot))
                     / (attack_time * (double)TPQN * 2);
 
                 if (attackfn > 1.0) attackfn = 1.0;
-                old_attackfn[noteIndex[l1]] = attackfn;
+                old_attackfn[slot] = attackfn;
             }
-            else attackfn = old_attackfn[noteIndex[l1]];
+            else attackfn = old_attackfn[slot];
         }
         else attackfn = 1.0;
 
-        velocity[l1] = clip((double)notes[noteBufPtr][1][noteIndex[l1]]
+        velocity[l1] = clip((double)noteSet.velocity(slot)
                 * vel * (1.0 + 0.005 * (double)(randomVelocity + grooveTmp))
                 * releasefn * attackfn, 0, 127, &outOfRange);
 
-        if ((release_time > 0.) && (notes[noteBufPtr][3][noteIndex[l1]]) && (!velocity[l1])) {
-            removeNote(&notes[noteBufPtr][0][noteIndex[l1]], -1, 0);
+        if ((release_time > 0.) && released && (!velocity[l1])) {
+            removeNote(NoteSet::note(slot), -1, 0);
         }
         else {
             l1++;
         }
-    } while (  (l1 < MAXCHORD - 1)
-            && (tmpIndex[l1] >= 0)
-            && ((l1 < noteCount) || (tmpIndex[l1] == 0))
+    } while (  (l1 < stepNoteCount)
+            && ((l1 < noteCount) || (stepNote[l1].index + ofs == 0))
             && (noteCount));
 
     note[l1] = -1; // mark end of array
@@ -531,6 +337,7 @@ void MidiArp::getNote(int64_t *tick, int64_t note[], int velocity[], int *length
     if (!(patternLen && noteCount) || pause || isMuted) {
         velocity[0] = 0;
     }
+    patternBuffer.release();
 }
 
 void MidiArp::checkOctaveAtEdge(bool reset)
@@ -576,11 +383,9 @@ void MidiArp::checkOctaveAtEdge(bool reset)
 
 bool MidiArp::advancePatternIndex(bool reset)
 {
-    if (patternLen) {
-        patternIndex++;
-    }
+    patternIndex++;
 
-    if ((patternIndex >= patternLen) || reset) {
+    if ((patternIndex >= stepCount) || reset) {
         patternIndex = 0;
         restartFlag = false;
         applyPendingParChanges();
@@ -608,8 +413,16 @@ bool MidiArp::advancePatternIndex(bool reset)
                 break;
             case 3:
                 if (noteCount > 1) {
+                    /* draw among the other notes so that a new one is
+                     * always chosen with a single draw */
                     int oldnoteofs = noteOfs;
-                    while (noteOfs == oldnoteofs) noteOfs = rand() % noteCount;
+                    if ((oldnoteofs < 0) || (oldnoteofs >= noteCount)) {
+                        noteOfs = prng.below(noteCount);
+                    }
+                    else {
+                        noteOfs = prng.below(noteCount - 1);
+                        if (noteOfs >= oldnoteofs) noteOfs++;
+                    }
                 }
                 if ((noteOfs == noteCount) || (noteOfs == 0) || reset) {
                     octOfs+=octIncr;
@@ -626,10 +439,6 @@ bool MidiArp::advancePatternIndex(bool reset)
 
 void MidiArp::initLoop()
 {
-    stepWidth = 1.0;
-    len = 0.5;
-    vel = 0.8;
-    semitone = 0;
     framePtr = 0;
 }
 
@@ -663,20 +472,12 @@ void MidiArp::getNextFrame(int64_t askedTick)
 
 void MidiArp::foldReleaseTicks(int64_t tick)
 {
-    int bufPtr, l2;
-
-    bufPtr = (noteBufPtr) ? 0 : 1;
-
     if (tick <= 0) {
-        purgeReleaseNotes(bufPtr);
+        purgeReleaseNotes();
         return;
     }
 
-    for (l2 = 0; l2 < noteCount; l2++) {
-            notes[bufPtr][2][l2] -= tick;
-    }
-
-    copyNoteBuffer();
+    noteBuffer.shiftTicks(tick);
     lastLatchTick -= tick;    
 }
 
@@ -727,6 +528,7 @@ void MidiArp::updatePattern(const std::string& p_pattern)
     int npoints = 0;
 
     pattern = stripPattern(pattern);
+    compilePattern();
     // determine some useful properties of the arp pattern,
     // number of octaves, step width and number of steps in beats and
     // number of points
@@ -804,14 +606,133 @@ void MidiArp::updatePattern(const std::string& p_pattern)
     nPoints = npoints;
 }
 
+void MidiArp::compilePattern()
+{
+    ArpPattern *compiled = patternBuffer.edit();
+    std::vector<ArpStep>& newSteps = compiled->steps;
+    std::vector<ArpStepNote>& newNotes = compiled->stepNotes;
+    ArpStep step;
+    int tmpIndex[MAXCHORD], chordSemitone[MAXCHORD], chordIndex;
+    int semitone = 0;
+    int index = 0;
+    bool chordMode = false;
+    bool gotCC, pause;
+    char c;
+
+    // the recycled instance keeps its capacity
+    newSteps.clear();
+    newNotes.clear();
+
+    step.stepWidth = 1.0;
+    step.len = 0.5;
+    step.vel = 0.8;
+
+    // This reads the pattern the way getNote() used to read it at
+    // runtime, one step per outer loop
+    do {
+        chordIndex = 0;
+        tmpIndex[0] = 0;
+        tmpIndex[1] = -1;
+        chordSemitone[0] = semitone;
+        gotCC = false;
+        pause = false;
+        step.isChord = false;
+
+        do {
+            c = (patternLen) ? pattern[index] : ' ';
+
+            if (isdigit(c) || (c == 'p')) {
+                tmpIndex[chordIndex] = c - '0';
+                if ((chordIndex < MAXCHORD - 1) && chordMode) {
+                    chordIndex++;
+                    chordSemitone[chordIndex] = semitone;
+                }
+                gotCC = false;
+                pause = (c == 'p');
+            }
+            else if (c != ' ') {
+                gotCC = true;
+
+                switch(c) {
+                    case '(':
+                        chordMode = true;
+                        step.isChord = true;
+                        break;
+                    case ')':
+                        // mark end of chord
+                        tmpIndex[chordIndex] = -1;
+                        chordMode = false;
+                        gotCC = false;
+                        break;
+                    case 't':
+                        semitone++;
+                        break;
+                    case 'g':
+                        semitone--;
+                        break;
+                    case '+':
+                        semitone+=12;
+                        break;
+                    case '-':
+                        semitone-=12;
+                        break;
+                    case '=':
+                        semitone = 0;
+                        break;
+                    case '>':
+                        step.stepWidth *= .5;
+                        break;
+                    case '<':
+                        step.stepWidth *= 2.0;
+                        break;
+                    case '.':
+                        step.stepWidth = 1.0;
+                        break;
+                    case '/':
+                        step.vel += 0.2;
+                        break;
+                    case '\\':
+                        step.vel -= 0.2;
+                        break;
+                    case 'd':
+                        step.len *= 2.0;
+                        break;
+                    case 'h':
+                        step.len *= .5;
+                        break;
+                }
+                chordSemitone[chordIndex] = semitone;
+            }
+            if (patternLen) index++;
+        } while ((index < patternLen) && (gotCC || chordMode || c == ' '));
+
+        // close a chord left open at the end of the pattern
+        if (chordMode) {
+            tmpIndex[chordIndex] = -1;
+            chordMode = false;
+        }
+
+        step.firstNote = newNotes.size();
+        step.noteCount = 0;
+        while ((step.noteCount < MAXCHORD - 1) && (tmpIndex[step.noteCount] >= 0)) {
+            ArpStepNote stepNote;
+            stepNote.index = tmpIndex[step.noteCount];
+            stepNote.semitone = chordSemitone[step.noteCount];
+            newNotes.push_back(stepNote);
+            step.noteCount++;
+        }
+        step.pause = pause;
+        newSteps.push_back(step);
+    } while (index < patternLen);
+
+    patternBuffer.publish(compiled);
+}
+
 void MidiArp::newRandomValues()
 {
-    randomTick = (double)randomTickAmp * (0.5 - (double)rand()
-            / (double)RAND_MAX);
-    randomVelocity = (double)randomVelocityAmp * (0.5 - (double)rand()
-            / (double)RAND_MAX);
-    randomLength = (double)randomLengthAmp * (0.5 - (double)rand()
-            / (double)RAND_MAX);
+    randomTick = (double)randomTickAmp * (0.5 - prng.uniform());
+    randomVelocity = (double)randomVelocityAmp * (0.5 - prng.uniform());
+    randomLength = (double)randomLengthAmp * (0.5 - prng.uniform());
 }
 
 void MidiArp::updateRandomTickAmp(int val)
@@ -867,14 +788,15 @@ void MidiArp::updateReleaseTime(int val)
 
 void MidiArp::clearNoteBuffer()
 {
+    noteBuffer.clear();
     noteCount = 0;
     latchBufferCount = 0;
-    releaseNoteCount = 0;
 }
 
 int MidiArp::getPressedNoteCount()
 {
-    int c = noteCount - latchBufferCount - releaseNoteCount;
+    int c = noteCount - latchBufferCount
+            - noteBuffer.current().releasedCount();
     return(c);
 }
 
@@ -890,8 +812,7 @@ void MidiArp::setSustain(bool on, uint64_t sustick)
 void MidiArp::purgeSustainBuffer(uint64_t sustick)
 {
     for (int l1 = 0; l1 < sustainBufferCount; l1++) {
-        int64_t buf = sustainBuffer[l1];
-        removeNote(&buf, sustick, 1);
+        removeNote(sustainBuffer[l1], sustick, 1);
     }
     sustainBufferCount = 0;
 }
@@ -905,20 +826,15 @@ void MidiArp::setLatchMode(bool on)
 void MidiArp::purgeLatchBuffer(uint64_t latchtick)
 {
     for (int l1 = 0; l1 < latchBufferCount; l1++) {
-        int64_t buf = latchBuffer[l1];
-        removeNote(&buf, latchtick, 1);
+        removeNote(latchBuffer[l1], latchtick, 1);
     }
     latchBufferCount = 0;
 }
 
-void MidiArp::purgeReleaseNotes(int bufptr)
+void MidiArp::purgeReleaseNotes()
 {
-    for (int l1 = noteCount - 1; l1 >= 0; l1--) {
-        if (notes[bufptr][3][l1]) {
-            deleteNoteAt(l1, bufptr);
-            releaseNoteCount--;
-        }
-    }
+    noteBuffer.removeReleased();
+    noteCount = noteBuffer.current().count();
 }
 
 void MidiArp::applyPendingParChanges()
@@ -937,6 +853,7 @@ void MidiArp::setNextTick(uint64_t tick)
 {
     if (nSteps == 0) return;
 
+    prng.setSeed(randomSeed);
     returnTick = tick / (int)(nSteps*TPQN) * (int)(nSteps*TPQN);
     patternIndex = 0;
     framePtr = 0;
@@ -26,6 +26,34 @@
 
 #include <string>
 #include "midiworker.h"
+#include "noteset.h"
+
+/*! @brief One note of a compiled arpeggio step */
+struct ArpStepNote {
+    int index;      /*!< Index into the input note buffer, before adding MidiArp::noteOfs */
+    int semitone;   /*!< Semitone shift applied to the note */
+};
+
+/*! @brief One step of the arpeggio pattern, compiled by MidiArp::updatePattern()
+ *
+ * It holds the state the pattern text had accumulated when the step
+ * was reached, counted from the start of the pattern.
+ */
+struct ArpStep {
+    int firstNote;      /*!< Position of the first note in MidiArp::stepNotes */
+    int noteCount;      /*!< Number of notes played at this step */
+    double stepWidth;   /*!< Step width factor relative to one beat */
+    double vel;         /*!< Velocity factor */
+    double len;         /*!< Note length factor */
+    bool isChord;       /*!< True if the notes were given in a chord bracket */
+    bool pause;         /*!< True if the last note of the step was a pause 'p' */
+};
+
+/*! @brief Arpeggio pattern compiled by MidiArp::compilePattern() */
+struct ArpPattern {
+    std::vector<ArpStep> steps;         /*!< The steps of the pattern, never empty once compiled */
+    std::vector<ArpStepNote> stepNotes; /*!< The notes of all steps */
+};
 
  /*!
  * @brief MIDI worker class for the Arpeggiator Module. Implements the
@@ -54,9 +82,10 @@ class MidiArp : public MidiWorker  {
                                     @see MidiArp::updateNotes, MidiArp::nextNote */
     uint64_t arpTick;
     int nextLength;
-    bool chordMode;
     bool purgeReleaseFlag; /*!< Causes MidiArp::getNote() to call MidiArp::purgeReleaseNotes() */
-    int patternIndex; /*!< Holds the current position within the pattern text*/
+    int patternIndex; /*!< Holds the current step within ArpPattern::steps */
+    int stepCount;    /*!< Number of steps of the pattern acquired by getNote() */
+    SnapshotBuffer<ArpPattern> patternBuffer; /*!< Patterns published by compilePattern() and read by getNote() */
     int randomTick, randomVelocity, randomLength;
     int sustainBufferCount, latchBufferCount;
     uint64_t lastLatchTick;
@@ -66,51 +95,54 @@ class MidiArp : public MidiWorker  {
     int latchBuffer[MAXNOTES];   /*!< Holds released note values when MidiArp::latch_mode is True */
 
     bool sustain;
-    int noteIndex[MAXCHORD], chordSemitone[MAXCHORD];
-    int semitone;
- /*! @brief The input note buffer array of the Arpeggiator, which has
-  * two array copies.
+    int noteIndex[MAXCHORD];
+ /*! @brief The input note buffer of the Arpeggiator.
   *
-  * @par The first index (0:1) selects the copy to be modified
-  * avoiding access conflicts while modifying its data.
-  * @par The second index selects the columns corresponding to
-  * - 0: Note value
-  * - 1: Note velocity
-  * - 2: Timing of the note event in internal ticks (NOTE_ON or NOTE_OFF)
-  * - 3: Release tag (0: note is kept in buffer, 1: MidiArp::getNote
-  * will decrease this note's velocity until it reaches 0, and then
-  * definitely remove the by a MidiArp::removeNote call.
-  *
-  * @par The third index is the note index in the buffer.
+  * It holds the value, velocity, timing (NOTE_ON or NOTE_OFF) and
+  * release tag of each note. Notes tagged as released have their
+  * velocity decreased by MidiArp::getNote at each arpeggio step until
+  * it reaches 0, and are then removed by a MidiArp::removeNote call.
   * */
-    int64_t notes[2][4][MAXNOTES];
+    NoteBuffer noteBuffer;
 
  /*! @brief The storage copy of dynamic attack values.
   *
   * These values are to be multiplied with the
   * velocity at each new arpeggiator step. Its index corresponds
-  * to that of the third MidiArp::notes buffer index.
+  * to the NoteSet slot of the note.
   * */
-    double old_attackfn[MAXNOTES];
-    int64_t noteBufPtr;     /*!< Pointer to the currently active note buffer copy */
+    double old_attackfn[NoteSet::SLOTS];
     int noteOfs;        /*!< The current index in a chord. @see repeatPatternThroughChord */
     int octOfs;        /*!< The currently active octave shift. @see repeatPatternThroughChord */
     int octIncr;        /*!< The octave increment at repeat end. @see repeatPatternThroughChord */
-    int releaseNoteCount; /*!< The number of notes currently in release stage */
 
 /**
- * @brief  resets all attributes the pattern
- * accumulates during run.
+ * @brief  restarts the frame pointer at the beginning of the pattern.
  *
- * It is called when the currentIndex revolves to restart the loop with
- * default velocity, s-Wno-deprecated-copytep width, octave and length.
+ * It is called when the currentIndex revolves to restart the loop.
+ * Velocity, step width and length are reset by the compiled steps
+ * themselves.
 */
     void initLoop();
+/**
+ * @brief  translates MidiArp::pattern into the ArpPattern steps and
+ * publishes them to MidiArp::patternBuffer.
+ *
+ * Each step holds the note indices, semitone shifts, step width, velocity
+ * and length the pattern text yields when it is read from its beginning,
+ * so that getNote() does not have to parse the text at every step. A
+ * chord left open at the end of the pattern is closed there. An empty
+ * pattern compiles to a single step.
+ *
+ * It is called from the GUI thread, while getNote() keeps reading the
+ * previous pattern until it acquires the new one at its next call.
+ */
+    void compilePattern();
 /**
  * @brief This is MidiArp's main note processor producing output notes
  * from input notes.
  *
- * It analyzes the MidiArp::pattern text and MidiArp::notes input buffer
+ * It combines the current step of the ArpPattern with the MidiArp::notes input buffer
  * to yield arrays of notes that have to be sent at the given timing.
  * The calculated note data is stored in arrays, copied again by
  * getNextFrame() and the copy is accessed by Engine::echoCallback().
@@ -152,16 +184,16 @@ class MidiArp : public MidiWorker  {
  *
  * This function is called when the latch and sustain buffers are 
  * cleared. The specified note is either 
- * deleted via MidiArp::deleteNoteAt() or tagged as released if the 
+ * deleted from MidiArp::noteBuffer or tagged as released if the 
  * release function is active and if the keep_rel flag is set to 1. 
  *
- * @param noteptr pointer to the note to be looked for
- * @param tick the current tick position
+ * @param note the note to be looked for
+ * @param tick the current tick position, -1 to delete a released note
  * @param keep_rel If set to 1 and MidiArp::release_time is set, the 
  * note is marked as released. If set to 0, the note will be deleted
  * 
  */
-    void removeNote(int64_t *noteptr, int64_t tick, int keep_rel);
+    void removeNote(int note, int64_t tick, int keep_rel);
 /**
  * @brief Handles a released incoming note
  *
@@ -177,35 +209,16 @@ class MidiArp : public MidiWorker  {
  */
     void releaseNote(int note, int64_t tick, bool keep_rel);
 /**
- * @brief  Deletes a note inside the MidiArp::notes input
- * note buffer.
+ * @brief  sets the released flag for the first held copy of a note
  *
- * The note  at the given index is deleted from the buffer with the
- * given bufPtr index (0 or 1), and notes at higher positions in the
- * buffer are moved in position.
- * @param index Index of the note to delete from the buffer
- * @param bufPtr Buffer copy to work with
- */
-    void deleteNoteAt(int index, int bufPtr);
-/**
- * @brief  sets the released flag (value 1) for the note
- * at the given index
- *
- * This operation is done for the buffer with given bufPtr index (0 or 1).
  * A released flag set will cause getNote to diminish the velocity of
  * this note at each arpeggio step, and to remove it when the velocity
  * reaches zero.
  *
  * @param note Note value to be tagged as released
  * @param tick The time in internal ticks at which the note was released
- * @param bufPtr The index of the MidiArp::notes buffer currently in use
- */
-    void tagAsReleased(int note, int64_t tick, int bufPtr);
-/**
- * @brief  performs a copy within MidiArp::notes from the
- * currently active index to the inactive index
  */
-    void copyNoteBuffer();
+    void tagAsReleased(int note, int64_t tick);
 /**
  * @brief Advances octOfs according to the settings. Called when the octave
  * reaches an edge condition (at octave range or outside permitted range)
@@ -259,6 +272,7 @@ class MidiArp : public MidiWorker  {
     bool advancePatternIndex(bool reset);
 
     bool handleEvent(MidiEvent inEv, int64_t tick, int keep_rel = 0) override;
+    void getRoute(MidiRoute *route) override;
 /**
  * @brief Causes calculation of a new note set at a step and copies it
  * to arrays accessed by Engine.
@@ -334,11 +348,9 @@ class MidiArp : public MidiWorker  {
   */
     void purgeLatchBuffer(uint64_t latchtick);
 
- /*! @brief Untags notes tagged as released in the specified buffer.
-  * 
-  * @param bufptr Buffer pointer (0 or 1) to the buffer to act on
+ /*! @brief Removes all notes tagged as released from MidiArp::noteBuffer.
   */
-    void purgeReleaseNotes(int bufptr);
+    void purgeReleaseNotes();
 /**
  * @brief sets MidiArp::nextTick and MidiArp::patternIndex position
  * according to the specified tick.
@@ -24,15 +24,17 @@
 
 #include <cstdio>
 #include <cmath>
+#include <algorithm>
 #include "midiarp_lv2.h"
 
 MidiArpLV2::MidiArpLV2 (
     double sample_rate, const LV2_Feature *const *host_features )
-    :MidiArp()
+    :MidiArp(), noteOffQueue(JQ_BUFSZ)
 {
     for (int l1 = 0; l1 < 30; l1++) val[l1] = 0;
 
     sampleRate = sample_rate;
+    timeBase.setRate((uint64_t)(sample_rate * 60));
     curFrame = 0;
     inEventBuffer = NULL;
     outEventBuffer = NULL;
@@ -48,16 +50,9 @@ MidiArpLV2::MidiArpLV2 (
     trStartingTick = 0;
     transportAtomReceived = false;
 
-    for (int l1 = 0; l1 < JQ_BUFSZ; l1++) {
-        evQueue[l1] = 0;
-        evTickQueue[l1] = 0;
-    }
-
     sendPatternFlag = false;
     ui_up = false;
 
-    bufPtr = 0;
-
     LV2_URID_Map *urid_map;
 
 
@@ -140,9 +135,10 @@ void MidiArpLV2::updatePos(uint64_t pos, float bpm, int speed, bool ignore_pos)
     }
 
     if (!ignore_pos) {
-        const float frames_per_beat = 60.0f / transportBpm * sampleRate;
         transportFramesDelta = pos;
-        tempoChangeTick = pos * TPQN / frames_per_beat;
+        tempoChangeTick = TimeBase::mulDiv(pos,
+                TimeBase::tpmFromTempo(transportBpm), timeBase.rate());
+        timeBase.setTempoAt(tempo, tempoChangeTick, transportFramesDelta);
     }    
     if (transportSpeed != speed) {
         /* Speed changed, e.g. 0 (stop) to 1 (play) */
@@ -222,12 +218,8 @@ void MidiArpLV2::run ( uint32_t nframes )
 
                 inEv.channel = di[0] & 0x0f;
                 inEv.data=di[1];
-                int tick = ((uint64_t)(curFrame - transportFramesDelta) 
-                        * nframes
-                        + (uint64_t)(&event->time.frames) % nframes)
-                        * TPQN*tempo/nframes/60/sampleRate 
-                        + tempoChangeTick;
-                        
+                int tick = timeBase.posToTick(curFrame + event->time.frames);
+
                 //printf("curFrame %d \n", curFrame - transportFramesDelta);
                 // Set ticks to zero whenever notes with stopped
                 // transport are received.
@@ -243,17 +235,37 @@ void MidiArpLV2::run ( uint32_t nframes )
                     unmatched = handleEvent(inEv, tick - 2, 1);
                 }
                 if (unmatched) //if event is unmatched, forward it
-                    forgeMidiEvent((int)((uint64_t)(&event->time.frames) % nframes), di, 3);
+                    forgeMidiEvent(event->time.frames, di, 3);
             }
         }
     }
 
 
         // MIDI Output
-    for (uint32_t f = 0 ; f < nframes; f++) {
-        curTick = (uint64_t)(curFrame - transportFramesDelta)
-                        *TPQN*tempo/60/sampleRate + tempoChangeTick;
-        if ((curTick >= nextTick) && (transportSpeed)) {
+    // Jump from one due event to the next instead of visiting every
+    // frame. Arp steps are output at most once per frame as before.
+    const uint64_t endFrame = curFrame + nframes;
+    uint64_t stepFrame = curFrame;
+
+    if (hostTransport && !transportSpeed) sendNoteOffs(0, UINT64_MAX);
+
+    for (;;) {
+        uint64_t frame = endFrame;
+        if (transportSpeed) {
+            stepFrame = std::max(stepFrame,
+                    timeBase.tickToPos(nextTick > 0 ? nextTick : 0));
+            frame = stepFrame;
+        }
+        if (!noteOffQueue.isEmpty()) {
+            frame = std::min(frame, std::max(curFrame,
+                    timeBase.tickToPos(noteOffQueue.nextTick())));
+        }
+        if (frame >= endFrame) break;
+
+        const uint32_t f = frame - curFrame;
+        curTick = timeBase.posToTick(frame);
+
+        if (transportSpeed && (frame == stepFrame)) {
             getNextFrame(curTick);
             if (!isMuted) {
                 if (outFrame[0].value) {
@@ -264,43 +276,33 @@ void MidiArpLV2::run ( uint32_t nframes )
                         d[1] = outFrame[l2].data;
                         d[2] = outFrame[l2].value;
                         forgeMidiEvent(f, d, 3);
-                        evTickQueue[bufPtr] = curTick + returnLength / 4;
-                        evQueue[bufPtr] = outFrame[l2].data;
-                        bufPtr++;
+                        noteOffQueue.push(curTick + returnLength / 4,
+                                outFrame[l2].data);
                         l2++;
                     }
                 }
             }
             float pos = (float)getFramePtr();
             *val[CURSOR_POS] = pos;
+            stepFrame = frame + 1;
         }
 
-        // Note Off Queue handling
-        int noteofftick = evTickQueue[0];
-        int idx = 0;
-        for (int l1 = 0; l1 < bufPtr; l1++) {
-            int tmptick = evTickQueue[l1];
-            if (noteofftick > tmptick) {
-                idx = l1;
-                noteofftick = tmptick;
-            }
-        }
-        if ( (bufPtr) && ((curTick >= noteofftick)
-                || (hostTransport && !transportSpeed)) ) {
-            int outval = evQueue[idx];
-            for (int l4 = idx ; l4 < (bufPtr - 1);l4++) {
-                evQueue[l4] = evQueue[l4 + 1];
-                evTickQueue[l4] = evTickQueue[l4 + 1];
-            }
-            bufPtr--;
+        sendNoteOffs(f, frame);
+    }
+    curFrame = endFrame;
+    curTick = timeBase.posToTick(curFrame);
+}
 
-            unsigned char d[3];
-            d[0] = 0x80 + channelOut;
-            d[1] = outval;
-            d[2] = 127;
-            forgeMidiEvent(f, d, 3);
-        }
-        curFrame++;
+void MidiArpLV2::sendNoteOffs(uint32_t f, uint64_t frame)
+{
+    while (!noteOffQueue.isEmpty()
+            && (timeBase.tickToPos(noteOffQueue.nextTick()) <= frame)) {
+        unsigned char d[3];
+        d[0] = 0x80 + channelOut;
+        d[1] = noteOffQueue.next();
+        d[2] = 127;
+        forgeMidiEvent(f, d, 3);
+        noteOffQueue.pop();
     }
 }
 
@@ -388,6 +390,7 @@ void MidiArpLV2::initTransport()
         transportBpm = internalTempo;
         tempo = internalTempo;
         transportSpeed = 1;
+        timeBase.setTempoAt(tempo, tempoChangeTick, transportFramesDelta);
     }
     else transportSpeed = 0;
 
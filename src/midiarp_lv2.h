@@ -27,6 +27,8 @@
 
 #include "midiarp.h"
 #include "lv2_common.h"
+#include "timebase.h"
+#include "tickqueue.h"
 
 #define QMIDIARP_ARP_LV2_URI QMIDIARP_LV2_URI "/arp"
 #define QMIDIARP_ARP_LV2_PREFIX QMIDIARP_ARP_LV2_URI "#"
@@ -92,7 +94,7 @@ private:
         uint64_t curFrame;
         uint64_t tempoChangeTick;
         uint64_t trStartingTick;
-        int curTick;
+        uint64_t curTick;
         double internalTempo;
         double sampleRate;
         double tempo;
@@ -101,14 +103,14 @@ private:
         void updateParams();
         void sendPattern(const std::string & p);
         void forgeMidiEvent(uint32_t f, const uint8_t* const buffer, uint32_t size);
+        void sendNoteOffs(uint32_t f, uint64_t frame);
 
         uint64_t transportFramesDelta;  /**< Frames since last click start */
+        TimeBase timeBase;              /**< Tick mapping of the host frames */
         float transportBpm;
         float transportSpeed;
         bool hostTransport;
-        uint32_t evQueue[JQ_BUFSZ];
-        uint32_t evTickQueue[JQ_BUFSZ];
-        int bufPtr;
+        TickQueue<int> noteOffQueue;    /**< Pending note offs by tick */
 
         LV2_Atom_Sequence *inEventBuffer;
         const LV2_Atom_Sequence *outEventBuffer;
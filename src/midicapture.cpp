@@ -0,0 +1,232 @@
+/*!
+ * @file midicapture.cpp
+ * @brief Implementation of the MidiCapture and CaptureReader classes
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#include <chrono>
+#include <cstring>
+
+#include "main.h"
+#include "midicapture.h"
+
+static const char captureMagic[8] = { 'Q', 'M', 'A', 'C', 'A', 'P', 'T', '1' };
+
+static_assert(sizeof(CaptureHeader) == 32, "CaptureHeader layout");
+static_assert(sizeof(CaptureRecord) == 32, "CaptureRecord layout");
+
+
+MidiCapture::MidiCapture()
+    : ring(CAPTURE_RINGSIZE), active(false), stopRequested(false)
+{
+    batch.resize(ring.capacity());
+    file = NULL;
+    startSteady = 0;
+    written = 0;
+    writeFailed = false;
+    memset(&header, 0, sizeof(header));
+}
+
+MidiCapture::~MidiCapture()
+{
+    close();
+}
+
+bool MidiCapture::open(const QString& fn)
+{
+    close();
+
+    file = fopen(qPrintable(fn), "wb");
+    if (!file) {
+        qWarning("Could not open capture file %s", qPrintable(fn));
+        return false;
+    }
+    fileName = fn;
+
+    memcpy(header.magic, captureMagic, sizeof(header.magic));
+    header.version = 1;
+    header.tpqn = TPQN;
+    header.startTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    header.dropped = 0;
+    startSteady = RtStats::now();
+    written = 0;
+    writeFailed = (fwrite(&header, sizeof(header), 1, file) != 1);
+
+    /* records left from a previous capture are discarded **/
+    while (ring.pop(batch.data(), batch.size())) { }
+    ring.takeDropped();
+
+    stopRequested.store(false);
+    active.store(true, std::memory_order_release);
+    start(QThread::LowPriority);
+    return true;
+}
+
+void MidiCapture::close()
+{
+    if (!file) return;
+
+    active.store(false, std::memory_order_release);
+    stopRequested.store(true);
+    wait();
+    drain();
+
+    fflush(file);
+    if (!fseek(file, 0, SEEK_SET))
+        fwrite(&header, sizeof(header), 1, file);
+    fclose(file);
+    file = NULL;
+
+    printf("Captured %llu events to %s", (unsigned long long)written,
+            qPrintable(fileName));
+    if (header.dropped) {
+        printf(", %llu dropped", (unsigned long long)header.dropped);
+    }
+    printf("\n");
+}
+
+unsigned int MidiCapture::drain()
+{
+    header.dropped += ring.takeDropped();
+
+    const unsigned int count = ring.pop(batch.data(), batch.size());
+    if (!count || writeFailed) return count;
+
+    /* the monotonic times of record() are converted to wall clock time
+     * here, outside the realtime thread **/
+    for (unsigned int l1 = 0; l1 < count; l1++) {
+        batch[l1].time = header.startTime + (batch[l1].time - startSteady);
+    }
+
+    if (fwrite(batch.data(), sizeof(CaptureRecord), count, file) != count) {
+        qWarning("Could not write capture file %s, capture stopped",
+                qPrintable(fileName));
+        writeFailed = true;
+        return count;
+    }
+    fflush(file);
+    written += count;
+    return count;
+}
+
+void MidiCapture::run()
+{
+    while (!stopRequested.load()) {
+        if (drain() < batch.size()) msleep(CAPTURE_INTERVAL);
+    }
+}
+
+CaptureReader::CaptureReader()
+{
+    header = NULL;
+    records = NULL;
+    count = 0;
+}
+
+bool CaptureReader::isCaptureFile(const QString& fn)
+{
+    QFile f(fn);
+    char magic[sizeof(captureMagic)];
+
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    if (f.read(magic, sizeof(magic)) != sizeof(magic)) return false;
+    return !memcmp(magic, captureMagic, sizeof(magic));
+}
+
+bool CaptureReader::open(const QString& fn)
+{
+    header = NULL;
+    records = NULL;
+    count = 0;
+    if (file.isOpen()) file.close();
+
+    file.setFileName(fn);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorString = "Could not open file";
+        return false;
+    }
+    const qint64 size = file.size();
+    if (size < (qint64)sizeof(CaptureHeader)) {
+        errorString = "Not a capture file";
+        return false;
+    }
+    const uchar *map = file.map(0, size);
+    if (!map) {
+        errorString = "Could not map file";
+        return false;
+    }
+
+    const CaptureHeader *h = (const CaptureHeader *)map;
+    if (memcmp(h->magic, captureMagic, sizeof(captureMagic))) {
+        errorString = "Not a capture file";
+        return false;
+    }
+    if ((h->version != 1) || !h->tpqn) {
+        errorString = "Capture file version is not supported";
+        return false;
+    }
+
+    header = h;
+    records = (const CaptureRecord *)(map + sizeof(CaptureHeader));
+    count = (size - sizeof(CaptureHeader)) / sizeof(CaptureRecord);
+    return true;
+}
+
+int CaptureReader::toRaw(const CaptureRecord& rec, unsigned char *data)
+{
+    /* inverse of the input decoding of JackDriver **/
+    data[1] = rec.data & 0x7f;
+    data[2] = rec.value & 0x7f;
+    switch (rec.type) {
+        case EV_NOTEON:
+            data[0] = 0x90;
+            break;
+        case EV_NOTEOFF:
+            data[0] = 0x80;
+            break;
+        case EV_KEYPRESS:
+            data[0] = 0xa0;
+            break;
+        case EV_CONTROLLER:
+            data[0] = 0xb0;
+            break;
+        case EV_PGMCHANGE:
+            data[0] = 0xc0;
+            data[1] = rec.value & 0x7f;
+            data[0] += rec.channel & 0x0f;
+            return 2;
+        case EV_CHANPRESS:
+            data[0] = 0xd0;
+            data[1] = rec.value & 0x7f;
+            data[0] += rec.channel & 0x0f;
+            return 2;
+        case EV_PITCHBEND:
+            data[0] = 0xe0;
+            data[1] = (rec.value + 8192) & 0x7f;
+            data[2] = ((rec.value + 8192) >> 7) & 0x7f;
+            break;
+        default:
+            return 0;
+    }
+    data[0] += rec.channel & 0x0f;
+    return 3;
+}
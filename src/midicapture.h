@@ -0,0 +1,213 @@
+/*!
+ * @file midicapture.h
+ * @brief Header for the MidiCapture and CaptureReader classes
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#ifndef MIDICAPTURE_H
+#define MIDICAPTURE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <cstdio>
+#include <vector>
+#include <QFile>
+#include <QString>
+#include <QThread>
+
+#include "midievent.h"
+#include "lockfree.h"
+#include "rtstats.h"
+
+/*! @brief Direction of a captured event */
+enum {
+    CAPTURE_IN = 0,     /*!< Received by the engine */
+    CAPTURE_OUT         /*!< Sent by the engine to the driver */
+};
+
+/*!
+ * @brief Header at the start of a capture file
+ *
+ * All fields are in the byte order of the recording host.
+ */
+struct CaptureHeader {
+    char magic[8];      /**< "QMACAPT1" */
+    uint32_t version;   /**< Format version, currently 1 */
+    uint32_t tpqn;      /**< Ticks per quarter note of the tick fields */
+    uint64_t startTime; /**< Wall clock time of the start in ns since the epoch */
+    uint64_t dropped;   /**< Events lost because the ring was full */
+};
+
+/*!
+ * @brief Fixed size record of one captured event
+ *
+ * The records follow the CaptureHeader in the order they were captured,
+ * so that a capture file can be mapped and read as an array.
+ */
+struct CaptureRecord {
+    uint64_t tick;      /**< Tick at reception or scheduled output tick */
+    uint64_t time;      /**< Wall clock time in ns since the epoch */
+    uint32_t duration;  /**< Length in ticks of output note ons, else 0 */
+    int16_t data;       /**< MidiEvent::data */
+    int16_t value;      /**< MidiEvent::value */
+    uint8_t type;       /**< MidiEvent::type */
+    uint8_t channel;    /**< MidiEvent::channel */
+    uint8_t port;       /**< Output port, 0 for input events */
+    uint8_t direction;  /**< CAPTURE_IN or CAPTURE_OUT */
+    uint32_t reserved;
+};
+
+/*!
+ * The MidiCapture class records the events received and sent by the
+ * Engine to a capture file. The realtime thread only pushes fixed size
+ * CaptureRecords into an SpscRing with record(), which never blocks and
+ * never allocates. A low priority thread started by open() drains the
+ * ring every CAPTURE_INTERVAL ms and appends the records to the file,
+ * so that the memory use is bounded however long the capture runs.
+ * Records that do not fit in the ring are dropped and their count is
+ * written to the CaptureHeader by close().
+ *
+ * Only one thread may call record(). The driver backends record from
+ * their realtime thread only, which fulfills this.
+ *
+ * @brief Background writer of a capture file
+ */
+class MidiCapture : public QThread
+{
+  private:
+    enum {
+        CAPTURE_RINGSIZE = 65536,   /**< Records held by the ring */
+        CAPTURE_INTERVAL = 50       /**< Drain period of the writer in ms */
+    };
+
+    SpscRing<CaptureRecord> ring;
+    std::vector<CaptureRecord> batch;
+    std::atomic<bool> active;       /**< Set while record() accepts events */
+    std::atomic<bool> stopRequested;
+    FILE *file;
+    QString fileName;
+    CaptureHeader header;
+    uint64_t startSteady;   /**< RtStats::now() at CaptureHeader::startTime */
+    uint64_t written;
+    bool writeFailed;
+
+/*!
+* @brief moves the records in the ring to the file
+*
+* @return Number of records taken from the ring
+*/
+    unsigned int drain();
+
+  protected:
+    void run();
+
+  public:
+    MidiCapture();
+    ~MidiCapture();
+
+/*!
+* @brief creates a capture file and starts recording
+*
+* @param fn Path of the capture file, which is overwritten
+* @return False if the file could not be created
+*/
+    bool open(const QString& fn);
+/*!
+* @brief stops recording, writes the remaining records and closes the
+* file
+*/
+    void close();
+    bool isOpen() const { return active.load(std::memory_order_relaxed); }
+
+/*!
+* @brief queues an event for the capture file, to be called from the
+* realtime thread only
+*
+* @param ev Event as received or sent
+* @param tick Tick of reception or scheduled tick of output
+* @param port Output port, 0 for input events
+* @param direction CAPTURE_IN or CAPTURE_OUT
+* @param duration Length in ticks of output note ons
+*/
+    void record(const MidiEvent& ev, uint64_t tick, int port,
+            int direction, unsigned int duration = 0)
+    {
+        if (!active.load(std::memory_order_acquire)) return;
+
+        CaptureRecord rec;
+        rec.tick = tick;
+        rec.time = RtStats::now();
+        rec.duration = duration;
+        rec.data = ev.data;
+        rec.value = ev.value;
+        rec.type = ev.type;
+        rec.channel = ev.channel;
+        rec.port = port;
+        rec.direction = direction;
+        rec.reserved = 0;
+        ring.push(rec);
+    }
+};
+
+/*!
+ * The CaptureReader class maps a capture file written by MidiCapture
+ * into memory and gives access to its records without copying them.
+ * It is used by HeadlessEngine::render() to replay the input events of
+ * a capture into the offline renderer.
+ *
+ * @brief Memory mapped reader of a capture file
+ */
+class CaptureReader
+{
+  private:
+    QFile file;
+
+  public:
+    CaptureReader();
+
+    const CaptureHeader *header;    /**< Header of the mapped file */
+    const CaptureRecord *records;   /**< Records of the mapped file */
+    uint64_t count;                 /**< Number of complete records */
+    QString errorString;    /**< Reason of the last open() failure */
+
+/*!
+* @brief maps a capture file
+*
+* A record truncated by an interrupted capture is ignored.
+*
+* @param fn Path of the file
+* @return False if the file could not be mapped or is no capture file
+*/
+    bool open(const QString& fn);
+/*! @brief returns true if the file starts with the capture file magic */
+    static bool isCaptureFile(const QString& fn);
+/*!
+* @brief converts a record into a raw MIDI channel message
+*
+* @param rec Record to convert
+* @param data Receives up to three status and data bytes
+* @return Number of bytes written to data, 0 for events other than
+* channel messages
+*/
+    static int toRaw(const CaptureRecord& rec, unsigned char *data);
+};
+
+#endif
@@ -150,12 +150,12 @@ void MidiCCTable::accept()
 
 void MidiCCTable::apply()
 {
-    engine->midiControl->ccList.clear();
-    engine->globStoreWidget->midiControl->ccList.clear();
-    engine->grooveWidget->midiControl->ccList.clear();
+    engine->midiControl->clearCcList();
+    engine->globStoreWidget->midiControl->clearCcList();
+    engine->grooveWidget->midiControl->clearCcList();
 
     for (int l1 = 0; l1 < engine->moduleWidgetCount(); l1++)
-        engine->moduleWidget(l1)->midiControl->ccList.clear();
+        engine->moduleWidget(l1)->midiControl->clearCcList();
 
     for (int l1 = 0; l1 < midiCCTable->rowCount(); l1++) {
         int ccnumber = midiCCTable->item(l1, 1)->text().toInt();
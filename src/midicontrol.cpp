@@ -64,6 +64,7 @@ void MidiControl::update()
         ccList.append(pendingCC);
         qWarning("MIDI Controller %d appended for %s (internal ID %d)"
         , pendingCC.ccnumber, qPrintable(pendingCC.name), pendingCC.ID);
+        emit ccListChanged();
     }
     else {
         qWarning("MIDI Controller %d already attributed to %s"
@@ -118,6 +119,7 @@ void MidiControl::removeMidiCC(int controlID, int ccnumber, int channel)
         }
     }
     modified = true;
+    emit ccListChanged();
 }
 
 void MidiControl::midiLearn(int controlID)
@@ -158,57 +160,89 @@ void MidiControl::addMidiLearnMenu(const QString &name, QWidget *widget, int cou
 
 void MidiControl::readData(QXmlStreamReader& xml)
 {
-    int controlID, ccnumber, channel, min, max;
+    readCcList(xml, &ccList);
+    refresh();
+}
+
+void MidiControl::writeData(QXmlStreamWriter& xml)
+{
+    writeCcList(xml, ccList);
+}
+
+void MidiControl::readCcList(QXmlStreamReader& xml, QVector<MidiCC> *list,
+        int idOffset)
+{
+    MidiCC cc;
+
     while (!xml.atEnd()) {
         xml.readNext();
         if (xml.isEndElement())
             break;
         if (xml.isStartElement() && (xml.name() == "MIDICC")) {
-            controlID = xml.attributes().value("CtrlID").toString().toInt();
-            ccnumber = -1;
-            channel = -1;
-            min = -1;
-            max = -1;
+            cc.ID = xml.attributes().value("CtrlID").toString().toInt() + idOffset;
+            cc.ccnumber = -1;
+            cc.channel = -1;
+            cc.min = -1;
+            cc.max = -1;
             while (!xml.atEnd()) {
                 xml.readNext();
                 if (xml.isEndElement())
                     break;
                 if (xml.name() == "ccnumber")
-                    ccnumber = xml.readElementText().toInt();
+                    cc.ccnumber = xml.readElementText().toInt();
                 else if (xml.name() == "channel")
-                    channel = xml.readElementText().toInt();
+                    cc.channel = xml.readElementText().toInt();
                 else if (xml.name() == "min")
-                    min = xml.readElementText().toInt();
+                    cc.min = xml.readElementText().toInt();
                 else if (xml.name() == "max")
-                    max = xml.readElementText().toInt();
+                    cc.max = xml.readElementText().toInt();
                 else skipXmlElement(xml);
             }
-            if ((-1 < ccnumber) && (-1 < channel)) {
-                appendMidiCC(controlID, ccnumber, channel, min, max);
+            if ((-1 >= cc.ccnumber) || (-1 >= cc.channel)) {
+                qWarning("Controller data incomplete");
+                continue;
             }
-            else qWarning("Controller data incomplete");
+            int l1 = 0;
+            while ((l1 < list->count()) &&
+                ((cc.ID != list->at(l1).ID) ||
+                (cc.ccnumber != list->at(l1).ccnumber) ||
+                (cc.channel != list->at(l1).channel))) l1++;
+
+            if (list->count() == l1) list->append(cc);
+            else qWarning("MIDI Controller %d already attributed", cc.ccnumber);
         }
         else skipXmlElement(xml);
     }
 }
-void MidiControl::writeData(QXmlStreamWriter& xml)
+
+void MidiControl::writeCcList(QXmlStreamWriter& xml, const QVector<MidiCC> &list)
 {
     xml.writeStartElement("midiControllers");
-    for (int l1 = 0; l1 < ccList.count(); l1++) {
+    for (int l1 = 0; l1 < list.count(); l1++) {
         xml.writeStartElement("MIDICC");
-        xml.writeAttribute("CtrlID", QString::number(ccList.at(l1).ID));
+        xml.writeAttribute("CtrlID", QString::number(list.at(l1).ID));
             xml.writeTextElement("ccnumber", QString::number(
-                ccList.at(l1).ccnumber));
+                list.at(l1).ccnumber));
             xml.writeTextElement("channel", QString::number(
-                ccList.at(l1).channel));
+                list.at(l1).channel));
             xml.writeTextElement("min", QString::number(
-                ccList.at(l1).min));
+                list.at(l1).min));
             xml.writeTextElement("max", QString::number(
-                ccList.at(l1).max));
+                list.at(l1).max));
         xml.writeEndElement();
     }
     xml.writeEndElement();
 }
+
+void MidiControl::refresh()
+{
+    for (int l1 = 0; l1 < ccList.count(); l1++) {
+        const int id = ccList.at(l1).ID;
+        if ((id >= 0) && (id < names.count())) ccList[l1].name = names.at(id);
+    }
+    emit ccListChanged();
+}
+
 void MidiControl::skipXmlElement(QXmlStreamReader& xml)
 {
     if (xml.isStartElement()) {
@@ -229,4 +263,49 @@ void MidiControl::skipXmlElement(QXmlStreamReader& xml)
 void MidiControl::setCcList(const QVector<MidiCC> &p_ccList)
 {
     ccList = p_ccList;
+    emit ccListChanged();
+}
+
+void MidiControl::clearCcList()
+{
+    ccList.clear();
+    emit ccListChanged();
+}
+
+MidiCCIndex::MidiCCIndex()
+    : offsets(16 * 128 + 1, 0)
+{
+}
+
+void MidiCCIndex::add(MidiCCHandler *handler, const QVector<MidiCC> &ccList)
+{
+    for (int l1 = 0; l1 < ccList.count(); l1++) {
+        const MidiCC &cc = ccList.at(l1);
+        if (((unsigned int)cc.channel > 15) || ((unsigned int)cc.ccnumber > 127))
+            continue;
+
+        MidiCCTarget target;
+        target.handler = handler;
+        target.ID = cc.ID;
+        target.min = cc.min;
+        target.max = cc.max;
+        targets.push_back(target);
+        keys.push_back(cc.channel * 128 + cc.ccnumber);
+    }
+}
+
+void MidiCCIndex::finalize()
+{
+    const int count = targets.size();
+    std::vector<MidiCCTarget> sorted(count);
+
+    offsets.assign(16 * 128 + 1, 0);
+    for (int l1 = 0; l1 < count; l1++) offsets[keys[l1] + 1]++;
+    for (int l1 = 0; l1 < 16 * 128; l1++) offsets[l1 + 1] += offsets[l1];
+
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (int l1 = 0; l1 < count; l1++) sorted[fill[keys[l1]]++] = targets[l1];
+
+    targets.swap(sorted);
+    keys.clear();
 }
@@ -31,6 +31,7 @@
 #include <QXmlStreamWriter>
 
 #include <cstdio>
+#include <vector>
 #include "main.h"
 
 #ifndef MIDICC_H
@@ -49,6 +50,86 @@ struct MidiCC {
 #define MIDICC_H
 #endif
 
+/*!
+ * @brief Interface of the objects owning a MidiControl, which receive the
+ * controller values of its bindings.
+ *
+ * Implemented by EngineCore, GlobStore, GrooveWidget and ModuleCore.
+ */
+class MidiCCHandler
+{
+  public:
+    virtual ~MidiCCHandler() { }
+/*!
+* @brief Handles a MIDI-learned controller value for one binding
+*
+* It is called by EngineCore::sendController() from the realtime thread.
+* @param controlID Internal ID of the bound GUI element
+* @param min Value mapped to controller value 0
+* @param max Value mapped to controller value 127
+* @param value The received controller value
+*/
+    virtual void handleController(int controlID, int min, int max, int value) = 0;
+};
+
+/*! @brief Structure holding one controller binding target of a MidiCCIndex
+ */
+struct MidiCCTarget {
+        MidiCCHandler *handler; /**< @brief Owner of the binding */
+        int ID;         /**< @brief Internal ID of the assigned GUI element */
+        int min;        /**< @brief Value output when the CC value is 0 */
+        int max;        /**< @brief Value output when the CC value is 127 */
+    };
+
+/*!
+ * @brief Index of all MIDI controller bindings by channel and CC number.
+ *
+ * Engine builds it from the MidiControl::ccList of all handlers outside
+ * the realtime thread whenever a binding changes, and publishes it
+ * through a SnapshotStore. A received controller then costs one lookup
+ * returning exactly the bound targets, in the order they were added.
+ */
+class MidiCCIndex
+{
+  private:
+    std::vector<int> offsets;           /**< Start of each list in targets, 16 * 128 + 1 entries */
+    std::vector<MidiCCTarget> targets;  /**< Concatenated target lists */
+    std::vector<int> keys;              /**< Channel and CC of each target before finalize() */
+
+  public:
+    MidiCCIndex();
+/*!
+* @brief Adds the bindings of a handler
+*
+* @param handler The object handling the controllers
+* @param ccList The bindings of the handler's MidiControl
+*/
+    void add(MidiCCHandler *handler, const QVector<MidiCC> &ccList);
+/*!
+* @brief Sorts the added targets into the index, has to be called
+* after the last add()
+*/
+    void finalize();
+/*!
+* @brief Returns the targets bound to a controller
+*
+* @param ccnumber The received CC number
+* @param channel The channel on which the controller was received
+* @param count Is set to the number of targets returned
+* @return Pointer to the first target
+*/
+    const MidiCCTarget *lookup(int ccnumber, int channel, int *count) const
+    {
+        if (((unsigned int)channel > 15) || ((unsigned int)ccnumber > 127)) {
+            *count = 0;
+            return targets.data();
+        }
+        const int k = channel * 128 + ccnumber;
+        *count = offsets[k + 1] - offsets[k];
+        return targets.data() + offsets[k];
+    }
+};
+
 /*!
  * @brief Manages the list of MIDI-controllable Widgets for a Module.
  *
@@ -108,7 +189,31 @@ class MidiControl : public QObject
 */
     void addMidiLearnMenu(const QString &name, QWidget *widget, int count = 0);
 
-#ifdef APPBUILD
+/*!
+* @brief Reads the bindings of a midiControllers element into a list
+*
+* Used by MidiControl::readData() and by the classes reading a
+* session without GUI. Bindings already in the list are not appended
+* twice.
+*
+* @param xml QXmlStreamReader positioned at the midiControllers element
+* @param list List the bindings are appended to
+* @param idOffset Value added to the ID of each binding
+*/
+    static void readCcList(QXmlStreamReader& xml, QVector<MidiCC> *list,
+            int idOffset = 0);
+/*!
+* @brief Writes a list of bindings as midiControllers element
+*
+* @param xml QXmlStreamWriter to write to
+* @param list Bindings to write
+*/
+    static void writeCcList(QXmlStreamWriter& xml, const QVector<MidiCC> &list);
+/*!
+* @brief Sets the names of the bindings in MidiControl::ccList after
+* they were read by readCcList() and emits ccListChanged()
+*/
+    void refresh();
 /*!
 * @brief allows ignoring one XML element in the XML stream
 * passed by the caller.
@@ -118,10 +223,13 @@ class MidiControl : public QObject
 *
 * @param xml reference to QXmlStreamReader containing the open XML stream
 */
-void skipXmlElement(QXmlStreamReader& xml);
-#endif
+    static void skipXmlElement(QXmlStreamReader& xml);
 
   signals:
+/*! @brief Emitted whenever MidiControl::ccList was modified, connected to
+*  Engine::updateCCIndex()
+*/
+    void ccListChanged();
 /*! @brief Connected to Engine::setMidiLearn() to listen for incoming events.
 *  @param ID ID of the module requesting MIDI learn
 *  @param controlID ID of the GUI element to be assigned to the controller
@@ -218,5 +326,9 @@ void skipXmlElement(QXmlStreamReader& xml);
 * @param p_ccList QVector<MidiCC> to copy from
 */
     void setCcList(const QVector<MidiCC> &p_ccList);
+/*!
+* @brief Removes all MIDI controller - GUI element bindings
+*/
+    void clearCcList();
 };
 #endif
@@ -50,8 +50,18 @@ typedef struct {
     } MidiEvent;
 
 #ifdef APPBUILD
+#include <stdint.h>
 #include <QMetaType>
 Q_DECLARE_METATYPE (MidiEvent)
+
+/*! @brief Structure holding a MidiEvent received by the Engine for the
+ * LogWidget
+ */
+typedef struct {
+        MidiEvent ev;
+        int tick;
+        uint64_t time_ns;   /**< RtStats::now() at reception */
+    } MidiLogEvent;
 #endif
 
 /*! @brief Sequencer event type enum in analogy to the ALSA snd_seq_event_types */
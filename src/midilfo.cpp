@@ -23,12 +23,22 @@
  */
 #include <cmath>
 #include <cstdint>
+#include <algorithm>
 #include "midilfo.h"
 
+/* mute state of a point in the bit set published to MidiLfo::muteBuffer,
+ * points beyond its end are not muted */
+static bool isMutedIn(const std::vector<uint64_t>& mutes, int index)
+{
+    const unsigned int word = index >> 6;
+    return (word < mutes.size()) && ((mutes[word] >> (index & 63)) & 1);
+}
+
 
 MidiLfo::MidiLfo()
 {
     eventType = EV_CONTROLLER;
+    moduleType = MOD_LFO;
     amp = 64;
     offs = 0;
     phase = 0;
@@ -43,23 +53,28 @@ MidiLfo::MidiLfo()
     isRecording = false;
     recValue = 0;
     cwmin = 0;
-    const int wavesize = 32768;
-
-    customWave.resize(wavesize);
-    muteMask.resize(wavesize);
-    data.reserve(wavesize);
+    thinDeadband = -1;
+    thinMinTicks = 0;
+    thinnedCount = 0;
+    lastOutValue = -1;
+    lastOutDest = -1;
+    lastInValue = -1;
+    lastOutTick = 0;
+    thinPending = false;
+
+    customWave.resize(maxNPoints);
+    std::fill(waveKey, waveKey + 7, -1);
     outFrame.resize(32);
     
     Sample sample = {0, 0, 0, false};
     sample.value = 63;
     sample.data = 0;
-    for (int l1 = 0; l1 < wavesize; l1++) {
-        sample.tick =  l1 * TPQN / res;;
-        sample.muted = false;
-        customWave[l1] = sample;
-        data[l1] = sample;
-        if (l1 < 32) outFrame[l1] = sample;
-        muteMask[l1] = false;
+    for (int l1 = 0; l1 < maxNPoints; l1++) {
+        customWave.setValue(l1, 63);
+    }
+    for (int l1 = 0; l1 < 32; l1++) {
+        sample.tick =  l1 * TPQN / res;
+        outFrame[l1] = sample;
     }
     updateWaveForm(waveFormIndex);
     getData(&data);
@@ -76,8 +91,26 @@ void MidiLfo::getNextFrame(int64_t tick)
     //if res <= LFO_FRAMELIMIT. If res > LFO_FRAMELIMIT, a frame is output
     //The FRAMELIMIT avoids excessive cursor updating
 
-    if ((uint32_t)framePtr >= data.size()) return;
-    
+    /* built-in waveforms are evaluated at each point, only their mute
+     * states are published by getData(). The published wave or mute
+     * states may still have the previous size if size or resolution
+     * were just changed */
+    const bool analytic = (waveFormIndex < 5);
+    const std::vector<Sample> *wave = NULL;
+    const std::vector<uint64_t> *mutes = NULL;
+    int wavePoints = 0;
+    if (analytic) {
+        mutes = muteBuffer.acquire();
+    }
+    else {
+        wave = waveBuffer.acquire();
+        wavePoints = wave->size() - 1;
+        if ((wavePoints < 1) || (framePtr >= wavePoints)) {
+            waveBuffer.release();
+            return;
+        }
+    }
+
     Sample sample = {0, 0, 0, false};
     const int npoints = size * res;
     int lt, l1;
@@ -104,7 +137,13 @@ void MidiLfo::getNextFrame(int64_t tick)
         else {
             index = (l1 + framePtr) % npoints;
         }
-        sample = data.at(index);
+        if (analytic) {
+            sample.value = waveValue(index);
+            sample.muted = isMutedIn(*mutes, index);
+        }
+        else {
+            sample = (*wave)[index % wavePoints];
+        }
 
         if (isRecording) {
             if (frameSize < 2) {
@@ -119,16 +158,32 @@ void MidiLfo::getNextFrame(int64_t tick)
                             + (double)(recValue - lastSampleValue) / res * framelimit
                             * ((double)l1 + .5);
             }
-            customWave[index] = sample;
+            RecordedPoint point = {index, sample.value};
+            recordRing.push(point);
             dataChanged = true;
         }
         sample.tick = lt;
         sample.data = ccnumber;
         
         if (seqFinished) sample.muted = true;
+        if ((thinDeadband >= 0) && !isRecording) {
+            const int next = reverse ? index - 1 : index + 1;
+            int nextValue = -1;
+            if ((next >= 0) && (next < npoints)) {
+                if (analytic) {
+                    if (!isMutedIn(*mutes, next))
+                        nextValue = waveValue(next);
+                }
+                else if (!(*wave)[next % wavePoints].muted) {
+                    nextValue = (*wave)[next % wavePoints].value;
+                }
+            }
+            if (!thinSample(sample, nextValue)) sample.muted = true;
+        }
         outFrame[l1] = sample;
         l1++;
     } while ((l1 < frameSize) && (l1 < npoints));
+    if (analytic) muteBuffer.release(); else waveBuffer.release();
 
     lt = nextTick + l1 * TPQN / res;
 
@@ -138,7 +193,7 @@ void MidiLfo::getNextFrame(int64_t tick)
         || (framePtr == npoints - l1 && reverse)) applyPendingParChanges();
 
     if (curLoopMode == 6) {
-        framePtr = (rand() % npoints) / l1;
+        framePtr = prng.below(npoints) / l1;
         framePtr *= l1;
     }
     else {
@@ -194,94 +249,127 @@ void MidiLfo::getNextFrame(int64_t tick)
     if (seqFinished) framePtr = 0;
 }
 
+/* One period of (1 - cos) / 2 in 16-bit fixed point, with a guard point
+ * at the end for the interpolation */
+namespace {
+struct CosTable {
+    enum { BITS = 10, SIZE = 1 << BITS };
+    int32_t value[SIZE + 1];
+    CosTable()
+    {
+        for (int l1 = 0; l1 <= SIZE; l1++) {
+            value[l1] = lround((1. - cos(2. * M_PI * l1 / SIZE)) * 32768.);
+        }
+    }
+};
+const CosTable cosTable;
+}
+
 void MidiLfo::getData(std::vector<Sample> *p_data)
 {
     //this function returns the full LFO wave
 
+    mergeRecorded(&customWave);
+
     Sample sample = {0, 0, 0, false};
     const int npoints = size * res;
-    int val = 0;
-    bool cl = false;
-    std::vector<Sample> tmpdata;
 
-    tmpdata.clear();
+    data.resize(npoints + 1);
+
+    if (waveFormIndex == 5) {
+        for (int l1 = 0; l1 < npoints; l1++) {
+            sample.value = customWave.value(l1);
+            sample.tick = l1 * TPQN / res;
+            sample.muted = customWave.isMuted(l1);
+            data[l1] = sample;
+        }
+    }
+    else {
+        const int key[7] = {waveFormIndex, freq, amp, offs, phase, res, size};
+        if (!std::equal(key, key + 7, waveKey)) {
+            waveCache.resize(npoints);
+            calcWave(npoints);
+            std::copy(key, key + 7, waveKey);
+        }
+        for (int l1 = 0; l1 < npoints; l1++) {
+            sample.value = waveCache[l1];
+            sample.tick = l1 * TPQN / res;
+            sample.muted = customWave.isMuted(l1);
+            data[l1] = sample;
+        }
+    }
+    sample.data = -1;
+    sample.tick = npoints * TPQN / res;
+    data[npoints] = sample;
+
+    if (waveFormIndex == 5) {
+        std::vector<Sample> *snapshot = waveBuffer.edit();
+        *snapshot = data;
+        waveBuffer.publish(snapshot);
+    }
+    else {
+        std::vector<uint64_t> *mutes = muteBuffer.edit();
+        mutes->assign((npoints + 63) / 64, 0);
+        for (int l1 = 0; l1 < npoints; l1++) {
+            if (customWave.isMuted(l1)) {
+                (*mutes)[l1 >> 6] |= (uint64_t)1 << (l1 & 63);
+            }
+        }
+        muteBuffer.publish(mutes);
+    }
+
+    if (p_data != &data) *p_data = data;
+}
+
+void MidiLfo::calcWave(int npoints)
+{
+    int *wave = waveCache.data();
+
+    for (int l1 = 0; l1 < npoints; l1++) {
+        wave[l1] = waveValue(l1);
+    }
+}
 
-    int phase_max = res * 32 / freq;
-    int ph = phase_max * phase / 128;
+int MidiLfo::waveValue(int index) const
+{
+    /* the shapes run on an integer phase accumulator counting res * 32
+     * steps per period, which is advanced by freq at each point. Its
+     * value at a given point is obtained directly from the point index,
+     * so that no state has to be carried from one point to the next */
+    const int period = res * 32;
+    const int ph = res * 32 / freq * phase / 128;
+    const int val = (int64_t)freq * (index + ph) % period;
+    int value;
 
     switch(waveFormIndex) {
         case 0: //sine
-            for (int l1 = 0; l1 < npoints; l1++) {
-                sample.value = clip((-cos((double)((l1 + ph) * 6.28 /
-                res * freq / 32)) + 1) * amp / 2 + offs, 0, 127, &cl);
-                sample.tick = l1 * TPQN / res;;
-                sample.muted = muteMask.at(l1);
-                tmpdata.push_back(sample);
+            {
+                const int pos = (int64_t)val * (CosTable::SIZE << 8) / period;
+                const int32_t *p = cosTable.value + (pos >> 8);
+                const int32_t y = p[0] + (((p[1] - p[0]) * (pos & 0xff)) >> 8);
+                value = ((int64_t)y * amp >> 16) + offs;
             }
         break;
         case 1: //sawtooth up
-            val = freq * ph;
-            val %= res * 32;
-            for (int l1 = 0; l1 < npoints; l1++) {
-                sample.value = clip(val * amp / res / 32
-                + offs, 0, 127, &cl);
-                sample.tick = l1 * TPQN / res;;
-                sample.muted = muteMask.at(l1);
-                tmpdata.push_back(sample);
-                val += freq;
-                val %= res * 32;
-            }
+            value = val * amp / period + offs;
         break;
         case 2: //triangle
-            val = freq * ph;
-            val %= res * 32;
-            for (int l1 = 0; l1 < npoints; l1++) {
-                int tempval = val - res * 16;
-                if (tempval < 0 ) tempval = -tempval;
-                sample.value = clip((res * 16 - tempval) * amp
-                        / res / 16 + offs, 0, 127, &cl);
-                sample.tick = l1 * TPQN / res;;
-                sample.muted = muteMask.at(l1);
-                tmpdata.push_back(sample);
-                val += freq;
-                val %= res * 32;
-            }
+            value = (period / 2 - abs(val - period / 2)) * amp / (period / 2)
+                    + offs;
         break;
         case 3: //sawtooth down
-            val = freq * ph;
-            val %= res * 32;
-            for (int l1 = 0; l1 < npoints; l1++) {
-                sample.value = clip((res * 32 - val)
-                        * amp / res / 32 + offs, 0, 127, &cl);
-                sample.tick = l1 * TPQN / res;;
-                sample.muted = muteMask.at(l1);
-                tmpdata.push_back(sample);
-                val += freq;
-                val %= res * 32;
-            }
+            value = (period - val) * amp / period + offs;
         break;
         case 4: //square
-            for (int l1 = 0; l1 < npoints; l1++) {
-                sample.value = clip(amp * (( (l1 + ph) * freq / 16
-                        / res) % 2 == 0) + offs, 0, 127, &cl);
-                sample.tick = l1 * TPQN / res;;
-                sample.muted = muteMask.at(l1);
-                tmpdata.push_back(sample);
-            }
-        break;
-        case 5: //custom
-            for (int l1 = 0; l1 < npoints; l1++) {
-                tmpdata.push_back(customWave[l1]);
-            }
+            value = amp * (((int64_t)(index + ph) * freq / 16 / res) % 2 == 0)
+                    + offs;
         break;
         default:
+            value = offs;
         break;
     }
-    sample.data = -1;
-    sample.tick = npoints * TPQN / res;;
-    tmpdata.push_back(sample);
-    data = tmpdata;
-    *p_data = data;
+
+    return std::min(std::max(value, 0), 127);
 }
 
 void MidiLfo::updateWaveForm(int val)
@@ -337,7 +425,6 @@ void MidiLfo::updateLoop(int val)
 
 int MidiLfo::setCustomWavePoint(double mouseX, double mouseY, bool newpt)
 {
-    Sample sample = {0, 0, 0, false};
     int loc = mouseX * (res * size);
     int Y = mouseY * 128;
 
@@ -362,9 +449,7 @@ int MidiLfo::setCustomWavePoint(double mouseX, double mouseY, bool newpt)
             lastMouseY -= (double)(lastMouseY - Y) / (lastMouseLoc - loc) - .5;
             lastMouseLoc--;
         }
-        sample = customWave[lastMouseLoc];
-        sample.value = lastMouseY;
-        customWave[lastMouseLoc] = sample;
+        customWave.setValue(lastMouseLoc, lastMouseY);
     } while (lastMouseLoc != loc);
 
     newCustomOffset();
@@ -398,18 +483,14 @@ int MidiLfo::mouseEvent(double mouseX, double mouseY, int buttons, int pressed)
 void MidiLfo::resizeAll()
 {
     const int npoints = res * size;
-    Sample sample = {0, 0, 0, false};
 
     framePtr%=npoints;
 
     if (maxNPoints < npoints) {
-        for (int l1 = 0; l1 < npoints; l1++) {
-            if (l1 >= maxNPoints)
-                muteMask[l1] = muteMask[l1 % maxNPoints];
-            sample = customWave[l1 % maxNPoints];
-            sample.tick = l1 * TPQN / res;
-            sample.muted = muteMask[l1];
-            customWave[l1] = sample;
+        customWave.resize(npoints);
+        for (int l1 = maxNPoints; l1 < npoints; l1++) {
+            customWave.setValue(l1, customWave.value(l1 % maxNPoints));
+            customWave.setMuted(l1, customWave.isMuted(l1 % maxNPoints));
         }
         maxNPoints = npoints;
     }
@@ -421,7 +502,7 @@ void MidiLfo::copyToCustom()
 {
     updateWaveForm(5);
     for (int l1 = 0; l1 < nPoints; l1++)
-        customWave[l1] = data[l1];
+        customWave.setValue(l1, data[l1].value);
 
 }
 
@@ -430,7 +511,7 @@ void MidiLfo::newCustomOffset()
     int min = 127;
     const int npoints = res * size;
     for (int l1 = 0; l1 < npoints; l1++) {
-        int value = customWave[l1].value;
+        int value = customWave.value(l1);
         if (value < min) min = value;
     }
     cwmin = min;
@@ -441,7 +522,6 @@ void MidiLfo::newCustomOffset()
 
 void MidiLfo::flipWaveVertical()
 {
-    Sample sample = {0, 0, 0, false};
     int min = 127;
     int max = 0;
     const int npoints = res * size;
@@ -451,15 +531,13 @@ void MidiLfo::flipWaveVertical()
     }
     
     for (int l1 = 0; l1 < npoints; l1++) {
-        int value = customWave[l1].value;
+        int value = customWave.value(l1);
         if (value < min) min = value;
         if (value > max) max = value;
     }
 
     for (int l1 = 0; l1 < npoints; l1++) {
-        sample = customWave[l1];
-        sample.value = min + max - sample.value;
-        customWave[l1] = sample;
+        customWave.setValue(l1, min + max - customWave.value(l1));
     }
     cwmin = min;
 #ifdef APPBUILD
@@ -469,47 +547,36 @@ void MidiLfo::flipWaveVertical()
 
 void MidiLfo::updateCustomWaveOffset(int o)
 {
-    Sample sample = {0, 0, 0, false};
     const int count = res * size;
     int l1 = 0;
     bool cl = false;
 
     while ((!cl) && (l1 < count)) {
-        sample.value = clip(customWave[l1].value + o - cwmin,
-                            0, 127, &cl);
+        clip(customWave.value(l1) + o - cwmin, 0, 127, &cl);
         l1++;
         }
 
     if (cl) return;
 
     for (l1 = 0; l1 < count; l1++) {
-        sample = customWave[l1];
-        sample.value += o - cwmin;
-        customWave[l1] = sample;
+        customWave.setValue(l1, customWave.value(l1) + o - cwmin);
     }
     cwmin = o;
 }
 
 bool MidiLfo::toggleMutePoint(double mouseX)
 {
-    Sample sample = {0, 0, 0, false};
     bool m;
     int loc = mouseX * (res * size);
 
-    m = muteMask.at(loc);
-    muteMask[loc] = !m;
-    if (waveFormIndex == 5) {
-        sample = customWave[loc];
-        sample.muted = !m;
-        customWave[loc] = sample;
-    }
+    m = customWave.isMuted(loc);
+    customWave.setMuted(loc, !m);
     lastMouseLoc = loc;
     return(!m);
 }
 
 int MidiLfo::setMutePoint(double mouseX, bool on)
 {
-    Sample sample = {0, 0, 0, false};
     int loc = mouseX * (res * size);
     
     // Return negative value to signal that data hasn't changed
@@ -518,12 +585,7 @@ int MidiLfo::setMutePoint(double mouseX, bool on)
     if (lastMouseLoc >= (res * size)) lastMouseLoc = loc;
 
     do {
-        if (waveFormIndex == 5) {
-            sample = customWave[lastMouseLoc];
-            sample.muted = on;
-            customWave[lastMouseLoc] = sample;
-        }
-        muteMask[lastMouseLoc] = on;
+        customWave.setMuted(lastMouseLoc, on);
         if (loc > lastMouseLoc) lastMouseLoc++;
         if (loc < lastMouseLoc) lastMouseLoc--;
     } while (lastMouseLoc != loc);
@@ -548,12 +610,68 @@ void MidiLfo::setRecordMode(bool on)
 {
     if (!on) {
         isRecording = false;
+        mergeRecorded(&customWave);
         newCustomOffset();
         dataChanged = true;
     }
     recordMode = on;
 }
 
+void MidiLfo::updateThinning(int deadband, int maxRate)
+{
+    thinDeadband = deadband;
+    thinMinTicks = (maxRate > 0) ? TPQN / maxRate : 0;
+    thinnedCount = 0;
+    lastOutValue = -1;
+    thinPending = false;
+}
+
+bool MidiLfo::thinSample(const Sample& sample, int nextValue)
+{
+    const int prevValue = lastInValue;
+    const int dest = (portOut * 16 + channelOut) * 128 + sample.data;
+
+    lastInValue = sample.value;
+
+    if (sample.muted || isMuted) {
+        /* the receiver may have been changed meanwhile */
+        lastOutValue = -1;
+        lastInValue = -1;
+        return true;
+    }
+
+    if ((lastOutValue >= 0) && (dest == lastOutDest)) {
+        if (sample.value == lastOutValue) {
+            thinPending = false;
+            thinnedCount++;
+            return false;
+        }
+
+        bool segmentEnd = (nextValue < 0) || (nextValue == sample.value);
+        if (!segmentEnd && (prevValue >= 0)) {
+            segmentEnd = ((sample.value > prevValue) != (nextValue > sample.value));
+        }
+
+        if (!segmentEnd && !thinPending
+                && (abs(sample.value - lastOutValue) <= thinDeadband)) {
+            thinnedCount++;
+            return false;
+        }
+        /* segment ends are sent even within the rate limit */
+        if (!segmentEnd && (sample.tick - lastOutTick < thinMinTicks)) {
+            thinPending = true;
+            thinnedCount++;
+            return false;
+        }
+    }
+
+    lastOutValue = sample.value;
+    lastOutDest = dest;
+    lastOutTick = sample.tick;
+    thinPending = false;
+    return true;
+}
+
 void MidiLfo::record(int value)
 {
     recValue = value;
@@ -602,6 +720,16 @@ bool MidiLfo::handleEvent(MidiEvent inEv, int64_t tick, int keep_rel)
     return(false);
 }
 
+void MidiLfo::getRoute(MidiRoute *route)
+{
+    route->clear();
+    route->channel = chIn;
+    if (trigByKbd || trigLegato || restartByKbd || enableNoteOff) {
+        route->setNoteRange(indexIn[0], indexIn[1]);
+    }
+    if (recordMode) route->addController(ccnumberIn);
+}
+
 void MidiLfo::applyPendingParChanges()
 {
     if (!parChangesPending) return;
@@ -616,6 +744,9 @@ void MidiLfo::applyPendingParChanges()
 
 void MidiLfo::setNextTick(uint64_t tick)
 {
+    prng.setSeed(randomSeed);
+    lastOutValue = -1;
+    thinPending = false;
     uint64_t pos = (tick * res / TPQN) % nPoints;
 
     reverse = false;
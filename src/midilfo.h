@@ -26,6 +26,8 @@
 #define MIDILFO_H
 
 #include "midiworker.h"
+#include "compactwave.h"
+#include "lockfree.h"
 
 
 /*! @brief MIDI worker class for the LFO Module. Implements a sequencer
@@ -35,11 +37,15 @@
  * The backend driver thread calls the Engine::echoCallback(), which will
  * query each module, in this case via
  * the MidiLfo::getNextFrame() method. MidiLfo will fill a frame from
- * its internal MidiLfo::data buffer as a function of the position of
- * the driver's transport. MidiLfo::frame is then accessed by Engine. It
+ * the MidiLfo::waveBuffer snapshot as a function of the position of
+ * the driver's transport, or calculate the values directly in the case
+ * of a built-in waveform. MidiLfo::frame is then accessed by Engine. It
  * has size 1 except for resolution higher than 16th notes.
  * The MidiLfo::data buffer is populated by the getData() function
- * at each modification done via the LfoWidget. It can consist of
+ * at each modification done via the LfoWidget. A copy of it is
+ * published to MidiLfo::waveBuffer for a custom wave, only its mute
+ * states are published to MidiLfo::muteBuffer for a built-in
+ * waveform. It can consist of
  * a classic waveform calculation or a hand-drawn waveform. In all cases
  * the waveform has resolution, offset and size attributes and single
  * points can be tagged as muted, which will avoid data output at the
@@ -59,6 +65,48 @@ class MidiLfo : public MidiWorker  {
  * @param cwoffs New offset value
  */
     void updateCustomWaveOffset(int cwoffs);
+/*! @brief  calculates the values of the built-in waveform into
+ * MidiLfo::waveCache.
+ *
+ * It is called by MidiLfo::getData() when one of the parameters in
+ * MidiLfo::waveKey changed.
+ * @param npoints Number of points to calculate
+ */
+    void calcWave(int npoints);
+/*! @brief  calculates the value of the built-in waveform at one point.
+ *
+ * The value is derived from the point index alone, so it can be called
+ * for any point in any order. It is used by MidiLfo::calcWave() and by
+ * MidiLfo::getNextFrame(), which thereby picks up parameter changes at
+ * the next point without waiting for a new MidiLfo::waveBuffer snapshot.
+ * @param index Index of the point, 0 ... res * size - 1
+ */
+    int waveValue(int index) const;
+    std::vector<int> waveCache;     /*!< Values of the last calculated built-in waveform */
+    int waveKey[7];     /*!< waveFormIndex, freq, amp, offs, phase, res and size at which MidiLfo::waveCache was calculated */
+    int lastOutValue;   /*!< Last value sent while thinning, -1 if the next value must be sent */
+    int lastOutDest;    /*!< Port, channel and controller lastOutValue was sent to */
+    int lastInValue;    /*!< Value of the previous output point seen by thinSample() */
+    int64_t lastOutTick;    /*!< Tick at which lastOutValue was sent */
+    bool thinPending;   /*!< A value was held back by the rate limit and is still due */
+/*! @brief  decides whether an output point is sent or dropped by the
+ * output thinning.
+ *
+ * A point repeating the last sent value is always dropped. A point
+ * changing it by no more than MidiLfo::thinDeadband, or coming less than
+ * MidiLfo::thinMinTicks after the last sent point, is dropped unless it
+ * ends a segment. Segment ends are extrema, the first point of a
+ * plateau, the last point of the wave and a point followed by a muted
+ * point, so the value held at such a point is always exact, however
+ * close it follows the last sent point. A value held back by the rate
+ * limit is sent as soon as the limit allows.
+ *
+ * @param sample The output point
+ * @param nextValue Value of the following point, -1 if the point ends
+ * the wave or the following point is muted
+ * @return True if the point is to be sent
+ */
+    bool thinSample(const Sample& sample, int nextValue);
 
   public:
     bool recordMode, isRecording;
@@ -77,9 +125,13 @@ class MidiLfo : public MidiWorker  {
                                         @par 4: Square
                                         @par 5: Use Custom Wave */
     int cwmin;                      /*!< The minimum of MidiLfo::customWave */
-    std::vector<Sample> customWave; /*!< Vector of Sample points holding the custom drawn wave */
-    std::vector<bool> muteMask;     /*!< Vector of booleans with mute state information for each wave point */
-    std::vector<Sample> data;
+    int thinDeadband;               /*!< Output thinning deadband, -1 if the thinning is off */
+    int thinMinTicks;               /*!< Minimum distance of two points sent while thinning, 0 for no limit */
+    int thinnedCount;               /*!< Number of output events saved by the thinning */
+    CompactWave customWave;         /*!< Values of the custom drawn wave and mute states of all wave points, MidiLfo::maxNPoints long */
+    std::vector<Sample> data;       /*!< Waveform built by getData(), not accessed by getNextFrame() */
+    SnapshotBuffer<std::vector<Sample> > waveBuffer; /*!< Copies of MidiLfo::data of the custom wave published by getData() and read by getNextFrame() */
+    SnapshotBuffer<std::vector<uint64_t> > muteBuffer; /*!< Mute states of a built-in waveform, one bit per point, published by getData() and read by getNextFrame() */
 
   public:
     MidiLfo();
@@ -93,6 +145,13 @@ class MidiLfo : public MidiWorker  {
     void updateSize(int);
     void updateLoop(int);
     void record(int value);
+/*! @brief  sets the output thinning parameters.
+ *
+ * @param deadband Changes by up to this amount are not sent, 0 to only
+ * drop repeated values, -1 to switch the thinning off
+ * @param maxRate Maximum number of events per beat, 0 for no limit
+ */
+    void updateThinning(int deadband, int maxRate);
     void setRecordMode(bool on);
 /*! @brief  Called by LfoWidget::mouseEvent()
  */
@@ -127,14 +186,13 @@ class MidiLfo : public MidiWorker  {
  * @see MidiLfo::toggleMutePoint(), MidiLfo::setMutePoint()
  */
     int setCustomWavePoint(double mouseX, double mouseY, bool newpt);
-/*! @brief  sets the mute state of one point of the
- * MidiLfo::muteMask array to the given state.
+/*! @brief  sets the mute state of one point of
+ * MidiLfo::customWave to the given state.
  *
  * The method is called when the right mouse button is clicked on the
  * LfoScreen via the mouseEvent() function.
- * If calculated waveforms are active, only the MidiLfo::muteMask is
- * changed. If a custom waveform is active, the Sample.mute status
- * at the given position is changed as well.
+ * The mute states apply to calculated waveforms and to the custom
+ * waveform alike.
  *
  * @returns index in the wave vector that has been set
  * @param mouseX Normalized Horizontal location of the mouse on the
@@ -172,6 +230,7 @@ class MidiLfo : public MidiWorker  {
     void setFramePtr(int idx);
 
     bool handleEvent(MidiEvent inEv, int64_t tick, int keep_rel = 0) override;
+    void getRoute(MidiRoute *route) override;
 
 /*! @brief  is the main calculator for the data contained
  * in a waveform.
@@ -179,13 +238,20 @@ class MidiLfo : public MidiWorker  {
  * It is called upon every change of parameters in LfoWidget or upon
  * input by mouse clicks on the LfoScreen. It fills the
  * MidiLfo::data buffer with Sample points, which it either calculates
- * or which it copies from the MidiLfo::customWave data.
+ * or which it copies from the MidiLfo::customWave data. For
+ * MidiLfo::getNextFrame() it publishes a copy of a custom wave to
+ * MidiLfo::waveBuffer, or the mute states of a built-in waveform to
+ * MidiLfo::muteBuffer.
  *
  * @param *data reference to an array the waveform is copied to
  */
     void getData(std::vector<Sample> *data);
 /*! @brief fills the MidiLfo::frame with Sample data points taken from
- * the currently active waveform MidiLfo::data.
+ * the currently active waveform.
+ *
+ * Custom waves are read from the MidiLfo::waveBuffer snapshot, built-in
+ * waveforms are evaluated by MidiLfo::waveValue() and muted according
+ * to the MidiLfo::muteBuffer snapshot.
  *
  * MidiLfo::frame is then accessed by Engine::echoCallback() and sequenced
  * to the driver backend.
@@ -193,14 +259,13 @@ class MidiLfo : public MidiWorker  {
  * @param tick current tick
  */
     void getNextFrame(int64_t tick) override;
-/*! @brief  toggles the mute state of one point of the
- * MidiLfo::muteMask array.
+/*! @brief  toggles the mute state of one point of
+ * MidiLfo::customWave.
  *
  * The function is called when the right mouse button is clicked on the
  * LfoScreen.
- * If calculated waveforms are active, only the MidiLfo::muteMask is
- * changed. If a custom waveform is active, the Sample.mute status
- * at the given position is changed as well.
+ * The mute states apply to calculated waveforms and to the custom
+ * waveform alike.
  *
  * @param mouseX Normalized Horizontal location of the mouse on the
  * LfoScreen (0.0 ... 1.0)
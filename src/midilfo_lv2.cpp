@@ -24,6 +24,7 @@
 
 
 #include <cstdio>
+#include <algorithm>
 #include "midilfo_lv2.h"
 
 MidiLfoLV2::MidiLfoLV2 (
@@ -33,6 +34,7 @@ MidiLfoLV2::MidiLfoLV2 (
     for (int l1 = 0; l1 < 35; l1++) val[l1] = 0;
     
     sampleRate = sample_rate;
+    timeBase.setRate((uint64_t)(sample_rate * 60));
     curFrame = 0;
     inLfoFrame = 0;
     inEventBuffer = NULL;
@@ -138,9 +140,10 @@ void MidiLfoLV2::updatePos(uint64_t pos, float bpm, int speed, bool ignore_pos)
     }
 
     if (!ignore_pos) {
-        const float frames_per_beat = 60.0f / transportBpm * sampleRate;
         transportFramesDelta = pos;
-        tempoChangeTick = pos * TPQN / frames_per_beat;
+        tempoChangeTick = TimeBase::mulDiv(pos,
+                TimeBase::tpmFromTempo(transportBpm), timeBase.rate());
+        timeBase.setTempoAt(tempo, tempoChangeTick, transportFramesDelta);
     }
     if (transportSpeed != speed) {
         /* Speed changed, e.g. 0 (stop) to 1 (play) */
@@ -216,11 +219,9 @@ void MidiLfoLV2::run ( uint32_t nframes )
 
                 inEv.channel = di[0] & 0x0f;
                 inEv.data=di[1];
-                int tick = ((uint64_t)(curFrame - transportFramesDelta) * nframes
-                            +(uint64_t)(&event->time.frames) % nframes)
-                            *TPQN*tempo/nframes/60/sampleRate + tempoChangeTick;
+                int tick = timeBase.posToTick(curFrame + event->time.frames);
                 if (handleEvent(inEv, tick)) //if event is unmatched, forward it
-                    forgeMidiEvent((int)((uint64_t)(&event->time.frames) % nframes), di, 3);
+                    forgeMidiEvent(event->time.frames, di, 3);
             }
         }
     }
@@ -228,30 +229,39 @@ void MidiLfoLV2::run ( uint32_t nframes )
 
         // MIDI and Wave Control Output
 
-    for (uint32_t f = 0 ; f < nframes; f++) {
-        curTick = (uint64_t)(curFrame - transportFramesDelta)
-                        *TPQN*tempo/60/sampleRate + tempoChangeTick;
-        if ((curTick >= (uint64_t)outFrame.at(inLfoFrame).tick)
-            && (transportSpeed)) {
-            if (!outFrame.at(inLfoFrame).muted && !isMuted) {
-                unsigned char d[3];
-                d[0] = 0xb0 + channelOut;
-                d[1] = ccnumber;
-                d[2] = outFrame.at(inLfoFrame).value;
-                forgeMidiEvent(f, d, 3);
-                *val[WaveOut] = (float)d[2] / 128;
-            }
-            inLfoFrame++;
-            inLfoFrame%=frameSize;
-            if (!inLfoFrame) {
-                framePtr = getFramePtr();
-                float pos = (float)framePtr;
-                *val[CURSOR_POS] = pos;
-                getNextFrame(curTick);
-            }
+    // Jump straight to the frame of the next LFO sample instead of
+    // visiting every frame. Samples are output at most once per frame.
+    const uint64_t endFrame = curFrame + nframes;
+    uint64_t frame = curFrame;
+
+    while (transportSpeed) {
+        const int sampleTick = outFrame.at(inLfoFrame).tick;
+        frame = std::max(frame,
+                timeBase.tickToPos(sampleTick > 0 ? sampleTick : 0));
+        if (frame >= endFrame) break;
+
+        const uint32_t f = frame - curFrame;
+        curTick = timeBase.posToTick(frame);
+        if (!outFrame.at(inLfoFrame).muted && !isMuted) {
+            unsigned char d[3];
+            d[0] = 0xb0 + channelOut;
+            d[1] = ccnumber;
+            d[2] = outFrame.at(inLfoFrame).value;
+            forgeMidiEvent(f, d, 3);
+            *val[WaveOut] = (float)d[2] / 128;
+        }
+        inLfoFrame++;
+        inLfoFrame%=frameSize;
+        if (!inLfoFrame) {
+            framePtr = getFramePtr();
+            float pos = (float)framePtr;
+            *val[CURSOR_POS] = pos;
+            getNextFrame(curTick);
         }
-        curFrame++;
+        frame++;
     }
+    curFrame = endFrame;
+    curTick = timeBase.posToTick(curFrame);
 }
 
 void MidiLfoLV2::forgeMidiEvent(uint32_t f, const uint8_t* const buffer, uint32_t size)
@@ -371,7 +381,10 @@ void MidiLfoLV2::updateParams()
     if (changed) {
         dataChanged = true;
     }
-    if (dataChanged) {
+    /* built-in waveforms are evaluated by getNextFrame(), the wave only
+     * has to be rebuilt for the UI, for a custom wave or a new size */
+    if (dataChanged && (ui_up || (waveFormIndex == 5)
+            || ((int)data.size() != res * size + 1))) {
         getData(&data);
     }
 }
@@ -384,6 +397,7 @@ void MidiLfoLV2::initTransport()
         transportBpm = internalTempo;
         tempo = internalTempo;
         transportSpeed = 1;
+        timeBase.setTempoAt(tempo, tempoChangeTick, transportFramesDelta);
     }
     else transportSpeed = 0;
     
@@ -444,9 +458,10 @@ static LV2_State_Status MidiLfoLV2_state_restore ( LV2_Handle instance,
 
     pPlugin->setFramePtr(0);
     pPlugin->maxNPoints = (size - 1 ) / 2;
+    pPlugin->customWave.resize(pPlugin->maxNPoints);
 
     for (int l1 = 0; l1 <  pPlugin->maxNPoints; l1++) {
-        pPlugin->muteMask[l1] = (value1[2 * l1 + 1] == '1');
+        pPlugin->customWave.setMuted(l1, (value1[2 * l1 + 1] == '1'));
     }
 
     key = uris->hex_customwave;
@@ -457,7 +472,6 @@ static LV2_State_Status MidiLfoLV2_state_restore ( LV2_Handle instance,
 
     if (size < 2) return LV2_STATE_ERR_UNKNOWN;
 
-    Sample sample = {0, 0, 0, false};
     int min = 127;
     for (int l1 = 0; l1 <  pPlugin->maxNPoints; l1++) {
         int hi = 0;
@@ -468,13 +482,11 @@ static LV2_State_Status MidiLfoLV2_state_restore ( LV2_Handle instance,
         if (value[2*l1 + 1] <= '9' && value[2*l1 + 1] >= '0') lo = value[2*l1 + 1] - '0';
         if (value[2*l1 + 1] <= 'f' && value[2*l1 + 1] >= 'a') lo = value[2*l1 + 1] - 'a' + 10;
 
-        sample.value = hi * 16 + lo;
-        sample.tick = l1 * TPQN / pPlugin->res;
-        sample.muted = pPlugin->muteMask[l1];
-        pPlugin->customWave[l1] = sample;
-        if (sample.value < min) min = sample.value;
+        pPlugin->customWave.setValue(l1, hi * 16 + lo);
+        if (hi * 16 + lo < min) min = hi * 16 + lo;
     }
     pPlugin->cwmin = min;
+    pPlugin->resizeAll();
     pPlugin->getData(&pPlugin->data);
     pPlugin->sendWave();
 
@@ -503,8 +515,8 @@ static LV2_State_Status MidiLfoLV2_state_save ( LV2_Handle instance,
     char bt[pPlugin->maxNPoints * 2 + 1];
     
     for (l1 = 0; l1 < pPlugin->maxNPoints; l1++) {
-        bt[2*l1] = hexmap[(pPlugin->customWave[l1].value  & 0xF0) >> 4];
-        bt[2*l1 + 1] = hexmap[pPlugin->customWave[l1].value  & 0x0F];
+        bt[2*l1] = hexmap[(pPlugin->customWave.value(l1)  & 0xF0) >> 4];
+        bt[2*l1 + 1] = hexmap[pPlugin->customWave.value(l1)  & 0x0F];
     }
     bt[pPlugin->maxNPoints * 2] = '\0';
     
@@ -519,7 +531,7 @@ static LV2_State_Status MidiLfoLV2_state_save ( LV2_Handle instance,
 
     for (l1 = 0; l1 < pPlugin->maxNPoints; l1++) {
         bt[2*l1] = '0';
-        bt[2*l1 + 1] = hexmap[pPlugin->muteMask[l1]];
+        bt[2*l1 + 1] = hexmap[pPlugin->customWave.isMuted(l1)];
     }
 
     const char *value1 = bt;
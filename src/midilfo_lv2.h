@@ -27,6 +27,7 @@
 
 #include "midilfo.h"
 #include "lv2_common.h"
+#include "timebase.h"
 
 #define QMIDIARP_LFO_LV2_URI QMIDIARP_LV2_URI "/lfo"
 #define QMIDIARP_LFO_LV2_PREFIX QMIDIARP_LFO_LV2_URI "#"
@@ -114,6 +115,7 @@ private:
         void forgeMidiEvent(uint32_t f, const uint8_t* const buffer, uint32_t size);
 
         uint64_t transportFramesDelta;  /**< Frames since last click start */
+        TimeBase timeBase;              /**< Tick mapping of the host frames */
         float transportBpm;
         float transportSpeed;
         bool hostTransport;
@@ -29,6 +29,7 @@
 MidiSeq::MidiSeq()
 {
     eventType = EV_NOTEON;
+    moduleType = MOD_SEQ;
     
     recordMode = false;
     currentRecStep = 0;
@@ -36,6 +37,7 @@ MidiSeq::MidiSeq()
 
     nOctaves = 4;
     baseOctave = 3;
+    dispVertIndex = 0;
 
     ccnumber = -1;
     
@@ -52,29 +54,22 @@ MidiSeq::MidiSeq()
     lastMute = false;
     lastMouseLoc = 0;
     lastMouseY = 0;
-    const int wavesize = 8192;
 
-    customWave.resize(wavesize);
-    muteMask.resize(wavesize);
-    data.reserve(wavesize);
+    customWave.resize(maxNPoints);
     outFrame.resize(2);
     
     Sample sample = {0, 0, 0, false};
     sample.data = 60;
     sample.value = 0;
     
-    for (int l1 = 0; l1 < wavesize; l1++) {
-        sample.tick = l1 * TPQN / res;
-        sample.muted = false;
-        customWave[l1] = sample;
-        data[l1] = sample;
-        muteMask[l1] = false;
+    for (int l1 = 0; l1 < maxNPoints; l1++) {
+        customWave.setValue(l1, 60);
     }
     outFrame[0] = sample;
     sample.data = -1;
     sample.tick = nextTick;
     outFrame[1] = sample;
-
+    getData(&data);
 }
 
 bool MidiSeq::handleEvent(MidiEvent inEv, int64_t tick, int keep_rel)
@@ -124,6 +119,19 @@ bool MidiSeq::handleEvent(MidiEvent inEv, int64_t tick, int keep_rel)
     return(false);
 }
 
+void MidiSeq::getRoute(MidiRoute *route)
+{
+    route->clear();
+    route->channel = chIn;
+    if (recordMode) {
+        route->setNoteRange(36, 83);
+    }
+    else {
+        route->setNoteRange((indexIn[0] < 36) ? 36 : indexIn[0],
+                (indexIn[1] > 83) ? 83 : indexIn[1]);
+    }
+}
+
 void MidiSeq::getNextFrame(int64_t tick)
 {
     const int frame_nticks = TPQN / res;
@@ -134,7 +142,13 @@ void MidiSeq::getNextFrame(int64_t tick)
     if (restartFlag) setFramePtr(0);
     if (!framePtr) grooveTick = newGrooveTick;
 
-    sample = customWave[framePtr];
+    /* the sequence published by getData() may still have the previous
+     * size if size or resolution were just changed */
+    const std::vector<Sample> *wave = waveBuffer.acquire();
+    const int wavePoints = wave->size() - 1;
+    if (wavePoints > 0) sample = (*wave)[framePtr % wavePoints];
+    else sample.muted = true;
+    waveBuffer.release();
     advancePatternIndex();
 
     if (nextTick < (tick - frame_nticks)) nextTick = tick;
@@ -179,9 +193,9 @@ void MidiSeq::advancePatternIndex()
 
     if (curLoopMode == 6) {
         if (pivot)
-            framePtr = rand() % pivot;
+            framePtr = prng.below(pivot);
         else
-            framePtr = rand() % npoints;
+            framePtr = prng.below(npoints);
         return;
     }
 
@@ -248,15 +262,25 @@ void MidiSeq::getData(std::vector<Sample> * p_data)
     
     const int npoints = res * size;
 
+    mergeRecorded(&customWave);
     data.resize(npoints);
 
-    for (int l1 = 0; l1 < npoints; l1++) data[l1] = customWave[l1];
+    for (int l1 = 0; l1 < npoints; l1++) {
+        sample.data = customWave.value(l1);
+        sample.tick = l1 * TPQN / res;
+        sample.muted = customWave.isMuted(l1);
+        data[l1] = sample;
+    }
     sample.data = -1;
     sample.tick = npoints * TPQN / res;
     sample.muted = false;
     data.push_back(sample);
-    
-    *p_data = data;
+
+    std::vector<Sample> *snapshot = waveBuffer.edit();
+    *snapshot = data;
+    waveBuffer.publish(snapshot);
+
+    if (p_data != &data) *p_data = data;
 }
 
 void MidiSeq::updateResolution(int val)
@@ -312,15 +336,17 @@ void MidiSeq::updateTranspose(int val)
 
 void MidiSeq::recordNote(int val)
 {
-        setRecordedNote(val);
-        currentRecStep++;
-        currentRecStep %= (res * size);
+        RecordedPoint point = {currentRecStep, val};
+        recordRing.push(point);
+        currentRecStep = (currentRecStep + 1) % (res * size);
         dataChanged = true;
 }
 
 int MidiSeq::setCustomWavePoint(double mouseX, double mouseY)
 {
-    currentRecStep = mouseX * res * size;
+    int step = mouseX * res * size;
+    if (step >= res * size) step = res * size - 1;
+    currentRecStep = step;
     setRecordedNote(12 * (mouseY * nOctaves + baseOctave));
     return (currentRecStep);
 }
@@ -379,6 +405,7 @@ void MidiSeq::setLoopMarker(int ix)
 
 void MidiSeq::updateDispVert(int mode)
 {
+    dispVertIndex = mode;
     switch (mode) {
         case 0:
             nOctaves = 4;
@@ -409,30 +436,21 @@ void MidiSeq::setRecordMode(int on)
 
 void MidiSeq::setRecordedNote(int note)
 {
-    Sample sample = {0, 0, 0, false};
-
-    sample = customWave[currentRecStep];
-    sample.data = note;
-    sample.tick = currentRecStep * TPQN / res;
-    customWave[currentRecStep] = sample;
+    customWave.setValue(currentRecStep, note);
 }
 
 void MidiSeq::resizeAll()
 {
     const int npoints = res * size;
-    Sample sample = {0, 0, 0, false};
 
     framePtr%=npoints;
-    currentRecStep%=npoints;
+    currentRecStep = currentRecStep % npoints;
 
     if (maxNPoints < npoints) {
-        for (int l1 = 0; l1 < npoints; l1++) {
-            if (l1 >= maxNPoints)
-                muteMask[l1] = muteMask[l1 % maxNPoints];
-            sample = customWave[l1 % maxNPoints];
-            sample.tick = l1 * TPQN / res;
-            sample.muted = muteMask[l1];
-            customWave[l1] = sample;
+        customWave.resize(npoints);
+        for (int l1 = maxNPoints; l1 < npoints; l1++) {
+            customWave.setValue(l1, customWave.value(l1 % maxNPoints));
+            customWave.setMuted(l1, customWave.isMuted(l1 % maxNPoints));
         }
         maxNPoints = npoints;
     }
@@ -444,27 +462,21 @@ void MidiSeq::resizeAll()
 
 bool MidiSeq::toggleMutePoint(double mouseX)
 {
-    Sample sample = {0, 0, 0, false};
     bool m;
     int loc = mouseX * (res * size);
+    if (loc >= res * size) loc = res * size - 1;
 
-    m = muteMask[loc];
-    muteMask[loc] = !m;
-    sample = customWave[loc];
-    sample.muted = !m;
-    customWave[loc] = sample;
+    m = customWave.isMuted(loc);
+    customWave.setMuted(loc, !m);
     return(!m);
 }
 
 int MidiSeq::setMutePoint(double mouseX, bool on)
 {
-    Sample sample = {0, 0, 0, false};
     int loc = mouseX * (res * size);
+    if (loc >= res * size) loc = res * size - 1;
 
-    sample = customWave[loc];
-    sample.muted = on;
-    customWave[loc] = sample;
-    muteMask[loc] = on;
+    customWave.setMuted(loc, on);
     return (loc);
 }
 
@@ -506,6 +518,7 @@ void MidiSeq::applyPendingParChanges()
 
 void MidiSeq::setNextTick(uint64_t tick)
 {
+    prng.setSeed(randomSeed);
     int pos = (tick * res / TPQN) % nPoints;
 
     reverse = false;
@@ -26,6 +26,8 @@
 #define MIDISEQ_H
 
 #include "midiworker.h"
+#include "compactwave.h"
+#include "lockfree.h"
 #include <vector>
 
 /*! @brief MIDI worker class for the Seq Module. Implements a monophonic
@@ -35,10 +37,10 @@
  * The backend driver thread calls the Engine::echoCallback(), which will
  * query each module, in this case via
  * the MidiSeq::getNextFrame() method. MidiSeq will return a note from
- * its internal MidiSeq::data buffer as a function of the position of
+ * the MidiSeq::waveBuffer snapshot as a function of the position of
  * the driver's transport. The MidiSeq::data buffer is populated by the
  * MidiSeq::getData() function at each modification done via
- * the SeqWidget. It is modified by drawing a sequence of notes on the
+ * the SeqWidget, and a copy of it is published to MidiSeq::waveBuffer. It is modified by drawing a sequence of notes on the
  * SeqWidget display or by recording incoming notes step by step. In all
  * cases the sequence has resolution, velocity, note length and
  * size attributes and single points can be tagged as muted, which will
@@ -63,14 +65,15 @@ class MidiSeq : public MidiWorker  {
     int vel, transp, notelength;
     int velDefer, transpDefer, notelengthDefer;
     int size, res;
-    int currentRecStep;
+    std::atomic<int> currentRecStep; /*!< Step written by the next recorded note, advanced by the realtime thread */
     int loopMarker;
     int maxNPoints;        /*!< Maximum number of steps that have been used in the session */
     int nOctaves;
     int baseOctave;
-    std::vector<Sample> customWave;
-    std::vector<bool> muteMask;
-    std::vector<Sample> data;
+    int dispVertIndex;     /*!< Vertical display zoom mode set by MidiSeq::updateDispVert() */
+    CompactWave customWave;     /*!< Notes and mute states of the sequence, MidiSeq::maxNPoints long */
+    std::vector<Sample> data;       /*!< Sequence built by getData(), not accessed by getNextFrame() */
+    SnapshotBuffer<std::vector<Sample> > waveBuffer; /*!< Copies of MidiSeq::data published by getData() and read by getNextFrame() */
 
   public:
     MidiSeq();
@@ -87,6 +90,7 @@ class MidiSeq : public MidiWorker  {
     void recordNote(int note);
 
     bool handleEvent(MidiEvent inEv, int64_t tick, int keep_rel = 0) override;
+    void getRoute(MidiRoute *route) override;
 /*! @brief  sets the (controller) value of one point of the
  * MidiSeq::customWave array. It is used for handling drawing functionality.
  *
@@ -128,14 +132,11 @@ class MidiSeq : public MidiWorker  {
  * MidiSeq::setLoopMarker()
  */
     void setLoopMarkerMouse(double mouseX);
-/*! @brief  sets the mute state of one point of the
- * MidiSeq::muteMask array to the given state.
+/*! @brief  sets the mute state of one point of
+ * MidiSeq::customWave to the given state.
  *
  * It is called when the right mouse button is clicked on the
  * SeqScreen via the mouseEvent() function.
- * If calculated waveforms are active, only the MidiSeq::muteMask is
- * changed. If a custom waveform is active, the Sample.mute status
- * at the given position is changed as well.
  *
  * @param mouseX Normalized horizontal location of the mouse on the
  * SeqScreen (0.0 ... 1.0)
@@ -163,7 +164,8 @@ class MidiSeq : public MidiWorker  {
  *
  * It fills the
  * MidiSeq::data buffer with Sample points, which it copies from the
- * MidiSeq::customWave data.
+ * MidiSeq::customWave data, and publishes a copy of it to
+ * MidiSeq::waveBuffer for MidiSeq::getNextFrame().
  *
  * @param data reference to an array the waveform is copied to
  */
@@ -178,12 +180,11 @@ class MidiSeq : public MidiWorker  {
  * used to calculate the nextTick which is quantized to the pattern
  */
     void getNextFrame(int64_t tick) override;
-/*! @brief  toggles the mute state of one point of the
- * MidiSeq::muteMask array.
+/*! @brief  toggles the mute state of one point of
+ * MidiSeq::customWave.
  *
  * It is called when the right mouse button is clicked on the
- * SeqScreen. The Sample.mute status at the given position in
- * MidiSeq::customWave is changed as well.
+ * SeqScreen.
  *
  * @param mouseX Normalized Horizontal location of the mouse on the
  * SeqScreen (0.0 ... 1.0)
@@ -24,15 +24,17 @@
 
 #include <cstdio>
 #include <cmath>
+#include <algorithm>
 #include "midiseq_lv2.h"
 
 MidiSeqLV2::MidiSeqLV2 (
     double sample_rate, const LV2_Feature *const *host_features )
-    :MidiSeq()
+    :MidiSeq(), noteOffQueue(JQ_BUFSZ)
 {
     for (int l1 = 0; l1 < 35; l1++) val[l1] = 0;
 
     sampleRate = sample_rate;
+    timeBase.setRate((uint64_t)(sample_rate * 60));
     curFrame = 0;
     inEventBuffer = NULL;
     outEventBuffer = NULL;
@@ -43,7 +45,6 @@ MidiSeqLV2::MidiSeqLV2 (
     tempo = 120.0f;
     internalTempo = 120.0f;
     lastMouseIndex = 0;
-    dispVertIndex = 0;
 
     transportBpm = 120.0f;
     transportFramesDelta = 0;
@@ -59,15 +60,9 @@ MidiSeqLV2::MidiSeqLV2 (
     transportSpeed = 0;
     transportAtomReceived = false;
     
-    for (int l1 = 0; l1 < JQ_BUFSZ; l1++) {
-        evQueue[l1] = 0;
-        evTickQueue[l1] = 0;
-    }
-
     transpFromGui = 0;
     velFromGui = 256;
 
-    bufPtr = 0;
     dataChanged = true;
     ui_up = false;
 
@@ -151,9 +146,10 @@ void MidiSeqLV2::updatePos(uint64_t pos, float bpm, int speed, bool ignore_pos)
     }
 
     if (!ignore_pos && (transportBpm > 0)) {
-        const float frames_per_beat = 60.0f / transportBpm * sampleRate;
         transportFramesDelta = pos;
-        tempoChangeTick = pos * TPQN / frames_per_beat;
+        tempoChangeTick = TimeBase::mulDiv(pos,
+                TimeBase::tpmFromTempo(transportBpm), timeBase.rate());
+        timeBase.setTempoAt(tempo, tempoChangeTick, transportFramesDelta);
     }
     if (transportSpeed != speed) {
         /* Speed changed, e.g. 0 (stop) to 1 (play) */
@@ -217,21 +213,39 @@ void MidiSeqLV2::run (uint32_t nframes )
 
                 inEv.channel = di[0] & 0x0f;
                 inEv.data=di[1];
-                int tick = ((uint64_t)(curFrame - transportFramesDelta) * nframes
-                            +(uint64_t)(&event->time.frames) % nframes)
-                            *TPQN*tempo/nframes/60/sampleRate + tempoChangeTick;
+                int tick = timeBase.posToTick(curFrame + event->time.frames);
                 if (handleEvent(inEv, tick - 2)) //if event is unmatched, forward it
-                    forgeMidiEvent((int)((uint64_t)(&event->time.frames) % nframes), di, 3);
+                    forgeMidiEvent(event->time.frames, di, 3);
             }
         }
     }
 
 
         // MIDI Output
-    for (uint32_t f = 0 ; f < nframes; f++) {
-        curTick = (uint64_t)(curFrame - transportFramesDelta)
-                        *TPQN*tempo/60/sampleRate + tempoChangeTick;
-        if ((curTick >= (uint64_t)nextTick) && (transportSpeed)) {
+    // Jump from one due event to the next instead of visiting every
+    // frame. Sequencer steps are output at most once per frame as before.
+    const uint64_t endFrame = curFrame + nframes;
+    uint64_t stepFrame = curFrame;
+
+    if (hostTransport && !transportSpeed) sendNoteOffs(0, UINT64_MAX);
+
+    for (;;) {
+        uint64_t frame = endFrame;
+        if (transportSpeed) {
+            stepFrame = std::max(stepFrame,
+                    timeBase.tickToPos(nextTick > 0 ? nextTick : 0));
+            frame = stepFrame;
+        }
+        if (!noteOffQueue.isEmpty()) {
+            frame = std::min(frame, std::max(curFrame,
+                    timeBase.tickToPos(noteOffQueue.nextTick())));
+        }
+        if (frame >= endFrame) break;
+
+        const uint32_t f = frame - curFrame;
+        curTick = timeBase.posToTick(frame);
+
+        if (transportSpeed && (frame == stepFrame)) {
             getNextFrame(curTick);
             if (!outFrame[0].muted && !isMuted) {
                 unsigned char d[3];
@@ -239,40 +253,29 @@ void MidiSeqLV2::run (uint32_t nframes )
                 d[1] = outFrame[0].data;
                 d[2] = vel;
                 forgeMidiEvent(f, d, 3);
-                evTickQueue[bufPtr] = curTick + notelength / 4;
-                evQueue[bufPtr] = outFrame[0].data;
-                bufPtr++;
+                noteOffQueue.push(curTick + notelength / 4, outFrame[0].data);
             }
             float pos = (float)getFramePtr();
             *val[CURSOR_POS] = pos;
+            stepFrame = frame + 1;
         }
 
-        // Note Off Queue handling
-        uint64_t noteofftick = evTickQueue[0];
-        int idx = 0;
-        for (int l1 = 0; l1 < bufPtr; l1++) {
-            uint64_t tmptick = evTickQueue[l1];
-            if (noteofftick > tmptick) {
-                idx = l1;
-                noteofftick = tmptick;
-            }
-        }
-        if ( (bufPtr) && ((curTick >= noteofftick)
-                || (hostTransport && !transportSpeed)) ) {
-            int outval = evQueue[idx];
-            for (int l4 = idx ; l4 < (bufPtr - 1);l4++) {
-                evQueue[l4] = evQueue[l4 + 1];
-                evTickQueue[l4] = evTickQueue[l4 + 1];
-            }
-            bufPtr--;
+        sendNoteOffs(f, frame);
+    }
+    curFrame = endFrame;
+    curTick = timeBase.posToTick(curFrame);
+}
 
-            unsigned char d[3];
-            d[0] = 0x80 + channelOut;
-            d[1] = outval;
-            d[2] = 127;
-            forgeMidiEvent(f, d, 3);
-        }
-        curFrame++;
+void MidiSeqLV2::sendNoteOffs(uint32_t f, uint64_t frame)
+{
+    while (!noteOffQueue.isEmpty()
+            && (timeBase.tickToPos(noteOffQueue.nextTick()) <= frame)) {
+        unsigned char d[3];
+        d[0] = 0x80 + channelOut;
+        d[1] = noteOffQueue.next();
+        d[2] = 127;
+        forgeMidiEvent(f, d, 3);
+        noteOffQueue.pop();
     }
 }
 
@@ -299,8 +302,7 @@ void MidiSeqLV2::updateParams()
     
     if (dispVertIndex != (int)*val[DISPLAY_ZOOM]) {
         changed = true;
-        dispVertIndex = (int)*val[DISPLAY_ZOOM];
-        updateDispVert(dispVertIndex);
+        updateDispVert((int)*val[DISPLAY_ZOOM]);
     }
 
     if (mouseXCur != *val[MOUSEX] || mouseYCur != *val[MOUSEY]
@@ -407,6 +409,7 @@ void MidiSeqLV2::initTransport()
         transportBpm = internalTempo;
         tempo = internalTempo;
         transportSpeed = 1;
+        timeBase.setTempoAt(tempo, tempoChangeTick, transportFramesDelta);
     }
     else transportSpeed = 0;
 
@@ -465,9 +468,10 @@ static LV2_State_Status MidiSeqLV2_state_restore ( LV2_Handle instance,
 
     pPlugin->setFramePtr(0);
     pPlugin->maxNPoints = (size - 1 ) / 2;
+    pPlugin->customWave.resize(pPlugin->maxNPoints);
 
     for (int l1 = 0; l1 <  pPlugin->maxNPoints; l1++) {
-        pPlugin->muteMask[l1] = (value1[2 * l1 + 1] == '1');
+        pPlugin->customWave.setMuted(l1, (value1[2 * l1 + 1] == '1'));
     }
 
     key = uris->hex_customwave;
@@ -478,8 +482,6 @@ static LV2_State_Status MidiSeqLV2_state_restore ( LV2_Handle instance,
 
     if (size < 2) return LV2_STATE_ERR_UNKNOWN;
 
-    Sample sample = {0, 0, 0, false};
-
     for (int l1 = 0; l1 <  pPlugin->maxNPoints; l1++) {
         int hi = 0;
         int lo = 0;
@@ -489,11 +491,9 @@ static LV2_State_Status MidiSeqLV2_state_restore ( LV2_Handle instance,
         if (value[2*l1 + 1] <= '9' && value[2*l1 + 1] >= '0') lo = value[2*l1 + 1] - '0';
         if (value[2*l1 + 1] <= 'f' && value[2*l1 + 1] >= 'a') lo = value[2*l1 + 1] - 'a' + 10;
 
-        sample.data = hi * 16 + lo;
-        sample.tick = l1 * TPQN / pPlugin->res;
-        sample.muted = pPlugin->muteMask[l1];
-        pPlugin->customWave[l1] = sample;
+        pPlugin->customWave.setValue(l1, hi * 16 + lo);
     }
+    pPlugin->resizeAll();
 
     pPlugin->getData(&pPlugin->data);
     pPlugin->dataChanged = true;
@@ -522,8 +522,8 @@ static LV2_State_Status MidiSeqLV2_state_save ( LV2_Handle instance,
     char bt[pPlugin->maxNPoints * 2 + 1];
     
     for (l1 = 0; l1 < pPlugin->maxNPoints; l1++) {
-        bt[2*l1] = hexmap[(pPlugin->customWave[l1].data  & 0xF0) >> 4];
-        bt[2*l1 + 1] = hexmap[pPlugin->customWave[l1].data  & 0x0F];
+        bt[2*l1] = hexmap[(pPlugin->customWave.value(l1)  & 0xF0) >> 4];
+        bt[2*l1 + 1] = hexmap[pPlugin->customWave.value(l1)  & 0x0F];
     }
     bt[pPlugin->maxNPoints * 2] = '\0';
     
@@ -538,7 +538,7 @@ static LV2_State_Status MidiSeqLV2_state_save ( LV2_Handle instance,
 
     for (l1 = 0; l1 < pPlugin->maxNPoints; l1++) {
         bt[2*l1] = '0';
-        bt[2*l1 + 1] = hexmap[pPlugin->muteMask[l1]];
+        bt[2*l1 + 1] = hexmap[pPlugin->customWave.isMuted(l1)];
     }
 
     const char *value1 = bt;
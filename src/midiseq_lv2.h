@@ -27,6 +27,8 @@
 
 #include "midiseq.h"
 #include "lv2_common.h"
+#include "timebase.h"
+#include "tickqueue.h"
 
 #define QMIDIARP_SEQ_LV2_URI QMIDIARP_LV2_URI "/seq"
 #define QMIDIARP_SEQ_LV2_PREFIX QMIDIARP_SEQ_LV2_URI "#"
@@ -101,7 +103,6 @@ private:
         double mouseYCur;
         int mouseEvCur;
         int lastMouseIndex;
-        int dispVertIndex;
         int transpFromGui;
         int velFromGui;
         double internalTempo;
@@ -112,14 +113,14 @@ private:
         void updateParams();
         void sendWave();
         void forgeMidiEvent(uint32_t f, const uint8_t* const buffer, uint32_t size);
+        void sendNoteOffs(uint32_t f, uint64_t frame);
 
         uint64_t transportFramesDelta;  /**< Frames since last click start */
+        TimeBase timeBase;              /**< Tick mapping of the host frames */
         float transportBpm;
         float transportSpeed;
         bool hostTransport;
-        uint32_t evQueue[JQ_BUFSZ];
-        uint64_t evTickQueue[JQ_BUFSZ];
-        int bufPtr;
+        TickQueue<int> noteOffQueue;    /**< Pending note offs by tick */
 
         LV2_Atom_Sequence *inEventBuffer;
         const LV2_Atom_Sequence *outEventBuffer;
@@ -25,7 +25,7 @@
 #include "midiworker.h"
 
 
-MidiWorker::MidiWorker()
+MidiWorker::MidiWorker() : recordRing(512)
 {
     enableNoteIn = true;
     enableNoteOff = false;
@@ -70,6 +70,12 @@ MidiWorker::MidiWorker()
     nRepetitions = 1;
     currentRepetition = 0;
     nPoints = 1;
+    isRestoreMaster = false;
+    dispFramePtr = 0;
+    dispPercent = 0;
+
+    /* EngineCore::addModule() gives each module of a session its own seed */
+    setRandomSeed(1);
 
     dataChanged = false;
     needsGUIUpdate = false;
@@ -88,6 +94,29 @@ void MidiWorker::setMuted(bool on)
     needsGUIUpdate = false;
 }
 
+void MidiWorker::setRandomSeed(uint64_t seed)
+{
+    randomSeed = seed;
+    prng.setSeed(seed);
+}
+
+bool MidiWorker::mergeRecorded(CompactWave *wave)
+{
+    RecordedPoint points[64];
+    unsigned int count;
+    bool merged = false;
+
+    while ((count = recordRing.pop(points, 64))) {
+        for (unsigned int l1 = 0; l1 < count; l1++) {
+            if (points[l1].index < wave->count()) {
+                wave->setValue(points[l1].index, points[l1].value);
+            }
+        }
+        merged = true;
+    }
+    return merged;
+}
+
 int MidiWorker::clip(int value, int min, int max, bool *outOfRange)
 {
     int tmp = value;
@@ -102,3 +131,33 @@ int MidiWorker::clip(int value, int min, int max, bool *outOfRange)
     }
     return(tmp);
 }
+
+bool MidiWorker::prepareNextFrame(bool echo_from_trig, int syncTol,
+                int64_t tick, bool restoreAtEnd, int64_t *restoreTick,
+                bool *restoreFlag)
+{
+    if (echo_from_trig != gotKbdTrig) return false;
+    if ((tick + syncTol) < nextTick) return false;
+
+    int ci = getFramePtr();
+    dispFramePtr.store(ci, std::memory_order_relaxed);
+    if (reverse) ci = nPoints - ci;
+    if (nPoints) {
+        dispPercent.store((ci * 100 / nPoints + currentRepetition * 100)
+                / nRepetitions, std::memory_order_relaxed);
+    }
+    else dispPercent.store(0, std::memory_order_relaxed);
+
+    getNextFrame(tick);
+
+    bool repetitionsFinished = (currentRepetition == 0);
+    if (reverse) {
+        repetitionsFinished = (currentRepetition >= nRepetitions - 1);
+    }
+    if (!getFramePtr() && *restoreFlag && repetitionsFinished
+            && isRestoreMaster && restoreAtEnd) {
+        *restoreTick = nextTick;
+        *restoreFlag = false;
+    }
+    return true;
+}
@@ -26,10 +26,71 @@
 #define MIDIWORKER_H
 
 #include "main.h"
+#include "compactwave.h"
+#include "lockfree.h"
+#include "prng.h"
+#include "rtstats.h"
 #include <cstdlib>
 #include <cstdio>
 #include <cstdint>
 #include <vector>
+#include <atomic>
+
+/*! @brief Module type enum, set by the constructor of each MidiWorker subclass */
+enum module_type {
+    MOD_ARP = 0,
+    MOD_LFO,
+    MOD_SEQ
+};
+
+/*! @brief Wave point recorded by the realtime thread, see MidiWorker::recordRing */
+struct RecordedPoint {
+    int index;          /*!< Index of the point in the custom wave */
+    int value;          /*!< Recorded value or note */
+};
+
+/*! @brief Structure describing the input events a MidiWorker acts on
+ *
+ * It is filled by MidiWorker::getRoute() and may list more events than
+ * the module actually handles, but never less. Engine builds its
+ * RoutingTable from it.
+ */
+struct MidiRoute {
+    int channel;        /*!< Input channel or OMNI */
+    int noteMin;        /*!< Lowest accepted note, no notes if above noteMax */
+    int noteMax;        /*!< Highest accepted note */
+    uint32_t ccMask[4]; /*!< One bit per accepted controller number */
+
+    void clear()
+    {
+        channel = OMNI;
+        noteMin = 1;
+        noteMax = 0;
+        for (int l1 = 0; l1 < 4; l1++) ccMask[l1] = 0;
+    }
+    void setNoteRange(int min, int max)
+    {
+        noteMin = (min < 0) ? 0 : min;
+        noteMax = (max > 127) ? 127 : max;
+    }
+    void addController(int cc)
+    {
+        if ((cc >= 0) && (cc < 128)) ccMask[cc >> 5] |= 1u << (cc & 31);
+    }
+    bool hasController(int cc) const
+    {
+        return (ccMask[cc >> 5] >> (cc & 31)) & 1;
+    }
+    bool operator==(const MidiRoute& other) const
+    {
+        for (int l1 = 0; l1 < 4; l1++) {
+            if (ccMask[l1] != other.ccMask[l1]) return false;
+        }
+        return ((channel == other.channel) && (noteMin == other.noteMin)
+                && (noteMax == other.noteMax));
+    }
+    bool operator!=(const MidiRoute& other) const { return !(*this == other); }
+};
 
 /*! @brief MIDI worker base class for QMidiArp modules.
  *
@@ -41,6 +102,7 @@ class MidiWorker {
 
   public:
     int eventType;      /*!< Midi Event Type needs to be set for every module instance*/
+    int moduleType;     /*!< Module type (module_type enum), set by every module class */
     double queueTempo;  /*!< current tempo of the transport, not in use here */
     int chIn;           /**< Channel of input events */
     int indexIn[2]; /*!< Note range filter 0: lower, 1: upper limit, set by ModuleWidget */
@@ -81,6 +143,14 @@ class MidiWorker {
     int frameSize;                  /*!< Current size of a vector returned by MidiLfo::getNextFrame() */
     std::vector<Sample> outFrame;   /*!< Vector of Sample points holding the current frame for transfer */
     int returnLength; /*!< Holds the note length of the currently active step */
+    bool isRestoreMaster; /*!< Mirror of ParStore::isRestoreMaster, set by Engine */
+    std::atomic<int> dispFramePtr; /*!< Frame position published by prepareNextFrame() for the display */
+    std::atomic<int> dispPercent; /*!< Pattern progress in percent published by prepareNextFrame() for the display */
+    RtHistogram frameTime; /*!< Duration of prepareNextFrame() in ns, recorded by the engine */
+    RtHistogram eventTime; /*!< Duration of handleEvent() in ns, recorded by the engine */
+    SpscRing<RecordedPoint> recordRing; /*!< Points recorded by the realtime thread, written to the custom wave by mergeRecorded() */
+    uint64_t randomSeed; /*!< Seed of MidiWorker::prng, stored in the session file */
+    Prng prng;          /*!< Random generator of this module, reseeded with randomSeed by setNextTick() */
 
   public:
     MidiWorker();
@@ -91,6 +161,25 @@ class MidiWorker {
  * @param on Set to True to suppress data output to the Driver
  */
     virtual void setMuted(bool on);
+/**
+ * @brief sets MidiWorker::randomSeed and restarts the random sequence
+ * of the module from it.
+ *
+ * @param seed The new seed
+ */
+    void setRandomSeed(uint64_t seed);
+/**
+ * @brief writes the points recorded by the realtime thread to wave
+ *
+ * The custom wave of a module is only modified outside the realtime
+ * thread, which passes its recorded points through
+ * MidiWorker::recordRing instead. This is called by getData() before
+ * the wave is copied.
+ *
+ * @param wave The custom wave of the module
+ * @return True if points were written
+ */
+    bool mergeRecorded(CompactWave *wave);
 
 /*! @brief  sets MidiWorker::deferChanges, which will cause a
  * parameter changes only at pattern end.
@@ -111,6 +200,16 @@ class MidiWorker {
  * @return True if inEv is in not the input range of the module (event is unmatched)
  */
     virtual bool handleEvent(MidiEvent inEv, int64_t tick, int keep_rel = 0) = 0;
+/**
+ * @brief  describes the input events handleEvent() currently acts on.
+ *
+ * It is called by Engine outside the realtime thread to decide which
+ * modules an incoming event is passed to. It has to be consistent with
+ * the filters applied by handleEvent().
+ *
+ * @param route MidiRoute to fill
+ */
+    virtual void getRoute(MidiRoute *route) = 0;
 /**
  * @brief allows forcing an integer value within the
  * specified range (clip).
@@ -137,6 +236,27 @@ class MidiWorker {
  * aligned.
  */
     virtual void setNextTick(uint64_t tick) = 0;
+/**
+ * @brief  computes the next frame if this module is due at tick.
+ *
+ * It is called by Engine in the realtime thread for each echo. It does
+ * not touch any widget, the position of the frame is published in
+ * MidiWorker::dispFramePtr and MidiWorker::dispPercent, which the
+ * ModuleWidget reads when updating the display.
+ *
+ * @param echo_from_trig True if the echo was requested by a keyboard trigger
+ * @param syncTol Tolerance in ticks within which the module is due
+ * @param tick The current tick
+ * @param restoreAtEnd True if global restores happen at the end of the
+ * pattern of the restore master module
+ * @param restoreTick Set to the tick of the next global restore
+ * if this module is the restore master and its pattern ends
+ * @param restoreFlag True if a global restore is pending, cleared when
+ * restoreTick was set
+ * @return True if a new frame was computed and has to be sent out
+ */
+    bool prepareNextFrame(bool echo_from_trig, int syncTol, int64_t tick,
+            bool restoreAtEnd, int64_t *restoreTick, bool *restoreFlag);
 /**
  * @brief  Implemented in Arp only. Ensures continuity of the Arp's 
  * release function when the currentTick position jumps into
@@ -0,0 +1,1062 @@
+/*!
+ * @file modulecore.cpp
+ * @brief Implements the ModuleCore class and its Arp, LFO and Seq
+ * variants.
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#include <QByteArray>
+
+#include "modulecore.h"
+#include "arpwidget.h"
+#include "lfowidget.h"
+#include "seqwidget.h"
+
+
+ModuleCore::ModuleCore(MidiWorker *p_midiWorker, Prefs *p_prefs,
+        const QString& p_name, ParList *p_parList, QVector<MidiCC> *p_ccList)
+{
+    midiWorker = p_midiWorker;
+    prefs = p_prefs;
+    name = p_name;
+
+    ownsParList = (p_parList == NULL);
+    parList = (ownsParList) ? new ParList : p_parList;
+    ownsCcList = (p_ccList == NULL);
+    ccList = (ownsCcList) ? new QVector<MidiCC> : p_ccList;
+
+    dataUpdated = false;
+    needsUpdate = false;
+}
+
+ModuleCore::~ModuleCore()
+{
+    if (ownsParList) delete parList;
+    if (ownsCcList) delete ccList;
+}
+
+int ModuleCore::tableIndex(const int *table, int size, int value, int fallback)
+{
+    for (int l1 = 0; l1 < size; l1++) {
+        if (table[l1] == value) return l1;
+    }
+    return fallback;
+}
+
+void ModuleCore::readData(QXmlStreamReader& xml, const QString& qmaxVersion)
+{
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (xml.isEndElement())
+            break;
+
+        if (!xml.isStartElement())
+            continue;
+
+        const QStringRef tag = xml.name();
+        if ((tag == "midiControllers") || (tag == "globalStores")
+                || (tag == "seed") || (tag == "input") || (tag == "output"))
+            readCommonData(xml);
+        else if (!readModuleData(xml, qmaxVersion))
+            skipXmlElement(xml);
+    }
+    readDone(qmaxVersion);
+    updateWave();
+    midiWorker->needsGUIUpdate = false;
+    midiWorker->dataChanged = false;
+}
+
+void ModuleCore::readCommonData(QXmlStreamReader& xml)
+{
+    if (xml.name() == "midiControllers") {
+        MidiControl::readCcList(xml, ccList);
+    }
+    else if (xml.name() == "globalStores") {
+        parList->readData(xml);
+    }
+    else if (xml.name() == "seed") {
+        midiWorker->setRandomSeed(xml.readElementText().toULongLong());
+    }
+    else if (xml.name() == "input") {
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (xml.isEndElement())
+                break;
+
+            if (xml.name() == "enableNote")
+                midiWorker->enableNoteIn = xml.readElementText().toInt();
+            else if (xml.name() == "enableNoteOff")
+                midiWorker->enableNoteOff = xml.readElementText().toInt();
+            else if (xml.name() == "enableVelocity")
+                midiWorker->enableVelIn = xml.readElementText().toInt();
+            else if (xml.name() == "restartByKbd")
+                midiWorker->restartByKbd = xml.readElementText().toInt();
+            else if (xml.name() == "trigByKbd")
+                midiWorker->trigByKbd = xml.readElementText().toInt();
+            else if (xml.name() == "trigLegato")
+                midiWorker->trigLegato = xml.readElementText().toInt();
+            else if (xml.name() == "channel")
+                midiWorker->chIn = xml.readElementText().toInt();
+            else if (xml.name() == "indexMin")
+                midiWorker->indexIn[0] = xml.readElementText().toInt();
+            else if (xml.name() == "indexMax")
+                midiWorker->indexIn[1] = xml.readElementText().toInt();
+            else if (xml.name() == "rangeMin")
+                midiWorker->rangeIn[0] = xml.readElementText().toInt();
+            else if (xml.name() == "rangeMax")
+                midiWorker->rangeIn[1] = xml.readElementText().toInt();
+            else if (xml.name() == "ccnumber")
+                midiWorker->ccnumberIn = xml.readElementText().toInt();
+            else skipXmlElement(xml);
+        }
+    }
+    else if (xml.name() == "output") {
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (xml.isEndElement())
+                break;
+            if (xml.name() == "muted")
+                midiWorker->setMuted(xml.readElementText().toInt());
+            else if (xml.name() == "defer")
+                midiWorker->updateDeferChanges(xml.readElementText().toInt());
+            else if (xml.name() == "channel")
+                midiWorker->channelOut = xml.readElementText().toInt();
+            else if (xml.name() == "port")
+                midiWorker->portOut = xml.readElementText().toInt();
+            else if (xml.name() == "ccnumber")
+                midiWorker->ccnumber = xml.readElementText().toInt();
+            else skipXmlElement(xml);
+        }
+    }
+}
+
+void ModuleCore::writeData(QXmlStreamWriter& xml, bool inOutVisible)
+{
+    writeCommonData(xml, inOutVisible);
+    writeModuleData(xml);
+    xml.writeEndElement();
+}
+
+void ModuleCore::writeCommonData(QXmlStreamWriter& xml, bool inOutVisible)
+{
+    xml.writeStartElement(name.left(3));
+    xml.writeAttribute("name", name.mid(name.indexOf(':') + 1));
+    xml.writeAttribute("inOutVisible", QString::number(inOutVisible));
+
+        xml.writeStartElement("input");
+            if (!name.startsWith('A')) {
+            xml.writeTextElement("enableNoteOff", QString::number(
+                midiWorker->enableNoteOff));
+            }
+            if (name.startsWith('S')) {
+            xml.writeTextElement("enableNote", QString::number(
+                midiWorker->enableNoteIn));
+            xml.writeTextElement("enableVelocity", QString::number(
+                midiWorker->enableVelIn));
+            }
+            xml.writeTextElement("restartByKbd", QString::number(
+                midiWorker->restartByKbd));
+            xml.writeTextElement("trigByKbd", QString::number(
+                midiWorker->trigByKbd));
+            xml.writeTextElement("trigLegato", QString::number(
+                midiWorker->trigLegato));
+            xml.writeTextElement("channel", QString::number(
+                midiWorker->chIn));
+            xml.writeTextElement("indexMin", QString::number(
+                midiWorker->indexIn[0]));
+            xml.writeTextElement("indexMax", QString::number(
+                midiWorker->indexIn[1]));
+            xml.writeTextElement("rangeMin", QString::number(
+                midiWorker->rangeIn[0]));
+            xml.writeTextElement("rangeMax", QString::number(
+                midiWorker->rangeIn[1]));
+            if (name.startsWith('L')) {
+            xml.writeTextElement("ccnumber", QString::number(
+                midiWorker->ccnumberIn));
+            }
+        xml.writeEndElement();
+
+        xml.writeStartElement("output");
+            xml.writeTextElement("muted", QString::number(
+                midiWorker->isMutedDefer));
+            xml.writeTextElement("defer", QString::number(
+                midiWorker->deferChanges));
+            xml.writeTextElement("port", QString::number(
+                midiWorker->portOut));
+            xml.writeTextElement("channel", QString::number(
+                midiWorker->channelOut));
+            if (name.startsWith('L')) {
+            xml.writeTextElement("ccnumber", QString::number(
+                midiWorker->ccnumber));
+            }
+        xml.writeEndElement();
+
+        xml.writeTextElement("seed", QString::number(midiWorker->randomSeed));
+
+        MidiControl::writeCcList(xml, *ccList);
+
+        parList->writeData(xml);
+}
+
+void ModuleCore::writeWave(QXmlStreamWriter& xml, const CompactWave& wave,
+        int count, const QString& element)
+{
+    QByteArray tempArray;
+    int l1;
+
+    tempArray.clear();
+    l1 = 0;
+    while (l1 < count) {
+        tempArray.append(wave.isMuted(l1));
+        l1++;
+    }
+    xml.writeStartElement("muteMask");
+        xml.writeTextElement("data", tempArray.toHex());
+    xml.writeEndElement();
+
+    tempArray.clear();
+    l1 = 0;
+    while (l1 < count) {
+        tempArray.append(wave.value(l1));
+        l1++;
+    }
+    xml.writeStartElement(element);
+        xml.writeTextElement("data", tempArray.toHex());
+    /* the caller adds its own elements and closes the element */
+}
+
+void ModuleCore::readWave(QXmlStreamReader& xml, CompactWave *wave, bool isMask)
+{
+    QByteArray tmpArray =
+            QByteArray::fromHex(xml.readElementText().toLatin1());
+
+    /* the mute mask is written first and sets the size */
+    if (isMask) {
+        wave->resize(tmpArray.count());
+        for (int l1 = 0; l1 < tmpArray.count(); l1++) {
+            wave->setMuted(l1, tmpArray.at(l1));
+        }
+    }
+    else {
+        for (int l1 = 0; (l1 < tmpArray.count())
+                && (l1 < wave->count()); l1++) {
+            wave->setValue(l1, tmpArray.at(l1));
+        }
+    }
+}
+
+void ModuleCore::skipXmlElement(QXmlStreamReader& xml)
+{
+    if (xml.isStartElement()) {
+        qWarning("Unknown Element in XML File: %s",qPrintable(xml.name().toString()));
+        while (!xml.atEnd()) {
+            xml.readNext();
+
+            if (xml.isEndElement())
+                break;
+
+            if (xml.isStartElement()) {
+                skipXmlElement(xml);
+            }
+        }
+    }
+}
+
+void ModuleCore::storeParams(int ix, bool empty)
+{
+    ParList::TempStore& temp = parList->temp;
+
+    temp.empty = empty;
+    temp.muteOut = midiWorker->isMutedDefer;
+    temp.chIn = midiWorker->chIn;
+    temp.channelOut = midiWorker->channelOut;
+    temp.portOut = midiWorker->portOut;
+    temp.indexIn0 = midiWorker->indexIn[0];
+    temp.indexIn1 = midiWorker->indexIn[1];
+    temp.rangeIn0 = midiWorker->rangeIn[0];
+    temp.rangeIn1 = midiWorker->rangeIn[1];
+    doStoreParams();
+
+    parList->tempToList(ix);
+}
+
+void ModuleCore::restoreParams(int ix)
+{
+    doRestoreParams(ix);
+    if (!parList->onlyPatternList.at(ix)) {
+        const ParList::TempStore& loc = parList->list.at(ix);
+        if (prefs->storeMuteState) midiWorker->setMuted(loc.muteOut);
+        midiWorker->indexIn[0] = loc.indexIn0;
+        midiWorker->indexIn[1] = loc.indexIn1;
+        midiWorker->rangeIn[0] = loc.rangeIn0;
+        midiWorker->rangeIn[1] = loc.rangeIn1;
+        midiWorker->chIn = loc.chIn;
+        midiWorker->channelOut = loc.channelOut;
+        midiWorker->portOut = loc.portOut;
+        midiWorker->currentRepetition = 0;
+    }
+    needsUpdate = true;
+}
+
+bool ModuleCore::repetitionsFinished()
+{
+    return (midiWorker->currentRepetition == 0);
+}
+
+bool ModuleCore::update()
+{
+    bool changed = false;
+
+    const int restored = parList->updateRestore(midiWorker->getFramePtr(),
+            midiWorker->nPoints, repetitionsFinished(), midiWorker->reverse);
+    if (restored >= 0) restoreParams(restored);
+
+    if (parList->nRepList.count() > 0) {
+        const int nrep = parList->nRepList.at(parList->activeStore);
+        if (nrep != midiWorker->nRepetitions) {
+            midiWorker->nRepetitions = nrep;
+            changed = true;
+        }
+    }
+
+    if (midiWorker->dataChanged) {
+        midiWorker->dataChanged = false;
+        updateWave();
+    }
+
+    if (needsUpdate || midiWorker->needsGUIUpdate) {
+        applyControllerChanges();
+        needsUpdate = false;
+        midiWorker->needsGUIUpdate = false;
+        changed = true;
+    }
+    return changed;
+}
+
+void ModuleCore::handleController(int controlID, int min, int max, int value)
+{
+    int sval = min + ((double)value * (max - min) / 127);
+
+    switch (controlID) {
+        case ModuleWidget::MUTE_BUTTON: if (min == max) {
+                    if (value == max) {
+                        midiWorker->setMuted(!midiWorker->isMutedDefer);
+                    }
+                }
+                else {
+                    if (value == max) {
+                        midiWorker->setMuted(false);
+                    }
+                    if (value == min) {
+                        midiWorker->setMuted(true);
+                    }
+                }
+        break;
+
+        case ModuleWidget::PARAM_RESTORE:
+                if ((sval < parList->list.count())
+                        && (sval != parList->activeStore)
+                        && (sval != parList->currentRequest)) {
+                    parList->requestDispState(sval, 2);
+                    parList->restoreRequest = sval;
+                    parList->restoreRunOnce = (parList->jumpToList.at(sval) > -2);
+                }
+                else return;
+        break;
+
+        default:
+                handleModuleController(controlID, sval, min, max, value);
+        break;
+    }
+    needsUpdate = true;
+}
+
+/* Arp */
+
+ArpCore::ArpCore(MidiArp *p_midiArp, Prefs *p_prefs, const QString& p_name,
+        const QStringList *p_patternPresets, ParList *p_parList,
+        QVector<MidiCC> *p_ccList)
+        : ModuleCore(p_midiArp, p_prefs, p_name, p_parList, p_ccList)
+{
+    midiArp = p_midiArp;
+    patternPresets = p_patternPresets;
+    presetIndex = 0;
+    pendingPresetIndex = -1;
+}
+
+bool ArpCore::readModuleData(QXmlStreamReader& xml, const QString& qmaxVersion)
+{
+    (void)qmaxVersion;
+
+    if (xml.name() == "pattern") {
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (xml.isEndElement())
+                break;
+            if (xml.name() == "pattern") {
+                midiArp->updatePattern(xml.readElementText().toStdString());
+                presetIndex = 0;
+            }
+            else if (xml.name() == "repeatMode")
+                midiArp->repeatPatternThroughChord = xml.readElementText().toInt();
+            else if (xml.name() == "octaveMode")
+                midiArp->updateOctaveMode(xml.readElementText().toInt());
+            else if (xml.name() == "octaveLow")
+                midiArp->octLow = xml.readElementText().toInt();
+            else if (xml.name() == "octaveHigh")
+                midiArp->octHigh = xml.readElementText().toInt();
+            else if (xml.name() == "latchMode")
+                midiArp->setLatchMode(xml.readElementText().toInt());
+            else skipXmlElement(xml);
+        }
+    }
+    else if (xml.name() == "random") {
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (xml.isEndElement())
+                break;
+            if (xml.name() == "tick")
+                midiArp->updateRandomTickAmp(xml.readElementText().toInt());
+            else if (xml.name() == "velocity")
+                midiArp->updateRandomVelocityAmp(xml.readElementText().toInt());
+            else if (xml.name() == "length")
+                midiArp->updateRandomLengthAmp(xml.readElementText().toInt());
+            else skipXmlElement(xml);
+        }
+    }
+    else if (xml.name() == "envelope") {
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (xml.isEndElement())
+                break;
+            if (xml.name() == "attack")
+                midiArp->updateAttackTime(xml.readElementText().toInt());
+            else if (xml.name() == "release")
+                midiArp->updateReleaseTime(xml.readElementText().toInt());
+            else skipXmlElement(xml);
+        }
+    }
+    else return false;
+
+    return true;
+}
+
+void ArpCore::writeModuleData(QXmlStreamWriter& xml)
+{
+        xml.writeStartElement("pattern");
+            xml.writeTextElement("pattern", QString::fromStdString(midiArp->pattern));
+            xml.writeTextElement("repeatMode", QString::number(
+                midiArp->repeatPatternThroughChord));
+            xml.writeTextElement("octaveMode", QString::number(
+                midiArp->octMode));
+            xml.writeTextElement("octaveLow", QString::number(
+                midiArp->octLow));
+            xml.writeTextElement("octaveHigh", QString::number(
+                midiArp->octHigh));
+            xml.writeTextElement("latchMode", QString::number(
+                midiArp->latch_mode));
+        xml.writeEndElement();
+
+        xml.writeStartElement("random");
+            xml.writeTextElement("tick", QString::number(
+                midiArp->randomTickAmp));
+            xml.writeTextElement("velocity", QString::number(
+                midiArp->randomVelocityAmp));
+            xml.writeTextElement("length", QString::number(
+                midiArp->randomLengthAmp));
+        xml.writeEndElement();
+
+        xml.writeStartElement("envelope");
+            xml.writeTextElement("attack", QString::number(
+                (int)midiArp->attack_time));
+            xml.writeTextElement("release", QString::number(
+                (int)midiArp->release_time));
+        xml.writeEndElement();
+}
+
+void ArpCore::doStoreParams()
+{
+    parList->temp.attack = (int)midiArp->attack_time;
+    parList->temp.release = (int)midiArp->release_time;
+    parList->temp.rndTick = midiArp->randomTickAmp;
+    parList->temp.rndLen = midiArp->randomLengthAmp;
+    parList->temp.rndVel = midiArp->randomVelocityAmp;
+    parList->temp.pattern = QString::fromStdString(midiArp->pattern);
+    parList->temp.repeatMode = midiArp->repeatPatternThroughChord;
+}
+
+void ArpCore::doRestoreParams(int ix)
+{
+    const ParList::TempStore& loc = parList->list.at(ix);
+
+    midiArp->applyPendingParChanges();
+    if (loc.empty) return;
+    midiArp->updatePattern(loc.pattern.toStdString());
+    presetIndex = 0;
+    midiArp->repeatPatternThroughChord = loc.repeatMode;
+    if (!parList->onlyPatternList.at(ix)) {
+        midiArp->updateAttackTime(loc.attack);
+        midiArp->updateReleaseTime(loc.release);
+        midiArp->updateRandomTickAmp(loc.rndTick);
+        midiArp->updateRandomLengthAmp(loc.rndLen);
+        midiArp->updateRandomVelocityAmp(loc.rndVel);
+    }
+    midiArp->advancePatternIndex(true);
+}
+
+void ArpCore::handleModuleController(int controlID, int sval,
+        int min, int max, int value)
+{
+    (void)min; (void)max; (void)value;
+
+    if (controlID == ArpWidget::ARP_PRESET_SWITCH) pendingPresetIndex = sval;
+}
+
+void ArpCore::applyControllerChanges()
+{
+    /* preset 0 is the entry for a custom pattern */
+    if ((pendingPresetIndex > 0) && (pendingPresetIndex < patternPresets->count())) {
+        midiArp->updatePattern(patternPresets->at(pendingPresetIndex).toStdString());
+        presetIndex = pendingPresetIndex;
+    }
+    pendingPresetIndex = -1;
+}
+
+/* LFO */
+
+LfoCore::LfoCore(MidiLfo *p_midiLfo, Prefs *p_prefs, const QString& p_name,
+        ParList *p_parList, QVector<MidiCC> *p_ccList)
+        : ModuleCore(p_midiLfo, p_prefs, p_name, p_parList, p_ccList)
+{
+    midiLfo = p_midiLfo;
+    waveFormIndex = -1;
+    freqIndex = -1;
+    resIndex = -1;
+    sizeIndex = -1;
+    thinIndex = 0;
+    maxRateIndex = 0;
+}
+
+bool LfoCore::readModuleData(QXmlStreamReader& xml, const QString& qmaxVersion)
+{
+    int tmp;
+
+    if (xml.name() == "waveParams") {
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (xml.isEndElement())
+                break;
+            if (xml.name() == "loopmode")
+                midiLfo->updateLoop(xml.readElementText().toInt());
+            else if (xml.name() == "waveform")
+                waveFormIndex = xml.readElementText().toInt();
+            else if (xml.name() == "frequency")
+                freqIndex = xml.readElementText().toInt();
+            else if (xml.name() == "resolution") {
+                tmp = xml.readElementText().toInt();
+                if (qmaxVersion == "" && tmp < 9) {
+                    tmp = mapOldLfoRes[tmp];
+                }
+                resIndex = tmp;
+            }
+            else if (xml.name() == "size") {
+                tmp = xml.readElementText().toInt();
+                if (qmaxVersion == "" && tmp < 12) {
+                    tmp = mapOldLfoSize[tmp];
+                }
+                sizeIndex = tmp;
+            }
+            else if (xml.name() == "amplitude")
+                midiLfo->updateAmplitude(xml.readElementText().toInt());
+            else if (xml.name() == "offset")
+                midiLfo->updateOffset(xml.readElementText().toInt());
+            else if (xml.name() == "phase")
+                midiLfo->updatePhase(xml.readElementText().toInt());
+            else if (xml.name() == "thin")
+                thinIndex = xml.readElementText().toInt();
+            else if (xml.name() == "maxrate")
+                maxRateIndex = xml.readElementText().toInt();
+            else skipXmlElement(xml);
+        }
+    }
+    else if (xml.name() == "muteMask") {
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (xml.isEndElement())
+                break;
+            if (xml.isStartElement() && (xml.name() == "data")) {
+                readWave(xml, &midiLfo->customWave, true);
+                midiLfo->maxNPoints = midiLfo->customWave.count();
+            }
+            else skipXmlElement(xml);
+        }
+    }
+    else if (xml.name() == "customWave") {
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (xml.isEndElement())
+                break;
+            if (xml.isStartElement() && (xml.name() == "data")) {
+                readWave(xml, &midiLfo->customWave, false);
+                midiLfo->resizeAll();
+            }
+            else skipXmlElement(xml);
+        }
+    }
+    else return false;
+
+    return true;
+}
+
+void LfoCore::readDone(const QString& qmaxVersion)
+{
+    // Compatibility with earlier versions //
+    for (int l1 = 0; l1 < parList->list.count(); l1++) {
+        if (qmaxVersion == "" && parList->list[l1].res < 5) {
+            parList->list[l1].res = mapOldLfoRes[parList->list[l1].res];
+        }
+        if (qmaxVersion == "" && parList->list[l1].size < 10) {
+            parList->list[l1].size = mapOldLfoSize[parList->list[l1].size];
+        }
+    }
+    if ((uint64_t)thinIndex >= sizeof(lfoThinValues)/sizeof(lfoThinValues[0]))
+        thinIndex = 0;
+    if ((uint64_t)maxRateIndex >= sizeof(lfoMaxRateValues)/sizeof(lfoMaxRateValues[0]))
+        maxRateIndex = 0;
+    midiLfo->updateThinning(lfoThinValues[thinIndex], lfoMaxRateValues[maxRateIndex]);
+    applyControllerChanges();
+    if (midiLfo->waveFormIndex == 5) midiLfo->newCustomOffset();
+}
+
+void LfoCore::writeModuleData(QXmlStreamWriter& xml)
+{
+    const int maxRate = (midiLfo->thinMinTicks) ? TPQN / midiLfo->thinMinTicks : 0;
+
+        xml.writeStartElement("waveParams");
+            xml.writeTextElement("loopmode", QString::number(
+                midiLfo->curLoopMode));
+            xml.writeTextElement("waveform", QString::number(
+                midiLfo->waveFormIndex));
+            xml.writeTextElement("frequency", QString::number(
+                tableIndex(lfoFreqValues, 14, midiLfo->freq, 3)));
+            xml.writeTextElement("resolution", QString::number(
+                tableIndex(lfoResValues, 13, midiLfo->res, 3)));
+            xml.writeTextElement("size", QString::number(
+                tableIndex(lfoSizeValues, 20, midiLfo->size, 0)));
+            xml.writeTextElement("amplitude", QString::number(
+                midiLfo->amp));
+            xml.writeTextElement("offset", QString::number(
+                midiLfo->offs));
+            xml.writeTextElement("phase", QString::number(
+                midiLfo->phase));
+            xml.writeTextElement("thin", QString::number(
+                tableIndex(lfoThinValues, 6, midiLfo->thinDeadband, 0)));
+            xml.writeTextElement("maxrate", QString::number(
+                tableIndex(lfoMaxRateValues, 8, maxRate, 0)));
+        xml.writeEndElement();
+
+        writeWave(xml, midiLfo->customWave, midiLfo->maxNPoints, "customWave");
+        xml.writeEndElement();
+}
+
+void LfoCore::updateWave()
+{
+    midiLfo->getData(&data);
+    dataUpdated = true;
+}
+
+void LfoCore::doStoreParams()
+{
+    ParList::TempStore& temp = parList->temp;
+
+    temp.ccnumberIn = midiLfo->ccnumberIn;
+    temp.ccnumber = midiLfo->ccnumber;
+    temp.res = tableIndex(lfoResValues, 13, midiLfo->res, 3);
+    temp.size = tableIndex(lfoSizeValues, 20, midiLfo->size, 0);
+    temp.loopMode = midiLfo->curLoopMode;
+    temp.freq = tableIndex(lfoFreqValues, 14, midiLfo->freq, 3);
+    temp.ampl = midiLfo->amp;
+    temp.offs = midiLfo->offs;
+    temp.phase = midiLfo->phase;
+    temp.waveForm = midiLfo->waveFormIndex;
+    temp.wave = midiLfo->customWave;
+}
+
+void LfoCore::doRestoreParams(int ix)
+{
+    const ParList::TempStore& loc = parList->list.at(ix);
+
+    midiLfo->applyPendingParChanges();
+    if (loc.empty) return;
+    midiLfo->customWave.copyFrom(loc.wave);
+    sizeIndex = loc.size;
+    resIndex = loc.res;
+    freqIndex = loc.freq;
+    waveFormIndex = loc.waveForm;
+    midiLfo->updateLoop(loc.loopMode);
+    if (!parList->onlyPatternList.at(ix)) {
+        midiLfo->updateAmplitude(loc.ampl);
+        midiLfo->updateOffset(loc.offs);
+        midiLfo->updatePhase(loc.phase);
+        midiLfo->ccnumberIn = loc.ccnumberIn;
+        midiLfo->ccnumber = loc.ccnumber;
+    }
+    applyControllerChanges();
+    int frame = ( midiLfo->reverse ? midiLfo->nPoints : 0);
+    midiLfo->setFramePtr(frame);
+}
+
+void LfoCore::handleModuleController(int controlID, int sval,
+        int min, int max, int value)
+{
+    bool m = false;
+    switch (controlID) {
+        case LfoWidget::LFO_AMPLITUDE:
+                midiLfo->updateAmplitude(sval);
+        break;
+
+        case LfoWidget::LFO_OFFSET:
+                midiLfo->updateOffset(sval);
+        break;
+        case LfoWidget::LFO_WAVEFORM:
+                if (sval < 6) waveFormIndex = sval;
+        break;
+        case LfoWidget::LFO_FREQUENCY:
+                if ((uint64_t)sval < sizeof(lfoFreqValues)/sizeof(lfoFreqValues[0])) freqIndex = sval;
+        break;
+        case LfoWidget::LFO_RECORD: if (min == max) {
+                    if (value == max) {
+                        m = midiLfo->recordMode;
+                        midiLfo->setRecordMode(!m);
+                    }
+                }
+                else {
+                    if (value == max) {
+                        midiLfo->setRecordMode(true);
+                    }
+                    if (value == min) {
+                        midiLfo->setRecordMode(false);
+                    }
+                }
+        break;
+        case LfoWidget::LFO_RESOLUTION:
+                if ((uint64_t)sval < sizeof(lfoResValues)/sizeof(lfoResValues[0])) resIndex = sval;
+        break;
+        case LfoWidget::LFO_SIZE:
+                if ((uint64_t)sval < sizeof(lfoSizeValues)/sizeof(lfoSizeValues[0])) sizeIndex = sval;
+        break;
+        case LfoWidget::LFO_LOOPMODE:
+                if (sval < 6) midiLfo->curLoopMode = sval;
+        break;
+        case LfoWidget::LFO_PHASE:
+                midiLfo->updatePhase(sval);
+        break;
+
+        default:
+        break;
+    }
+}
+
+void LfoCore::applyControllerChanges()
+{
+    if ((uint64_t)resIndex < sizeof(lfoResValues)/sizeof(lfoResValues[0])
+            && (midiLfo->res != lfoResValues[resIndex])) {
+        midiLfo->updateResolution(lfoResValues[resIndex]);
+        if (midiLfo->waveFormIndex == 5) midiLfo->newCustomOffset();
+    }
+    if ((uint64_t)sizeIndex < sizeof(lfoSizeValues)/sizeof(lfoSizeValues[0])
+            && (midiLfo->size != lfoSizeValues[sizeIndex])) {
+        midiLfo->updateSize(lfoSizeValues[sizeIndex]);
+        if (midiLfo->waveFormIndex == 5) midiLfo->newCustomOffset();
+    }
+    if ((uint64_t)freqIndex < sizeof(lfoFreqValues)/sizeof(lfoFreqValues[0]))
+        midiLfo->updateFrequency(lfoFreqValues[freqIndex]);
+    if ((waveFormIndex >= 0) && (waveFormIndex <= 5)
+            && (waveFormIndex != midiLfo->waveFormIndex)) {
+        midiLfo->updateWaveForm(waveFormIndex);
+        if (waveFormIndex == 5) midiLfo->newCustomOffset();
+    }
+    /* the GUI may change the worker directly after this */
+    waveFormIndex = -1;
+    freqIndex = -1;
+    resIndex = -1;
+    sizeIndex = -1;
+    updateWave();
+}
+
+bool LfoCore::repetitionsFinished()
+{
+    if (midiLfo->reverse)
+        return (midiLfo->currentRepetition >= midiLfo->nRepetitions - 1);
+    return (midiLfo->currentRepetition == 0);
+}
+
+/* Seq */
+
+SeqCore::SeqCore(MidiSeq *p_midiSeq, Prefs *p_prefs, const QString& p_name,
+        ParList *p_parList, QVector<MidiCC> *p_ccList)
+        : ModuleCore(p_midiSeq, p_prefs, p_name, p_parList, p_ccList)
+{
+    midiSeq = p_midiSeq;
+    resIndex = -1;
+    sizeIndex = -1;
+}
+
+bool SeqCore::readModuleData(QXmlStreamReader& xml, const QString& qmaxVersion)
+{
+    int tmp;
+
+    if (xml.name() == "display") {
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (xml.isEndElement())
+                break;
+            if (xml.name() == "vertical")
+                midiSeq->updateDispVert(xml.readElementText().toInt());
+            else skipXmlElement(xml);
+        }
+    }
+    else if (xml.name() == "seqParams") {
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (xml.isEndElement())
+                break;
+            if (xml.name() == "loopmode")
+                midiSeq->updateLoop(xml.readElementText().toInt());
+            else if (xml.name() == "resolution") {
+                tmp = xml.readElementText().toInt();
+                if (qmaxVersion == "" && tmp < 5) {
+                    tmp = mapOldSeqRes[tmp];
+                }
+                resIndex = tmp;
+            }
+            else if (xml.name() == "size") {
+                tmp = xml.readElementText().toInt();
+                if (qmaxVersion == "" && tmp < 10) {
+                    tmp = mapOldSeqSize[tmp];
+                }
+                sizeIndex = tmp;
+            }
+            else if (xml.name() == "velocity")
+                midiSeq->updateVelocity(xml.readElementText().toInt());
+            else if (xml.name() == "noteLength")
+                midiSeq->updateNoteLength(sliderToTickLen(xml.readElementText().toInt()));
+            else if (xml.name() == "transp")
+                midiSeq->updateTranspose(xml.readElementText().toInt());
+            else skipXmlElement(xml);
+        }
+    }
+    else if (xml.name() == "muteMask") {
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (xml.isEndElement())
+                break;
+            if (xml.isStartElement() && (xml.name() == "data")) {
+                readWave(xml, &midiSeq->customWave, true);
+                midiSeq->maxNPoints = midiSeq->customWave.count();
+            }
+            else skipXmlElement(xml);
+        }
+    }
+    else if (xml.name() == "sequence") {
+        while (!xml.atEnd()) {
+            xml.readNext();
+            if (xml.isEndElement())
+                break;
+            if (xml.isStartElement() && (xml.name() == "data")) {
+                readWave(xml, &midiSeq->customWave, false);
+                midiSeq->resizeAll();
+            }
+            else if (xml.name() == "loopmarker")
+                midiSeq->setLoopMarker(xml.readElementText().toInt());
+            else skipXmlElement(xml);
+        }
+    }
+    else return false;
+
+    return true;
+}
+
+void SeqCore::readDone(const QString& qmaxVersion)
+{
+    // Compatibility with earlier versions //
+    for (int l1 = 0; l1 < parList->list.count(); l1++) {
+        if (qmaxVersion == "" && parList->list[l1].res < 5) {
+            parList->list[l1].res = mapOldSeqRes[parList->list[l1].res];
+        }
+        if (qmaxVersion == "" && parList->list[l1].size < 10) {
+            parList->list[l1].size = mapOldSeqSize[parList->list[l1].size];
+        }
+    }
+    applyControllerChanges();
+}
+
+void SeqCore::writeModuleData(QXmlStreamWriter& xml)
+{
+        xml.writeStartElement("display");
+            xml.writeTextElement("vertical", QString::number(
+                midiSeq->dispVertIndex));
+        xml.writeEndElement();
+
+        xml.writeStartElement("seqParams");
+            xml.writeTextElement("loopmode", QString::number(
+                midiSeq->curLoopMode));
+            xml.writeTextElement("resolution", QString::number(
+                tableIndex(seqResValues, 13, midiSeq->res, 3)));
+            xml.writeTextElement("size", QString::number(
+                tableIndex(seqSizeValues, 20, midiSeq->size, 3)));
+            xml.writeTextElement("velocity", QString::number(
+                midiSeq->velDefer));
+            xml.writeTextElement("noteLength", QString::number(
+                tickLenToSlider(midiSeq->notelengthDefer)));
+            xml.writeTextElement("transp", QString::number(
+                midiSeq->transpDefer));
+        xml.writeEndElement();
+
+        writeWave(xml, midiSeq->customWave, midiSeq->maxNPoints, "sequence");
+            xml.writeTextElement("loopmarker", QString::number(
+                midiSeq->loopMarker));
+        xml.writeEndElement();
+}
+
+void SeqCore::updateWave()
+{
+    midiSeq->getData(&data);
+    dataUpdated = true;
+}
+
+void SeqCore::doStoreParams()
+{
+    ParList::TempStore& temp = parList->temp;
+
+    temp.res = tableIndex(seqResValues, 13, midiSeq->res, 3);
+    temp.size = tableIndex(seqSizeValues, 20, midiSeq->size, 3);
+    temp.loopMode = midiSeq->curLoopMode;
+    temp.notelen = tickLenToSlider(midiSeq->notelengthDefer);
+    temp.transp = midiSeq->transpDefer;
+    temp.vel = midiSeq->velDefer;
+    temp.dispVertIndex = midiSeq->dispVertIndex;
+    temp.wave = midiSeq->customWave;
+    temp.loopMarker = midiSeq->loopMarker;
+}
+
+void SeqCore::doRestoreParams(int ix)
+{
+    const ParList::TempStore& loc = parList->list.at(ix);
+
+    midiSeq->applyPendingParChanges();
+    if (loc.empty) return;
+    midiSeq->customWave.copyFrom(loc.wave);
+    sizeIndex = loc.size;
+    resIndex = loc.res;
+    applyControllerChanges();
+    midiSeq->setLoopMarker(loc.loopMarker);
+
+    if (!parList->onlyPatternList.at(ix)) {
+        midiSeq->notelength = sliderToTickLen(loc.notelen);
+        midiSeq->notelengthDefer = midiSeq->notelength;
+        midiSeq->transp = loc.transp;
+        midiSeq->transpDefer = loc.transp;
+        midiSeq->vel = loc.vel;
+        midiSeq->velDefer = loc.vel;
+        midiSeq->updateDispVert(loc.dispVertIndex);
+    }
+    midiSeq->updateLoop(loc.loopMode);
+    updateWave();
+    midiSeq->setFramePtr(0);
+}
+
+void SeqCore::handleModuleController(int controlID, int sval,
+        int min, int max, int value)
+{
+    bool m = false;
+    switch (controlID) {
+        case SeqWidget::SEQ_VELOCITY:
+                midiSeq->updateVelocity(sval);
+        break;
+
+        case SeqWidget::SEQ_NOTE_LENGTH:
+                midiSeq->updateNoteLength(sliderToTickLen(sval));
+        break;
+
+        case SeqWidget::SEQ_RECORD: if (min == max) {
+                    if (value == max) {
+                        m = midiSeq->recordMode;
+                        midiSeq->setRecordMode(!m);
+                    }
+                }
+                else {
+                    if (value == max) {
+                        midiSeq->setRecordMode(true);
+                    }
+                    if (value == min) {
+                        midiSeq->setRecordMode(false);
+                    }
+                }
+        break;
+        case SeqWidget::SEQ_RESOLUTION:
+                if ((uint64_t)sval < sizeof(seqResValues)/sizeof(seqResValues[0])) resIndex = sval;
+        break;
+        case SeqWidget::SEQ_SIZE:
+                if ((uint64_t)sval < sizeof(seqSizeValues)/sizeof(seqSizeValues[0])) sizeIndex = sval;
+        break;
+        case SeqWidget::SEQ_LOOP_MODE:
+                if (sval < 6) midiSeq->curLoopMode = sval;
+        break;
+        case SeqWidget::SEQ_TRANSPOSE:
+                midiSeq->updateTranspose(sval - 36);
+        break;
+        case SeqWidget::SEQ_CHANNEL_OUT:
+                if (sval < 16) midiSeq->channelOut = sval;
+        break;
+
+        default:
+        break;
+    }
+}
+
+void SeqCore::applyControllerChanges()
+{
+    bool changed = false;
+
+    if ((uint64_t)resIndex < sizeof(seqResValues)/sizeof(seqResValues[0])
+            && (midiSeq->res != seqResValues[resIndex])) {
+        midiSeq->res = seqResValues[resIndex];
+        changed = true;
+    }
+    if ((uint64_t)sizeIndex < sizeof(seqSizeValues)/sizeof(seqSizeValues[0])
+            && (midiSeq->size != seqSizeValues[sizeIndex])) {
+        midiSeq->size = seqSizeValues[sizeIndex];
+        changed = true;
+    }
+    /* the GUI may change the worker directly after this */
+    resIndex = -1;
+    sizeIndex = -1;
+    if (changed) midiSeq->resizeAll();
+    updateWave();
+}
+
+bool SeqCore::repetitionsFinished()
+{
+    if (midiSeq->reverse)
+        return (midiSeq->currentRepetition >= midiSeq->nRepetitions - 1);
+    return (midiSeq->currentRepetition == 0);
+}
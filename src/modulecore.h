@@ -0,0 +1,275 @@
+/*!
+ * @file modulecore.h
+ * @brief Member definitions for the ModuleCore class and its
+ * Arp, LFO and Seq variants.
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#ifndef MODULECORE_H
+#define MODULECORE_H
+
+#include <vector>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+#include "midiarp.h"
+#include "midicontrol.h"
+#include "midilfo.h"
+#include "midiseq.h"
+#include "parlist.h"
+#include "prefs.h"
+
+/*!
+ * @brief Widget-free part of a module
+ *
+ * ModuleCore reads and writes the module section of a .qmax file
+ * directly from and to its MidiWorker, stores and restores the
+ * parameter storage locations of the module and handles its MIDI
+ * controller bindings. The realtime thread only calls
+ * handleController(), all other functions are called from the main
+ * thread.
+ *
+ * The ModuleWidget of the GUI creates a ModuleCore with its ParStore
+ * and the MidiControl::ccList of the module and calls update() from
+ * ModuleWidget::updateDisplay(), after which it only copies the worker
+ * values into its widgets. When QMidiArp runs with the --headless
+ * option, the ModuleCore keeps its own ParList and bindings and
+ * EngineCore::update() calls update() directly.
+ */
+class ModuleCore : public MidiCCHandler
+{
+  public:
+/*!
+ * @param p_midiWorker MidiWorker of the module, not deleted by ModuleCore
+ * @param p_prefs Application preferences
+ * @param p_name Name of the module preceded by its type (Arp: , etc...)
+ * @param p_parList Storage locations of the module, a ParList owned by
+ * ModuleCore is created if NULL
+ * @param p_ccList Controller bindings of the module, a list owned by
+ * ModuleCore is created if NULL
+ */
+    ModuleCore(MidiWorker *p_midiWorker, Prefs *p_prefs,
+            const QString& p_name, ParList *p_parList = NULL,
+            QVector<MidiCC> *p_ccList = NULL);
+    virtual ~ModuleCore();
+
+    QString name;
+    MidiWorker *midiWorker;
+    Prefs *prefs;
+    ParList *parList;           /**< Parameter storage locations */
+    QVector<MidiCC> *ccList;    /**< MIDI controller bindings of the module */
+    std::vector<Sample> data;   /**< Wave or sequence read from the worker by updateWave() */
+    bool dataUpdated;           /**< Set by updateWave(), cleared by the display */
+
+/*!
+* @brief reads all parameters of the module from the module element
+* of a .qmax file
+*
+* @param xml QXmlStreamReader positioned at the module element
+* @param qmaxVersion The format version of the file
+*/
+    void readData(QXmlStreamReader& xml, const QString& qmaxVersion);
+/*!
+* @brief writes the module element with all parameters of the module
+*
+* @param xml QXmlStreamWriter to write to
+* @param inOutVisible Visibility of the in-out settings stored as attribute
+*/
+    void writeData(QXmlStreamWriter& xml, bool inOutVisible = true);
+/*!
+* @brief stores the current module parameters in the location ix
+*
+* @param ix Location index, the parameters are appended if ix is
+* beyond the last location
+* @param empty Signal an empty location
+*/
+    void storeParams(int ix, bool empty = false);
+/*!
+* @brief restores all module parameters from the storage location ix
+*/
+    void restoreParams(int ix);
+/*!
+* @brief is called periodically outside the realtime thread
+*
+* It does the pending and automatic restores of the storage locations,
+* applies the parameter changes received by handleController() and
+* reads the wave of the worker into ModuleCore::data when it changed.
+* The wave is always read, also while the module is hidden, since
+* updateWave() publishes it to the realtime thread. Only the drawing
+* is left to the shown widgets.
+*
+* @return True if worker parameters changed which are shown in the GUI
+*/
+    bool update();
+/*!
+* @brief reads the wave or sequence of the worker into ModuleCore::data
+* and publishes it to the realtime thread
+*/
+    virtual void updateWave() { }
+    void handleController(int controlID, int min, int max, int value) override;
+/*!
+* @brief returns the index of value in the table of the given size,
+* used for the combo box indices stored in the session file and shown
+* in the GUI
+*
+* @return The index, fallback if value is not in the table
+*/
+    static int tableIndex(const int *table, int size, int value, int fallback);
+
+  protected:
+    bool needsUpdate;           /**< Set by handleController() for update() */
+    bool ownsParList;
+    bool ownsCcList;
+
+/*!
+* @brief reads one element of the module section that is specific
+* to the module type
+*
+* @return False if the element is unknown
+*/
+    virtual bool readModuleData(QXmlStreamReader& xml,
+            const QString& qmaxVersion) = 0;
+/*! @brief finishes reading the module section, called once at its end */
+    virtual void readDone(const QString& qmaxVersion) { (void)qmaxVersion; }
+/*! @brief writes the elements of the module section specific to the module type */
+    virtual void writeModuleData(QXmlStreamWriter& xml) = 0;
+/*! @brief copies the module specific parameters to ParList::temp */
+    virtual void doStoreParams() = 0;
+/*! @brief restores the module specific parameters from location ix */
+    virtual void doRestoreParams(int ix) = 0;
+/*! @brief applies the changes made by handleController() */
+    virtual void applyControllerChanges() { }
+/*!
+* @brief handles the controllers specific to the module type
+*
+* Called by handleController() for all IDs it does not handle itself.
+*/
+    virtual void handleModuleController(int controlID, int sval,
+            int min, int max, int value)
+    {
+        (void)controlID; (void)sval; (void)min; (void)max; (void)value;
+    }
+    virtual bool repetitionsFinished();
+
+    void readCommonData(QXmlStreamReader& xml);
+    void writeCommonData(QXmlStreamWriter& xml, bool inOutVisible);
+    void writeWave(QXmlStreamWriter& xml, const CompactWave& wave,
+            int count, const QString& element);
+    void readWave(QXmlStreamReader& xml, CompactWave *wave, bool isMask);
+    void skipXmlElement(QXmlStreamReader& xml);
+};
+
+/*!
+ * @brief ModuleCore holding a MidiArp
+ */
+class ArpCore : public ModuleCore
+{
+  public:
+/*!
+ * @param p_patternPresets Pattern presets selected by the
+ * ArpWidget::ARP_PRESET_SWITCH controller
+ */
+    ArpCore(MidiArp *p_midiArp, Prefs *p_prefs, const QString& p_name,
+            const QStringList *p_patternPresets, ParList *p_parList = NULL,
+            QVector<MidiCC> *p_ccList = NULL);
+    MidiArp *midiArp;
+/*! Preset applied by the last ARP_PRESET_SWITCH controller, 0 if the
+ * pattern was changed otherwise since */
+    int presetIndex;
+
+  protected:
+    bool readModuleData(QXmlStreamReader& xml,
+            const QString& qmaxVersion) override;
+    void writeModuleData(QXmlStreamWriter& xml) override;
+    void doStoreParams() override;
+    void doRestoreParams(int ix) override;
+    void applyControllerChanges() override;
+    void handleModuleController(int controlID, int sval,
+            int min, int max, int value) override;
+
+  private:
+    const QStringList *patternPresets;
+    int pendingPresetIndex;     /**< Set by the controller, -1 if none */
+};
+
+/*!
+ * @brief ModuleCore holding a MidiLfo
+ */
+class LfoCore : public ModuleCore
+{
+  public:
+    LfoCore(MidiLfo *p_midiLfo, Prefs *p_prefs, const QString& p_name,
+            ParList *p_parList = NULL, QVector<MidiCC> *p_ccList = NULL);
+    MidiLfo *midiLfo;
+    void updateWave() override;
+
+  protected:
+    bool readModuleData(QXmlStreamReader& xml,
+            const QString& qmaxVersion) override;
+    void readDone(const QString& qmaxVersion) override;
+    void writeModuleData(QXmlStreamWriter& xml) override;
+    void doStoreParams() override;
+    void doRestoreParams(int ix) override;
+    void applyControllerChanges() override;
+    void handleModuleController(int controlID, int sval,
+            int min, int max, int value) override;
+    bool repetitionsFinished() override;
+
+  private:
+    /* table indices set by the controllers or read from file, -1 if none */
+    int waveFormIndex, freqIndex, resIndex, sizeIndex;
+    int thinIndex, maxRateIndex;
+};
+
+/*!
+ * @brief ModuleCore holding a MidiSeq
+ */
+class SeqCore : public ModuleCore
+{
+  public:
+    SeqCore(MidiSeq *p_midiSeq, Prefs *p_prefs, const QString& p_name,
+            ParList *p_parList = NULL, QVector<MidiCC> *p_ccList = NULL);
+    MidiSeq *midiSeq;
+    void updateWave() override;
+
+  protected:
+    bool readModuleData(QXmlStreamReader& xml,
+            const QString& qmaxVersion) override;
+    void readDone(const QString& qmaxVersion) override;
+    void writeModuleData(QXmlStreamWriter& xml) override;
+    void doStoreParams() override;
+    void doRestoreParams(int ix) override;
+    void applyControllerChanges() override;
+    void handleModuleController(int controlID, int sval,
+            int min, int max, int value) override;
+    bool repetitionsFinished() override;
+
+  private:
+    /* table indices set by the controllers or read from file, -1 if none */
+    int resIndex, sizeIndex;
+    int sliderToTickLen(int val) { return (val * TPQN / 64); }
+    int tickLenToSlider(int val) { return (val * 64 / TPQN); }
+};
+
+#endif
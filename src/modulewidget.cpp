@@ -38,6 +38,9 @@ ModuleWidget::ModuleWidget(MidiWorker *p_midiWorker, GlobStore *p_globStore,
     name(p_name),
     globStore(p_globStore),
     prefs(p_prefs),
+    dispFramePtr(-1),
+    dispPercent(-1),
+    moduleCore(NULL),
     modified(false)
 {
     bool compactStyle = p_prefs->compactStyle;
@@ -289,8 +292,6 @@ ModuleWidget::ModuleWidget(const QString& name):
                     , deferChangesAction, this);
         connect(parStore, SIGNAL(store(int, bool)),
                  this, SLOT(storeParams(int, bool)));
-        connect(parStore, SIGNAL(restore(int)),
-                 this, SLOT(restoreParams(int)));
     if (compactStyle) parStore->setStyleSheet( COMPACT_STYLE );
     midiControl->addMidiLearnMenu("Note Low", indexIn[0], NOTE_LOW);
     midiControl->addMidiLearnMenu("Note Hi", indexIn[1], NOTE_HIGH);
@@ -352,6 +353,7 @@ ModuleWidget::ModuleWidget(const QString& name):
 ModuleWidget::~ModuleWidget()
 {
 #ifdef APPBUILD
+    delete moduleCore;
     delete parStore;
 #endif
 }
@@ -508,54 +510,13 @@ void ModuleWidget::updateNRep(int nrep)
 void ModuleWidget::storeParams(int ix, bool empty)
 {
 #ifdef APPBUILD
-    parStore->temp.empty = empty;
-    parStore->temp.muteOut = muteOut->isChecked();
-    parStore->temp.chIn = chIn->currentIndex();
-    parStore->temp.channelOut = channelOut->currentIndex();
-    parStore->temp.portOut = portOut->currentIndex();
-    parStore->temp.indexIn0 = indexIn[0]->value();
-    parStore->temp.indexIn1 = indexIn[1]->value();
-    parStore->temp.rangeIn0 = rangeIn[0]->value();
-    parStore->temp.rangeIn1 = rangeIn[1]->value();
-    doStoreParams(ix);
-    
+    moduleCore->storeParams(ix, empty);
 #else
     (void)ix;
     (void)empty;
 #endif
 }
 
-void ModuleWidget::restoreParams(int ix)
-{
-#ifdef APPBUILD
-    doRestoreParams(ix);
-    if (!parStore->onlyPatternList.at(ix)) {
-        if (prefs->storeMuteState) muteOutAction->setChecked(parStore->list.at(ix).muteOut);
-        indexIn[0]->setValue(parStore->list.at(ix).indexIn0);
-        indexIn[1]->setValue(parStore->list.at(ix).indexIn1);
-        rangeIn[0]->setValue(parStore->list.at(ix).rangeIn0);
-        rangeIn[1]->setValue(parStore->list.at(ix).rangeIn1);
-        chIn->setCurrentIndex(parStore->list.at(ix).chIn);
-        updateChIn(parStore->list.at(ix).chIn);
-        channelOut->setCurrentIndex(parStore->list.at(ix).channelOut);
-        updateChannelOut(parStore->list.at(ix).channelOut);
-        setPortOut(parStore->list.at(ix).portOut);
-        updatePortOut(parStore->list.at(ix).portOut);
-        midiWorker->currentRepetition = 0;
-    }
-#else
-    (void)ix;
-#endif
-}
-
-#ifdef APPBUILD
-void ModuleWidget::setPortOut(int value)
-{
-    portOut->setCurrentIndex(value);
-    modified = true;
-}
-#endif
-
 void ModuleWidget::moduleDelete()
 {
 #ifdef APPBUILD
@@ -585,6 +546,7 @@ void ModuleWidget::moduleRename()
 
     if (ok && !newname.isEmpty()) {
         name = oldname.left(4) + newname;
+        moduleCore->name = name;
         emit dockRename(name, ID);
     }
 #endif
@@ -598,216 +560,104 @@ void ModuleWidget::moduleClone()
 }
 
 #ifdef APPBUILD
-void ModuleWidget::writeCommonData(QXmlStreamWriter& xml)
-{
-    xml.writeStartElement(name.left(3));
-    xml.writeAttribute("name", name.mid(name.indexOf(':') + 1));
-    xml.writeAttribute("inOutVisible", QString::number(inOutBoxWidget->isVisible()));
-
-        xml.writeStartElement("input");
-            if (!name.startsWith('A')) {
-            xml.writeTextElement("enableNoteOff", QString::number(
-                enableNoteOff->isChecked()));
-            }
-            if (name.startsWith('S')) {
-            xml.writeTextElement("enableNote", QString::number(
-                enableNoteIn->isChecked()));
-            xml.writeTextElement("enableVelocity", QString::number(
-                enableVelIn->isChecked()));
-            }
-            xml.writeTextElement("restartByKbd", QString::number(
-                enableRestartByKbd->isChecked()));
-            xml.writeTextElement("trigByKbd", QString::number(
-                enableTrigByKbd->isChecked()));
-            xml.writeTextElement("trigLegato", QString::number(
-                enableTrigLegato->isChecked()));
-            xml.writeTextElement("channel", QString::number(
-                chIn->currentIndex()));
-            xml.writeTextElement("indexMin", QString::number(
-                indexIn[0]->value()));
-            xml.writeTextElement("indexMax", QString::number(
-                indexIn[1]->value()));
-            xml.writeTextElement("rangeMin", QString::number(
-                rangeIn[0]->value()));
-            xml.writeTextElement("rangeMax", QString::number(
-                rangeIn[1]->value()));
-            if (name.startsWith('L')) {
-            xml.writeTextElement("ccnumber", QString::number(
-                ccnumberInBox->value()));
-            }
-        xml.writeEndElement();
-
-        xml.writeStartElement("output");
-            xml.writeTextElement("muted", QString::number(
-                muteOut->isChecked()));
-            xml.writeTextElement("defer", QString::number(
-                deferChangesButton->isChecked()));
-            xml.writeTextElement("port", QString::number(
-                portOut->currentIndex()));
-            xml.writeTextElement("channel", QString::number(
-                channelOut->currentIndex()));
-            if (name.startsWith('L')) {
-            xml.writeTextElement("ccnumber", QString::number(
-                ccnumberBox->value()));
-            }
-        xml.writeEndElement();
-        
-        midiControl->writeData(xml);
-
-        parStore->writeData(xml);
-}
-
-void ModuleWidget::readCommonData(QXmlStreamReader& xml)
-{
-    int tmp = 0;
-    
-    if (xml.isStartElement() && (xml.name() == "midiControllers")) {
-        midiControl->readData(xml);
-    }
-    else if (xml.isStartElement() && (xml.name() == "globalStores")) {
-        parStore->readData(xml);
-    }
-
-    else if (xml.isStartElement() && (xml.name() == "input")) {
-        while (!xml.atEnd()) {
-            xml.readNext();
-            if (xml.isEndElement())
-                break;
-                
-            if (xml.name() == "enableNote")
-                enableNoteIn->setChecked(xml.readElementText().toInt());
-            else if (xml.name() == "enableNoteOff")
-                enableNoteOff->setChecked(xml.readElementText().toInt());
-            else if (xml.name() == "enableVelocity")
-                enableVelIn->setChecked(xml.readElementText().toInt());
-            else if (xml.name() == "restartByKbd")
-                enableRestartByKbd->setChecked(xml.readElementText().toInt());
-            else if (xml.name() == "trigByKbd")
-                enableTrigByKbd->setChecked(xml.readElementText().toInt());
-            else if (xml.name() == "trigLegato")
-                enableTrigLegato->setChecked(xml.readElementText().toInt());
-            else if (xml.name() == "channel") {
-                tmp = xml.readElementText().toInt();
-                chIn->setCurrentIndex(tmp);
-            }
-            else if (xml.name() == "indexMin")
-                indexIn[0]->setValue(xml.readElementText().toInt());
-            else if (xml.name() == "indexMax")
-                indexIn[1]->setValue(xml.readElementText().toInt());
-            else if (xml.name() == "rangeMin")
-                rangeIn[0]->setValue(xml.readElementText().toInt());
-            else if (xml.name() == "rangeMax")
-                rangeIn[1]->setValue(xml.readElementText().toInt());
-            else if (xml.name() == "ccnumber")
-                ccnumberInBox->setValue(xml.readElementText().toInt());
-            else skipXmlElement(xml);
-        }
-    }
-    else if (xml.isStartElement() && (xml.name() == "output")) {
-        while (!xml.atEnd()) {
-            xml.readNext();
-            if (xml.isEndElement())
-                break;
-            if (xml.name() == "muted")
-                muteOutAction->setChecked(xml.readElementText().toInt());
-            else if (xml.name() == "defer")
-                deferChangesAction->setChecked(xml.readElementText().toInt());
-            else if (xml.name() == "channel") {
-                tmp = xml.readElementText().toInt();
-                channelOut->setCurrentIndex(tmp);
-            }
-            else if (xml.name() == "port") {
-                tmp = xml.readElementText().toInt();
-                portOut->setCurrentIndex(tmp);
-            }
-            else if (xml.name() == "ccnumber")
-                ccnumberBox->setValue(xml.readElementText().toInt());
-            else skipXmlElement(xml);
-        }
-    }
+void ModuleWidget::writeData(QXmlStreamWriter& xml)
+{
+    moduleCore->writeData(xml, inOutBoxWidget->isVisible());
 }
 
-void ModuleWidget::skipXmlElement(QXmlStreamReader& xml)
+void ModuleWidget::readData(QXmlStreamReader& xml, const QString& qmaxVersion)
 {
-    if (xml.isStartElement()) {
-        qWarning("Unknown Element in XML File: %s",qPrintable(xml.name().toString()));
-        while (!xml.atEnd()) {
-            xml.readNext();
+    moduleCore->readData(xml, qmaxVersion);
+    updateWidgets();
+    updateScreen(true);
+    moduleCore->dataUpdated = false;
+    midiControl->refresh();
+    needsGUIUpdate = false;
+    modified = false;
+}
 
-            if (xml.isEndElement())
-                break;
+void ModuleWidget::updateDisplay()
+{
+    const bool changed = moduleCore->update();
 
-            if (xml.isStartElement()) {
-                skipXmlElement(xml);
-            }
-        }
+    midiControl->update();
+    if (isShown()) {
+        parStore->updateDisplay();
+        updateScreen(moduleCore->dataUpdated);
+        moduleCore->dataUpdated = false;
     }
-}
 
-void ModuleWidget::newGrooveValues(int p_grooveTick, int p_grooveVelocity,
-        int p_grooveLength)
-{
-    // grooveTick is only updated on pair steps to keep quantization
-    // newGrooveTick stores the GUI value temporarily
-    midiWorker->newGrooveTick = p_grooveTick;
-    midiWorker->grooveVelocity = p_grooveVelocity;
-    midiWorker->grooveLength = p_grooveLength;
-    midiWorker->needsGUIUpdate = true;
+    if (!(changed || needsGUIUpdate)) return;
+
+    updateWidgets();
+    if (changed) modified = true;
+    needsGUIUpdate = false;
 }
 
-void ModuleWidget::updateIndicators()
+void ModuleWidget::updateWidgets()
 {
-    int ci = midiWorker->getFramePtr();
+    chIn->setCurrentIndex(midiWorker->chIn);
+    channelOut->setCurrentIndex(midiWorker->channelOut);
+    portOut->setCurrentIndex(midiWorker->portOut);
 
-    if (midiWorker->reverse) {
-        ci = midiWorker->nPoints - ci;
+    QSpinBox *spinBoxes[6] = { indexIn[0], indexIn[1], rangeIn[0],
+            rangeIn[1], ccnumberInBox, ccnumberBox };
+    const int spinValues[6] = { midiWorker->indexIn[0],
+            midiWorker->indexIn[1], midiWorker->rangeIn[0],
+            midiWorker->rangeIn[1], midiWorker->ccnumberIn,
+            midiWorker->ccnumber };
+    for (int l1 = 0; l1 < 6; l1++) {
+        spinBoxes[l1]->blockSignals(true);
+        spinBoxes[l1]->setValue(spinValues[l1]);
+        spinBoxes[l1]->blockSignals(false);
     }
 
-    int percent;
-    if (midiWorker->nPoints)
-        percent = (ci * 100 / (midiWorker->nPoints)  
-                + midiWorker->currentRepetition * 100 )
-                / midiWorker->nRepetitions;
-    else
-        percent = 0;
-    
-    parStore->ndc->updatePercent(percent);
-    
-    if (parStore->isRestoreMaster
-            && (!globStore->timeModeBox->currentIndex())) {
-        globStore->indicator->updatePercent(percent);
+    QCheckBox *checkBoxes[6] = { enableNoteIn, enableVelIn, enableNoteOff,
+            enableRestartByKbd, enableTrigByKbd, enableTrigLegato };
+    const bool checkValues[6] = { midiWorker->enableNoteIn,
+            midiWorker->enableVelIn, midiWorker->enableNoteOff,
+            midiWorker->restartByKbd, midiWorker->trigByKbd,
+            midiWorker->trigLegato };
+    for (int l1 = 0; l1 < 6; l1++) {
+        checkBoxes[l1]->blockSignals(true);
+        checkBoxes[l1]->setChecked(checkValues[l1]);
+        checkBoxes[l1]->blockSignals(false);
     }
+
+    muteOutAction->blockSignals(true);
+    muteOutAction->setChecked(midiWorker->isMutedDefer);
+    muteOutAction->blockSignals(false);
+    deferChangesAction->blockSignals(true);
+    deferChangesAction->setChecked(midiWorker->deferChanges);
+    deferChangesAction->blockSignals(false);
+    parStore->ndc->setMuted(midiWorker->isMuted);
+
+    checkIfInputFilterSet();
 }
 
-void ModuleWidget::checkIfRestore(int64_t *restoreTick, bool *restoreFlag)
+void ModuleWidget::updateIndicators()
 {
-    bool repetitionsFinished = (midiWorker->currentRepetition == 0);
-    if (midiWorker->reverse) {
-        repetitionsFinished = (midiWorker->currentRepetition >= midiWorker->nRepetitions - 1);
+    int pos = midiWorker->dispFramePtr.load(std::memory_order_relaxed);
+    int percent = midiWorker->dispPercent.load(std::memory_order_relaxed);
+
+    // a hidden cursor is moved once the module is shown again
+    if ((pos != dispFramePtr) && isShown()) {
+        dispFramePtr = pos;
+        updateCursorPos(pos);
     }
+    if (percent == dispPercent) return;
+    dispPercent = percent;
+
+    parStore->ndc->updatePercent(percent);
     
-    if (!midiWorker->getFramePtr() && restoreFlag && repetitionsFinished
-        && parStore->isRestoreMaster
-        && !globStore->timeModeBox->currentIndex()) {
-        *restoreTick = midiWorker->nextTick;
-        *restoreFlag = false;
+    if (parStore->isRestoreMaster && !globStore->timeMode) {
+        globStore->indicator->updatePercent(percent);
     }
 }
 
-bool ModuleWidget::prepareNextFrame(bool echo_from_trig, int syncTol,
-                int64_t tick, int64_t *restoreTick, bool *restoreFlag)
+bool ModuleWidget::isShown() const
 {
-    if ((echo_from_trig && midiWorker->gotKbdTrig)
-            || (!midiWorker->gotKbdTrig && !echo_from_trig)) {
-        if ((tick + syncTol) >= midiWorker->nextTick) {
-            updateCursorPos();
-            updateIndicators();
-            midiWorker->getNextFrame(tick);
-            checkIfRestore(restoreTick, restoreFlag);
-            return true;
-        }
-    }
-    return false;
+    return isVisible() && !window()->isMinimized();
 }
 
 void ModuleWidget::setID(int id)
@@ -40,6 +40,8 @@
 
 #ifdef APPBUILD
 #include <QInputDialog>
+#include "midicontrol.h"
+#include "modulecore.h"
 #include "parstore.h"
 #include "prefs.h"
 #endif
@@ -78,8 +80,13 @@ class ModuleWidget: public QWidget
     QAction *deleteAction, *renameAction, *cloneAction;
     int ID;             /**< @brief Corresponds to the Engine::midi*List index of the associated MidiSeq */
     Prefs *prefs;
+    int dispFramePtr;   /**< @brief Frame position the cursor was last moved to */
+    int dispPercent;    /**< @brief Percent the indicators were last set to */
     ParStore *parStore;
     MidiControl *midiControl;
+/*! @brief Widget-free part of the module, created by the derived widget
+ * with ModuleWidget::parStore and the MidiControl::ccList */
+    ModuleCore *moduleCore;
 #else
     ModuleWidget(const QString& name);
 #endif
@@ -132,97 +139,68 @@ class ModuleWidget: public QWidget
 
     virtual void setID(int ID);
 /*!
-* @brief Writes common module parameters to disk
-* @param xml XML stream to write to
-*/
-    virtual void writeCommonData(QXmlStreamWriter& xml);
-/*!
-* @brief Reads common module parameters from disk
-* @param xml XML stream to read from
-*/
-    virtual void readCommonData(QXmlStreamReader& xml);
-/*!
-* @brief Setter for the ModuleWidget::portOut spinbox setting the output
-* port of this module.
-* @param value Number of the output port to send data to
-*
-*/
-    virtual void setPortOut(int value);
-/*!
-* @brief stores some module parameters in a parameter
-* list object
-*
-* @param ix Position index in the parameter list
-*/
-    virtual void doStoreParams(int ix) = 0;
+ * @brief Updates the GUI elements with the current state of the module.
+ *
+ * It is called by Engine::updateModule() from the MTimer driven display
+ * update. It calls ModuleCore::update(), which carries out the pending
+ * restores and controller changes on the MidiWorker and reads its wave
+ * data. The screen and cursor are then redrawn by updateScreen() if the
+ * module is shown, and the widgets are set to the worker values by
+ * updateWidgets() if these changed. This way, no memory allocations
+ * are done within the jack run thread, for instance by MIDI
+ * controllers, since the Qt widgets are not called directly.
+ */
+    virtual void updateDisplay();
 /*!
-* @brief Restores some module parameters from the parameter
-* list object
-*
-* @param ix Position index in the parameter list
-*/
-    virtual void doRestoreParams(int ix) = 0;
-/**
- * @brief Copies the new values transferred from the
- * GrooveWidget into variables used by the main routine.
+ * @brief Sets all GUI elements of the module to the values of its
+ * MidiWorker without calling their slots.
  *
- * @param p_grooveTick Groove amount for timing displacements
- * @param p_grooveVelocity Groove amount for velocity variations
- * @param p_grooveLength Groove amount for note length variations
+ * Derived widgets reimplement it for their own elements and call the
+ * base implementation for the in-out settings.
  */
-    virtual void newGrooveValues(int p_grooveTick, int p_grooveVelocity,
-            int p_grooveLength);
-
-/**
- * @brief Handles MIDI-learned controller events locally in each module
- * 
- * It is called by Engine::sendController() when a MIDI controller is received.
+    virtual void updateWidgets();
+/*!
+ * @brief Redraws the screen and cursor of the module
+ *
+ * @param newData True if ModuleCore::data was updated since the last call
  */
-    virtual void handleController(int ccnumber, int channel, int value) = 0;
+    virtual void updateScreen(bool newData) = 0;
 /*!
- * @brief Updates the SeqScreen and other GUI elements with data from
- * the MidiSeq instance.
+ * @brief Moves the cursor and the progress indicators to the position
+ * published by MidiWorker::prepareNextFrame().
  *
- * It is called by Engine::updateDisplay(), which itself is
- * connected to the MTimer::timeout event. It runs in the MTimer thread.
- * It reads the waveform data and other settings from the MidiSeq instance
- * and sets GUI cursor, wave display and other elements accordingly. This
- * way, no memory allocations are done within the jack run thread, for
- * instance by MIDI controllers, since the Qt widgets are not called directly.
- * This function also checks whether parameter changes from ParStore are
- * pending and causes them to get transferred if so.
+ * It is called by Engine::updateModule() before updateDisplay() and
+ * only redraws when the published position changed.
  */
-    virtual void updateDisplay() = 0;
     virtual void updateIndicators();
-    virtual void updateCursorPos() = 0;
-    virtual void checkIfRestore(int64_t *restoreTick, bool *restoreFlag);
-    virtual bool prepareNextFrame(bool echo_from_trig, int syncTol,
-                int64_t tick, int64_t *restoreTick, bool *restoreFlag);
+    virtual void updateCursorPos(int pos) = 0;
 /*!
-* @brief reads all parameters of this LFO from an XML stream
+ * @brief Returns false if the dock of the module is hidden or its
+ * window minimized.
+ *
+ * updateDisplay() and updateIndicators() then skip the drawing of the
+ * screen and cursor, ModuleCore::update() still reads the changed wave
+ * data. The drawing is caught up when the module is shown again.
+ */
+    bool isShown() const;
+/*!
+* @brief reads all parameters of this module from an XML stream
 * passed by the caller, i.e. MainWindow.
 *
-* @param xml QXmlStreamWriter to read from
+* The parameters are read into the MidiWorker by ModuleCore::readData(),
+* the widgets are then set with updateWidgets().
+*
+* @param xml QXmlStreamReader to read from
 * @param qmaxVersion QString with xml format version
 */
-    virtual void readData(QXmlStreamReader& xml, const QString& qmaxVersion) = 0;
+    void readData(QXmlStreamReader& xml, const QString& qmaxVersion);
 /*!
 * @brief writes all parameters of this module to an XML stream
 * passed by the caller, i.e. MainWindow.
 *
 * @param xml QXmlStreamWriter to write to
 */
-    virtual void writeData(QXmlStreamWriter& xml) = 0;
-/*!
-* @brief allows ignoring one XML element in the XML stream
-* passed by the caller.
-*
-* It also advances the stream read-in. It is used to
-* ignore unknown elements for both-ways-compatibility
-*
-* @param xml reference to QXmlStreamReader containing the open XML stream
-*/
-    virtual void skipXmlElement(QXmlStreamReader& xml);
+    void writeData(QXmlStreamWriter& xml);
 #endif
     
   public slots:
@@ -252,26 +230,13 @@ class ModuleWidget: public QWidget
     virtual void setInputFilterVisible(bool on);
     
 /*!
-* @brief Store common module parameters and call doStoreParams
-* 
-* Stores common module parameters to ParStore::list and then calls 
-* ModuleWidget::doStoreParams(), which is reimplemented in each module widget
-* to store module specific parameters.
-* 
+* @brief Stores the module parameters in ParStore::list by calling
+* ModuleCore::storeParams()
+*
 * @param ix The storage location index to write to
 * @param empty Signal an empty location
 */
     virtual void storeParams(int ix, bool empty = 0);
-/*!
-* @brief Restore common module parameters and call doRestoreParams
-* 
-* Restores common module parameters from ParStore::list and then calls 
-* ModuleWidget::doRestoreParams(), which is reimplemented in each module widget
-* to restore module specific parameters.
-* 
-* @param ix The storage location index to read from
-*/
-    virtual void restoreParams(int ix);
 
     virtual void copyParamsFrom(ModuleWidget *fromWidget) { (void)fromWidget; };
 
@@ -0,0 +1,298 @@
+/*!
+ * @file noteset.h
+ * @brief Implementation of the NoteSet and NoteBuffer classes
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#ifndef NOTESET_H
+#define NOTESET_H
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief Set of held input notes with their velocity, timing and
+ * release state
+ *
+ * Each note value owns NoteSet::COPIES slots, so that the same note can
+ * be held several times, for example once released and once pressed
+ * again. A slot is numbered note * COPIES + copy, and a bit mask marks
+ * the occupied slots. Inserting and removing a note is O(1).
+ *
+ * The notes can be indexed in two orders. In ascending order, select()
+ * finds the slot at a given index by counting bits in the mask. In the
+ * order they were played, select() walks a doubly linked list kept
+ * through the slots.
+ */
+class NoteSet
+{
+public:
+    enum {
+        COPIES = 4,             /*!< Number of copies of the same note */
+        SLOTS = 128 * COPIES,
+        WORDS = SLOTS / 64
+    };
+
+    NoteSet() { clear(); }
+
+    /** @brief Remove all notes */
+    void clear()
+    {
+        for (int l1 = 0; l1 < WORDS; l1++) m_mask[l1] = 0;
+        m_count = 0;
+        m_releasedCount = 0;
+        m_first = -1;
+        m_last = -1;
+    }
+
+    int count() const { return m_count; }
+    int releasedCount() const { return m_releasedCount; }
+
+    static int note(int slot) { return slot / COPIES; }
+    int velocity(int slot) const { return m_vel[slot]; }
+    int64_t tick(int slot) const { return m_tick[slot]; }
+    bool isReleased(int slot) const { return m_released[slot]; }
+
+    /**
+     * @brief Add a note to the set
+     *
+     * @return The slot of the note, or -1 if all copies of the note are
+     * already in use
+     */
+    int insert(int note, int vel, int64_t tick)
+    {
+        if ((note < 0) || (note > 127)) return -1;
+
+        const int base = note * COPIES;
+        const unsigned int used = (m_mask[base >> 6] >> (base & 63))
+                & ((1u << COPIES) - 1);
+        if (used == (1u << COPIES) - 1) return -1;
+
+        const int slot = base + __builtin_ctz(~used);
+        m_mask[slot >> 6] |= (uint64_t)1 << (slot & 63);
+        m_vel[slot] = vel;
+        m_tick[slot] = tick;
+        m_released[slot] = false;
+
+        m_prev[slot] = m_last;
+        m_next[slot] = -1;
+        if (m_last >= 0) m_next[m_last] = slot;
+        else m_first = slot;
+        m_last = slot;
+
+        m_count++;
+        return slot;
+    }
+
+    /** @brief Remove the note held in slot */
+    void remove(int slot)
+    {
+        m_mask[slot >> 6] &= ~((uint64_t)1 << (slot & 63));
+
+        if (m_prev[slot] >= 0) m_next[m_prev[slot]] = m_next[slot];
+        else m_first = m_next[slot];
+        if (m_next[slot] >= 0) m_prev[m_next[slot]] = m_prev[slot];
+        else m_last = m_prev[slot];
+
+        if (m_released[slot]) m_releasedCount--;
+        m_count--;
+    }
+
+    /** @brief Tag the note in slot as released at tick */
+    void release(int slot, int64_t tick)
+    {
+        if (!m_released[slot]) m_releasedCount++;
+        m_released[slot] = true;
+        m_tick[slot] = tick;
+    }
+
+    /**
+     * @brief Find the first copy of a note
+     *
+     * @param note The note value
+     * @param released -1 for any copy, 0 for a held copy, 1 for a
+     * released copy
+     * @return The slot of the copy, or -1 if there is none
+     */
+    int find(int note, int released = -1) const
+    {
+        if ((note < 0) || (note > 127)) return -1;
+
+        for (int slot = note * COPIES; slot < (note + 1) * COPIES; slot++) {
+            if (!(m_mask[slot >> 6] & ((uint64_t)1 << (slot & 63)))) continue;
+            if ((released < 0) || (m_released[slot] == (released > 0)))
+                return slot;
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Slot of the note at a given index
+     *
+     * @param index Index of the note, 0 <= index < count()
+     * @param asPlayed Count in the order the notes were played instead of
+     * ascending order
+     */
+    int select(int index, bool asPlayed = false) const
+    {
+        if ((index < 0) || (index >= m_count)) return -1;
+        if (asPlayed) {
+            int slot = m_first;
+            while (index-- && (slot >= 0)) slot = m_next[slot];
+            return slot;
+        }
+        for (int l1 = 0; l1 < WORDS; l1++) {
+            uint64_t word = m_mask[l1];
+            const int bits = __builtin_popcountll(word);
+            if (index >= bits) {
+                index -= bits;
+                continue;
+            }
+            while (index--) word &= word - 1;
+            return l1 * 64 + __builtin_ctzll(word);
+        }
+        return -1;
+    }
+
+    /** @brief Slot of the last note in the given order, -1 if empty */
+    int last(bool asPlayed = false) const
+    {
+        if (asPlayed) return m_last;
+        for (int l1 = WORDS - 1; l1 >= 0; l1--) {
+            if (m_mask[l1]) return l1 * 64 + 63 - __builtin_clzll(m_mask[l1]);
+        }
+        return -1;
+    }
+
+    /** @brief Move the timing of all notes by -ticks */
+    void shiftTicks(int64_t ticks)
+    {
+        for (int slot = m_first; slot >= 0; slot = m_next[slot]) {
+            m_tick[slot] -= ticks;
+        }
+    }
+
+    /** @brief Remove all notes tagged as released */
+    void removeReleased()
+    {
+        int slot = m_first;
+        while (m_releasedCount && (slot >= 0)) {
+            const int next = m_next[slot];
+            if (m_released[slot]) remove(slot);
+            slot = next;
+        }
+    }
+
+private:
+    uint64_t m_mask[WORDS];
+    int m_count;
+    int m_releasedCount;
+    int m_first;
+    int m_last;
+    int m_vel[SLOTS];
+    int64_t m_tick[SLOTS];
+    bool m_released[SLOTS];
+    int16_t m_prev[SLOTS];
+    int16_t m_next[SLOTS];
+};
+
+/**
+ * @brief Two copies of a NoteSet, one of which is read by the arpeggio
+ * output while the other one is modified
+ *
+ * A change is applied to the copy that is not read, then the atomic
+ * index of the copy to read is flipped, and the same change is applied
+ * to the other copy. Since the changes are deterministic, both copies
+ * hold the same notes in the same slots afterwards. Nothing is ever
+ * copied as a whole.
+ */
+class NoteBuffer
+{
+public:
+    NoteBuffer() : m_current(0) {}
+
+    /** @brief The copy to read from */
+    const NoteSet& current() const
+    {
+        return m_sets[m_current.load(std::memory_order_acquire)];
+    }
+
+    void clear()
+    {
+        back().clear();
+        flip();
+        back().clear();
+    }
+
+    int insert(int note, int vel, int64_t tick)
+    {
+        back().insert(note, vel, tick);
+        flip();
+        return back().insert(note, vel, tick);
+    }
+
+    void remove(int slot)
+    {
+        back().remove(slot);
+        flip();
+        back().remove(slot);
+    }
+
+    void release(int slot, int64_t tick)
+    {
+        back().release(slot, tick);
+        flip();
+        back().release(slot, tick);
+    }
+
+    void shiftTicks(int64_t ticks)
+    {
+        back().shiftTicks(ticks);
+        flip();
+        back().shiftTicks(ticks);
+    }
+
+    void removeReleased()
+    {
+        back().removeReleased();
+        flip();
+        back().removeReleased();
+    }
+
+private:
+    /** @brief The copy that is not read */
+    NoteSet& back()
+    {
+        return m_sets[1 - m_current.load(std::memory_order_relaxed)];
+    }
+
+    /** @brief Make the changed copy the one to read */
+    void flip()
+    {
+        m_current.store(1 - m_current.load(std::memory_order_relaxed),
+                std::memory_order_release);
+    }
+
+    NoteSet m_sets[2];
+    std::atomic<int> m_current;
+};
+
+#endif
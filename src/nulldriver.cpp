@@ -0,0 +1,120 @@
+/*!
+ * @file nulldriver.cpp
+ * @brief Implementation of the NullDriver class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#include <cstdio>
+#include "nulldriver.h"
+
+
+NullDriver::NullDriver(
+    int p_portCount,
+    void * callback_context,
+    bool (* midi_event_received_callback)(void * context, MidiEvent ev),
+    void (* tick_callback)(void * context, bool echo_from_trig))
+    : DriverBase(p_portCount, callback_context, midi_event_received_callback, tick_callback, 48000 * 60),
+    echoQueue(JQ_BUFSZ)
+{
+    lastSchedTick = 0;
+    sameTickEchoes = 0;
+    resetCounters();
+}
+
+bool NullDriver::callJack(int port_count, const QString & clientname)
+{
+    (void)port_count;
+    (void)clientname;
+    return false;
+}
+
+void NullDriver::resetCounters()
+{
+    sentEvents = 0;
+    receivedEvents = 0;
+    echoes = 0;
+}
+
+void NullDriver::receive(uint64_t tick, MidiEvent ev)
+{
+    process(tick);
+    if (tick > m_current_tick) m_current_tick = tick;
+    receivedEvents++;
+    midi_event_received(ev);
+}
+
+void NullDriver::process(uint64_t end_tick)
+{
+    while (queueStatus && !echoQueue.isEmpty()
+            && (echoQueue.nextTick() < end_tick)) {
+        const bool echo_from_trig = echoQueue.next();
+        const uint64_t echo_tick = echoQueue.nextTick();
+        echoQueue.pop();
+        if (echo_tick > m_current_tick) {
+            m_current_tick = echo_tick;
+            sameTickEchoes = 0;
+        }
+        /* guard against a module requesting the same tick forever **/
+        if (++sameTickEchoes > echoQueue.capacity()) {
+            printf("WARNING: Echo loop at tick %llu. Echo dropped.\n",
+                    (unsigned long long)m_current_tick);
+            continue;
+        }
+        echoes++;
+        tick_callback(echo_from_trig);
+    }
+    if (end_tick > m_current_tick) m_current_tick = end_tick;
+}
+
+void NullDriver::sendMidiEvent(MidiEvent ev, uint64_t n_tick, unsigned outport, unsigned duration)
+{
+    capture.record(ev, n_tick, outport, CAPTURE_OUT, duration);
+
+    sentEvents++;
+    /* JackDriver would schedule the note off **/
+    if ((ev.type == EV_NOTEON) && (ev.value)) sentEvents++;
+}
+
+bool NullDriver::requestEchoAt(uint64_t echo_tick, bool echo_from_trig)
+{
+    if (echoQueue.count() > echoQueue.capacity() - 1) {
+        rtStats.echoOverflows.fetch_add(1, std::memory_order_relaxed);
+        echoQueue.clear();
+    }
+    if ((echo_tick == lastSchedTick) && (echo_tick)) return false;
+    echoQueue.push(echo_tick, echo_from_trig);
+    lastSchedTick = echo_tick;
+
+    return true;
+}
+
+void NullDriver::setTransportStatus(bool on)
+{
+    tempo = internalTempo;
+
+    if (on) {
+        m_current_tick = 0;
+        lastSchedTick = 0;
+        sameTickEchoes = 0;
+        echoQueue.clear();
+    }
+    queueStatus = on;
+}
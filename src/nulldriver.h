@@ -0,0 +1,90 @@
+/*!
+ * @file nulldriver.h
+ * @brief Header for the NullDriver class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#ifndef NULLDRIVER_H
+#define NULLDRIVER_H
+
+#include "config.h"
+
+#include "main.h"
+#include "driverbase.h"
+#include "tickqueue.h"
+
+/*!
+ * The NullDriver class is a backend without MIDI interface, used to
+ * measure the realtime path of the engine in isolation. Like
+ * OfflineDriver, it has no realtime clock and only advances its tick
+ * when process() is called, but it does not queue or convert the events
+ * sent by the engine, it only counts them. Input events are passed to
+ * the engine callback right away by receive().
+ *
+ * Echo requests are kept in a TickQueue like in JackDriver, so that the
+ * engine tick callback is called at the exact tick of each echo.
+ *
+ * @brief Backend discarding all output, for benchmarking the engine
+ */
+class NullDriver : public DriverBase
+{
+  private:
+    uint64_t lastSchedTick;
+    int sameTickEchoes;     /**< Echoes handled in a row at the current tick */
+    TickQueue<bool> echoQueue;
+
+  public:
+    NullDriver(int p_portCount,
+            void * callback_context,
+            bool (* midi_event_received_callback)(void * context, MidiEvent ev),
+            void (* tick_callback)(void * context, bool echo_from_trig));
+
+    uint64_t sentEvents;    /**< Events sent by the engine, note offs included */
+    uint64_t receivedEvents; /**< Events passed to the engine by receive() */
+    uint64_t echoes;        /**< Calls of the engine tick callback */
+
+/*!
+* @brief handles the echoes up to tick and passes an event to the engine
+* at this tick
+*
+* @param tick Tick at which the event is received, not before the
+* current tick
+* @param ev The input event
+*/
+    void receive(uint64_t tick, MidiEvent ev);
+/*!
+* @brief advances the clock up to end_tick, handling the echoes
+* before it
+*
+* @param end_tick Tick at which the clock stops, not included
+*/
+    void process(uint64_t end_tick);
+/*! @brief resets the event and echo counters */
+    void resetCounters();
+
+    void sendMidiEvent(MidiEvent ev, uint64_t n_tick, unsigned int outport, unsigned int duration = 0);
+    bool requestEchoAt(uint64_t echoTick, bool echo_from_trig = 0);
+    void setTransportStatus(bool run);
+    int getClientId() { return 0; }
+    bool callJack(int portcount, const QString & clientname=PACKAGE);
+};
+
+#endif
@@ -0,0 +1,223 @@
+/*!
+ * @file offlinedriver.cpp
+ * @brief Implementation of the OfflineDriver class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#include <cstdio>
+#include "offlinedriver.h"
+
+
+OfflineDriver::OfflineDriver(
+    int p_portCount,
+    void * callback_context,
+    bool (* midi_event_received_callback)(void * context, MidiEvent ev),
+    void (* tick_callback)(void * context, bool echo_from_trig))
+    : DriverBase(p_portCount, callback_context, midi_event_received_callback, tick_callback, 48000 * 60),
+    echoQueue(JQ_BUFSZ),
+    evQueue(JQ_BUFSZ)
+{
+    lastSchedTick = 0;
+    sameTickEchoes = 0;
+    inputIndex = 0;
+}
+
+bool OfflineDriver::callJack(int port_count, const QString & clientname)
+{
+    (void)port_count;
+    (void)clientname;
+    return false;
+}
+
+void OfflineDriver::queueInput(uint64_t tick, const unsigned char *data, int size)
+{
+    if ((size < 2) || (data[0] < 0x80) || (data[0] >= 0xf0)) return;
+
+    RawEvent raw;
+    raw.tick = tick;
+    raw.port = 0;
+    raw.size = (size > 3) ? 3 : size;
+    for (int l1 = 0; l1 < raw.size; l1++) raw.data[l1] = data[l1];
+    input.push_back(raw);
+}
+
+uint64_t OfflineDriver::inputEndTick() const
+{
+    return input.empty() ? 0 : input.back().tick;
+}
+
+void OfflineDriver::process(uint64_t end_tick)
+{
+    MidiEvent inEv;
+
+    for (;;) {
+        const bool has_input = (inputIndex < input.size())
+                && (input[inputIndex].tick < end_tick);
+        const bool has_echo = queueStatus && !echoQueue.isEmpty()
+                && (echoQueue.nextTick() < end_tick);
+        if (!has_input && !has_echo) break;
+
+        if (has_input && (!has_echo
+                || (input[inputIndex].tick <= echoQueue.nextTick()))) {
+            const RawEvent raw = input[inputIndex++];
+            if (raw.tick > m_current_tick) m_current_tick = raw.tick;
+
+            /* MIDI Output due up to this input event first **/
+            outputEvents(m_current_tick + 1);
+
+            /* same decoding as JackDriver **/
+            const int status = raw.data[0] & 0xf0;
+            inEv.channel = raw.data[0] & 0x0f;
+            inEv.data = raw.data[1];
+            inEv.value = (raw.size > 2) ? raw.data[2] : 0;
+            if (status == 0x90) inEv.type = EV_NOTEON;
+            else if (status == 0x80) inEv.type = EV_NOTEOFF;
+            else if (status == 0xa0) inEv.type = EV_KEYPRESS;
+            else if (status == 0xb0) inEv.type = EV_CONTROLLER;
+            else if (status == 0xc0) {
+                inEv.type = EV_PGMCHANGE;
+                inEv.value = raw.data[1];
+            }
+            else if (status == 0xd0) {
+                inEv.type = EV_CHANPRESS;
+                inEv.value = raw.data[1];
+            }
+            else {
+                inEv.type = EV_PITCHBEND;
+                inEv.value = inEv.value * 128 + raw.data[1] - 8192;
+            }
+
+            bool unmatched = midi_event_received(inEv);
+
+            if (unmatched && forwardUnmatched) {
+                capture.record(inEv, m_current_tick, portUnmatched,
+                        CAPTURE_OUT);
+                RawEvent fwd = raw;
+                fwd.tick = m_current_tick;
+                fwd.port = portUnmatched;
+                output.push_back(fwd);
+            }
+        }
+        else {
+            const bool echo_from_trig = echoQueue.next();
+            const uint64_t echo_tick = echoQueue.nextTick();
+            echoQueue.pop();
+            if (echo_tick > m_current_tick) {
+                m_current_tick = echo_tick;
+                sameTickEchoes = 0;
+            }
+            /* guard against a module requesting the same tick forever **/
+            if (++sameTickEchoes > echoQueue.capacity()) {
+                printf("WARNING: Echo loop at tick %llu. Echo dropped.\n",
+                        (unsigned long long)m_current_tick);
+                continue;
+            }
+            tick_callback(echo_from_trig);
+        }
+    }
+    if (end_tick > m_current_tick) m_current_tick = end_tick;
+    outputEvents(end_tick);
+}
+
+void OfflineDriver::flush()
+{
+    outputEvents(UINT64_MAX);
+}
+
+void OfflineDriver::outputEvents(uint64_t end_tick)
+{
+    while (!evQueue.isEmpty() && (evQueue.nextTick() < end_tick)) {
+        const OutEvent outEv = evQueue.next();
+        const uint64_t tick = evQueue.nextTick();
+        evQueue.pop();
+        appendOutput(outEv.ev, tick, outEv.port);
+    }
+}
+
+void OfflineDriver::appendOutput(const MidiEvent& ev, uint64_t tick, unsigned int port)
+{
+    RawEvent raw;
+    raw.tick = tick;
+    raw.port = port;
+    raw.size = 3;
+    raw.data[2] = ev.value;        /* velocity / value **/
+    raw.data[1] = ev.data;         /* note / controller **/
+    if (ev.type == EV_NOTEON) {
+        if (ev.value) {
+            raw.data[0] = 0x90;
+        }
+        else {
+            raw.data[0] = 0x80;
+            raw.data[2] = 127;
+        }
+    }
+    else if (ev.type == EV_CONTROLLER) raw.data[0] = 0xb0;
+    else return;
+    raw.data[0] += ev.channel;
+    output.push_back(raw);
+}
+
+void OfflineDriver::sendMidiEvent(MidiEvent ev, uint64_t n_tick, unsigned outport, unsigned duration)
+{
+    capture.record(ev, n_tick, outport, CAPTURE_OUT, duration);
+    OutEvent outEv;
+    outEv.ev = ev;
+    outEv.port = outport;
+    const int rank = outputPriority(ev.type);
+
+    if (evQueue.count() > evQueue.capacity() - 2) {
+        rtStats.eventOverflows.fetch_add(1, std::memory_order_relaxed);
+        evQueue.clear();
+    }
+    evQueue.push(n_tick, outEv, rank);
+
+    if ((ev.type == EV_NOTEON) && (ev.value)) {
+        outEv.ev.value = 0;
+        evQueue.push(n_tick + (duration / 4), outEv, rank);
+    }
+}
+
+bool OfflineDriver::requestEchoAt(uint64_t echo_tick, bool echo_from_trig)
+{
+    if (echoQueue.count() > echoQueue.capacity() - 1) {
+        rtStats.echoOverflows.fetch_add(1, std::memory_order_relaxed);
+        echoQueue.clear();
+    }
+    if ((echo_tick == lastSchedTick) && (echo_tick)) return false;
+    echoQueue.push(echo_tick, echo_from_trig);
+    lastSchedTick = echo_tick;
+
+    return true;
+}
+
+void OfflineDriver::setTransportStatus(bool on)
+{
+    tempo = internalTempo;
+
+    if (on) {
+        m_current_tick = 0;
+        lastSchedTick = 0;
+        sameTickEchoes = 0;
+        echoQueue.clear();
+        evQueue.clear();
+    }
+    queueStatus = on;
+}
@@ -0,0 +1,129 @@
+/*!
+ * @file offlinedriver.h
+ * @brief Header for the OfflineDriver class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#ifndef OFFLINEDRIVER_H
+#define OFFLINEDRIVER_H
+
+#include "config.h"
+#include <vector>
+
+#include "main.h"
+#include "driverbase.h"
+#include "tickqueue.h"
+
+/*!
+ * The OfflineDriver class is a backend without MIDI interface and
+ * without realtime clock. Its tick only advances when process() is
+ * called, so that a session is rendered as fast as the engine
+ * computes it.
+ *
+ * Input events are queued in advance with queueInput() as raw MIDI
+ * messages and passed to the engine callback when the clock reaches
+ * their tick. Echo requests are kept in a TickQueue like in JackDriver,
+ * and the engine tick callback is called at the exact tick of each
+ * echo. The events sent by the engine are converted to raw MIDI
+ * messages in the same way as by JackDriver and collected in
+ * OfflineDriver::output in tick order, once the clock has passed their
+ * tick.
+ *
+ * The DIN bandwidth model of the output ports and the MIDI clock output
+ * are not applied, they only concern the timing on a real interface.
+ *
+ * @brief Backend rendering a session with a virtual clock
+ */
+class OfflineDriver : public DriverBase
+{
+  public:
+    /*! @brief Raw MIDI message at a tick */
+    struct RawEvent {
+        uint64_t tick;
+        unsigned int port;
+        int size;
+        unsigned char data[3];
+    };
+
+  private:
+    /*! @brief Element of the output event queue */
+    struct OutEvent {
+        MidiEvent ev;
+        unsigned int port;
+    };
+
+    uint64_t lastSchedTick;
+    int sameTickEchoes;     /**< Echoes handled in a row at the current tick */
+    TickQueue<bool> echoQueue;
+    TickQueue<OutEvent> evQueue;
+    std::vector<RawEvent> input;
+    unsigned int inputIndex;   /**< Next event in input to be passed to the engine */
+
+    void outputEvents(uint64_t end_tick);
+    void appendOutput(const MidiEvent& ev, uint64_t tick, unsigned int port);
+
+  public:
+    OfflineDriver(int p_portCount,
+            void * callback_context,
+            bool (* midi_event_received_callback)(void * context, MidiEvent ev),
+            void (* tick_callback)(void * context, bool echo_from_trig));
+
+    std::vector<RawEvent> output; /**< Rendered events in tick order */
+
+/*!
+* @brief queues an input message to be received at a given tick
+*
+* Messages have to be queued in ascending tick order. Only channel
+* messages are accepted, others are ignored.
+*
+* @param tick Tick at which the message is received
+* @param data Status and data bytes of the message
+* @param size Number of bytes in data
+*/
+    void queueInput(uint64_t tick, const unsigned char *data, int size);
+/*!
+* @brief advances the clock up to end_tick
+*
+* Passes the input events and handles the echoes before end_tick in
+* tick order, input events first if both are due at the same tick.
+* The events sent until then are moved to OfflineDriver::output.
+*
+* @param end_tick Tick at which the clock stops, not included
+*/
+    void process(uint64_t end_tick);
+/*!
+* @brief moves all remaining queued events to OfflineDriver::output
+*
+* Used at the end of a rendering, so that pending note offs are
+* not lost.
+*/
+    void flush();
+/*! @brief returns the tick of the last queued input event */
+    uint64_t inputEndTick() const;
+
+    void sendMidiEvent(MidiEvent ev, uint64_t n_tick, unsigned int outport, unsigned int duration = 0);
+    bool requestEchoAt(uint64_t echoTick, bool echo_from_trig = 0);
+    void setTransportStatus(bool run);
+    int getClientId() { return 0; }
+    bool callJack(int portcount, const QString & clientname=PACKAGE);
+};
+
+#endif
@@ -0,0 +1,355 @@
+/*!
+ * @file paintbench.cpp
+ * @brief Display paint benchmark, built by "make paintbench"
+ *
+ *      Renders the module screens and cursors offscreen and writes the
+ *      cost of a full repaint, a repaint from the cached static layers
+ *      and a playhead step as JSON, so that they can be compared between
+ *      releases.
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <getopt.h>
+#include <vector>
+#include <QApplication>
+#include <QImage>
+#include <QRegion>
+#include <QString>
+#include <QStringList>
+
+#include "arpscreen.h"
+#include "lfoscreen.h"
+#include "seqscreen.h"
+#include "cursor.h"
+#include "midiarp.h"
+#include "midilfo.h"
+#include "midiseq.h"
+#include "main.h"
+
+typedef std::chrono::steady_clock BenchClock;
+
+/*! @brief Timings of one module display in ns per paint */
+struct PaintResult {
+    double uncached;        /**< Full repaint drawing all layers */
+    double cached;          /**< Full repaint from the cached static layers */
+    double playhead;        /**< Playhead step, dirty area only */
+    double playheadFull;    /**< Playhead step repainting the whole widget */
+    double playheadPixels;  /**< Mean dirty area of a playhead step */
+};
+
+/*! @brief returns the area to render for a paint number */
+typedef std::function<QRect(int)> PaintStep;
+
+static struct option options[] = {
+    {"help", 0, 0, 'h'},
+    {"size", 1, 0, 's'},
+    {"lfo-res", 1, 0, 'r'},
+    {"paints", 1, 0, 'p'},
+    {"repeat", 1, 0, 'n'},
+    {"output", 1, 0, 'o'},
+    {0, 0, 0, 0}
+};
+
+/* pattern without chords, so that each digit and pause is a cursor step */
+static const char benchPattern[] = "0123>01230123<+0-0p";
+
+static int64_t elapsedNs(BenchClock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            BenchClock::now() - start).count();
+}
+
+static bool parseList(const char *arg, std::vector<int> *list, int min, int max)
+{
+    const QStringList values = QString(arg).split(',', QString::SkipEmptyParts);
+    list->clear();
+    for (int l1 = 0; l1 < values.count(); l1++) {
+        bool ok;
+        int val = values.at(l1).toInt(&ok);
+        if (!ok || (val < min) || (val > max)) {
+            qWarning("Invalid value %s, allowed are %d to %d",
+                    qPrintable(values.at(l1)), min, max);
+            return false;
+        }
+        list->push_back(val);
+    }
+    return !list->empty();
+}
+
+static bool isLfoRes(int res)
+{
+    for (unsigned int l1 = 0; l1 < sizeof(lfoResValues)/sizeof(lfoResValues[0]); l1++) {
+        if (lfoResValues[l1] == res) return true;
+    }
+    return false;
+}
+
+/*!
+* @brief renders a widget into an offscreen image in a loop
+*
+* @param widget Widget to render
+* @param step Called before each paint, returns the area to render
+* @param paints Number of paints of each run
+* @param repeat Number of runs, the best is kept
+* @param pixels If not NULL, receives the mean rendered area
+* @return Nanoseconds per paint
+*/
+static double paintBench(QWidget *widget, const PaintStep& step, int paints,
+        int repeat, double *pixels = NULL)
+{
+    QImage image(widget->size(), QImage::Format_ARGB32_Premultiplied);
+    int64_t best = -1;
+    int64_t area = 0;
+
+    for (int l2 = 0; l2 < repeat; l2++) {
+        int64_t ns = 0;
+        area = 0;
+        for (int l1 = 0; l1 < paints; l1++) {
+            const QRect r = step(l1) & widget->rect();
+            area += r.width() * r.height();
+            BenchClock::time_point start = BenchClock::now();
+            if (!r.isEmpty()) widget->render(&image, r.topLeft(), QRegion(r),
+                    QWidget::DrawChildren);
+            ns += elapsedNs(start);
+        }
+        if ((best < 0) || (ns < best)) best = ns;
+    }
+    if (pixels) *pixels = (double)area / paints;
+    return (double)best / paints;
+}
+
+/*!
+* @brief measures a module screen and the widget holding its playhead
+*
+* @param screen Screen with its data set
+* @param refresh Sets the same data again, which invalidates the cache
+* @param playhead Widget showing the playhead, the screen for the arp
+* @param advance Moves the playhead one step and returns the dirty area
+*/
+static PaintResult moduleBench(Screen *screen, const std::function<void()>& refresh,
+        QWidget *playhead, const PaintStep& advance, int paints, int repeat)
+{
+    PaintResult res;
+
+    res.uncached = paintBench(screen,
+            [&](int) { refresh(); return screen->rect(); }, paints, repeat);
+    res.cached = paintBench(screen,
+            [&](int) { return screen->rect(); }, paints, repeat);
+    res.playhead = paintBench(playhead, advance, paints, repeat,
+            &res.playheadPixels);
+    /* before the cache each playhead step redrew every layer */
+    res.playheadFull = paintBench(playhead, [&](int l1) {
+                advance(l1);
+                if (playhead == screen) refresh();
+                return playhead->rect();
+            }, paints, repeat);
+    return res;
+}
+
+static void writeResult(FILE *out, const char *module, int res, QWidget *screen,
+        const PaintResult& r, bool last)
+{
+    fprintf(out, "    {\"module\": \"%s\", \"res\": %d, \"width\": %d, "
+            "\"height\": %d, \"ns_uncached\": %.0f, \"ns_cached\": %.0f, "
+            "\"ns_playhead\": %.0f, \"ns_playhead_full\": %.0f, "
+            "\"playhead_pixels\": %.0f}%s\n",
+            module, res, screen->width(), screen->height(), r.uncached,
+            r.cached, r.playhead, r.playheadFull, r.playheadPixels,
+            last ? "" : ",");
+}
+
+/*! @brief returns the dirty area of a Cursor and clears it like updateDraw() */
+static QRect takeDirty(Cursor *cursor)
+{
+    const QRect r = cursor->dirtyRect;
+    cursor->dirtyRect = QRect();
+    return r;
+}
+
+static void usage()
+{
+    printf("Usage: qmidiarp-paintbench [OPTION]\n\n");
+    printf("Renders the module displays offscreen, the Qt platform defaults\n");
+    printf("to \"offscreen\" unless QT_QPA_PLATFORM is set.\n\n");
+    printf("Options:\n");
+    printf("  -h, --help               Print this message\n");
+    printf("  -s, --size <w>x<h>       Size of each screen [600x250]\n");
+    printf("  -r, --lfo-res <list>     LFO resolution [16,192]\n");
+    printf("  -p, --paints <num>       Paints of each measurement [2000]\n");
+    printf("  -n, --repeat <num>       Runs of each measurement, the best is kept [3]\n");
+    printf("  -o, --output <file>      Write the JSON results to file [stdout]\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int getopt_return;
+    int option_index;
+    int width = 600;
+    int height = 250;
+    std::vector<int> lfoRes = {16, 192};
+    int paints = 2000;
+    int repeat = 3;
+    const char *outName = NULL;
+    bool ok = true;
+    QStringList size;
+
+    /* no display is needed, an explicit platform is kept */
+    setenv("QT_QPA_PLATFORM", "offscreen", 0);
+    QApplication app(argc, argv);
+
+    while ((getopt_return = getopt_long(argc, argv, "hs:r:p:n:o:", options,
+                    &option_index)) >= 0) {
+        switch(getopt_return) {
+            case 'h':
+                usage();
+                return EXIT_SUCCESS;
+            case 's':
+                size = QString(optarg).split('x');
+                if (size.count() != 2) {
+                    ok = false;
+                    break;
+                }
+                width = size.at(0).toInt();
+                height = size.at(1).toInt();
+                break;
+            case 'r':
+                ok &= parseList(optarg, &lfoRes, 1, 192);
+                break;
+            case 'p':
+                paints = atoi(optarg);
+                break;
+            case 'n':
+                repeat = atoi(optarg);
+                break;
+            case 'o':
+                outName = optarg;
+                break;
+            default:
+                usage();
+                return EXIT_FAILURE;
+        }
+    }
+    for (unsigned int l1 = 0; l1 < lfoRes.size(); l1++) {
+        if (!isLfoRes(lfoRes[l1])) {
+            qWarning("LFO resolution %d is not one of the GUI values", lfoRes[l1]);
+            ok = false;
+        }
+    }
+    if (!ok || (width < 2 * SCR_HMARG + 1) || (height < CSR_MIN_H)
+            || (paints < 1) || (repeat < 1)) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    FILE *out = stdout;
+    if (outName && !(out = fopen(outName, "w"))) {
+        qWarning("Could not open %s for writing", outName);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "{\n  \"program\": \"qmidiarp-paintbench\",\n");
+    fprintf(out, "  \"version\": \"%s\",\n", PACKAGE_VERSION);
+    fprintf(out, "  \"platform\": \"%s\",\n", getenv("QT_QPA_PLATFORM"));
+    fprintf(out, "  \"paints\": %d,\n  \"repeat\": %d,\n", paints, repeat);
+    fprintf(out, "  \"modules\": [\n");
+
+    /* arp, the cursor is drawn by the screen itself */
+    {
+        const QString pattern(benchPattern);
+        MidiArp arp;
+        ArpScreen screen;
+        int steps = 0;
+
+        arp.updatePattern(pattern.toStdString());
+        for (int l1 = 0; l1 < pattern.length(); l1++) {
+            if (pattern.at(l1).isDigit() || (pattern.at(l1) == 'p')) steps++;
+        }
+        auto refresh = [&]() {
+            screen.updateData(pattern, arp.minOctave, arp.maxOctave,
+                    arp.minStepWidth, arp.nSteps, arp.patternMaxIndex);
+        };
+        screen.resize(width, height);
+        refresh();
+        PaintResult r = moduleBench(&screen, refresh, &screen, [&](int l1) {
+                    screen.updateCursor(l1 % steps);
+                    const QRect dirty = screen.dirtyRect;
+                    screen.dirtyRect = QRect();
+                    return dirty;
+                }, paints, repeat);
+        writeResult(out, "arp", 0, &screen, r, false);
+        fflush(out);
+    }
+
+    /* LFO for each resolution, with a separate cursor widget */
+    for (unsigned int l2 = 0; l2 < lfoRes.size(); l2++) {
+        MidiLfo lfo;
+        std::vector<Sample> sdata;
+        LfoScreen screen;
+        Cursor cursor('L');
+
+        lfo.updateResolution(lfoRes[l2]);
+        lfo.getData(&sdata);
+        const QVector<Sample> data = QVector<Sample>::fromStdVector(sdata);
+        screen.resize(width, height);
+        screen.updateData(data);
+        cursor.resize(width, CSR_MIN_H);
+        cursor.updateNumbers(lfo.res, lfo.size);
+        const int steps = lfo.res * lfo.size;
+
+        PaintResult r = moduleBench(&screen, [&]() { screen.updateData(data); },
+                &cursor, [&](int l1) {
+                    cursor.updatePosition(l1 % steps);
+                    return takeDirty(&cursor);
+                }, paints, repeat);
+        writeResult(out, "lfo", lfoRes[l2], &screen, r, false);
+        fflush(out);
+    }
+
+    /* seq at its default resolution, with a separate cursor widget */
+    {
+        MidiSeq seq;
+        std::vector<Sample> sdata;
+        SeqScreen screen;
+        Cursor cursor('S');
+
+        seq.getData(&sdata);
+        const QVector<Sample> data = QVector<Sample>::fromStdVector(sdata);
+        screen.resize(width, height);
+        screen.updateData(data);
+        cursor.resize(width, CSR_MIN_H);
+        cursor.updateNumbers(seq.res, seq.size);
+        const int steps = seq.res * seq.size;
+
+        PaintResult r = moduleBench(&screen, [&]() { screen.updateData(data); },
+                &cursor, [&](int l1) {
+                    cursor.updatePosition(l1 % steps);
+                    return takeDirty(&cursor);
+                }, paints, repeat);
+        writeResult(out, "seq", seq.res, &screen, r, true);
+    }
+    fprintf(out, "  ]\n}\n");
+
+    if (out != stdout) fclose(out);
+    return EXIT_SUCCESS;
+}
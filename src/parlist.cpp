@@ -0,0 +1,425 @@
+/*!
+ * @file parlist.cpp
+ * @brief Implements the ParList class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#include <QByteArray>
+
+#include "parlist.h"
+
+ParList::ParList()
+{
+    // when temp.empty is true, restoring from that set is ignored
+    temp.empty = false;
+    temp.muteOut = false;
+    temp.res = 1;
+    temp.size = 0;
+    temp.loopMode = 0;
+    temp.nRepetitions = 1;
+    temp.waveForm = 0;
+    temp.portOut = 0;
+    temp.channelOut = 0;
+    temp.chIn = 0;
+    temp.wave = CompactWave();
+    /* LFO Modules */
+    temp.ccnumber = -1;
+    temp.ccnumberIn = -1;
+    temp.freq = 0;
+    temp.ampl = 0;
+    temp.offs = 0;
+    temp.phase = 0;
+    /* Seq Modules */
+    temp.loopMarker = 0;
+    temp.notelen = 0;
+    temp.vel = 0;
+    temp.transp = 0;
+    temp.dispVertIndex = 0;
+    /* Arp Modules */
+    temp.indexIn0 = 0;
+    temp.indexIn1 = 127;
+    temp.rangeIn0 = 0;
+    temp.rangeIn1 = 127;
+    temp.attack = 0;
+    temp.release = 0;
+    temp.repeatMode = 0;
+    temp.rndTick = 0;
+    temp.rndLen = 0;
+    temp.rndVel = 0;
+    temp.pattern = "";
+
+    engineRunning = false;
+    isRestoreMaster = false;
+    restoreRequest = -1;
+    oldRestoreRequest = 0;
+    isManualRequest = false;
+    isForcedToStay = false;
+    restoreRunOnce = false;
+    activeStore = 0;
+    currentRequest = 0;
+    dispReqIx = 0;
+    dispReqSelected = 0;
+    needsGUIUpdate = false;
+}
+
+void ParList::writeData(QXmlStreamWriter& xml)
+{
+    QByteArray tempArray;
+
+    xml.writeStartElement("globalStores");
+
+    for (int ix = 0; ix < list.size(); ix++) {
+        xml.writeStartElement("parStore");
+        xml.writeAttribute("ID", QString::number(ix));
+            xml.writeTextElement("empty", QString::number(list.at(ix).empty));
+            xml.writeTextElement("muteOut", QString::number(list.at(ix).muteOut));
+            xml.writeTextElement("res", QString::number(list.at(ix).res));
+            xml.writeTextElement("size", QString::number(list.at(ix).size));
+            xml.writeTextElement("loopMode", QString::number(list.at(ix).loopMode));
+            xml.writeTextElement("waveForm", QString::number(list.at(ix).waveForm));
+            xml.writeTextElement("portOut", QString::number(list.at(ix).portOut));
+            xml.writeTextElement("channelOut", QString::number(list.at(ix).channelOut));
+            xml.writeTextElement("chIn", QString::number(list.at(ix).chIn));
+            xml.writeTextElement("ccnumber", QString::number(list.at(ix).ccnumber));
+            xml.writeTextElement("ccnumberIn", QString::number(list.at(ix).ccnumberIn));
+            xml.writeTextElement("freq", QString::number(list.at(ix).freq));
+            xml.writeTextElement("ampl", QString::number(list.at(ix).ampl));
+            xml.writeTextElement("offs", QString::number(list.at(ix).offs));
+            xml.writeTextElement("phase", QString::number(list.at(ix).phase));
+            xml.writeTextElement("loopMarker", QString::number(list.at(ix).loopMarker));
+            xml.writeTextElement("notelen", QString::number(list.at(ix).notelen));
+            xml.writeTextElement("vel", QString::number(list.at(ix).vel));
+            xml.writeTextElement("dispVertical", QString::number(list.at(ix).dispVertIndex));
+            xml.writeTextElement("transp", QString::number(list.at(ix).transp));
+            xml.writeTextElement("indexIn0", QString::number(list.at(ix).indexIn0));
+            xml.writeTextElement("indexIn1", QString::number(list.at(ix).indexIn1));
+            xml.writeTextElement("rangeIn0", QString::number(list.at(ix).rangeIn0));
+            xml.writeTextElement("rangeIn1", QString::number(list.at(ix).rangeIn1));
+            xml.writeTextElement("attack", QString::number(list.at(ix).attack));
+            xml.writeTextElement("release", QString::number(list.at(ix).release));
+            xml.writeTextElement("repeatMode", QString::number(list.at(ix).repeatMode));
+            xml.writeTextElement("rndTick", QString::number(list.at(ix).rndTick));
+            xml.writeTextElement("rndLen", QString::number(list.at(ix).rndLen));
+            xml.writeTextElement("rndVel", QString::number(list.at(ix).rndVel));
+            xml.writeTextElement("pattern", list.at(ix).pattern);
+
+            xml.writeTextElement("jumpTo", QString::number(jumpToList.at(ix)));
+            xml.writeTextElement("nRep", QString::number(nRepList.at(ix)));
+            xml.writeTextElement("onlyPattern", QString::number((int)onlyPatternList.at(ix)));
+
+            tempArray.clear();
+            int l1 = 0;
+            while (l1 < list.at(ix).wave.count()) {
+                tempArray.append(list.at(ix).wave.isMuted(l1));
+                l1++;
+            }
+            xml.writeStartElement("muteMask");
+                xml.writeTextElement("data", tempArray.toHex());
+            xml.writeEndElement();
+
+            tempArray.clear();
+            l1 = 0;
+            while (l1 < list.at(ix).wave.count()) {
+                tempArray.append(list.at(ix).wave.value(l1));
+                l1++;
+            }
+            xml.writeStartElement("wave");
+                xml.writeTextElement("data", tempArray.toHex());
+            xml.writeEndElement();
+        xml.writeEndElement();
+    }
+    xml.writeEndElement();
+}
+
+void ParList::readData(QXmlStreamReader& xml)
+{
+    int ix = 0;
+    int tmpjumpto = -2;
+    int tmpnrep = 1;
+    int tmponlypattern = 0;
+
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (xml.isEndElement())
+            break;
+
+        if (xml.isStartElement() && (xml.name() == "parStore")) {
+            while (!xml.atEnd()) {
+                xml.readNext();
+                if (xml.isEndElement())
+                    break;
+                if (xml.name() == "empty")
+                    temp.empty = xml.readElementText().toInt();
+                else if (xml.name() == "muteOut")
+                    temp.muteOut = xml.readElementText().toInt();
+                else if (xml.name() == "res")
+                    temp.res = xml.readElementText().toInt();
+                else if (xml.name() == "size")
+                    temp.size = xml.readElementText().toInt();
+                else if (xml.name() == "loopMode")
+                    temp.loopMode = xml.readElementText().toInt();
+                else if (xml.name() == "waveForm")
+                    temp.waveForm = xml.readElementText().toInt();
+                else if (xml.name() == "portOut")
+                    temp.portOut = xml.readElementText().toInt();
+                else if (xml.name() == "channelOut")
+                    temp.channelOut = xml.readElementText().toInt();
+                else if (xml.name() == "chIn")
+                    temp.chIn = xml.readElementText().toInt();
+                else if (xml.name() == "ccnumber")
+                    temp.ccnumber = xml.readElementText().toInt();
+                else if (xml.name() == "ccnumberIn")
+                    temp.ccnumberIn = xml.readElementText().toInt();
+                else if (xml.name() == "freq")
+                    temp.freq = xml.readElementText().toInt();
+                else if (xml.name() == "ampl")
+                    temp.ampl = xml.readElementText().toInt();
+                else if (xml.name() == "offs")
+                    temp.offs = xml.readElementText().toInt();
+                else if (xml.name() == "phase")
+                    temp.phase = xml.readElementText().toInt();
+                else if (xml.name() == "vel")
+                    temp.vel = xml.readElementText().toInt();
+                else if (xml.name() == "dispVertical")
+                    temp.dispVertIndex = xml.readElementText().toInt();
+                else if (xml.name() == "transp")
+                    temp.transp = xml.readElementText().toInt();
+                else if (xml.name() == "notelen")
+                    temp.notelen = xml.readElementText().toInt();
+                else if (xml.name() == "loopMarker")
+                    temp.loopMarker = xml.readElementText().toInt();
+                else if (xml.name() == "indexIn0")
+                    temp.indexIn0 = xml.readElementText().toInt();
+                else if (xml.name() == "indexIn1")
+                    temp.indexIn1 = xml.readElementText().toInt();
+                else if (xml.name() == "rangeIn0")
+                    temp.rangeIn0 = xml.readElementText().toInt();
+                else if (xml.name() == "rangeIn1")
+                    temp.rangeIn1 = xml.readElementText().toInt();
+                else if (xml.name() == "attack")
+                    temp.attack = xml.readElementText().toInt();
+                else if (xml.name() == "release")
+                    temp.release = xml.readElementText().toInt();
+                else if (xml.name() == "repeatMode")
+                    temp.repeatMode = xml.readElementText().toInt();
+                else if (xml.name() == "rndTick")
+                    temp.rndTick = xml.readElementText().toInt();
+                else if (xml.name() == "rndLen")
+                    temp.rndLen = xml.readElementText().toInt();
+                else if (xml.name() == "rndVel")
+                    temp.rndVel = xml.readElementText().toInt();
+                else if (xml.name() == "pattern")
+                    temp.pattern = xml.readElementText();
+                else if (xml.name() == "jumpTo")
+                    tmpjumpto = xml.readElementText().toInt();
+                else if (xml.name() == "nRep")
+                    tmpnrep = xml.readElementText().toInt();
+                else if (xml.name() == "onlyPattern")
+                    tmponlypattern = xml.readElementText().toInt();
+                else if (xml.isStartElement() && (xml.name() == "muteMask")) {
+                    while (!xml.atEnd()) {
+                        xml.readNext();
+                        if (xml.isEndElement())
+                            break;
+                        if (xml.isStartElement() && (xml.name() == "data")) {
+                            QByteArray tmpArray =
+                                    QByteArray::fromHex(xml.readElementText().toLatin1());
+                            temp.wave = CompactWave(tmpArray.count());
+                            for (int l1 = 0; l1 < tmpArray.count(); l1++) {
+                                temp.wave.setMuted(l1, tmpArray.at(l1));
+                            }
+                        }
+                        else skipXmlElement(xml);
+                    }
+                }
+                else if (xml.isStartElement() && (xml.name() == "wave")) {
+                    while (!xml.atEnd()) {
+                        xml.readNext();
+                        if (xml.isEndElement())
+                            break;
+                        if (xml.isStartElement() && (xml.name() == "data")) {
+                            QByteArray tmpArray =
+                                    QByteArray::fromHex(xml.readElementText().toLatin1());
+                            /* the mute mask was read before and sets the size */
+                            for (int l1 = 0; (l1 < tmpArray.count())
+                                    && (l1 < temp.wave.count()); l1++) {
+                                temp.wave.setValue(l1, tmpArray.at(l1));
+                            }
+                        }
+                        else skipXmlElement(xml);
+                    }
+                }
+                else skipXmlElement(xml);
+            }
+            //For compatibility with files stored before all modules got
+            //Note filters:
+            if (!(temp.indexIn0 + temp.indexIn1)) temp.indexIn1 = 127;
+            if (!(temp.rangeIn0 + temp.rangeIn1)) temp.rangeIn1 = 127;
+            tempToList(ix);
+            updateRunOnce(ix, tmpjumpto);
+            updateNRep(ix, tmpnrep);
+            onlyPatternList.replace(ix, tmponlypattern);
+            ix++;
+        }
+    }
+}
+
+void ParList::skipXmlElement(QXmlStreamReader& xml)
+{
+    if (xml.isStartElement()) {
+        qWarning("Unknown Element in XML File: %s",qPrintable(xml.name().toString()));
+        while (!xml.atEnd()) {
+            xml.readNext();
+
+            if (xml.isEndElement())
+                break;
+
+            if (xml.isStartElement()) {
+                skipXmlElement(xml);
+            }
+        }
+    }
+}
+
+void ParList::addLocation()
+{
+    jumpToList.append(-2);
+    nRepList.append(1);
+    onlyPatternList.append(false);
+}
+
+void ParList::removeLocation(int ix)
+{
+    if (ix == -1) ix = list.count() - 1;
+    if ((ix < 0) || (ix >= list.count())) return;
+
+    list.removeAt(ix);
+    jumpToList.removeAt(ix);
+    nRepList.removeAt(ix);
+    onlyPatternList.removeAt(ix);
+
+    for (int l1 = 0; l1 < jumpToList.count(); l1++) {
+        if (jumpToList.at(l1) >= jumpToList.count()) updateRunOnce(l1, -2);
+    }
+
+    const int last = (list.count()) ? list.count() - 1 : 0;
+    if (activeStore > last) activeStore = last;
+    if (currentRequest > last) currentRequest = last;
+    if (oldRestoreRequest > last) oldRestoreRequest = last;
+    if (restoreRequest > last) restoreRequest = -1;
+}
+
+void ParList::setRestoreRequest(int ix, bool forcestay)
+{
+    if (ix >= list.count()) return;
+
+    restoreRequest = ix;
+    isManualRequest = true;
+    isForcedToStay = forcestay;
+    restoreRunOnce = (jumpToList.at(ix) > -2 );
+
+    setDispState(ix, 2);
+}
+
+void ParList::updateNRep(int location, int nrep)
+{
+    nRepList.replace(location, nrep);
+}
+
+void ParList::updateRunOnce(int location, int choice)
+{
+    if (choice < -2) return;
+    jumpToList.replace(location, choice);
+}
+
+void ParList::tempToList(int ix)
+{
+    if (ix >= list.size()) {
+        list.append(temp);
+        addLocation();
+    }
+    else {
+        list.replace(ix, temp);
+    }
+    currentRequest = ix;
+    setDispState(ix, 1);
+}
+
+void ParList::setDispState(int ix, int selected)
+{
+    if (selected == 1) {
+        activeStore = ix;
+    }
+    else if (selected == 2) {
+        currentRequest = ix;
+    }
+}
+
+void ParList::requestDispState(int ix, int selected)
+{
+    dispReqIx = ix;
+    dispReqSelected = selected;
+    needsGUIUpdate = true;
+}
+
+int ParList::updateRestore(int frame, int nframes, bool repetitionsFinished,
+        bool reverse)
+{
+    int restored = -1;
+
+    if (needsGUIUpdate) {
+        needsGUIUpdate = false;
+        setDispState(dispReqIx, dispReqSelected);
+    }
+
+    if (restoreRequest >= 0) {
+        if (!engineRunning || (!frame && repetitionsFinished)) {
+            restored = restoreRequest;
+            setDispState(restored, 1);
+            isManualRequest = false;
+            restoreRequest = -1;
+            if (!restoreRunOnce) {
+                oldRestoreRequest = restored;
+            }
+            if (isForcedToStay) {
+                isForcedToStay = false;
+                isManualRequest = true;
+            }
+        }
+    }
+
+    if (!engineRunning) return restored;
+
+    if ((restoreRequest != oldRestoreRequest) && restoreRunOnce && !isManualRequest) {
+        if ((frame == 1 && !reverse) || ((frame == nframes - 1) && reverse)){
+           if (jumpToList.at(activeStore) >= 0) {
+                restoreRequest = jumpToList.at(activeStore);
+                oldRestoreRequest = restoreRequest;
+            }
+            else {
+                restoreRequest = oldRestoreRequest;
+            }
+            restoreRunOnce = (jumpToList.at(restoreRequest) > -2);
+            setDispState(restoreRequest, 2);
+        }
+    }
+    return restored;
+}
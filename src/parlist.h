@@ -0,0 +1,245 @@
+/*!
+ * @file parlist.h
+ * @brief Member definitions for the ParList class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#ifndef PARLIST_H
+#define PARLIST_H
+
+#include <QList>
+#include <QString>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+#include "compactwave.h"
+
+/*! @brief Parameter storage locations of one module
+ *
+ * ParList holds the module parameter fields stored in each location,
+ * the jump and repetition settings of the locations and the state of
+ * the pending restores. It reads and writes the globalStores element
+ * of the module in .qmax files and decides when a location has to be
+ * restored.
+ *
+ * ParList has no GUI. ParStore derives from it and adds the storage
+ * buttons and their menus, the headless session uses it as it is. The
+ * virtual functions are those which change the location buttons in
+ * ParStore.
+ */
+class ParList
+{
+  public:
+    ParList();
+    virtual ~ParList() { }
+
+/*! List of jumpTo configurations for each location
+*    @see ParList::updateRunOnce()
+*/
+    QList<int> jumpToList;
+/*! List of the number of repetitions the module performs before restoring
+*    @see ParList::updateNRep()
+*/
+    QList<int> nRepList;
+/*! List of switch configuration for each location, if set only the
+*   pattern is restored
+*/
+    QList<bool> onlyPatternList;
+
+    int activeStore; /**< Currently active location index*/
+    int currentRequest; /**< Currently pending location index*/
+    bool isRestoreMaster; /**< @brief Indicates whether this module triggers global restores */
+    bool engineRunning; /**< @brief Set by engine when changing running state*/
+    bool isManualRequest; /**< @brief Set to true when restore button pressed, set to false when restore done*/
+    bool isForcedToStay; /**< @brief Set to true when Stay area was clicked on restore button, overrides automatic jumps*/
+
+    struct TempStore {
+        bool empty;
+        bool muteOut;
+        int res;
+        int size;
+        int loopMode;
+        int nRepetitions;
+        int waveForm;
+        int portOut;
+        int channelOut;
+        int chIn;
+        CompactWave wave;
+        /* LFO Modules */
+        int ccnumber;
+        int ccnumberIn;
+        int freq;
+        int ampl;
+        int offs;
+        int phase;
+        /* Seq Modules */
+        int loopMarker;
+        int notelen;
+        int vel;
+        int transp;
+        int dispVertIndex;
+        /* Arp Modules */
+        int indexIn0;
+        int indexIn1;
+        int rangeIn0;
+        int rangeIn1;
+        int attack;
+        int release;
+        int repeatMode;
+        int rndTick;
+        int rndLen;
+        int rndVel;
+        QString pattern;
+    };
+    TempStore temp; /**< Structure to which all module parameters are copied
+                        * before being appended to the ParList::list*/
+    QList<TempStore> list; /**< List of TempStore structures for
+                        parameter storage*/
+
+/*! When this variable is greater than -1, ParList::updateRestore() will
+* return it at pattern end
+*/
+    int restoreRequest;
+    int oldRestoreRequest; /**< Contains the last active location for jumping back*/
+/*!
+* Signals to ParList::updateRestore() that only one
+* run is done and then a restore is required.
+*/
+    bool restoreRunOnce;
+/*! Signals to ParList::updateRestore() that the location
+* display state has to be updated.
+*/
+    bool needsGUIUpdate;
+/*! When ParList::needsGUIUpdate is true, ParList::updateRestore()
+* sets the display state to these values
+*/
+    int dispReqIx, dispReqSelected;
+
+/*!
+* @brief stores ParList::temp in ParList::list at index ix. If the given
+* index is greater than the list size, temp is appended to ParList::list.
+*
+* @param ix Index at which the parameters are stored.
+*/
+    void tempToList(int ix);
+/*!
+* @brief reads the ParList::list from the globalStores element of an
+* XML stream
+*
+* @param xml QXmlStreamReader to read from
+*/
+    void readData(QXmlStreamReader& xml);
+/*!
+* @brief writes the ParList::list as globalStores element to an XML
+* stream
+*
+* @param xml QXmlStreamWriter to write to
+*/
+    void writeData(QXmlStreamWriter& xml);
+/*!
+* @brief sets ParList::restoreRequest and ParList::restoreRunOnce to the
+* location specified
+*
+* This will cause ParList::updateRestore() to return the location on
+* its next call at pattern end
+*
+* @param ix Location index to be restored at pattern end
+* @param forcestay If set, automatic jumps are suspended after the restore
+*/
+    void setRestoreRequest(int ix, bool forcestay);
+/*!
+* @brief will cause a flag to be set, which causes ParList::updateRestore()
+*  to call ParList::setDispState() at the next occasion.
+*
+* This function is used by the controller handlers, since setDispState()
+* cannot be called directly from the realtime thread which sends the controller.
+*
+* @param ix Storage index of the location to act on
+* @param selected Display state, 1 = active, 2 = pending
+*/
+    void requestDispState(int ix, int selected);
+/*!
+* @brief handles the pending and automatic restores, called
+* periodically outside the realtime thread
+*
+* @param frame Current frame position of the module
+* @param nframes Number of frames in the module
+* @param repetitionsFinished Set to True when at the end of the repetitions cycle
+* @param reverse Set to true if the module currently plays backward
+* @return Location the module has to restore now, -1 if none
+*/
+    int updateRestore(int frame, int nframes, bool repetitionsFinished,
+            bool reverse);
+
+/*!
+* @brief appends the jump and repetition settings of a new location
+*/
+    virtual void addLocation();
+/*!
+* @brief removes a location from ParList::list and its settings
+*
+* Jumps to locations that no longer exist are reset to "Stay here".
+*
+* @param ix Location index to be removed, -1 for the last one
+*/
+    virtual void removeLocation(int ix);
+/*!
+* @brief configures the location behavior at pattern end
+*
+* The choices are -2 for "Stay here" (no jumps at pattern end), -1 for
+* returning to the previous location (ParList::oldRestoreRequest) or (if
+* zero or above) the location to jump to at pattern end. The choice value is
+* copied to ParList::jumpToList
+*
+* @param location Location to be configured
+* @param choice -2 (no jumps), -1 (return to previous),
+* >=0 (next location to jump to)
+*/
+    virtual void updateRunOnce(int location, int choice);
+/*!
+* @brief sets the number of repetitions of a location, the nrep value
+* is copied to ParList::nRepList
+*
+* @param location Location for which the loop count is set
+* @param nrep Loop count
+*/
+    virtual void updateNRep(int location, int nrep);
+/*!
+* @brief sets the active or the pending location
+*
+* @param ix Storage index of the location
+* @param selected 1 sets ParList::activeStore, 2 sets ParList::currentRequest
+*/
+    virtual void setDispState(int ix, int selected);
+
+/*!
+* @brief allows ignoring one XML element in the XML stream
+* passed by the caller.
+*
+* It also advances the stream read-in. It is used to
+* ignore unknown elements for both-ways-compatibility
+*
+* @param xml reference to QXmlStreamReader containing the open XML stream
+*/
+    void skipXmlElement(QXmlStreamReader& xml);
+};
+
+#endif
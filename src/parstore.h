@@ -29,20 +29,20 @@
 
 #include "globstore.h"
 #include "midievent.h"
+#include "parlist.h"
 #include "storagebutton.h"
 
 
 /*!
- * ParStore holds module parameter fields in its ParStore::list. These parameter
- * fields can be read by the modules, which have a pointer to ParStore. ParStore
- * also creates storage location GUI handling for each module. Each list entry
- * is represented by a StorageButton and its associated context menu. GUI elements
- * are dynamically added to and removed from the GlobStore Widget. ParStore is 
- * midi controllable and it can save all field lists to disk. 
+ * ParStore adds the storage location GUI handling of each module to the
+ * ParList holding its parameter fields. Each list entry is represented by
+ * a StorageButton and its associated context menu. GUI elements are
+ * dynamically added to and removed from the GlobStore Widget. The
+ * virtual functions of ParList are reimplemented to update the buttons.
 
  * @brief Manages a list of module parameter fields and GUI elements
  */
-class ParStore : public QWidget
+class ParStore : public QWidget, public ParList
 {
   Q_OBJECT
 
@@ -58,128 +58,12 @@ class ParStore : public QWidget
     QToolButton *muteOut;
     QToolButton *deferChanges;
     Indicator *ndc;
-/*! List of jumpTo configurations for each location
-*    @see ParStore::updateRunOnce()
-*/
-    QList<int> jumpToList; 
-/*! List of the number of repetitions the module performs before restoring
-*    @see ParStore::updateNRep()
-*/
-    QList<int> nRepList; 
-/*! List of switch configuration for each location
-*   @see ParStore::updateOnlyPattern()
-*/
-    QList<bool> onlyPatternList;
     QMenu *locContextMenu;
     QMenu *jumpToIndexMenu;
     QMenu *nRepMenu;
     QActionGroup *jumpToGroup;
     QActionGroup *nRepGroup;
 
-    int activeStore; /**< Currently active location index*/
-    int currentRequest; /**< Currently pending location index*/
-    bool isRestoreMaster; /**< @brief Indicates whether this module triggers global restores */
-    bool engineRunning; /**< @brief Set by engine when changing running state*/
-    bool isManualRequest; /**< @brief Set to true when restore button pressed, set to false when restore done*/
-    bool isForcedToStay; /**< @brief Set to true when Stay area was clicked on restore button, overrides automatic jumps*/
-    
-    struct TempStore {
-        bool empty;
-        bool muteOut;
-        int res;
-        int size;
-        int loopMode;
-        int nRepetitions;
-        int waveForm;
-        int portOut;
-        int channelOut;
-        int chIn;
-        QVector<Sample> wave;
-        QVector<bool> muteMask;
-        /* LFO Modules */
-        int ccnumber;
-        int ccnumberIn;
-        int freq;
-        int ampl;
-        int offs;
-        int phase;
-        /* Seq Modules */
-        int loopMarker;
-        int notelen;
-        int vel;
-        int transp;
-        int dispVertIndex;
-        /* Arp Modules */
-        int indexIn0;
-        int indexIn1;
-        int rangeIn0;
-        int rangeIn1;
-        int attack;
-        int release;
-        int repeatMode;
-        int rndTick;
-        int rndLen;
-        int rndVel;
-        QString pattern;
-    };
-    TempStore temp; /**< Structure to which all module parameters are copied
-                        * before being appended to the ParStore::list*/
-    QList<TempStore> list; /**< List of TempStore structures for
-                        parameter storage*/
-
-/*! When this variable is greater than -1, ParStore::updateDisplay() will cause
-* ParStore::restoreParams(restoreRequest) at pattern end
-*/
-    int restoreRequest;
-    int oldRestoreRequest; /**< Contains the last active location for jumping back*/
-/*!
-* Signals to ParStore::updateDisplay() that only one
-* run is done and then a restore is required.
-*/
-    bool restoreRunOnce; 
-/*! Signals to ParStore::updateDisplay() that the location
-* button color has to be updated.
-*/
-    bool needsGUIUpdate; 
-/*! When ParStore::needsGUIUpdate is true, ParStore::updateDisplay()
-* sets colors to these values
-*/
-    int dispReqIx, dispReqSelected; 
-
-/*!
-* @brief stores all module parameters to ParStore::temp and stores temp
-* in ParStore::list at index ix. If the given index is greater than the list size,
-* temp is appended to ParStore::list.
-*
-* @param ix Index at which the parameters are stored.
-*/
-    void tempToList(int ix);
-/*!
-* @brief reads the ParStore::list from an XML stream
-* passed by the caller, i.e. MainWindow.
-*
-* @param xml QXmlStreamWriter to read from
-*/
-    void readData(QXmlStreamReader& xml);
-/*!
-* @brief writes the ParStore::list to an XML stream
-* passed by the caller, i.e. MainWindow.
-*
-* @param xml QXmlStreamWriter to write to
-*/
-    void writeData(QXmlStreamWriter& xml);
-
-/*!
-* @brief sets ParStore::restoreRequest and ParStore::restoreRunOnce to the
-* location specified
-*
-* This will cause ParStore::updateDisplay() to do the parameter restore on
-* its next call
-*
-* @param ix Location index to be restored at pattern end
-*/
-    void setRestoreRequest(int ix, bool forcestay);
-    
 /*!
 * @brief returns a pointer to the storage button at location index
 *
@@ -194,30 +78,10 @@ class ParStore : public QWidget
 */
     void setBGColorAt(int row, int color);
 /*!
-* @brief is called by the parent widget and part of the display timer event loop.
-
-* sets the indicator position and handles storage requests as a function of the
-* GUI requests and series parameters
-*
-* @param frame Current frame position of the parent module
-* @param nframes Number of frames in the module
-* @param set to True when at the end of the repetitions cycle
-* @param reverse Set to true if the parent module currently plays backward
-*/
-    void updateDisplay(int frame, int nframes, bool repetitionsFinished, bool reverse);
-    
-#ifdef APPBUILD
-/*!
-* @brief allows ignoring one XML element in the XML stream
-* passed by the caller.
-*
-* It also advances the stream read-in. It is used to
-* ignore unknown elements for both-ways-compatibility
-*
-* @param xml reference to QXmlStreamReader containing the open XML stream
+* @brief is called by the parent widget and part of the display timer
+* event loop. It redraws the indicator of the module.
 */
-void skipXmlElement(QXmlStreamReader& xml);
-#endif
+    void updateDisplay();
 
   signals:
 /*!
@@ -228,13 +92,6 @@ void skipXmlElement(QXmlStreamReader& xml);
 * @param empty True if no parameters are stored and only the template is added
 */
     void store(int ix, bool empty);
-/*!
-* @brief is connected to the parent widget and should cause immediate
-* parameter restore from location ix
-*
-* @param ix Storage location
-*/
-    void restore(int ix);
 
   public slots:
 
@@ -257,44 +114,44 @@ void skipXmlElement(QXmlStreamReader& xml);
 * behavior at pattern end
 *
 * The choices are -2 for "Stay here" (no jumps at pattern end), -1 for
-* returning to the previous location (ParStore::oldRestoreRequest) or (if
+* returning to the previous location (ParList::oldRestoreRequest) or (if
 * zero or above) the location to jump to at pattern end. The choice value is
-* copied to ParStore::jumpToList()
+* copied to ParList::jumpToList
 *
 * @param location Location to be configured
 * @param choice -2 (no jumps), -1 (return to previous),
 * >=0 (next location to jump to)
 */
-    void updateRunOnce(int location, int choice);
+    void updateRunOnce(int location, int choice) override;
 /*!
 * @brief called by ParStore::mapNRepGroup(). Sets the number of repetitions
 *
-* The nrep value is copied to ParStore::nRepList()
+* The nrep value is copied to ParList::nRepList
 *
 * @param location Location for which the loop count is set
 * @param nrep Loop count
 */
-    void updateNRep(int location, int nrep);
+    void updateNRep(int location, int nrep) override;
 /*!
 * @brief adds all storage location GUI elements to the widget
 *
-* It also adds a new element to the ParStore::jumpToList
+* It also adds the location settings by calling ParList::addLocation()
 */
-    void addLocation();
+    void addLocation() override;
 /*!
 * @brief removes and deletes all storage location GUI elements
 *
-* It also removes the parameter storage structure from ParStore::list and
-* the element from ParStore::jumpToList
+* It also removes the parameter storage structure from ParList::list and
+* the location settings by calling ParList::removeLocation()
 *
 * @param ix Location index to be removed
 */
-    void removeLocation(int ix);
+    void removeLocation(int ix) override;
 /*!
 * @brief slot for each location's global restore button
 *
 * Sets the location index to restore from the caller widget "index" property and
-* calls ParStore::setRestoreRequest() with that location.
+* calls ParList::setRestoreRequest() with that location.
 */
     void mapRestoreSignal();
 /*!
@@ -315,24 +172,13 @@ void skipXmlElement(QXmlStreamReader& xml);
 * @param ix Storage index of the storage button to act on
 * @param selected Color state to attribute to the button, 1 = green, 2 = blueish
 */
-    void setDispState(int ix, int selected);
-/*!
-* @brief will cause a flag to be set, which causes ParStore::updateDisplay()
-*  to call ParStore::setDispState() at the next occasion.
-*
-* This function is used by ParStore::handleController(), since setDispState()
-* cannot be called directly from the realtime thread which sends the controller.
-*
-* @param ix Storage index of the storage button to act on
-* @param selected Color state to attribute to the button, 1 = green, 2 = blueish
-*/
-    void requestDispState(int ix, int selected);
+    void setDispState(int ix, int selected) override;
 /*!
 * @brief configures and shows the context menu for individual storage locations
 *
 * This is the slot for context menu call of each individual storage button.
 * As part of the context menu, the ParStore::jumpToGroup QAction group is
-* configured with the ParStore::jumpToList state of that location at each
+* configured with the ParList::jumpToList state of that location at each
 * time this function is called.
 *
 * @param &pos mouse position transferred by the caller widget in widget
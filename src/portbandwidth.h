@@ -0,0 +1,176 @@
+/*!
+ * @file portbandwidth.h
+ * @brief Implementation of the PortBandwidth class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#ifndef PORTBANDWIDTH_H
+#define PORTBANDWIDTH_H
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief Model of the wire of a DIN MIDI output port
+ *
+ * A DIN port transmits 31250 baud with 10 bits per byte, so a three
+ * byte message occupies the wire for 960 us. PortBandwidth keeps the
+ * backend position at which the wire becomes free, and schedule()
+ * returns the position at which a message can actually start. Messages
+ * are thereby spread in the order they are scheduled, instead of
+ * piling up in the interface.
+ *
+ * The byte count follows the running status rule, a channel message
+ * with the same status byte as the previous one is sent without it.
+ * System real-time messages neither use nor cancel the running status.
+ *
+ * The delays caused by the model are counted in a few atomic counters,
+ * which can be read by another thread with stats().
+ */
+class PortBandwidth
+{
+public:
+    enum {
+        BYTES_PER_MINUTE = 187500   /*!< 31250 baud, 10 bits per byte */
+    };
+
+    /** @brief Queue delay statistics of a port */
+    struct Stats {
+        uint64_t events;        /*!< Number of scheduled messages */
+        uint64_t delayed;       /*!< Number of messages that had to wait */
+        uint64_t delaySumUs;    /*!< Sum of all delays in microseconds */
+        uint64_t delayMaxUs;    /*!< Longest delay in microseconds */
+    };
+
+    PortBandwidth() : m_events(0), m_delayed(0), m_delaySumUs(0),
+            m_delayMaxUs(0)
+    {
+        reset(60000000000ULL);
+    }
+
+    /**
+     * @brief Free the wire and forget the running status
+     *
+     * To be called when the backend positions restart, i.e. at
+     * transport start.
+     *
+     * @param units_per_minute Rate of the backend positions
+     */
+    void reset(uint64_t units_per_minute)
+    {
+        m_rate = units_per_minute ? units_per_minute : 1;
+        m_byteUnits = m_rate / BYTES_PER_MINUTE;
+        m_byteFrac = m_rate % BYTES_PER_MINUTE;
+        m_freePos = 0;
+        m_freeFrac = 0;
+        m_runningStatus = -1;
+    }
+
+    /** @brief Clear the statistics */
+    void resetStats()
+    {
+        m_events.store(0, std::memory_order_relaxed);
+        m_delayed.store(0, std::memory_order_relaxed);
+        m_delaySumUs.store(0, std::memory_order_relaxed);
+        m_delayMaxUs.store(0, std::memory_order_relaxed);
+    }
+
+    /** @brief Length in bytes of a message with the given status byte */
+    static int messageSize(int status)
+    {
+        if (status >= 0xf8) return 1;
+        switch (status & 0xf0) {
+            case 0xc0:
+            case 0xd0:
+                return 2;
+            default:
+                return 3;
+        }
+    }
+
+    /**
+     * @brief Reserve the wire for one message
+     *
+     * @param status Status byte of the message
+     * @param pos Backend position at which the message is due
+     * @return Backend position at which the message starts on the wire,
+     * which is never before pos
+     */
+    uint64_t schedule(int status, uint64_t pos)
+    {
+        int bytes = messageSize(status);
+
+        if (status < 0xf0) {
+            if (status == m_runningStatus) bytes--;
+            m_runningStatus = status;
+        }
+        else if (status < 0xf8) {
+            m_runningStatus = -1;
+        }
+
+        uint64_t start = pos;
+        if (m_freePos > pos) {
+            start = m_freePos;
+        }
+        else {
+            m_freeFrac = 0;
+        }
+
+        const uint64_t frac = m_freeFrac + bytes * m_byteFrac;
+        m_freePos = start + bytes * m_byteUnits + frac / BYTES_PER_MINUTE;
+        m_freeFrac = frac % BYTES_PER_MINUTE;
+
+        m_events.fetch_add(1, std::memory_order_relaxed);
+        if (start > pos) {
+            const uint64_t delay = (start - pos) * 60000000ULL / m_rate;
+            m_delayed.fetch_add(1, std::memory_order_relaxed);
+            m_delaySumUs.fetch_add(delay, std::memory_order_relaxed);
+            if (delay > m_delayMaxUs.load(std::memory_order_relaxed))
+                m_delayMaxUs.store(delay, std::memory_order_relaxed);
+        }
+        return start;
+    }
+
+    Stats stats() const
+    {
+        Stats s;
+        s.events = m_events.load(std::memory_order_relaxed);
+        s.delayed = m_delayed.load(std::memory_order_relaxed);
+        s.delaySumUs = m_delaySumUs.load(std::memory_order_relaxed);
+        s.delayMaxUs = m_delayMaxUs.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    uint64_t m_rate;
+    uint64_t m_byteUnits;   /*!< Whole backend units per byte */
+    uint64_t m_byteFrac;    /*!< Remainder per byte in 1/BYTES_PER_MINUTE units */
+    uint64_t m_freePos;     /*!< Position at which the wire becomes free */
+    uint64_t m_freeFrac;    /*!< Remainder of m_freePos */
+    int m_runningStatus;
+
+    std::atomic<uint64_t> m_events;
+    std::atomic<uint64_t> m_delayed;
+    std::atomic<uint64_t> m_delaySumUs;
+    std::atomic<uint64_t> m_delayMaxUs;
+};
+
+#endif
@@ -35,4 +35,5 @@ Prefs::Prefs()
     midiControllable = true;
     outputMidiClock = false;
     portMidiClock = 0;
+    dinPorts = 0;
 }
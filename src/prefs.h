@@ -27,6 +27,7 @@
 
 #include <cstdlib>
 #include <cstdio>
+#include <stdint.h>
 
 
 class Prefs {
@@ -42,5 +43,6 @@ class Prefs {
     bool midiControllable;
     bool outputMidiClock;
     int portMidiClock;
+    uint64_t dinPorts;      /*!< Bit mask of the output ports with DIN MIDI bandwidth */
 };
 #endif
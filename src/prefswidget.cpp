@@ -23,6 +23,7 @@
  */
 #include <QBoxLayout>
 #include <QDialogButtonBox>
+#include <QGridLayout>
 #include <QLabel>
 
 #include "prefswidget.h"
@@ -92,6 +93,29 @@ PrefsWidget::PrefsWidget(Engine *p_engine, Prefs *p_prefs, QWidget *parent)
     portMidiClockLayout->addWidget(portMidiClockSpin);
     if (!(engine->alsaMidi)) portMidiClockSpin->setEnabled(false);
 
+    QLabel *dinPortLabel = new QLabel(tr("Limit to &DIN MIDI bandwidth on ports"), this);
+    QGridLayout *dinPortLayout = new QGridLayout;
+    dinPortLayout->addWidget(dinPortLabel, 0, 0, 1, 9);
+    for (l1 = 0; l1 < p_prefs->portCount; l1++) {
+        QCheckBox *dinPortCheck = new QCheckBox(QString::number(l1 + 1), this);
+        dinPortCheck->setToolTip(
+            tr("Spread the events sent to this port as a 31250 baud MIDI cable would, sending notes before controllers"));
+        QObject::connect(dinPortCheck, SIGNAL(toggled(bool)), this,
+                SLOT(updateDinPorts()));
+        dinPortLayout->addWidget(dinPortCheck, 1 + l1 / 8, l1 % 8);
+        dinPortChecks.append(dinPortCheck);
+    }
+    dinPortLayout->setColumnStretch(8, 1);
+    if (!dinPortChecks.isEmpty()) dinPortLabel->setBuddy(dinPortChecks.at(0));
+
+    dinStatsLabel = new QLabel(this);
+    dinStatsLabel->setToolTip(tr("Number of delayed events, mean and maximum delay"));
+    dinPortLayout->addWidget(dinStatsLabel, 2 + (p_prefs->portCount - 1) / 8, 0, 1, 9);
+
+    dinStatsTimer = new QTimer(this);
+    connect(dinStatsTimer, SIGNAL(timeout()), this, SLOT(updateDinStats()));
+    dinStatsTimer->start(500);
+
     QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
 
     connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
@@ -102,6 +126,7 @@ PrefsWidget::PrefsWidget(Engine *p_engine, Prefs *p_prefs, QWidget *parent)
     QVBoxLayout *midiBoxLayout = new QVBoxLayout(this);
     midiBoxLayout->addLayout(portBoxLayout);
     midiBoxLayout->addLayout(portMidiClockLayout);
+    midiBoxLayout->addLayout(dinPortLayout);
     midiBoxLayout->addWidget(cbuttonCheck);
     QGroupBox *midiBox = new QGroupBox(tr("Midi"), this);
     midiBox->setLayout(midiBoxLayout);
@@ -209,3 +234,38 @@ void PrefsWidget::setPortMidiClock(int id)
     updatePortMidiClock(id);
 }
 
+void PrefsWidget::updateDinPorts()
+{
+    uint64_t mask = 0;
+    for (int l1 = 0; l1 < dinPortChecks.count(); l1++) {
+        const bool on = dinPortChecks.at(l1)->isChecked();
+        engine->driver->setPortBandwidthLimited(l1, on);
+        if (on) mask |= (uint64_t)1 << l1;
+    }
+    prefs->dinPorts = mask;
+    modified = true;
+}
+
+void PrefsWidget::setDinPorts(uint64_t mask)
+{
+    for (int l1 = 0; l1 < dinPortChecks.count(); l1++) {
+        dinPortChecks.at(l1)->setChecked((mask >> l1) & 1);
+    }
+    updateDinPorts();
+}
+
+void PrefsWidget::updateDinStats()
+{
+    if (!isVisible()) return;
+
+    QStringList lines;
+    for (int l1 = 0; l1 < dinPortChecks.count(); l1++) {
+        if (!dinPortChecks.at(l1)->isChecked()) continue;
+        const PortBandwidth::Stats st = engine->driver->portBandwidthStats(l1);
+        const double mean = st.delayed ? (double)st.delaySumUs / st.delayed / 1000. : 0.;
+        lines << tr("Port %1: %2 of %3 events delayed, mean %4 ms, max %5 ms")
+                .arg(l1 + 1).arg(st.delayed).arg(st.events)
+                .arg(mean, 0, 'f', 2).arg(st.delayMaxUs / 1000., 0, 'f', 2);
+    }
+    dinStatsLabel->setText(lines.join("\n"));
+}
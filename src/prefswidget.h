@@ -25,6 +25,8 @@
 #define PREFSWIDGET_H
 
 #include <QDialog>
+#include <QLabel>
+#include <QTimer>
 
 #include "engine.h"
 
@@ -52,9 +54,17 @@ class PrefsWidget : public QDialog
     void setPortUnmatched(int id);
     void setOutputMidiClock(bool on);
     void setPortMidiClock(int id);
+/*!
+ * @brief sets the output ports with DIN MIDI bandwidth
+ * @param mask Bit mask of the ports, bit 0 is port 1
+ */
+    void setDinPorts(uint64_t mask);
     QCheckBox *cbuttonCheck, *compactStyleCheck, *mutedAddCheck;
     QCheckBox *forwardCheck, *storeMuteStateCheck, *outputMidiClockCheck;
     QComboBox *portUnmatchedSpin, *portMidiClockSpin;
+    QList<QCheckBox *> dinPortChecks;
+    QLabel *dinStatsLabel;
+    QTimer *dinStatsTimer;
     bool isModified() { return modified;};
     void setModified(bool on) { modified = on; };
 
@@ -70,6 +80,10 @@ class PrefsWidget : public QDialog
     void updateStoreMuteState(bool);
     void updateOutputMidiClock(bool on);
     void updatePortMidiClock(int);
+    void updateDinPorts();
+/*! @brief refreshes the queue delay statistics of the DIN ports while
+ * the dialog is shown */
+    void updateDinStats();
 };
 
 #endif
@@ -0,0 +1,101 @@
+/*!
+ * @file prng.h
+ * @brief Implementation of the Prng class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#ifndef PRNG_H
+#define PRNG_H
+
+#include <stdint.h>
+
+/**
+ * @brief Small pseudo random number generator owned by a single module
+ *
+ * This is xoshiro128** by D. Blackman and S. Vigna, with its state
+ * initialized from a 64-bit seed by splitmix64. It takes no lock and
+ * every call runs in constant time, so it can be used in the realtime
+ * thread. The same seed always yields the same sequence.
+ */
+class Prng
+{
+public:
+    Prng(uint64_t seed = 0) { setSeed(seed); }
+
+    /** @brief Restart the sequence belonging to seed */
+    void setSeed(uint64_t seed)
+    {
+        for (int l1 = 0; l1 < 4; l1 += 2) {
+            uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            z ^= z >> 31;
+            s[l1] = (uint32_t)z;
+            s[l1 + 1] = (uint32_t)(z >> 32);
+        }
+    }
+
+    /** @brief Next 32-bit random value */
+    uint32_t next()
+    {
+        const uint32_t result = rotl(s[1] * 5, 7) * 9;
+        const uint32_t t = s[1] << 9;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 11);
+
+        return result;
+    }
+
+    /**
+     * @brief Random integer in [0, range)
+     *
+     * Uses a single multiplication instead of a modulo or a rejection
+     * loop, the bias is below range / 2^32.
+     *
+     * @param range Number of possible values, returns 0 if range < 1
+     */
+    int below(int range)
+    {
+        if (range < 1) return 0;
+        return (int)(((uint64_t)next() * (uint32_t)range) >> 32);
+    }
+
+    /** @brief Random double in [0, 1) */
+    double uniform()
+    {
+        return next() * (1.0 / 4294967296.0);
+    }
+
+private:
+    static uint32_t rotl(uint32_t x, int k)
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+
+    uint32_t s[4];
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*!
+ * @file routingtable.cpp
+ * @brief Implements the RoutingTable class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#include "routingtable.h"
+
+RoutingTable::RoutingTable()
+    : offsets(N_KEYS + 1, 0)
+{
+    lastWorker = NULL;
+}
+
+static bool routeAccepts(const MidiRoute& route, int channel, int type,
+        int data)
+{
+    if ((route.channel != OMNI) && (route.channel != channel)) return false;
+    if (type) return route.hasController(data);
+
+    return ((data >= route.noteMin) && (data <= route.noteMax));
+}
+
+void RoutingTable::build(const std::vector<MidiWorker *>& p_workers,
+        const std::vector<MidiRoute>& routes)
+{
+    const int count = p_workers.size();
+    int k;
+
+    // First pass counts the entries of each list, second pass fills them
+    offsets.assign(N_KEYS + 1, 0);
+    for (int ch = 0; ch < 16; ch++) {
+        for (int type = 0; type < N_TYPES; type++) {
+            for (int data = 0; data < 128; data++) {
+                k = key(ch, type, data);
+                for (int l1 = 0; l1 < count; l1++) {
+                    if (routeAccepts(routes[l1], ch, type, data)) offsets[k + 1]++;
+                }
+            }
+        }
+    }
+    for (k = 0; k < N_KEYS; k++) offsets[k + 1] += offsets[k];
+
+    workers.resize(offsets[N_KEYS]);
+    indices.resize(offsets[N_KEYS]);
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (int ch = 0; ch < 16; ch++) {
+        for (int type = 0; type < N_TYPES; type++) {
+            for (int data = 0; data < 128; data++) {
+                k = key(ch, type, data);
+                for (int l1 = 0; l1 < count; l1++) {
+                    if (routeAccepts(routes[l1], ch, type, data)) {
+                        indices[fill[k]] = l1;
+                        workers[fill[k]++] = p_workers[l1];
+                    }
+                }
+            }
+        }
+    }
+
+    lastWorker = (count) ? p_workers[count - 1] : NULL;
+}
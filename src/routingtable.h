@@ -0,0 +1,107 @@
+/*!
+ * @file routingtable.h
+ * @brief Member definitions for the RoutingTable class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#ifndef ROUTINGTABLE_H
+#define ROUTINGTABLE_H
+
+#include <vector>
+#include "midiworker.h"
+
+/*! @brief Lookup table of the MidiWorkers interested in an input event
+ *
+ * The table is indexed by channel, event type (note or controller) and
+ * note or controller number. Each index holds the list of MidiWorkers
+ * whose MidiRoute accepts the event, in the order of the worker list
+ * passed to build(). The lists are stored contiguously, so that a lookup
+ * is a constant time operation without allocation.
+ *
+ * Engine builds the table outside the realtime thread whenever the
+ * MidiRoute of a module changes, and publishes it through a SnapshotStore.
+ */
+class RoutingTable
+{
+  private:
+    enum {
+        TYPE_NOTE = 0,
+        TYPE_CONTROLLER,
+        N_TYPES
+    };
+    enum { N_KEYS = 16 * N_TYPES * 128 };
+
+    std::vector<int> offsets;           /*!< Start of each list in workers, N_KEYS + 1 entries */
+    std::vector<MidiWorker *> workers;  /*!< Concatenated worker lists */
+    std::vector<int> indices;           /*!< Index in the list passed to build() of each entry of workers */
+
+    static int key(int channel, int type, int data)
+    {
+        return ((channel * N_TYPES) + type) * 128 + data;
+    }
+
+  public:
+    const MidiWorker *lastWorker; /*!< Last worker of the list passed to build() */
+
+    RoutingTable();
+/*!
+ * @brief fills the table from the workers and their routes
+ *
+ * @param p_workers The workers in dispatch order
+ * @param routes The MidiRoute of each worker, same order
+ */
+    void build(const std::vector<MidiWorker *>& p_workers,
+            const std::vector<MidiRoute>& routes);
+/*!
+ * @brief returns the workers inEv has to be passed to
+ *
+ * @param inEv The incoming event, with note offs given as note on
+ * with zero velocity
+ * @param count Is set to the number of workers in the returned list
+ * @return Pointer to the first worker of the list
+ */
+    MidiWorker * const *lookup(const MidiEvent& inEv, int *count) const
+    {
+        int type;
+        if (inEv.type == EV_NOTEON) type = TYPE_NOTE;
+        else if (inEv.type == EV_CONTROLLER) type = TYPE_CONTROLLER;
+        else type = -1;
+
+        if ((type < 0) || ((unsigned int)inEv.channel > 15)
+                || ((unsigned int)inEv.data > 127)) {
+            *count = 0;
+            return workers.data();
+        }
+        const int k = key(inEv.channel, type, inEv.data);
+        *count = offsets[k + 1] - offsets[k];
+        return workers.data() + offsets[k];
+    }
+/*!
+ * @brief returns the index of a worker in the list passed to build()
+ * @param entry Pointer to an entry of a list returned by lookup()
+ */
+    int moduleIndex(MidiWorker * const *entry) const
+    {
+        return indices[entry - workers.data()];
+    }
+};
+
+#endif
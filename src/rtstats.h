@@ -0,0 +1,254 @@
+/*!
+ * @file rtstats.h
+ * @brief Implementation of the RtHistogram and RtStats classes
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#ifndef RTSTATS_H
+#define RTSTATS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Histogram of values recorded by one realtime thread
+ *
+ * Each power of two is divided into four buckets, so that percentiles
+ * are known within 25 %. All counters are atomics accessed with relaxed
+ * order: record() never blocks or allocates, and another thread reads
+ * a consistent enough copy with getSnapshot() at any time. Only one
+ * thread may call record().
+ */
+class RtHistogram
+{
+public:
+    enum {
+        BUCKETS = 252   /*!< Four buckets for each power of two up to 2^63 */
+    };
+
+    /** @brief Copy of the counters taken by getSnapshot() */
+    struct Snapshot {
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+        uint32_t buckets[BUCKETS];
+
+        double mean() const { return count ? (double)sum / count : 0.; }
+
+        /**
+         * @brief Upper bound of the bucket holding the given fraction of
+         * the values, never above max
+         *
+         * @param p Fraction between 0 and 1, 0.99 for the 99th percentile
+         */
+        uint64_t percentile(double p) const
+        {
+            if (!count) return 0;
+            uint64_t rank = (uint64_t)(p * count + .5);
+            if (!rank) rank = 1;
+            uint64_t seen = 0;
+            for (int l1 = 0; l1 < BUCKETS; l1++) {
+                seen += buckets[l1];
+                if (seen >= rank) {
+                    const uint64_t upper = (l1 + 1 < BUCKETS)
+                            ? lowerBound(l1 + 1) - 1 : max;
+                    return (upper < max) ? upper : max;
+                }
+            }
+            return max;
+        }
+    };
+
+    RtHistogram() { reset(); }
+
+    /** @brief Add a value, to be called by the recording thread only */
+    void record(uint64_t value)
+    {
+        m_buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+        if (value > m_max.load(std::memory_order_relaxed))
+            m_max.store(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Clear all counters
+     *
+     * Can be called from any thread, values recorded at the same time
+     * may be lost.
+     */
+    void reset()
+    {
+        for (int l1 = 0; l1 < BUCKETS; l1++) {
+            m_buckets[l1].store(0, std::memory_order_relaxed);
+        }
+        m_count.store(0, std::memory_order_relaxed);
+        m_sum.store(0, std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+
+    void getSnapshot(Snapshot *s) const
+    {
+        s->count = m_count.load(std::memory_order_relaxed);
+        s->sum = m_sum.load(std::memory_order_relaxed);
+        s->max = m_max.load(std::memory_order_relaxed);
+        for (int l1 = 0; l1 < BUCKETS; l1++) {
+            s->buckets[l1] = m_buckets[l1].load(std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief JSON object with count, mean, percentiles and maximum
+     *
+     * @param unit Unit of the values, written as "unit" member
+     */
+    std::string toJson(const char *unit) const
+    {
+        Snapshot s;
+        char buf[256];
+        getSnapshot(&s);
+        snprintf(buf, sizeof(buf), "{\"unit\": \"%s\", \"count\": %llu, "
+                "\"mean\": %.1f, \"p50\": %llu, \"p90\": %llu, "
+                "\"p99\": %llu, \"p999\": %llu, \"max\": %llu}",
+                unit, (unsigned long long)s.count, s.mean(),
+                (unsigned long long)s.percentile(.5),
+                (unsigned long long)s.percentile(.9),
+                (unsigned long long)s.percentile(.99),
+                (unsigned long long)s.percentile(.999),
+                (unsigned long long)s.max);
+        return std::string(buf);
+    }
+
+    static int bucketOf(uint64_t value)
+    {
+        if (value < 4) return (int)value;
+        const int e = 63 - __builtin_clzll(value);
+        return 4 * (e - 1) + (int)((value >> (e - 2)) & 3);
+    }
+
+    static uint64_t lowerBound(int bucket)
+    {
+        if (bucket < 4) return bucket;
+        const int e = bucket / 4 + 1;
+        return (uint64_t)(4 + bucket % 4) << (e - 2);
+    }
+
+private:
+    std::atomic<uint32_t> m_buckets[BUCKETS];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+};
+
+/**
+ * @brief Timing statistics of the realtime path of a driver backend
+ *
+ * The histograms are filled by the driver and by the engine callbacks
+ * it calls, all in the realtime thread. The per module times are kept
+ * in MidiWorker::frameTime and MidiWorker::eventTime.
+ */
+struct RtStats {
+    RtHistogram period;     /*!< Duration of the period callback in ns */
+    RtHistogram echo;       /*!< Duration of the engine echo callback in ns */
+    RtHistogram queueDepth; /*!< Output queue length at each period start */
+    RtHistogram lateness;   /*!< Frames from scheduled to emitted position */
+    std::atomic<uint64_t> eventOverflows;   /*!< Output queue overflows */
+    std::atomic<uint64_t> echoOverflows;    /*!< Echo queue overflows */
+
+    /** @brief Histograms of one module for toJson() */
+    struct Module {
+        std::string name;
+        const RtHistogram *frame;
+        const RtHistogram *event;
+    };
+
+    RtStats() : eventOverflows(0), echoOverflows(0) { }
+
+    void reset()
+    {
+        period.reset();
+        echo.reset();
+        queueDepth.reset();
+        lateness.reset();
+        eventOverflows.store(0, std::memory_order_relaxed);
+        echoOverflows.store(0, std::memory_order_relaxed);
+    }
+
+    /** @brief Monotonic time in nanoseconds, safe to call in realtime */
+    static uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief JSON document with all histograms and counters
+     *
+     * @param modules Names and histograms of the modules
+     */
+    std::string toJson(const std::vector<Module>& modules) const
+    {
+        char buf[128];
+        std::string out = "{\n  \"period\": " + period.toJson("ns");
+        out += ",\n  \"echo\": " + echo.toJson("ns");
+        out += ",\n  \"queue_depth\": " + queueDepth.toJson("events");
+        out += ",\n  \"lateness\": " + lateness.toJson("frames");
+        snprintf(buf, sizeof(buf), ",\n  \"event_overflows\": %llu,"
+                "\n  \"echo_overflows\": %llu,\n  \"modules\": [",
+                (unsigned long long)eventOverflows.load(std::memory_order_relaxed),
+                (unsigned long long)echoOverflows.load(std::memory_order_relaxed));
+        out += buf;
+        for (unsigned int l1 = 0; l1 < modules.size(); l1++) {
+            out += l1 ? ",\n" : "\n";
+            out += "    {\"name\": \"" + jsonEscape(modules[l1].name) + "\",";
+            out += "\n     \"frame\": " + modules[l1].frame->toJson("ns") + ",";
+            out += "\n     \"event\": " + modules[l1].event->toJson("ns") + "}";
+        }
+        out += modules.empty() ? "]\n}\n" : "\n  ]\n}\n";
+        return out;
+    }
+
+private:
+    static std::string jsonEscape(const std::string& in)
+    {
+        std::string out;
+        for (unsigned int l1 = 0; l1 < in.size(); l1++) {
+            const unsigned char c = in[l1];
+            if ((c == '"') || (c == '\\')) {
+                out += '\\';
+                out += c;
+            }
+            else if (c < 0x20) {
+                char esc[8];
+                snprintf(esc, sizeof(esc), "\\u%04x", c);
+                out += esc;
+            }
+            else out += c;
+        }
+        return out;
+    }
+};
+
+#endif
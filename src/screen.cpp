@@ -39,19 +39,49 @@ Screen::Screen(QWidget* parent) : QWidget (parent)
     w = QWidget::width();
     h = QWidget::height();
     mouseW = 0;
+    cacheValid = false;
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void Screen::paintEvent(QPaintEvent *event)
+{
+    w = QWidget::width();
+    h = QWidget::height();
+
+    if (!cacheValid || (cache.size() != size())) {
+        if (cache.size() != size()) cache = QPixmap(size());
+        cache.fill(palette().color(QPalette::Window));
+        QPainter cp(&cache);
+        drawStatic(&cp);
+        cacheValid = true;
+    }
+
+    QPainter p(this);
+    p.drawPixmap(event->rect(), cache, event->rect());
+    drawDynamic(&p);
+}
+
+void Screen::invalidate()
+{
+    cacheValid = false;
+    needsRedraw = true;
 }
 
 void Screen::updateDraw()
 {
-    if (!needsRedraw) return;
+    if (needsRedraw)
+        update();
+    else if (!dirtyRect.isEmpty())
+        update(dirtyRect);
     needsRedraw = false;
-    update();
+    dirtyRect = QRect();
 }
 
 void Screen::setMuted(bool on)
 {
+    if (on == isMuted) return;
     isMuted = on;
-    needsRedraw = true;
+    invalidate();
 }
 
 void Screen::mouseMoveEvent(QMouseEvent *event)
@@ -78,15 +108,19 @@ void Screen::wheelEvent(QWheelEvent *event)
 
 void Screen::setRecordMode(bool on)
 {
+    if (on == recordMode) return;
     recordMode = on;
+    invalidate();
 }
 
 void Screen::newGrooveValues(int tick, int vel, int length)
 {
+    if ((tick == grooveTick) && (vel == grooveVelocity)
+            && (length == grooveLength)) return;
     grooveTick = tick;
     grooveVelocity = vel;
     grooveLength = length;
-    needsRedraw = true;
+    invalidate();
 }
 
 QSize Screen::sizeHint() const
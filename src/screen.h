@@ -34,6 +34,8 @@
 #include <QWheelEvent>
 #include <QSizePolicy>
 #include <QSize>
+#include <QRect>
+#include <QPaintEvent>
 
 #define SCR_MIN_W   250
 #define SCR_MIN_H   120
@@ -51,12 +53,43 @@
  * and mouseMoved() events. The mouse position is transferred as a
  * double from 0 ... 1.0 representing the relative mouse position on the
  * entire Screen display area.
+ *
+ * The static layers of the display, such as grid, labels and data, are
+ * drawn by drawStatic() into a pixmap which is only rendered again
+ * after invalidate() or a size change. Each paintEvent() copies the
+ * exposed part of the pixmap and draws the moving parts on top with
+ * drawDynamic(), so that small changes can be repainted through
+ * dirtyRect without drawing the whole display.
  */
 class Screen : public QWidget
 {
   Q_OBJECT
 
+  private:
+    QPixmap cache;
+    bool cacheValid;
+
   protected:
+    virtual void paintEvent(QPaintEvent *event);
+/*!
+* @brief draws the static layers, called when the cached pixmap is
+* rendered again
+*
+* @param p Painter on the cached pixmap, which is filled with the
+* background color
+*/
+    virtual void drawStatic(QPainter *p) = 0;
+/*!
+* @brief draws the moving parts on top of the cached pixmap
+*
+* @param p Painter on the widget, clipped to the exposed region
+*/
+    virtual void drawDynamic(QPainter *p) { (void)p; };
+/*!
+* @brief marks the cached pixmap for rendering at the next paint event
+* and requests a full repaint
+*/
+    void invalidate();
 
   public:
     Screen(QWidget* parent=0);
@@ -69,7 +102,8 @@ class Screen : public QWidget
     int currentIndex;
     bool recordMode;
     bool isMuted;
-    bool needsRedraw;
+    bool needsRedraw;   /**< A full repaint is requested by updateDraw() */
+    QRect dirtyRect;    /**< Area repainted by updateDraw() if no full repaint is requested */
 
   signals:
     void mouseEvent(double, double, int, int pressed);
@@ -39,6 +39,8 @@ SeqDriver::SeqDriver(
     void (* tick_callback)(void * context, bool echo_from_trig))
     : DriverBase(p_portCount, callback_context, midi_event_received_callback, tick_callback, 60e9)
     , jackSync(p_jackSync)
+    , jackTimeBase(48000 * 60)
+    , outQueue(JQ_BUFSZ)
 {
     int err;
     char buf[16];
@@ -91,15 +93,14 @@ SeqDriver::SeqDriver(
     m_current_tick = 0;
 
     startQueue = false;
+    captureStopTick = -1;
     midiTick = 0;
     lastRatioTick = 0;
-    tempoChangeTick = 0;
     midiTempoRefreshTick = 0;
     trStartingTick = 0;
     trLoopingTick = 0;
-    tempoChangeFrame = 0;
     initTempo();
-    tempoChangeTime = 0;
+    timeBase.reset(tempo);
     useMidiClock = false;
     
     outputMidiClock = false;
@@ -125,7 +126,7 @@ void SeqDriver::run()
 {
     snd_seq_event_t *evIn;
     bool unmatched = true;
-    double tmpTime = 0;
+    uint64_t tmpTime = 0;
     int pollr = 0;
 
     int nfds;
@@ -138,9 +139,19 @@ void SeqDriver::run()
     while (((long)poll >= 0) && (!threadAbort)) {
 
         pollr = poll(pfds, nfds, 200);
+
+        // setTransportStatus() can be called from other threads, only
+        // this one records to the capture
+        const int64_t stopTick = captureStopTick.exchange(-1);
+        if (stopTick >= 0) {
+            capture.record(mkMidiEvent(EV_STOP), stopTick, portMidiClock,
+                    CAPTURE_OUT);
+        }
+
         while (pollr > 0) {
 
             tmpTime = getCurrentTime();
+            const uint64_t start_ns = RtStats::now();
 
             snd_seq_event_input(seq_handle, &evIn);
             
@@ -153,8 +164,7 @@ void SeqDriver::run()
                     internalTempo = tempo;
                 }
                 if ((midiTick % 48) == 4 ) {
-                    tempoChangeTick = m_current_tick;
-                    tempoChangeTime = tmpTime;
+                    timeBase.setTempoAt(tempo, m_current_tick, tmpTime);
                     jackSync->tempoCb(internalTempo, jackSync->cbContext);
                 }
                 midiTick++;
@@ -164,6 +174,7 @@ void SeqDriver::run()
                 sendMidiClock();
                 startQueue = false;
                 tick_callback((inEv.data));
+                flushOutput();
             }
             else {
                 inEv.channel = evIn->data.control.channel;
@@ -181,8 +192,11 @@ void SeqDriver::run()
                 }
 
                 unmatched = midi_event_received(inEv);
+                flushOutput();
 
                 if (forwardUnmatched && unmatched) {
+                    capture.record(inEv, m_current_tick, portUnmatched,
+                            CAPTURE_OUT);
                     snd_seq_ev_set_subs(evIn);
                     snd_seq_ev_set_direct(evIn);
                     snd_seq_ev_set_source(evIn, portid_out[portUnmatched]);
@@ -190,6 +204,7 @@ void SeqDriver::run()
                 }
             }
             if (!queueStatus) m_current_tick = 0; //some events still come in after queue stop
+            rtStats.period.record(RtStats::now() - start_ns);
             pollr = snd_seq_event_input_pending(seq_handle, 0);
         }
     }
@@ -213,15 +228,13 @@ void SeqDriver::sendMidiClock()
     }
 }
 
-void SeqDriver::calcCurrentTick(double tmpTime) {
+void SeqDriver::calcCurrentTick(uint64_t tmpTime) {
 
     if (useJackSync) {
         jPos = jackSync->getCurrentPos();
         if (jPos.beats_per_minute > 0.01) requestedTempo = jPos.beats_per_minute;
 
-        m_current_tick = (uint64_t)(jPos.frame - tempoChangeFrame) * TPQN  * tempo
-                / jPos.frame_rate / 60.
-                + tempoChangeTick;
+        m_current_tick = jackTimeBase.posToTick(jPos.frame);
         tmpTime = tickToDelta(m_current_tick);
         snd_seq_event_t ev;
         snd_seq_ev_clear(&ev);
@@ -243,7 +256,9 @@ void SeqDriver::initTempo()
         else
             tempo = internalTempo;
 
-        tempoChangeFrame = (uint64_t)jPos.frame;
+        if (jPos.frame_rate
+                && (jackTimeBase.rate() != (uint64_t)jPos.frame_rate * 60))
+            jackTimeBase.setRate((uint64_t)jPos.frame_rate * 60);
     }
     else {
         tempo = internalTempo;
@@ -257,9 +272,40 @@ void SeqDriver::initTempo()
 }
 
 void SeqDriver::sendMidiEvent(MidiEvent outEv, uint64_t n_tick, unsigned outport, unsigned length)
+{
+    //qWarning("sendMidiEvent([%d, %d, %d, %d], %u, %u) at tick %lu", outEv.type, outEv.channel, outEv.data, outEv.value, outport, length, n_tick);
+    capture.record(outEv, n_tick, outport, CAPTURE_OUT, length);
+    if (!isPortBandwidthLimited(outport)) {
+        outputEvent(outEv, tickToDelta(n_tick), outport, length);
+        return;
+    }
+
+    /* events of bandwidth limited ports are collected and sent by
+     * flushOutput() once the current callback has returned */
+    OutEvent ev;
+    ev.ev = outEv;
+    ev.port = outport;
+    ev.length = length;
+    if (!outQueue.push(n_tick, ev, outputPriority(outEv.type))) {
+        rtStats.eventOverflows.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void SeqDriver::flushOutput()
+{
+    while (!outQueue.isEmpty()) {
+        const OutEvent outEv = outQueue.next();
+        const uint64_t delta = tickToDelta(outQueue.nextTick());
+        outQueue.pop();
+
+        outputEvent(outEv.ev, portBandwidth[outEv.port].schedule(
+                    statusByte(outEv.ev), delta), outEv.port, outEv.length);
+    }
+}
+
+void SeqDriver::outputEvent(MidiEvent outEv, uint64_t delta, unsigned outport, unsigned length)
 {
     double duration = (double)length / tempo * 40 / 128;
-    //qWarning("sendMidiEvent([%d, %d, %d, %d], %u, %f) at tick %lu", outEv.type, outEv.channel, outEv.data, outEv.value, outport, duration, n_tick);
     snd_seq_event_t ev;
     snd_seq_ev_clear(&ev);
 
@@ -273,7 +319,7 @@ void SeqDriver::sendMidiEvent(MidiEvent outEv, uint64_t n_tick, unsigned outport
     }
 
     ev.data.control.channel = outEv.channel;
-    snd_seq_ev_schedule_real(&ev, queue_id, 0, deltaToATime(tickToDelta(n_tick)));
+    snd_seq_ev_schedule_real(&ev, queue_id, 0, deltaToATime(delta));
     snd_seq_ev_set_subs(&ev);
     snd_seq_ev_set_source(&ev, portid_out[outport]);
     snd_seq_event_output_direct(seq_handle, &ev);
@@ -294,27 +340,32 @@ bool SeqDriver::requestEchoAt(uint64_t echo_tick, bool echo_from_trig)
     return true;
 }
 
+void SeqDriver::anchorTempo(uint64_t tick, uint64_t time)
+{
+    timeBase.setTempoAt(tempo, tick, time);
+    if (useJackSync) jackTimeBase.setTempoAt(tempo, tick, jPos.frame);
+}
+
 void SeqDriver::requestTempo(double bpm)
 {
-    double tmpTime = getCurrentTime();
+    uint64_t tmpTime = getCurrentTime();
     calcCurrentTick(tmpTime);
-    tempoChangeTick = m_current_tick;
-    tempoChangeTime = tmpTime;
     internalTempo = bpm;
     initTempo();
+    anchorTempo(m_current_tick, tmpTime);
     requestedTempo = bpm;
     requestEchoAt(lastSchedTick + 1);
 }
 
 void SeqDriver::setTempo(double bpm)
 {
-    tempoChangeTick = m_current_tick;
-    tempoChangeTime = getCurrentTime();
+    uint64_t tmpTime = getCurrentTime();
     internalTempo = bpm;
     initTempo();
+    anchorTempo(m_current_tick, tmpTime);
 }
 
-double SeqDriver::getCurrentTime()
+uint64_t SeqDriver::getCurrentTime()
 {
     snd_seq_queue_status_t *status;
 
@@ -336,14 +387,14 @@ void SeqDriver::setTransportStatus(bool run)
         startQueue = true;
 
         initTempo();
-        tempoChangeTick = 0;
-        tempoChangeTime = 0;
-        tempoChangeFrame = 0;
+        timeBase.reset(tempo);
+        jackTimeBase.reset(tempo);
         nextMidiClockTick = 0;
         if (useJackSync)
             trStartingTick = jackSync->trStartingTick;
         else
             trStartingTick = 0;
+        resetPortBandwidth();
         snd_seq_start_queue(seq_handle, queue_id, NULL);
         snd_seq_drain_output(seq_handle);
         calcCurrentTick(0);
@@ -352,7 +403,9 @@ void SeqDriver::setTransportStatus(bool run)
     else {
         queueStatus = false;
         if (outputMidiClock) {
-            sendMidiEvent(mkMidiEvent(EV_STOP), m_current_tick, portMidiClock, 0);
+            captureStopTick = m_current_tick;
+            outputEvent(mkMidiEvent(EV_STOP), tickToDelta(m_current_tick),
+                    portMidiClock, 0);
         }
         
         snd_seq_remove_events_set_queue(remove_ev, queue_id);
@@ -374,47 +427,44 @@ void SeqDriver::setUseMidiClock(bool on)
     if (!on) jackSync->tempoCb(internalTempo, jackSync->cbContext);
 }
 
-double SeqDriver::tickToDelta(uint64_t tick)
+uint64_t SeqDriver::tickToDelta(uint64_t tick)
 {
-    if (tick > tempoChangeTick)
-        return (double)(60e9/TPQN/tempo) * (tick-tempoChangeTick) + tempoChangeTime;
-    else
-        return 0;
+    return timeBase.tickToPos(tick);
 }
 
-uint64_t SeqDriver::deltaToTick(double curtime)
+uint64_t SeqDriver::deltaToTick(uint64_t curtime)
 {
-    if (tempoChangeTime < curtime)
-        return (int)((curtime-tempoChangeTime) / (60e9/TPQN/tempo))+tempoChangeTick;
-    else
-        return tempoChangeTick;
+    return timeBase.posToTick(curtime);
 }
 
-double SeqDriver::aTimeToDelta(snd_seq_real_time_t* atime)
+uint64_t SeqDriver::aTimeToDelta(snd_seq_real_time_t* atime)
 {
-    return (double)atime->tv_sec * 1e9 + (double)atime->tv_nsec;
+    return (uint64_t)atime->tv_sec * 1000000000ULL + atime->tv_nsec;
 }
 
-const snd_seq_real_time_t* SeqDriver::deltaToATime(double curtime)
+const snd_seq_real_time_t* SeqDriver::deltaToATime(uint64_t curtime)
 {
-    atime.tv_sec = (int)(curtime * 1e-9);
-    atime.tv_nsec = (uint64_t)(curtime - (double)atime.tv_sec * 1e9);
+    atime.tv_sec = curtime / 1000000000ULL;
+    atime.tv_nsec = curtime % 1000000000ULL;
     return &atime;
 }
 
-void SeqDriver::calcMidiClockTempo(double realtime)
+void SeqDriver::calcMidiClockTempo(uint64_t realtime)
 {
     double old_tempo = tempo;
+    const uint64_t anchor_tick = timeBase.anchorTick();
+    const uint64_t anchor_time = timeBase.anchorPos();
 
-    if (m_current_tick > 0) {
+    if ((m_current_tick > anchor_tick) && (realtime > anchor_time)) {
         tempo =   60e9
-                * (double)(m_current_tick - tempoChangeTick)
-                / (realtime - tempoChangeTime)
+                * (double)(m_current_tick - anchor_tick)
+                / (realtime - anchor_time)
                 / TPQN;
     }
     if ((tempo == 0) || (tempo > 1000.)) {
         tempo = old_tempo;
     }
+    timeBase.setTempoAt(tempo, anchor_tick, anchor_time);
 }
 
 int SeqDriver::getClientId()
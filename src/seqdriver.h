@@ -32,6 +32,7 @@
 
 #include "jackdriver.h"
 #include "driverbase.h"
+#include "tickqueue.h"
 
 /*! @brief ALSA sequencer backend QThread class.
  *
@@ -54,8 +55,18 @@
  * such as Jack Transport or an incoming ALSA MIDI clock,
  * SeqDriver works with snd_seq_real_time timing information when it
  * communicates with the ALSA queue. Internally, the real time information
- * is rescaled to a simpler tick-based timing, which is currently 192 tpqn
- * using the deltaToTick() and tickToDelta() functions.
+ * is rescaled to a simpler tick-based timing, which is currently TPQN ticks
+ * per quarter note, using the deltaToTick() and tickToDelta() functions.
+ * These work on nanosecond integers through the DriverBase::timeBase
+ * tempo map. When synchronized to JACK transport, the tick is derived
+ * from the transport frame with SeqDriver::jackTimeBase.
+ * Events for ports with a DIN bandwidth model are collected in
+ * SeqDriver::outQueue during a callback and sent in tick and priority
+ * order by flushOutput(), at the position the model assigns to them.
+ * The handling time of each received sequencer event is recorded as
+ * period in DriverBase::rtStats. Since the ALSA queue schedules the
+ * output itself, the queue length and the lateness of the events are
+ * not known here.
  */
 class SeqDriver : public DriverBase {
 
@@ -69,15 +80,17 @@ class SeqDriver : public DriverBase {
         int queue_id;
         bool startQueue;
         bool threadAbort;
+        std::atomic<int64_t> captureStopTick; /**< Tick of a clock stop sent by setTransportStatus() for run() to capture, -1 if none */
 
-        double tickToDelta(uint64_t tick);
-        uint64_t deltaToTick (double curtime);
-        double aTimeToDelta(snd_seq_real_time_t* atime);
-        const snd_seq_real_time_t* deltaToATime(double curtime);
+        uint64_t tickToDelta(uint64_t tick);
+        uint64_t deltaToTick (uint64_t curtime);
+        uint64_t aTimeToDelta(snd_seq_real_time_t* atime);
+        const snd_seq_real_time_t* deltaToATime(uint64_t curtime);
         snd_seq_remove_events_t *remove_ev;
-        void calcMidiClockTempo(double realtime);
+        void calcMidiClockTempo(uint64_t realtime);
         void sendMidiClock();
         void initTempo();
+        void anchorTempo(uint64_t tick, uint64_t time);
         bool callJack(int portcount, const QString & clientname=PACKAGE);
 
         JackDriver *jackSync;
@@ -89,12 +102,25 @@ class SeqDriver : public DriverBase {
         uint64_t nextMidiClockTick;
         uint64_t clockStartOffsetTick;
         uint64_t lastSchedTick;
-        uint64_t tempoChangeTick;
-        uint64_t tempoChangeFrame;
 
-        double tempoChangeTime;
+        TimeBase jackTimeBase;
         snd_seq_real_time_t atime;
 
+        /*! @brief Element of the output event queue */
+        struct OutEvent {
+            MidiEvent ev;
+            unsigned int port;
+            unsigned int length;
+        };
+        TickQueue<OutEvent> outQueue;   /**< Events of bandwidth limited ports waiting for flushOutput() */
+
+        /*! @brief Send the events collected in SeqDriver::outQueue
+         * through the bandwidth model of their port */
+        void flushOutput();
+        /*! @brief Schedule an event to the ALSA queue at the given
+         * position in nanoseconds */
+        void outputEvent(MidiEvent ev, uint64_t delta, unsigned int outport, unsigned int length);
+
 
     public:
         void sendMidiEvent(MidiEvent ev, uint64_t n_tick, unsigned int outport, unsigned int duration = 0);
@@ -108,8 +134,8 @@ class SeqDriver : public DriverBase {
             bool (* midi_event_received_callback)(void * context, MidiEvent ev),
             void (* tick_callback)(void * context, bool echo_from_trig));
         ~SeqDriver();
-        double getCurrentTime();
-        void calcCurrentTick(double time); /** calculate m_current_tick based on realTime */
+        uint64_t getCurrentTime();
+        void calcCurrentTick(uint64_t time); /** calculate m_current_tick based on realTime */
         void requestTempo(double bpm);
         void setTempo(double bpm);
         int getClientId();
@@ -33,25 +33,25 @@ SeqScreen::SeqScreen()
     loopMarker = 0;
     currentIndex = 0;
     mouseY = 0;
+    xscale = 1.0;
+    yscale = 1;
+    nsteps = 1;
+    npoints = 1;
 }
 
-// Paint event handler.
-void SeqScreen::paintEvent(QPaintEvent*)
+// Draws grid, labels and sequence into the cached pixmap
+void SeqScreen::drawStatic(QPainter *p)
 {
     if (p_data.isEmpty()) return;
 
-    QPainter p(this);
     QPen pen;
     pen.setWidth(1);
-    p.setFont(QFont("Helvetica", 8));
-    p.setPen(pen);
+    p->setFont(QFont("Helvetica", 8));
+    p->setPen(pen);
 
     int beat = 4;
     int tmpval = 0;
-    int ypos, xpos, yscale;
-    double xscale;
-    w = QWidget::width();
-    h = QWidget::height();
+    int ypos, xpos;
     int ofs;
     int x, x1;
     int minOctave = baseOctave;
@@ -59,31 +59,31 @@ void SeqScreen::paintEvent(QPaintEvent*)
     int notestreak_thick = 16 / nOctaves;
 
     //Grid setup
-    int nsteps = (int)( (double)p_data.at(p_data.count() - 1).tick / TPQN + .5);
+    nsteps = (int)( (double)p_data.at(p_data.count() - 1).tick / TPQN + .5);
     int beatRes = (p_data.count() - 1) / nsteps;
     int beatDiv = (beatRes * nsteps > 64) ? 64 / nsteps : beatRes;
-    int npoints = beatRes * nsteps;
+    npoints = beatRes * nsteps;
     xscale = (double)TPQN * (w - 2 * SEQSCR_HMARG) / p_data.at(p_data.count() - 1).tick;
     yscale = h - SEQSCR_VMARG_BOT - SEQSCR_VMARG_TOP;
 
     //Blue Filled Frame
     if (isMuted)
-        p.fillRect(0, 0, w, h, QColor(70, 70, 70));
+        p->fillRect(0, 0, w, h, QColor(70, 70, 70));
     else
-        p.fillRect(0, 0, w, h, QColor(10, 10, 50));
+        p->fillRect(0, 0, w, h, QColor(10, 10, 50));
     
     //Loop Marker Area
-    p.fillRect(SEQSCR_HMARG, h - SEQSCR_VMARG_BOT, w - 2*SEQSCR_HMARG, h, QColor(20, 20, 90));
-    p.setPen(QColor(90, 250, 120));
-    p.drawText(SEQSCR_HMARG / 2 - 2, h - SEQSCR_VMARG_BOT / 2 + 2, "L");
+    p->fillRect(SEQSCR_HMARG, h - SEQSCR_VMARG_BOT, w - 2*SEQSCR_HMARG, h, QColor(20, 20, 90));
+    p->setPen(QColor(90, 250, 120));
+    p->drawText(SEQSCR_HMARG / 2 - 2, h - SEQSCR_VMARG_BOT / 2 + 2, "L");
     
-    p.setViewport(0, 0, w, h);
-    p.setWindow(0, 0, w, h);
-    p.setPen(QColor(20, 20, 160));
+    p->setViewport(0, 0, w, h);
+    p->setWindow(0, 0, w, h);
+    p->setPen(QColor(20, 20, 160));
 
     //Draw current record step
     if (recordMode)
-    p.fillRect(currentRecStep * xscale * nsteps / npoints + SEQSCR_HMARG
+    p->fillRect(currentRecStep * xscale * nsteps / npoints + SEQSCR_HMARG
                 , SEQSCR_VMARG_TOP
                 , xscale * nsteps / npoints
                 , yscale, QColor(5, 40, 100));
@@ -97,25 +97,25 @@ void SeqScreen::paintEvent(QPaintEvent*)
             ofs = w / nsteps * .5 - 6 + SEQSCR_HMARG;
         }
         if ((bool)(l1%beat)) {
-            p.setPen(QColor(60, 100, 180));
+            p->setPen(QColor(60, 100, 180));
         } else {
-            p.setPen(QColor(100, 100, 180));
+            p->setPen(QColor(100, 100, 180));
         }
         x = l1 * xscale;
-        p.drawLine(SEQSCR_HMARG + x, SEQSCR_VMARG_TOP,
+        p->drawLine(SEQSCR_HMARG + x, SEQSCR_VMARG_TOP,
                 SEQSCR_HMARG + x, h);
 
         if (l1 < nsteps) {
             //Beat numbers
-            p.setPen(QColor(100, 150, 180));
-            p.drawText(ofs + x, SEQSCR_VMARG_TOP, QString::number(l1+1));
+            p->setPen(QColor(100, 150, 180));
+            p->drawText(ofs + x, SEQSCR_VMARG_TOP, QString::number(l1+1));
 
             // Beat divisor separators
-            p.setPen(QColor(20, 60, 120));
+            p->setPen(QColor(20, 60, 120));
             for (int l2 = 1; l2 < beatDiv; l2++) {
                 x1 = x + l2 * xscale / beatDiv;
                 if (x1 < xscale * nsteps)
-                    p.drawLine(SEQSCR_HMARG + x1,
+                    p->drawLine(SEQSCR_HMARG + x1,
                             SEQSCR_VMARG_BOT, SEQSCR_HMARG + x1, h);
             }
         }
@@ -128,32 +128,32 @@ void SeqScreen::paintEvent(QPaintEvent*)
         ypos = yscale * l1 / nOctaves / 12 + SEQSCR_VMARG_TOP;
 
         if (!l3) {
-            p.setPen(QColor(30, 60, 180));
-            p.drawText(w - SEQSCR_HMARG / 2 - 4,
+            p->setPen(QColor(30, 60, 180));
+            p->drawText(w - SEQSCR_HMARG / 2 - 4,
                     ypos + SEQSCR_VMARG_TOP - 5 - yscale / nOctaves / 2,
                     QString::number(maxOctave - l1 / 12));
         }
         else
-            p.setPen(QColor(10, 20, 100));
+            p->setPen(QColor(10, 20, 100));
 
-        p.drawLine(0, ypos, w - SEQSCR_HMARG, ypos);
+        p->drawLine(0, ypos, w - SEQSCR_HMARG, ypos);
         if ((l3 == 2) || (l3 == 4) || (l3 == 6) || (l3 == 9) || (l3 == 11)) {
             pen.setColor(QColor(20, 60, 180));
             pen.setWidth(notestreak_thick);
-            p.setPen(pen);
-            p.drawLine(0, ypos - notestreak_thick / 2, SEQSCR_HMARG / 2,
+            p->setPen(pen);
+            p->drawLine(0, ypos - notestreak_thick / 2, SEQSCR_HMARG / 2,
             ypos- notestreak_thick / 2);
             pen.setWidth(1);
-            p.setPen(pen);
+            p->setPen(pen);
         }
     }
-    p.setPen(QColor(30, 60, 180));
-    p.drawLine(0, h - 2, w - SEQSCR_HMARG, h - 2);
+    p->setPen(QColor(30, 60, 180));
+    p->drawLine(0, h - 2, w - SEQSCR_HMARG, h - 2);
 
     //Draw function
 
     pen.setWidth(notestreak_thick);
-    p.setPen(pen);
+    p->setPen(pen);
     for (int l1 = 0; l1 < npoints; l1++) {
         x = (l1 + .01 * (double)grooveTick * (l1 % 2)) * nsteps * xscale / npoints;
         tmpval = p_data.at(l1).data;
@@ -168,28 +168,38 @@ void SeqScreen::paintEvent(QPaintEvent*)
             else {
                 pen.setColor(QColor(50, 130, 180));
             }
-            p.setPen(pen);
-            p.drawLine(xpos, ypos,
+            p->setPen(pen);
+            p->drawLine(xpos, ypos,
                             xpos + (xscale / beatRes) - pen.width(), ypos);
         }
     }
-    
+}
+
+// Draws keyboard helper line and loop marker over the cached pixmap
+void SeqScreen::drawDynamic(QPainter *p)
+{
+    if (p_data.isEmpty()) return;
+
+    QPen pen;
+    int x, xpos, ypos, tmpval;
+    int notestreak_thick = 16 / nOctaves;
+
     // Helper tickline on keyboard
     ypos = yscale - yscale * (int)((1. - ((double)mouseY - SEQSCR_VMARG_TOP)
             / yscale) * nOctaves * 12) / nOctaves / 12
-            + SEQSCR_VMARG_TOP - 1 - pen.width() / 2;
+            + SEQSCR_VMARG_TOP - 1 - notestreak_thick / 2;
 
     pen.setWidth(2);
     pen.setColor(QColor(50, 160, 220));
-    p.setPen(pen);
-    p.drawLine(SEQSCR_HMARG / 2, ypos, SEQSCR_HMARG *2 / 3, ypos);
+    p->setPen(pen);
+    p->drawLine(SEQSCR_HMARG / 2, ypos, SEQSCR_HMARG *2 / 3, ypos);
 
     // Loop Marker
     if (loopMarker) {
         QPolygon trg;
         pen.setWidth(2);
         pen.setColor(QColor(80, 250, 120));
-        p.setPen(pen);
+        p->setPen(pen);
         x = abs(loopMarker) * xscale * nsteps / npoints;
         xpos = SEQSCR_HMARG + x + pen.width() / 2;
         ypos = h - SEQSCR_VMARG_BOT;
@@ -200,7 +210,7 @@ void SeqScreen::paintEvent(QPaintEvent*)
         else
             trg << QPoint(xpos + tmpval - 2, ypos + tmpval);
         trg << QPoint(xpos, h - 2);
-        p.drawPolygon(trg, Qt::WindingFill);
+        p->drawPolygon(trg, Qt::WindingFill);
     }
 }
 
@@ -218,13 +228,14 @@ void SeqScreen::emitMouseEvent(QMouseEvent *event, int pressed)
 void SeqScreen::updateData(const QVector<Sample>& data)
 {
     p_data = data;
-    needsRedraw = true;
+    invalidate();
 }
 
 void SeqScreen::setCurrentRecStep(int recStep)
 {
+    if (recStep == currentRecStep) return;
     currentRecStep = recStep;
-    needsRedraw = true;
+    if (recordMode) invalidate();
 }
 
 void SeqScreen::setLoopMarker(int pos)
@@ -256,5 +267,6 @@ void SeqScreen::updateDispVert(int mode)
             nOctaves = 4;
             baseOctave = 3;
     }
+    invalidate();
     update();
 }
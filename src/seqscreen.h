@@ -52,10 +52,13 @@ class SeqScreen : public Screen
     QVector<Sample> p_data, data;
     int baseOctave, nOctaves;
     QPointF trg[3];
+    double xscale;
+    int yscale, nsteps, npoints;    /**< Geometry of the last drawStatic() */
     void emitMouseEvent(QMouseEvent *event, int pressed);
 
   protected:
-    virtual void paintEvent(QPaintEvent *);
+    virtual void drawStatic(QPainter *p);
+    virtual void drawDynamic(QPainter *p);
 
   public:
     SeqScreen();
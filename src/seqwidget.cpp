@@ -35,6 +35,8 @@ SeqWidget::SeqWidget(MidiSeq *p_midiSeq, GlobStore *p_globStore,
     midiSeq(p_midiSeq)
 {
     bool compactStyle = p_prefs->compactStyle;
+    moduleCore = new SeqCore(p_midiSeq, p_prefs, p_name, parStore,
+            &midiControl->ccList);
 #else
 SeqWidget::SeqWidget():
     ModuleWidget("Seq:"),
@@ -224,186 +226,6 @@ MidiSeq *SeqWidget::getMidiWorker()
 {
     return (midiSeq);
 }
-
-void SeqWidget::writeData(QXmlStreamWriter& xml)
-{
-    QByteArray tempArray;
-    int l1;
-
-        writeCommonData(xml);
-
-        xml.writeStartElement("display");
-            xml.writeTextElement("vertical", QString::number(
-                dispVertIndex));
-        xml.writeEndElement();
-
-        xml.writeStartElement("seqParams");
-            xml.writeTextElement("loopmode", QString::number(
-                loopBox->currentIndex()));
-            xml.writeTextElement("resolution", QString::number(
-                resBox->currentIndex()));
-            xml.writeTextElement("size", QString::number(
-                sizeBox->currentIndex()));
-            xml.writeTextElement("velocity", QString::number(
-                midiSeq->vel));
-            xml.writeTextElement("noteLength", QString::number(
-                tickLenToSlider(midiSeq->notelength)));
-            xml.writeTextElement("transp", QString::number(
-                midiSeq->transp));
-        xml.writeEndElement();
-
-        tempArray.clear();
-        l1 = 0;
-        while (l1 < midiSeq->maxNPoints) {
-            tempArray.append(midiSeq->muteMask.at(l1));
-            l1++;
-        }
-        xml.writeStartElement("muteMask");
-            xml.writeTextElement("data", tempArray.toHex());
-        xml.writeEndElement();
-
-        tempArray.clear();
-        l1 = 0;
-        while (l1 < midiSeq->maxNPoints) {
-            tempArray.append(midiSeq->customWave.at(l1).data);
-            l1++;
-        }
-        xml.writeStartElement("sequence");
-            xml.writeTextElement("data", tempArray.toHex());
-            xml.writeTextElement("loopmarker", QString::number(
-                getLoopMarker()));
-        xml.writeEndElement();
-
-    xml.writeEndElement();
-}
-
-void SeqWidget::readData(QXmlStreamReader& xml, const QString& qmaxVersion)
-{
-    int tmp;
-    Sample sample = {0, 0, 0, false};
-
-    while (!xml.atEnd()) {
-        xml.readNext();
-        if (xml.isEndElement())
-            break;
-            
-        readCommonData(xml);
-            
-        // Compatibility with earlier versions //
-        for (int l1 = 0; l1 < parStore->list.count(); l1++) {
-            if (qmaxVersion == "" && parStore->list[l1].res < 5) {
-                parStore->list[l1].res = mapOldSeqRes[parStore->list[l1].res];
-            }
-            if (qmaxVersion == "" && parStore->list[l1].size < 10) {
-                parStore->list[l1].size = mapOldSeqSize[parStore->list[l1].size];
-            }
-        }
-        
-        if (xml.isStartElement() && (xml.name() == "display")) {
-            while (!xml.atEnd()) {
-                xml.readNext();
-                if (xml.isEndElement())
-                    break;
-                if (xml.name() == "vertical")
-                    setDispVert(xml.readElementText().toInt());
-                else skipXmlElement(xml);
-            }
-        }
-
-        else if (xml.isStartElement() && (xml.name() == "seqParams")) {
-            while (!xml.atEnd()) {
-                xml.readNext();
-                if (xml.isEndElement())
-                    break;
-                if (xml.name() == "loopmode") {
-                    tmp = xml.readElementText().toInt();
-                    loopBox->setCurrentIndex(tmp);
-                    updateLoop(tmp);
-                }
-                else if (xml.name() == "resolution") {
-                    tmp = xml.readElementText().toInt();
-                    if (qmaxVersion == "" && tmp < 5) {
-                        tmp = mapOldSeqRes[tmp];
-                    }
-                    resBox->setCurrentIndex(tmp);
-                    updateRes(tmp);
-                }
-                else if (xml.name() == "size") {
-                    tmp = xml.readElementText().toInt();
-                    if (qmaxVersion == "" && tmp < 10) {
-                        tmp = mapOldSeqSize[tmp];
-                    }
-                    sizeBox->setCurrentIndex(tmp);
-                    updateSize(tmp);
-                }
-                else if (xml.name() == "velocity") {
-                    tmp = xml.readElementText().toInt();
-                    velocity->setValue(tmp);
-                    updateVelocity(tmp);
-                }
-                else if (xml.name() == "noteLength") {
-                    notelength->setValue(xml.readElementText().toInt());
-                }
-                else if (xml.name() == "transp") {
-                    tmp = xml.readElementText().toInt();
-                    transpose->setValue(tmp);
-                    updateTranspose(tmp);
-                }
-                else skipXmlElement(xml);
-            }
-        }
-        else if (xml.isStartElement() && (xml.name() == "muteMask")) {
-            while (!xml.atEnd()) {
-                xml.readNext();
-                if (xml.isEndElement())
-                    break;
-                if (xml.isStartElement() && (xml.name() == "data")) {
-                    QByteArray tmpArray =
-                            QByteArray::fromHex(xml.readElementText().toLatin1());
-                    for (int l1 = 0; l1 < tmpArray.count(); l1++) {
-                        midiSeq->muteMask[l1] = tmpArray.at(l1);
-                    }
-                    midiSeq->maxNPoints = tmpArray.count();
-                }
-                else skipXmlElement(xml);
-            }
-        }
-        else if (xml.isStartElement() && (xml.name() == "sequence")) {
-            while (!xml.atEnd()) {
-                xml.readNext();
-                if (xml.isEndElement())
-                    break;
-                if (xml.isStartElement() && (xml.name() == "data")) {
-                    QByteArray tmpArray =
-                            QByteArray::fromHex(xml.readElementText().toLatin1());
-                    int step = TPQN / midiSeq->res;
-                    int lt = 0;
-                    for (int l1 = 0; l1 < tmpArray.count(); l1++) {
-                        sample.data = tmpArray.at(l1);
-                        sample.tick = lt;
-                        sample.muted = midiSeq->muteMask[l1];
-                        midiSeq->customWave[l1] = sample;
-                        lt+=step;
-                    }
-                    updateWaveForm(0);
-                }
-                else if (xml.name() == "loopmarker") {
-                    tmp = xml.readElementText().toInt();
-                    midiSeq->setLoopMarker(tmp);
-                    screen->setLoopMarker(tmp);
-                }
-                else skipXmlElement(xml);
-            }
-        }
-        else skipXmlElement(xml);
-    }
-    
-    updateChIn(chIn->currentIndex());
-    updateChannelOut(channelOut->currentIndex());
-    updatePortOut(portOut->currentIndex());
-    midiSeq->needsGUIUpdate = false;
-    modified = false;
-}
 #endif
 
 void SeqWidget::updateNoteLength(int val)
@@ -519,55 +341,6 @@ void SeqWidget::updateDispVert(int mode)
 
 #ifdef APPBUILD
 
-void SeqWidget::doStoreParams(int ix)
-{
-    parStore->temp.res = resBox->currentIndex();
-    parStore->temp.size = sizeBox->currentIndex();
-    parStore->temp.loopMode = loopBox->currentIndex();
-    parStore->temp.notelen = notelength->value();
-    parStore->temp.transp = transpose->value();
-    parStore->temp.vel = velocity->value();
-    parStore->temp.dispVertIndex = dispVertIndex;
-    parStore->temp.loopMode = loopBox->currentIndex();
-    parStore->temp.wave = getCustomWave().mid(0, midiSeq->maxNPoints);
-    parStore->temp.muteMask = getMuteMask().mid(0, midiSeq->maxNPoints);
-    parStore->temp.loopMarker = getLoopMarker();
-
-    parStore->tempToList(ix);
-}
-
-void SeqWidget::doRestoreParams(int ix)
-{
-    midiSeq->applyPendingParChanges();
-    if (parStore->list.at(ix).empty) return;
-    for (int l1 = 0; l1 < parStore->list.at(ix).wave.count(); l1++) {
-        midiSeq->customWave[l1] = parStore->list.at(ix).wave.at(l1);
-        midiSeq->muteMask[l1] = parStore->list.at(ix).muteMask.at(l1);
-    }
-    sizeBoxIndex = parStore->list.at(ix).size;
-    sizeBox->setCurrentIndex(sizeBoxIndex);
-    midiSeq->size = sizeBox->currentText().toInt();
-    resBoxIndex = parStore->list.at(ix).res;
-    midiSeq->res = seqResValues[resBoxIndex];
-    midiSeq->resizeAll();
-    midiSeq->setLoopMarker(parStore->list.at(ix).loopMarker);
-    screen->setLoopMarker(parStore->list.at(ix).loopMarker);
-
-    resBox->setCurrentIndex(parStore->list.at(ix).res);
-    loopBox->setCurrentIndex(parStore->list.at(ix).loopMode);
-    if (!parStore->onlyPatternList.at(ix)) {
-        midiSeq->notelength = sliderToTickLen(parStore->list.at(ix).notelen);
-        midiSeq->transp = parStore->list.at(ix).transp;
-        midiSeq->vel = parStore->list.at(ix).vel;
-        setDispVert(parStore->list.at(ix).dispVertIndex);
-    }
-    updateLoop(parStore->list.at(ix).loopMode);
-    updateWaveForm(parStore->list.at(ix).waveForm);
-    midiSeq->setFramePtr(0);
-    
-    needsGUIUpdate = true;
-}
-
 void SeqWidget::copyParamsFrom(ModuleWidget *p_fromWidget)
 {
     SeqWidget *fromWidget = (SeqWidget *)p_fromWidget;
@@ -617,10 +390,8 @@ void SeqWidget::copyParamsFrom(ModuleWidget *p_fromWidget)
     transpose->setValue(tmp);
 
     notelength->setValue(fromWidget->notelength->value());
-    for (int l1 = 0; l1 < fromWidget->getMidiWorker()->maxNPoints; l1++) {
-        midiSeq->customWave[l1] = fromWidget->getCustomWave().at(l1);
-        midiSeq->muteMask[l1] = midiSeq->customWave.at(l1).muted;
-    }
+    midiSeq->customWave = fromWidget->getCustomWave();
+    midiSeq->maxNPoints = fromWidget->getMidiWorker()->maxNPoints;
     tmp = fromWidget->getLoopMarker();
     midiSeq->setLoopMarker(tmp);
     screen->setLoopMarker(tmp);
@@ -629,160 +400,59 @@ void SeqWidget::copyParamsFrom(ModuleWidget *p_fromWidget)
     updateWaveForm(0);
 }
 
-QVector<Sample> SeqWidget::getCustomWave()
+CompactWave SeqWidget::getCustomWave()
 {
-    return QVector<Sample>::fromStdVector(midiSeq->customWave);
+    return midiSeq->customWave;
 }
 
-QVector<bool> SeqWidget::getMuteMask()
+void SeqWidget::updateScreen(bool newData)
 {
-    return QVector<bool>::fromStdVector(midiSeq->muteMask);
-}
-
-void SeqWidget::handleController(int ccnumber, int channel, int value)
-{
-    QVector<MidiCC> cclist= midiControl->ccList;
-
-    for (int l2 = 0; l2 < cclist.count(); l2++) {
-        int min = cclist.at(l2).min;
-        int max = cclist.at(l2).max;
-        if ((ccnumber == cclist.at(l2).ccnumber) &&
-            (channel == cclist.at(l2).channel)) {
-            int sval = 0;
-            bool m = false;
-            switch (cclist.at(l2).ID) {
-                case MUTE_BUTTON: if (min == max) {
-                            if (value == max) {
-                                m = midiSeq->isMuted;
-                                midiSeq->setMuted(!m);
-                            }
-                        }
-                        else {
-                            if (value == max) {
-                                midiSeq->setMuted(false);
-                            }
-                            if (value == min) {
-                                midiSeq->setMuted(true);
-                            }
-                        }
-                break;
-
-                case SEQ_VELOCITY:
-                        sval = min + ((double)value * (max - min) / 127);
-                        midiSeq->updateVelocity(sval);
-                break;
-
-                case SEQ_NOTE_LENGTH:
-                        sval = min + ((double)value * (max - min) / 127);
-                        midiSeq->updateNoteLength(sliderToTickLen(sval));
-                break;
-
-                case SEQ_RECORD: if (min == max) {
-                            if (value == max) {
-                                m = midiSeq->recordMode;
-                                midiSeq->setRecordMode(!m);
-                                return;
-                            }
-                        }
-                        else {
-                            if (value == max) {
-                                midiSeq->setRecordMode(true);
-                            }
-                            if (value == min) {
-                                midiSeq->setRecordMode(false);
-                            }
-                        }
-                break;
-                case SEQ_RESOLUTION:
-                        sval = min + ((double)value * (max - min) / 127);
-                        if ((uint64_t)sval < sizeof(seqResValues)/sizeof(seqResValues[0])) resBoxIndex = sval;
-                break;
-                case SEQ_SIZE:
-                        sval = min + ((double)value * (max - min) / 127);
-                        if ((uint64_t)sval < sizeof(seqSizeValues)/sizeof(seqResValues[0])) sizeBoxIndex = sval;
-                break;
-                case SEQ_LOOP_MODE:
-                        sval = min + ((double)value * (max - min) / 127);
-                        if (sval < 6) midiSeq->curLoopMode = sval;
-                break;
-                case PARAM_RESTORE:
-                        sval = min + ((double)value * (max - min) / 127);
-                        if ((sval < parStore->list.count())
-                                && (sval != parStore->activeStore)
-                                && (sval != parStore->currentRequest)) {
-                            parStore->requestDispState(sval, 2);
-                            parStore->restoreRequest = sval;
-                            parStore->restoreRunOnce = (parStore->jumpToList.at(sval) > -2);
-                        }
-                        else return;
-                break;
-
-                case SEQ_TRANSPOSE:
-                        sval = min + ((double)value * (max - min) / 127);
-                        midiSeq->updateTranspose(sval - 36);
-                break;
-                
-                case SEQ_CHANNEL_OUT:
-                        sval = min + ((double)value * (max - min) / 127);
-                        if (sval < 16) midiSeq->channelOut = sval;
-                break;
-
-                default:
-                break;
-            }
-            needsGUIUpdate = true;
-        }
+    if (newData) {
+        data = QVector<Sample>::fromStdVector(moduleCore->data);
+        screen->updateData(data);
+        if (recordMode) screen->setCurrentRecStep(midiSeq->currentRecStep);
+        cursor->updateNumbers(midiSeq->res, midiSeq->size);
     }
+    screen->updateDraw();
+    cursor->updateDraw();
 }
 
-void SeqWidget::updateDisplay()
+void SeqWidget::updateWidgets()
 {
-    QVector<Sample> data;
-    std::vector<Sample> sdata;
+    ModuleWidget::updateWidgets();
 
-    bool repetitionsFinished = (midiSeq->currentRepetition == 0);
-    if (midiSeq->reverse) {
-        repetitionsFinished = (midiSeq->currentRepetition >= midiSeq->nRepetitions - 1);
-    }
-    parStore->updateDisplay(getFramePtr(), midiSeq->nPoints, repetitionsFinished, midiSeq->reverse);
-    if (parStore->nRepList.count() > 0) {
-        if (parStore->nRepList.at(parStore->activeStore) != midiSeq->nRepetitions) {
-            updateNRep(parStore->nRepList.at(parStore->activeStore));
-        }
-    }
+    resBoxIndex = ModuleCore::tableIndex(seqResValues, 13, midiSeq->res, 3);
+    sizeBoxIndex = ModuleCore::tableIndex(seqSizeValues, 20, midiSeq->size, 3);
+    resBox->setCurrentIndex(resBoxIndex);
+    sizeBox->setCurrentIndex(sizeBoxIndex);
+    loopBox->setCurrentIndex(midiSeq->curLoopMode);
 
-    if (dataChanged || midiSeq->dataChanged) {
-        dataChanged=false;
-        midiSeq->dataChanged=false;
-        midiSeq->getData(&sdata);
-        data = QVector<Sample>::fromStdVector(sdata);
-        screen->updateData(data);
-        if (recordMode) screen->setCurrentRecStep(midiSeq->currentRecStep);
-        cursor->updateNumbers(midiSeq->res, midiSeq->size);
+    Slider *sliders[3] = { velocity, notelength, transpose };
+    const int sliderValues[3] = { midiSeq->velDefer,
+            tickLenToSlider(midiSeq->notelengthDefer), midiSeq->transpDefer };
+    for (int l1 = 0; l1 < 3; l1++) {
+        sliders[l1]->blockSignals(true);
+        sliders[l1]->setValue(sliderValues[l1]);
+        sliders[l1]->blockSignals(false);
     }
-    screen->updateDraw();
-    cursor->updateDraw();
-    midiControl->update();
 
-    if (!(needsGUIUpdate || midiSeq->needsGUIUpdate)) return;
+    if (midiSeq->dispVertIndex != dispVertIndex) {
+        dispVertIndex = midiSeq->dispVertIndex;
+        for (int l1 = 0; l1 < 4; l1++) dispVert[l1]->blockSignals(true);
+        dispVert[dispVertIndex]->setChecked(true);
+        for (int l1 = 0; l1 < 4; l1++) dispVert[l1]->blockSignals(false);
+        screen->updateDispVert(dispVertIndex);
+    }
+    screen->setLoopMarker(midiSeq->loopMarker);
 
-    transpose->setValue(midiSeq->transp);
-    notelength->setValue(tickLenToSlider(midiSeq->notelength));
-    velocity->setValue(midiSeq->vel);
-    muteOut->setChecked(midiSeq->isMuted);
+    recordMode = midiSeq->recordMode;
+    recordAction->blockSignals(true);
+    recordAction->setChecked(recordMode);
+    recordAction->blockSignals(false);
+    screen->setRecordMode(recordMode);
     screen->newGrooveValues(midiSeq->newGrooveTick, midiSeq->grooveVelocity,
                 midiSeq->grooveLength);
     screen->setMuted(midiSeq->isMuted);
-    parStore->ndc->setMuted(midiSeq->isMuted);
-    recordAction->setChecked(midiSeq->recordMode);
-    resBox->setCurrentIndex(resBoxIndex);
-    updateRes(resBoxIndex);
-    sizeBox->setCurrentIndex(sizeBoxIndex);
-    updateSize(sizeBoxIndex);
-    loopBox->setCurrentIndex(midiSeq->curLoopMode);
-    channelOut->setCurrentIndex(midiSeq->channelOut);
-    needsGUIUpdate = false;
-    midiSeq->needsGUIUpdate = false;
 }
 
 #endif
@@ -88,8 +88,7 @@ class SeqWidget : public ModuleWidget
     int resBoxIndex;
     int sizeBoxIndex;
 
-    QVector<Sample> getCustomWave();
-    QVector<bool> getMuteMask();
+    CompactWave getCustomWave();
 
 /*!
  * @brief ENUM for Internal MIDI Control IDs supported 
@@ -115,21 +114,6 @@ class SeqWidget : public ModuleWidget
     MidiSeq *getMidiWorker();
 
 /*!
-* @brief reads all parameters of this module from an XML stream
-* passed by the caller, i.e. MainWindow.
-*
-* @param xml QXmlStreamWriter to read from
-* @param qMaxVersion QString with xml format version
-*/
-    void readData(QXmlStreamReader& xml, const QString& qmaxVersion) override;
-/*!
-* @brief writes all parameters of this module to an XML stream
-* passed by the caller, i.e. MainWindow.
-*
-* @param xml QXmlStreamWriter to write to
-*/
-    void writeData(QXmlStreamWriter& xml) override;
-/*!
 * @brief copies all Seq module GUI parameters from
 * fromWidget
 *
@@ -137,11 +121,9 @@ class SeqWidget : public ModuleWidget
 */
     void copyParamsFrom(ModuleWidget *fromWidget) override;
 
-    void doStoreParams(int ix);
-    void doRestoreParams(int ix);
-    void updateDisplay();
-    void handleController(int ccnumber, int channel, int value);
-    void updateCursorPos() {cursor->updatePosition(getFramePtr()); }
+    void updateWidgets() override;
+    void updateScreen(bool newData) override;
+    void updateCursorPos(int pos) { cursor->updatePosition(pos); }
 #endif
 
 /* SIGNALS */
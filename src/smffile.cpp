@@ -0,0 +1,298 @@
+/*!
+ * @file smffile.cpp
+ * @brief Implementation of the SmfFile class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#include <algorithm>
+#include <QFile>
+
+#include "smffile.h"
+
+
+static bool tickLess(const SmfFile::Event& a, const SmfFile::Event& b)
+{
+    return (a.tick < b.tick);
+}
+
+static uint32_t readBE(const QByteArray& in, int pos, int count)
+{
+    uint32_t value = 0;
+    for (int l1 = 0; l1 < count; l1++) {
+        value = (value << 8) | (unsigned char)in.at(pos + l1);
+    }
+    return value;
+}
+
+SmfFile::SmfFile(int p_division)
+{
+    division = p_division;
+}
+
+bool SmfFile::read(const QString& fn)
+{
+    QFile f(fn);
+    if (!f.open(QIODevice::ReadOnly)) {
+        errorString = "Could not open file";
+        return false;
+    }
+    const QByteArray in = f.readAll();
+
+    events.clear();
+    if ((in.size() < 14) || !in.startsWith("MThd")) {
+        errorString = "Not a Standard MIDI File";
+        return false;
+    }
+    const uint32_t header_len = readBE(in, 4, 4);
+    const int format = readBE(in, 8, 2);
+    division = readBE(in, 12, 2);
+    if (format > 1) {
+        errorString = "Format 2 files are not supported";
+        return false;
+    }
+    if ((division & 0x8000) || !division) {
+        errorString = "SMPTE time division is not supported";
+        return false;
+    }
+
+    int pos = 8 + header_len;
+    while (pos + 8 <= in.size()) {
+        const uint32_t len = readBE(in, pos + 4, 4);
+        if ((uint32_t)(in.size() - pos - 8) < len) {
+            errorString = "Truncated track";
+            return false;
+        }
+        if (in.mid(pos, 4) == "MTrk") {
+            if (!readTrack(in.mid(pos + 8, len))) {
+                errorString = "Corrupt track";
+                return false;
+            }
+        }
+        pos += 8 + len;
+    }
+    std::stable_sort(events.begin(), events.end(), tickLess);
+    return true;
+}
+
+bool SmfFile::readTrack(const QByteArray& track)
+{
+    const int size = track.size();
+    uint64_t tick = 0;
+    int running = 0;
+    int pos = 0;
+
+    while (pos < size) {
+        uint32_t delta = 0;
+        unsigned char c;
+        do {
+            if (pos >= size) return false;
+            c = track.at(pos++);
+            delta = (delta << 7) | (c & 0x7f);
+        } while (c & 0x80);
+        tick += delta;
+
+        if (pos >= size) return false;
+        int status = (unsigned char)track.at(pos);
+
+        if ((status == 0xff) || (status == 0xf0) || (status == 0xf7)) {
+            int type = 0;
+            pos++;
+            if (status == 0xff) {
+                if (pos >= size) return false;
+                type = (unsigned char)track.at(pos++);
+            }
+            uint32_t len = 0;
+            do {
+                if (pos >= size) return false;
+                c = track.at(pos++);
+                len = (len << 7) | (c & 0x7f);
+            } while (c & 0x80);
+            if ((uint32_t)(size - pos) < len) return false;
+
+            if ((status == 0xff) && (type == 0x51) && (len == 3)) {
+                Event ev;
+                ev.tick = tick;
+                ev.port = -1;
+                ev.data = track.mid(pos, 3);
+                events.append(ev);
+            }
+            pos += len;
+            if ((status == 0xff) && (type == 0x2f)) break;
+            /* meta and sysex events cancel the running status */
+            running = 0;
+            continue;
+        }
+
+        if (status & 0x80) {
+            pos++;
+            running = status;
+        }
+        else if (running) {
+            status = running;
+        }
+        else return false;
+
+        const int datalen = (((status & 0xf0) == 0xc0)
+                || ((status & 0xf0) == 0xd0)) ? 1 : 2;
+        if (pos + datalen > size) return false;
+
+        Event ev;
+        ev.tick = tick;
+        ev.port = 0;
+        ev.data.append((char)status);
+        ev.data.append(track.mid(pos, datalen));
+        events.append(ev);
+        pos += datalen;
+    }
+    return true;
+}
+
+void SmfFile::appendMessage(uint64_t tick, int port, const unsigned char *data, int size)
+{
+    Event ev;
+    ev.tick = tick;
+    ev.port = port;
+    ev.data = QByteArray((const char *)data, size);
+    events.append(ev);
+}
+
+void SmfFile::appendTempo(uint64_t tick, double bpm)
+{
+    const uint32_t us = (bpm > 0.) ? (uint32_t)(60000000. / bpm + .5) : 500000;
+    Event ev;
+    ev.tick = tick;
+    ev.port = -1;
+    ev.data.append((char)((us >> 16) & 0xff));
+    ev.data.append((char)((us >> 8) & 0xff));
+    ev.data.append((char)(us & 0xff));
+    events.append(ev);
+}
+
+double SmfFile::tempoOf(const Event& ev)
+{
+    const uint32_t us = readBE(ev.data, 0, 3);
+    return us ? 60000000. / us : 120.;
+}
+
+bool SmfFile::write(const QString& fn)
+{
+    QList<Event> sorted = events;
+    std::stable_sort(sorted.begin(), sorted.end(), tickLess);
+
+    int maxPort = -1;
+    for (int l1 = 0; l1 < sorted.count(); l1++) {
+        if (sorted.at(l1).port > maxPort) maxPort = sorted.at(l1).port;
+    }
+
+    QList<Event> trackEvents;
+    QByteArray tracks;
+    int trackCount = 0;
+
+    for (int port = -1; port <= maxPort; port++) {
+        trackEvents.clear();
+        for (int l1 = 0; l1 < sorted.count(); l1++) {
+            if (sorted.at(l1).port == port) trackEvents.append(sorted.at(l1));
+        }
+        /* the tempo track is always written */
+        if ((port >= 0) && trackEvents.isEmpty()) continue;
+        writeTrack(tracks, trackEvents, port);
+        trackCount++;
+    }
+
+    QByteArray out("MThd");
+    append32(out, 6);
+    out.append((char)0);
+    out.append((char)1);
+    out.append((char)((trackCount >> 8) & 0xff));
+    out.append((char)(trackCount & 0xff));
+    out.append((char)((division >> 8) & 0x7f));
+    out.append((char)(division & 0xff));
+    out.append(tracks);
+
+    QFile f(fn);
+    if (!f.open(QIODevice::WriteOnly)) {
+        errorString = "Could not open file for writing";
+        return false;
+    }
+    if (f.write(out) != out.size()) {
+        errorString = "Could not write file";
+        return false;
+    }
+    return true;
+}
+
+void SmfFile::writeTrack(QByteArray& out, const QList<Event>& trackEvents,
+        int port)
+{
+    QByteArray data;
+    uint64_t lastTick = 0;
+
+    if (port >= 0) {
+        /* MIDI port meta event */
+        appendVarLen(data, 0);
+        data.append((char)0xff);
+        data.append((char)0x21);
+        data.append((char)1);
+        data.append((char)port);
+    }
+    for (int l1 = 0; l1 < trackEvents.count(); l1++) {
+        const Event& ev = trackEvents.at(l1);
+        appendVarLen(data, (uint32_t)(ev.tick - lastTick));
+        lastTick = ev.tick;
+        if (port < 0) {
+            data.append((char)0xff);
+            data.append((char)0x51);
+            data.append((char)3);
+        }
+        data.append(ev.data);
+    }
+    /* end of track */
+    appendVarLen(data, 0);
+    data.append((char)0xff);
+    data.append((char)0x2f);
+    data.append((char)0);
+
+    out.append("MTrk");
+    append32(out, data.size());
+    out.append(data);
+}
+
+void SmfFile::appendVarLen(QByteArray& out, uint32_t value)
+{
+    unsigned char buf[5];
+    int count = 0;
+
+    buf[count++] = value & 0x7f;
+    while (value >>= 7) {
+        buf[count++] = (value & 0x7f) | 0x80;
+    }
+    while (count) {
+        out.append((char)buf[--count]);
+    }
+}
+
+void SmfFile::append32(QByteArray& out, uint32_t value)
+{
+    out.append((char)((value >> 24) & 0xff));
+    out.append((char)((value >> 16) & 0xff));
+    out.append((char)((value >> 8) & 0xff));
+    out.append((char)(value & 0xff));
+}
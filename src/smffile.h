@@ -0,0 +1,92 @@
+/*!
+ * @file smffile.h
+ * @brief Header for the SmfFile class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#ifndef SMFFILE_H
+#define SMFFILE_H
+
+#include <stdint.h>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+/*!
+ * The SmfFile class holds the events of a Standard MIDI File. read()
+ * accepts files of format 0 and 1 and merges all tracks into one event
+ * list ordered by tick, keeping channel messages and tempo changes.
+ * write() writes a format 1 file with the tempo changes in the first
+ * track and one track for each output port holding events, marked by
+ * a MIDI port meta event.
+ *
+ * @brief Minimal reader and writer of Standard MIDI Files
+ */
+class SmfFile
+{
+  public:
+    /*! @brief MIDI message or tempo change at a tick */
+    struct Event {
+        uint64_t tick;
+        int port;           /**< Output port, -1 for tempo changes */
+        QByteArray data;    /**< Status and data bytes, for tempo
+                              changes the three tempo bytes */
+    };
+
+    SmfFile(int p_division = 192);
+
+    int division;           /**< Ticks per quarter note */
+    QList<Event> events;    /**< Events ordered by tick after read() */
+    QString errorString;    /**< Reason of the last read() or write() failure */
+
+/*!
+* @brief reads the events of a file, replacing the current ones
+*
+* @param fn Path of the file
+* @return False if the file could not be read or is not supported
+*/
+    bool read(const QString& fn);
+/*!
+* @brief writes the events to a file
+*
+* The events do not need to be ordered, events of the same port and tick
+* keep their order.
+*
+* @param fn Path of the file
+* @return False if the file could not be written
+*/
+    bool write(const QString& fn);
+/*! @brief appends a MIDI message of up to three bytes */
+    void appendMessage(uint64_t tick, int port, const unsigned char *data, int size);
+/*! @brief appends a tempo change in beats per minute */
+    void appendTempo(uint64_t tick, double bpm);
+/*! @brief returns the tempo change in beats per minute of an event */
+    static double tempoOf(const Event& ev);
+
+  private:
+    bool readTrack(const QByteArray& track);
+    static void appendVarLen(QByteArray& out, uint32_t value);
+    static void append32(QByteArray& out, uint32_t value);
+    static void writeTrack(QByteArray& out, const QList<Event>& trackEvents,
+            int port);
+};
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * @file statswidget.cpp
+ * @brief Implements the StatsWidget class displaying the realtime statistics.
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#include <QBoxLayout>
+#include <QHeaderView>
+#include <QPushButton>
+
+#include "statswidget.h"
+
+
+StatsWidget::StatsWidget(Engine *p_engine, QWidget *parent) : QWidget(parent)
+{
+    engine = p_engine;
+
+    statsTable = new QTableWidget(0, 6, this);
+    statsTable->setHorizontalHeaderLabels(QStringList() << tr("Measure")
+            << tr("Count") << tr("Mean") << tr("50 %") << tr("99 %")
+            << tr("Max"));
+    statsTable->verticalHeader()->hide();
+    statsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    statsTable->setSelectionMode(QAbstractItemView::NoSelection);
+    statsTable->setToolTip(tr("Times in microseconds, lateness in frames "
+                "between scheduled and emitted position"));
+
+    overflowLabel = new QLabel(this);
+
+    QPushButton *resetButton = new QPushButton(tr("&Reset"), this);
+    QObject::connect(resetButton, SIGNAL(clicked()), this, SLOT(resetStats()));
+    QHBoxLayout *buttonBoxLayout = new QHBoxLayout;
+    buttonBoxLayout->addWidget(overflowLabel);
+    buttonBoxLayout->addStretch(10);
+    buttonBoxLayout->addWidget(resetButton);
+
+    QVBoxLayout *statsBoxLayout = new QVBoxLayout;
+    statsBoxLayout->addWidget(statsTable);
+    statsBoxLayout->addLayout(buttonBoxLayout);
+    setLayout(statsBoxLayout);
+
+    updateTimer = new QTimer(this);
+    connect(updateTimer, SIGNAL(timeout()), this, SLOT(updateStats()));
+    updateTimer->start(500);
+}
+
+void StatsWidget::setRow(int row, const QString& name,
+        const RtHistogram& histogram, double scale)
+{
+    RtHistogram::Snapshot s;
+    histogram.getSnapshot(&s);
+
+    QStringList values;
+    values << name << QString::number(s.count)
+        << QString::number(s.mean() * scale, 'f', 1)
+        << QString::number(s.percentile(.5) * scale, 'f', 1)
+        << QString::number(s.percentile(.99) * scale, 'f', 1)
+        << QString::number(s.max * scale, 'f', 1);
+
+    for (int l1 = 0; l1 < values.count(); l1++) {
+        QTableWidgetItem *item = statsTable->item(row, l1);
+        if (!item) {
+            item = new QTableWidgetItem;
+            if (l1) item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            statsTable->setItem(row, l1, item);
+        }
+        item->setText(values.at(l1));
+    }
+}
+
+void StatsWidget::updateStats()
+{
+    if (!isVisible()) return;
+
+    const RtStats& stats = engine->driver->rtStats;
+    const int count = engine->moduleWidgetCount();
+    statsTable->setRowCount(4 + 2 * count);
+
+    setRow(0, tr("Period callback"), stats.period, 1e-3);
+    setRow(1, tr("Echo callback"), stats.echo, 1e-3);
+    setRow(2, tr("Output queue depth"), stats.queueDepth, 1);
+    setRow(3, tr("Lateness"), stats.lateness, 1);
+    for (int l1 = 0; l1 < count; l1++) {
+        ModuleWidget *moduleWidget = engine->moduleWidget(l1);
+        setRow(4 + 2 * l1, tr("%1 frame").arg(moduleWidget->name),
+                moduleWidget->midiWorker->frameTime, 1e-3);
+        setRow(5 + 2 * l1, tr("%1 input").arg(moduleWidget->name),
+                moduleWidget->midiWorker->eventTime, 1e-3);
+    }
+
+    overflowLabel->setText(tr("Queue overflows: %1 output, %2 echo")
+            .arg(stats.eventOverflows.load(std::memory_order_relaxed))
+            .arg(stats.echoOverflows.load(std::memory_order_relaxed)));
+}
+
+void StatsWidget::resetStats()
+{
+    engine->resetRtStats();
+    updateStats();
+}
@@ -0,0 +1,64 @@
+/**
+ * @file statswidget.h
+ * @brief Member definitions for the StatsWidget QWidget class.
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+#ifndef STATSWIDGET_H
+#define STATSWIDGET_H
+
+#include <QLabel>
+#include <QTableWidget>
+#include <QTimer>
+
+#include "engine.h"
+
+/*!
+ * @brief Creates a QWidget displaying the timing statistics of the
+ * realtime path.
+ *
+ * The StatsWidget is instantiated by MainWindow on program start. It is
+ * embedded in a DockWindow and shown/hidden by a MainWindow menu entry.
+ * While visible, it reads the histograms of DriverBase::rtStats and of
+ * each MidiWorker twice a second and shows their count, mean,
+ * percentiles and maximum in a table, as well as the queue overflows.
+ */
+class StatsWidget : public QWidget
+
+{
+  Q_OBJECT
+
+  private:
+    Engine *engine;
+    QTableWidget *statsTable;
+    QLabel *overflowLabel;
+    QTimer *updateTimer;
+    void setRow(int row, const QString& name, const RtHistogram& histogram,
+            double scale);
+
+  public:
+    StatsWidget(Engine *p_engine, QWidget* parent=0);
+
+  public slots:
+    void updateStats();
+    void resetStats();
+};
+
+#endif
@@ -0,0 +1,141 @@
+/*!
+ * @file tickqueue.h
+ * @brief Implementation of the TickQueue template
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#ifndef TICKQUEUE_H
+#define TICKQUEUE_H
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief Template class implementing a fixed-capacity queue of items
+ * ordered by their scheduled tick
+ *
+ * The queue is a binary min-heap whose storage is allocated once by the
+ * constructor, so that push() and pop() can be called from a realtime
+ * thread without allocating. Both operations are O(log n), the earliest
+ * item is accessed in O(1) by next() and nextTick().
+ *
+ * Items scheduled at the same tick leave the queue by ascending rank,
+ * and in the order they were pushed if their rank is equal.
+ */
+template <typename T>
+class TickQueue
+{
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param capacity Maximum number of items the queue can hold
+     */
+    TickQueue(int capacity) : m_heap(capacity), m_count(0), m_seq(0) {}
+
+    /**
+     * @brief Schedule an item at a given tick
+     *
+     * @param tick Tick at which the item is due
+     * @param item The item to schedule
+     * @param rank Order among items at the same tick, lower first
+     * @retval true the item was queued
+     * @retval false the queue is full, the item was discarded
+     */
+    bool push(uint64_t tick, const T& item, int rank = 0)
+    {
+        if (m_count >= (int)m_heap.size()) return false;
+
+        Entry entry;
+        entry.tick = tick;
+        entry.rank = rank;
+        entry.seq = m_seq++;
+        entry.item = item;
+
+        int idx = m_count++;
+        while (idx) {
+            int parent = (idx - 1) / 2;
+            if (!before(entry, m_heap[parent])) break;
+            m_heap[idx] = m_heap[parent];
+            idx = parent;
+        }
+        m_heap[idx] = entry;
+        return true;
+    }
+
+    /**
+     * @brief Remove the earliest item from the queue
+     */
+    void pop()
+    {
+        if (!m_count) return;
+
+        m_count--;
+        if (!m_count) return;
+
+        const Entry last = m_heap[m_count];
+        int idx = 0;
+        for (;;) {
+            int child = 2 * idx + 1;
+            if (child >= m_count) break;
+            if ((child + 1 < m_count) && before(m_heap[child + 1], m_heap[child]))
+                child++;
+            if (!before(m_heap[child], last)) break;
+            m_heap[idx] = m_heap[child];
+            idx = child;
+        }
+        m_heap[idx] = last;
+    }
+
+    /** @brief Remove all items from the queue */
+    void clear() { m_count = 0; }
+
+    /** @brief The earliest item, only valid if the queue is not empty */
+    const T& next() const { return m_heap[0].item; }
+
+    /** @brief Tick of the earliest item, only valid if the queue is not empty */
+    uint64_t nextTick() const { return m_heap[0].tick; }
+
+    bool isEmpty() const { return !m_count; }
+    int count() const { return m_count; }
+    int capacity() const { return m_heap.size(); }
+
+private:
+    struct Entry {
+        uint64_t tick;
+        int rank;
+        uint64_t seq;
+        T item;
+    };
+
+    static bool before(const Entry& a, const Entry& b)
+    {
+        if (a.tick != b.tick) return (a.tick < b.tick);
+        if (a.rank != b.rank) return (a.rank < b.rank);
+        return (a.seq < b.seq);
+    }
+
+    std::vector<Entry> m_heap;
+    int m_count;
+    uint64_t m_seq;
+};
+
+#endif
@@ -0,0 +1,204 @@
+/*!
+ * @file timebase.h
+ * @brief Implementation of the TimeBase class
+ *
+ *
+ *      Copyright 2009 - 2021 <qmidiarp-devel@lists.sourceforge.net>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ *
+ */
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "main.h"
+
+/*! @brief Converts between sequencer ticks and backend time positions
+ *
+ * A backend position is counted in units of the backend, which are
+ * audio frames for JACK and the LV2 plugins, and nanoseconds for the
+ * ALSA queue. The rate of the backend is given in units per minute.
+ *
+ * The tempo is held as an integer number of ticks per minute, i.e. in
+ * fixed-point with a resolution of 1/TPQN bpm, and all conversions are
+ * done in 64-bit integer arithmetic, so that no rounding error
+ * accumulates over time.
+ *
+ * TimeBase keeps a small map of tempo changes. Each entry anchors a
+ * tempo at a tick and a position, so that ticks scheduled before a
+ * tempo change still convert to the position they had when they were
+ * scheduled. When the map is full, the oldest entry is dropped.
+ *
+ * posToTick() rounds down and tickToPos() rounds up, so that
+ * tickToPos() returns the first position at which posToTick() reaches
+ * the given tick.
+ */
+class TimeBase
+{
+  public:
+    enum { MAX_SEGMENTS = 16 };
+
+  private:
+    struct Segment {
+        uint64_t tick;
+        uint64_t pos;
+        uint64_t tpm;
+    };
+
+    Segment segments[MAX_SEGMENTS];
+    int first;
+    int count;
+    uint64_t m_rate;
+
+    const Segment& segment(int index) const
+    {
+        return segments[(first + index) % MAX_SEGMENTS];
+    }
+
+    const Segment& segmentAtPos(uint64_t pos) const
+    {
+        int l1 = count - 1;
+        while (l1 && (segment(l1).pos > pos)) l1--;
+        return segment(l1);
+    }
+
+    const Segment& segmentAtTick(uint64_t tick) const
+    {
+        int l1 = count - 1;
+        while (l1 && (segment(l1).tick > tick)) l1--;
+        return segment(l1);
+    }
+
+  public:
+    /*!
+     * @param units_per_minute Rate of the backend positions
+     * @param bpm Initial tempo
+     */
+    TimeBase(uint64_t units_per_minute = 60000000000ULL, double bpm = 120.)
+    {
+        m_rate = units_per_minute ? units_per_minute : 1;
+        reset(bpm);
+    }
+
+    /*! @brief Convert a tempo in bpm to ticks per minute */
+    static uint64_t tpmFromTempo(double bpm)
+    {
+        if (bpm < 1.) bpm = 1.;
+        if (bpm > 1000.) bpm = 1000.;
+        return (uint64_t)(bpm * TPQN + .5);
+    }
+
+    /*!
+     * @brief Compute a * b / c, rounded down, without intermediate
+     * overflow as long as (c - 1) * b fits into 64 bits
+     *
+     * @param rem If not NULL, receives the remainder of the division
+     */
+    static uint64_t mulDiv(uint64_t a, uint64_t b, uint64_t c,
+            uint64_t *rem = NULL)
+    {
+        const uint64_t r = (a % c) * b;
+        if (rem) *rem = r % c;
+        return (a / c) * b + r / c;
+    }
+
+    /*! @brief Change the rate of the backend and clear the tempo map */
+    void setRate(uint64_t units_per_minute)
+    {
+        const double bpm = tempo();
+        m_rate = units_per_minute ? units_per_minute : 1;
+        reset(bpm);
+    }
+
+    uint64_t rate() const { return m_rate; }
+
+    /*! @brief Clear the tempo map and anchor bpm at tick and pos */
+    void reset(double bpm, uint64_t tick = 0, uint64_t pos = 0)
+    {
+        first = 0;
+        count = 1;
+        segments[0].tick = tick;
+        segments[0].pos = pos;
+        segments[0].tpm = tpmFromTempo(bpm);
+    }
+
+    /*!
+     * @brief Change the tempo to bpm from the given tick and position on
+     *
+     * Entries of the map at or after the new anchor are discarded, an
+     * anchor equal to the last one only replaces its tempo.
+     */
+    void setTempoAt(double bpm, uint64_t tick, uint64_t pos)
+    {
+        while ((count > 1) && ((segment(count - 1).tick >= tick)
+                || (segment(count - 1).pos >= pos))) count--;
+
+        if ((segment(count - 1).tick >= tick)
+                || (segment(count - 1).pos >= pos)) {
+            count = 0;
+            first = 0;
+        }
+        else if (count == MAX_SEGMENTS) {
+            first = (first + 1) % MAX_SEGMENTS;
+            count--;
+        }
+
+        Segment &seg = segments[(first + count) % MAX_SEGMENTS];
+        seg.tick = tick;
+        seg.pos = pos;
+        seg.tpm = tpmFromTempo(bpm);
+        count++;
+    }
+
+    /*! @brief Change the tempo to bpm from position pos on */
+    void setTempo(double bpm, uint64_t pos)
+    {
+        setTempoAt(bpm, posToTick(pos), pos);
+    }
+
+    /*! @brief Tempo of the most recent map entry in bpm */
+    double tempo() const
+    {
+        return (double)segment(count - 1).tpm / TPQN;
+    }
+
+    uint64_t anchorTick() const { return segment(count - 1).tick; }
+    uint64_t anchorPos() const { return segment(count - 1).pos; }
+
+    /*! @brief Tick at a backend position, rounded down */
+    uint64_t posToTick(uint64_t pos) const
+    {
+        const Segment &seg = segmentAtPos(pos);
+        if (pos <= seg.pos) return seg.tick;
+        return seg.tick + mulDiv(pos - seg.pos, seg.tpm, m_rate);
+    }
+
+    /*! @brief First backend position at which tick is reached */
+    uint64_t tickToPos(uint64_t tick) const
+    {
+        const Segment &seg = segmentAtTick(tick);
+        if (tick <= seg.tick) return seg.pos;
+        uint64_t rem;
+        uint64_t dpos = mulDiv(tick - seg.tick, m_rate, seg.tpm, &rem);
+        if (rem) dpos++;
+        return seg.pos + dpos;
+    }
+};
+
+#endif